@@ -0,0 +1,142 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Hands the result of an update which runs in the background, e.g. the GPU resources created for a scene, to the render thread,
+// without the render thread ever waiting for the update or for a lock.
+//
+// Any thread sets the source to update from. The render thread starts an update for the latest source with BeginUpdate() once the
+// previous update is done, and takes the latest published result with GetResult(). Results never change once published, so the render
+// thread keeps using the one it took while the next one is built, and frees it by dropping its reference. There are only ever two:
+// the published one and the one being built.
+//
+// The lock only orders publishing against Reset(), which leaves a running update stale, so that it doesn't publish its result anymore.
+template <typename Source, typename Result>
+class AsyncUpdatePublisher
+{
+public:
+    struct Update
+    {
+        uint32_t id = 0;
+        std::shared_ptr<const Source> source;
+    };
+
+    // Any thread: the source for the next update, or nullptr to stop updating and keep the current result.
+    void SetSource(std::shared_ptr<const Source> source)
+    {
+        m_source.store(std::move(source));
+    }
+
+    // Render thread: returns true and sets update if the source changed since the last update was started and no update is running.
+    // The caller then has to run the update and call Publish() with its id, even if it fails. Never waits.
+    bool BeginUpdate(Update& update)
+    {
+        // The id is read before the source, so that an update of a source cleared by Reset() is stale and never publishes its result.
+        const uint32_t updateId = m_updateId;
+        std::shared_ptr<const Source> source = m_source.load();
+        if (source == m_updatedSource || m_updating.exchange(true))
+        {
+            return false;
+        }
+
+        if (updateId != m_updateId)
+        {
+            // Reset() ran in the meantime and may have cleared the flag before it was set here, so try again with the next frame.
+            m_updating = false;
+            return false;
+        }
+
+        m_updatedSource = source;
+        if (!source)
+        {
+            m_updating = false;
+            return false;
+        }
+
+        update = {updateId, std::move(source)};
+        return true;
+    }
+
+    // Any thread: the latest published result, or nullptr if there is none. Never waits.
+    std::shared_ptr<const Result> GetResult() const
+    {
+        return m_result.load();
+    }
+
+    // Update: publishes the result of the update with the id and calls onPublish under the lock, unless the update is stale. A failed
+    // update passes nullptr, which keeps the current result. Returns false if the update was stale. The previous result is released after
+    // the lock, so that it is never freed while holding it.
+    template <typename OnPublish>
+    bool Publish(uint32_t updateId, std::shared_ptr<const Result> result, OnPublish&& onPublish)
+    {
+        std::shared_ptr<const Result> previous = std::move(result);
+        std::lock_guard lock(m_mutex);
+        if (updateId != m_updateId)
+        {
+            return false;
+        }
+
+        if (previous)
+        {
+            previous = m_result.exchange(std::move(previous));
+        }
+        onPublish();
+        m_updating = false;
+        return true;
+    }
+
+    bool Publish(uint32_t updateId, std::shared_ptr<const Result> result)
+    {
+        return Publish(updateId, std::move(result), [] {});
+    }
+
+    // Any thread: clears the source and the result, calls onReset under the lock, and leaves a running update stale.
+    template <typename OnReset>
+    void Reset(OnReset&& onReset)
+    {
+        std::shared_ptr<const Result> previous;
+        std::lock_guard lock(m_mutex);
+
+        // The source is cleared before the id changes, see BeginUpdate().
+        m_source.store(nullptr);
+        m_updateId++;
+        m_updating = false;
+        previous = m_result.exchange(nullptr);
+        onReset();
+    }
+
+    void Reset()
+    {
+        Reset([] {});
+    }
+
+    bool IsUpdating() const
+    {
+        return m_updating;
+    }
+
+private:
+    std::atomic<std::shared_ptr<const Source>> m_source;
+    // The source the last update was started for. Only used on the render thread.
+    std::shared_ptr<const Source> m_updatedSource;
+    // True while an update is running.
+    std::atomic<bool> m_updating = false;
+    // Identifies the current update, only that one may publish its result.
+    std::atomic<uint32_t> m_updateId = 0;
+    std::atomic<std::shared_ptr<const Result>> m_result;
+    std::mutex m_mutex;
+};
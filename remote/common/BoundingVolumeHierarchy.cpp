@@ -0,0 +1,412 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <BoundingVolumeHierarchy.h>
+
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    // The cost of visiting a node, relative to testing a primitive.
+    constexpr float TraversalCost = 1.0f;
+
+    using Bounds = BoundingVolumeHierarchy::Bounds;
+
+    constexpr Bounds EmptyBounds = {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+
+    void Extend(Bounds& bounds, const Bounds& other)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            bounds.min[axis] = std::min(bounds.min[axis], other.min[axis]);
+            bounds.max[axis] = std::max(bounds.max[axis], other.max[axis]);
+        }
+    }
+
+    // Half the surface area, which is all the heuristic needs.
+    float HalfArea(const float* min, const float* max)
+    {
+        const float x = max[0] - min[0];
+        const float y = max[1] - min[1];
+        const float z = max[2] - min[2];
+        return x * y + y * z + z * x;
+    }
+
+    void SetBounds(BoundingVolumeHierarchy::Node& node, const Bounds& bounds)
+    {
+        std::copy(bounds.min, bounds.min + 3, node.min);
+        std::copy(bounds.max, bounds.max + 3, node.max);
+    }
+
+    float HalfArea(const Bounds& bounds)
+    {
+        return bounds.min[0] > bounds.max[0] ? 0.0f : HalfArea(bounds.min, bounds.max);
+    }
+
+    void Subtract(const float* a, const float* b, float* result)
+    {
+        result[0] = a[0] - b[0];
+        result[1] = a[1] - b[1];
+        result[2] = a[2] - b[2];
+    }
+
+    void Cross(const float* a, const float* b, float* result)
+    {
+        result[0] = a[1] * b[2] - a[2] * b[1];
+        result[1] = a[2] * b[0] - a[0] * b[2];
+        result[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    float Dot(const float* a, const float* b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // a + s * b + t * c
+    void Combine(const float* a, float s, const float* b, float t, const float* c, float* result)
+    {
+        result[0] = a[0] + s * b[0] + t * c[0];
+        result[1] = a[1] + s * b[1] + t * c[1];
+        result[2] = a[2] + s * b[2] + t * c[2];
+    }
+} // namespace
+
+void BoundingVolumeHierarchy::Build(const Bounds* primitiveBounds, uint32_t count)
+{
+    Clear();
+    if (count == 0)
+    {
+        return;
+    }
+
+    std::vector<BuildPrimitive> primitives(count);
+    Bounds bounds = EmptyBounds;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        BuildPrimitive& primitive = primitives[i];
+        primitive.bounds = primitiveBounds[i];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            primitive.centroid[axis] = 0.5f * (primitive.bounds.min[axis] + primitive.bounds.max[axis]);
+        }
+        primitive.index = i;
+        Extend(bounds, primitive.bounds);
+    }
+
+    // A binary tree with at least one primitive per leaf has at most 2 * count - 1 nodes, so the nodes never move while they are built.
+    m_nodes.reserve(2 * static_cast<size_t>(count) - 1);
+    SetBounds(m_nodes.emplace_back(), bounds);
+    BuildNode(primitives, 0, 0, count, 0);
+    m_nodes.shrink_to_fit();
+
+    m_primitiveIndices.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_primitiveIndices[i] = primitives[i].index;
+    }
+}
+
+void BoundingVolumeHierarchy::BuildNode(
+    std::vector<BuildPrimitive>& primitives, uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth)
+{
+    // The bounds of the node are set by its parent, which got them from the bins of the split.
+    Node& node = m_nodes[nodeIndex];
+    node.index = begin;
+    node.count = end - begin;
+
+    const uint32_t count = end - begin;
+    if (count == 1 || depth + 1 >= MaxDepth)
+    {
+        return;
+    }
+
+    float centroidMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float centroidMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (uint32_t i = begin; i < end; i++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            centroidMin[axis] = std::min(centroidMin[axis], primitives[i].centroid[axis]);
+            centroidMax[axis] = std::max(centroidMax[axis], primitives[i].centroid[axis]);
+        }
+    }
+
+    // Sort the primitives into the bins of all three axes at once. Axes along which all centroids are the same can't be split, their
+    // primitives all end up in the first bin. Small nodes use fewer bins, most nodes are small and setting up and sweeping the bins would
+    // otherwise take longer than binning their primitives.
+    const uint32_t binCount = std::min(BinCount, count);
+    float scales[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const float extent = centroidMax[axis] - centroidMin[axis];
+        scales[axis] = extent > 0.0f ? binCount / extent : 0.0f;
+    }
+    auto binIndex = [&](const BuildPrimitive& primitive, int axis) {
+        return std::min(binCount - 1, static_cast<uint32_t>((primitive.centroid[axis] - centroidMin[axis]) * scales[axis]));
+    };
+
+    Bounds binBounds[3][BinCount];
+    uint32_t binCounts[3][BinCount] = {};
+    for (int axis = 0; axis < 3; axis++)
+    {
+        std::fill(binBounds[axis], binBounds[axis] + binCount, EmptyBounds);
+    }
+    for (uint32_t i = begin; i < end; i++)
+    {
+        const BuildPrimitive& primitive = primitives[i];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const uint32_t bin = binIndex(primitive, axis);
+            binCounts[axis][bin]++;
+            Extend(binBounds[axis][bin], primitive.bounds);
+        }
+    }
+
+    // Find the cheapest split at the bin boundaries of all axes. The costs are relative to the area of the node, the leaf costs one test
+    // per primitive.
+    const float leafCost = static_cast<float>(count);
+    const float inverseArea = 1.0f / std::max(HalfArea(node.min, node.max), FLT_MIN);
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (scales[axis] == 0.0f)
+        {
+            continue;
+        }
+
+        // Sweep from the right to get the cost of the right sides, then from the left.
+        float rightAreas[BinCount];
+        uint32_t rightCounts[BinCount];
+        Bounds right = EmptyBounds;
+        uint32_t rightCount = 0;
+        for (uint32_t bin = binCount - 1; bin > 0; bin--)
+        {
+            Extend(right, binBounds[axis][bin]);
+            rightCount += binCounts[axis][bin];
+            rightAreas[bin] = HalfArea(right);
+            rightCounts[bin] = rightCount;
+        }
+
+        Bounds left = EmptyBounds;
+        uint32_t leftCount = 0;
+        for (uint32_t split = 1; split < binCount; split++)
+        {
+            Extend(left, binBounds[axis][split - 1]);
+            leftCount += binCounts[axis][split - 1];
+            if (leftCount == 0 || rightCounts[split] == 0)
+            {
+                continue;
+            }
+
+            const float cost = TraversalCost + (HalfArea(left) * leftCount + rightAreas[split] * rightCounts[split]) * inverseArea;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    if (count <= MaxLeafSize && leafCost <= bestCost)
+    {
+        return;
+    }
+
+    uint32_t middle;
+    Bounds leftBounds = EmptyBounds;
+    Bounds rightBounds = EmptyBounds;
+    if (bestAxis >= 0)
+    {
+        const auto first = primitives.begin() + begin;
+        const auto last = primitives.begin() + end;
+        middle = static_cast<uint32_t>(
+            std::partition(first, last, [&](const BuildPrimitive& primitive) { return binIndex(primitive, bestAxis) < bestSplit; }) -
+            primitives.begin());
+        for (uint32_t bin = 0; bin < binCount; bin++)
+        {
+            Extend(bin < bestSplit ? leftBounds : rightBounds, binBounds[bestAxis][bin]);
+        }
+    }
+    else
+    {
+        // All centroids are at the same position, so there is nothing to tell them apart, but the leaf would be too large.
+        middle = begin + count / 2;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            Extend(i < middle ? leftBounds : rightBounds, primitives[i].bounds);
+        }
+    }
+
+    const uint32_t childIndex = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.resize(childIndex + 2);
+    m_nodes[nodeIndex].index = childIndex;
+    m_nodes[nodeIndex].count = 0;
+    SetBounds(m_nodes[childIndex], leftBounds);
+    SetBounds(m_nodes[childIndex + 1], rightBounds);
+
+    BuildNode(primitives, childIndex, begin, middle, depth + 1);
+    BuildNode(primitives, childIndex + 1, middle, end, depth + 1);
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+    m_nodes.clear();
+    m_primitiveIndices.clear();
+}
+
+BoundingVolumeHierarchy::Bounds BoundingVolumeHierarchy::GetBounds() const
+{
+    const Node& root = m_nodes[0];
+    return {{root.min[0], root.min[1], root.min[2]}, {root.max[0], root.max[1], root.max[2]}};
+}
+
+BoundingVolumeHierarchy::Statistics BoundingVolumeHierarchy::GetStatistics() const
+{
+    Statistics statistics;
+    if (m_nodes.empty())
+    {
+        return statistics;
+    }
+
+    const float inverseRootArea = 1.0f / std::max(HalfArea(m_nodes[0].min, m_nodes[0].max), FLT_MIN);
+    float cost = 0.0f;
+    std::vector<std::pair<uint32_t, uint32_t>> stack = {{0, 0}};
+    while (!stack.empty())
+    {
+        const auto [nodeIndex, depth] = stack.back();
+        stack.pop_back();
+
+        const Node& node = m_nodes[nodeIndex];
+        const float relativeArea = HalfArea(node.min, node.max) * inverseRootArea;
+        statistics.nodeCount++;
+        statistics.maxDepth = std::max(statistics.maxDepth, depth);
+        if (node.count != 0)
+        {
+            statistics.leafCount++;
+            cost += relativeArea * node.count;
+        }
+        else
+        {
+            cost += relativeArea * TraversalCost;
+            stack.push_back({node.index, depth + 1});
+            stack.push_back({node.index + 1, depth + 1});
+        }
+    }
+    statistics.cost = cost / m_primitiveIndices.size();
+    return statistics;
+}
+
+bool BoundingVolumeHierarchy::IntersectTriangle(
+    const float* origin, const float* direction, const float* v0, const float* v1, const float* v2, float& distance)
+{
+    // Möller-Trumbore, without culling back faces.
+    float edge1[3], edge2[3], p[3];
+    Subtract(v1, v0, edge1);
+    Subtract(v2, v0, edge2);
+    Cross(direction, edge2, p);
+    const float determinant = Dot(edge1, p);
+    if (std::abs(determinant) < FLT_MIN)
+    {
+        return false;
+    }
+
+    const float inverseDeterminant = 1.0f / determinant;
+    float s[3];
+    Subtract(origin, v0, s);
+    const float u = Dot(s, p) * inverseDeterminant;
+    if (u < 0.0f || u > 1.0f)
+    {
+        return false;
+    }
+
+    float q[3];
+    Cross(s, edge1, q);
+    const float v = Dot(direction, q) * inverseDeterminant;
+    if (v < 0.0f || u + v > 1.0f)
+    {
+        return false;
+    }
+
+    const float t = Dot(edge2, q) * inverseDeterminant;
+    if (t < 0.0f || t >= distance)
+    {
+        return false;
+    }
+
+    distance = t;
+    return true;
+}
+
+void BoundingVolumeHierarchy::ClosestPointOnTriangle(const float* point, const float* v0, const float* v1, const float* v2, float* closest)
+{
+    // Finds the Voronoi region of the triangle the point is in, see "Real-Time Collision Detection" (Ericson), 5.1.5.
+    float ab[3], ac[3], ap[3];
+    Subtract(v1, v0, ab);
+    Subtract(v2, v0, ac);
+    Subtract(point, v0, ap);
+    const float d1 = Dot(ab, ap);
+    const float d2 = Dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+    {
+        std::copy(v0, v0 + 3, closest);
+        return;
+    }
+
+    float bp[3];
+    Subtract(point, v1, bp);
+    const float d3 = Dot(ab, bp);
+    const float d4 = Dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+    {
+        std::copy(v1, v1 + 3, closest);
+        return;
+    }
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+        Combine(v0, d1 / (d1 - d3), ab, 0.0f, ac, closest);
+        return;
+    }
+
+    float cp[3];
+    Subtract(point, v2, cp);
+    const float d5 = Dot(ab, cp);
+    const float d6 = Dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+    {
+        std::copy(v2, v2 + 3, closest);
+        return;
+    }
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+        Combine(v0, 0.0f, ab, d2 / (d2 - d6), ac, closest);
+        return;
+    }
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+    {
+        float bc[3];
+        Subtract(v2, v1, bc);
+        Combine(v1, (d4 - d3) / ((d4 - d3) + (d5 - d6)), bc, 0.0f, bc, closest);
+        return;
+    }
+
+    const float denominator = 1.0f / (va + vb + vc);
+    Combine(v0, vb * denominator, ab, vc * denominator, ac, closest);
+}
@@ -0,0 +1,336 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// A bounding volume hierarchy over primitives given by their axis aligned bounds, for ray casts, nearest point and frustum queries.
+//
+// The hierarchy is built top down with the surface area heuristic, evaluated at BinCount bins along each axis of the centroid bounds. A
+// node is split at the cheapest bin boundary, unless keeping its primitives in one leaf is cheaper and they fit into MaxLeafSize. The
+// nodes are stored in one array, the two children of a node next to each other, and the leaves reference contiguous ranges of the
+// reordered primitive indices.
+//
+// The queries only test the bounds, the primitives themselves are tested by the callbacks, so the hierarchy works for any kind of
+// primitive, e.g. triangles, or the objects of a scene which have hierarchies of their own. Positions are x, y, z floats.
+class BoundingVolumeHierarchy
+{
+public:
+    static constexpr uint32_t BinCount = 16;
+    static constexpr uint32_t MaxLeafSize = 4;
+    static constexpr uint32_t MaxDepth = 48;
+
+    struct Bounds
+    {
+        float min[3];
+        float max[3];
+    };
+
+    // An inner node has a count of 0 and its children at index and index + 1, a leaf holds the primitives at [index, index + count) of
+    // GetPrimitiveIndices().
+    struct Node
+    {
+        float min[3];
+        uint32_t index;
+        float max[3];
+        uint32_t count;
+    };
+
+    struct Statistics
+    {
+        uint32_t nodeCount = 0;
+        uint32_t leafCount = 0;
+        uint32_t maxDepth = 0;
+        // the cost of the hierarchy according to the surface area heuristic, relative to testing all primitives
+        float cost = 0.0f;
+    };
+
+    // Builds the hierarchy over count primitives, replacing the previous one.
+    void Build(const Bounds* primitiveBounds, uint32_t count);
+
+    void Clear();
+
+    bool IsEmpty() const
+    {
+        return m_nodes.empty();
+    }
+
+    // The bounds of all primitives. Must not be empty.
+    Bounds GetBounds() const;
+
+    const std::vector<Node>& GetNodes() const
+    {
+        return m_nodes;
+    }
+
+    const std::vector<uint32_t>& GetPrimitiveIndices() const
+    {
+        return m_primitiveIndices;
+    }
+
+    Statistics GetStatistics() const;
+
+    // Casts a ray, nearer nodes first, and calls intersect(primitive, distance) for the primitives whose bounds it enters before distance.
+    // intersect returns true if it hits the primitive before distance, and then lowers distance to the hit, which skips everything
+    // farther away. direction doesn't need to be normalized, distances are in multiples of it. Returns true if any primitive was hit.
+    template <typename IntersectPrimitive>
+    bool Raycast(const float* origin, const float* direction, float& distance, IntersectPrimitive&& intersect) const;
+
+    // Calls closer(primitive, distance) for the primitives whose bounds are less than distance away from the point, nearer nodes first.
+    // closer returns true if the primitive is less than distance away, and then lowers distance to it. Returns true if any primitive was.
+    template <typename PrimitiveCloser>
+    bool FindNearest(const float* point, float& distance, PrimitiveCloser&& closer) const;
+
+    // Calls visit(primitive) for the primitives whose bounds are not completely outside of any of the planes. Leaves are tested as a
+    // whole, so primitives which share a leaf with them are visited as well. A plane is a, b, c, d with a * x + b * y + c * z + d > 0
+    // outside, like the planes of a SpatialBoundingFrustum.
+    template <typename VisitPrimitive>
+    void QueryPlanes(const float (*planes)[4], uint32_t planeCount, VisitPrimitive&& visit) const;
+
+    // Returns true if the ray hits the triangle (from either side) at a distance in [0, distance), and then sets distance to it.
+    static bool IntersectTriangle(
+        const float* origin, const float* direction, const float* v0, const float* v1, const float* v2, float& distance);
+
+    // Returns the point on the triangle closest to the point.
+    static void ClosestPointOnTriangle(const float* point, const float* v0, const float* v1, const float* v2, float* closest);
+
+private:
+    // Nodes whose bounds are entirely inside the planes are marked in the query stack, their primitives are visited without tests.
+    static constexpr uint32_t InsideBit = 0x80000000u;
+
+    // The queries keep at most one sibling of each inner node on the path to the current node, plus the two children of the deepest
+    // one, and inner nodes are shallower than MaxDepth.
+    static constexpr uint32_t StackSize = MaxDepth + 1;
+
+    struct BuildPrimitive
+    {
+        Bounds bounds;
+        float centroid[3];
+        uint32_t index;
+    };
+
+    void BuildNode(std::vector<BuildPrimitive>& primitives, uint32_t nodeIndex, uint32_t begin, uint32_t end, uint32_t depth);
+
+    static bool IntersectBounds(const Node& node, const float* origin, const float* inverseDirection, float distance, float& entry)
+    {
+        float tMin = 0.0f;
+        float tMax = distance;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float t0 = (node.min[axis] - origin[axis]) * inverseDirection[axis];
+            const float t1 = (node.max[axis] - origin[axis]) * inverseDirection[axis];
+            // NaNs (a ray in the plane of a face) fall through the comparisons and don't narrow the interval.
+            tMin = std::max(tMin, std::min(t0, t1));
+            tMax = std::min(tMax, std::max(t0, t1));
+        }
+        entry = tMin;
+        return tMin <= tMax;
+    }
+
+    static float SquaredDistanceToBounds(const Node& node, const float* point)
+    {
+        float squaredDistance = 0.0f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float d = std::max(std::max(node.min[axis] - point[axis], point[axis] - node.max[axis]), 0.0f);
+            squaredDistance += d * d;
+        }
+        return squaredDistance;
+    }
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_primitiveIndices;
+};
+
+template <typename IntersectPrimitive>
+bool BoundingVolumeHierarchy::Raycast(const float* origin, const float* direction, float& distance, IntersectPrimitive&& intersect) const
+{
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+
+    const float inverseDirection[3] = {1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]};
+    float entry;
+    if (!IntersectBounds(m_nodes[0], origin, inverseDirection, distance, entry))
+    {
+        return false;
+    }
+
+    bool hit = false;
+    uint32_t stack[StackSize];
+    float stackEntries[StackSize];
+    uint32_t stackSize = 0;
+    uint32_t nodeIndex = 0;
+    while (true)
+    {
+        const Node& node = m_nodes[nodeIndex];
+        if (node.count != 0)
+        {
+            for (uint32_t i = node.index; i < node.index + node.count; i++)
+            {
+                hit |= intersect(m_primitiveIndices[i], distance);
+            }
+        }
+        else
+        {
+            float leftEntry, rightEntry;
+            const bool left = IntersectBounds(m_nodes[node.index], origin, inverseDirection, distance, leftEntry);
+            const bool right = IntersectBounds(m_nodes[node.index + 1], origin, inverseDirection, distance, rightEntry);
+            if (left && right)
+            {
+                // Continue with the nearer child, the farther one is skipped later if a hit is found before it.
+                const bool leftFirst = leftEntry <= rightEntry;
+                stack[stackSize] = leftFirst ? node.index + 1 : node.index;
+                stackEntries[stackSize] = leftFirst ? rightEntry : leftEntry;
+                stackSize++;
+                nodeIndex = leftFirst ? node.index : node.index + 1;
+                continue;
+            }
+            if (left || right)
+            {
+                nodeIndex = left ? node.index : node.index + 1;
+                continue;
+            }
+        }
+
+        // Pop the next node which starts before the closest hit so far.
+        do
+        {
+            if (stackSize == 0)
+            {
+                return hit;
+            }
+            stackSize--;
+        } while (stackEntries[stackSize] > distance);
+        nodeIndex = stack[stackSize];
+    }
+}
+
+template <typename PrimitiveCloser>
+bool BoundingVolumeHierarchy::FindNearest(const float* point, float& distance, PrimitiveCloser&& closer) const
+{
+    if (m_nodes.empty() || SquaredDistanceToBounds(m_nodes[0], point) >= distance * distance)
+    {
+        return false;
+    }
+
+    bool found = false;
+    uint32_t stack[StackSize];
+    float stackDistances[StackSize];
+    uint32_t stackSize = 0;
+    uint32_t nodeIndex = 0;
+    while (true)
+    {
+        const Node& node = m_nodes[nodeIndex];
+        if (node.count != 0)
+        {
+            for (uint32_t i = node.index; i < node.index + node.count; i++)
+            {
+                found |= closer(m_primitiveIndices[i], distance);
+            }
+        }
+        else
+        {
+            const float squaredDistance = distance * distance;
+            const float leftDistance = SquaredDistanceToBounds(m_nodes[node.index], point);
+            const float rightDistance = SquaredDistanceToBounds(m_nodes[node.index + 1], point);
+            const bool left = leftDistance < squaredDistance;
+            const bool right = rightDistance < squaredDistance;
+            if (left && right)
+            {
+                const bool leftFirst = leftDistance <= rightDistance;
+                stack[stackSize] = leftFirst ? node.index + 1 : node.index;
+                stackDistances[stackSize] = leftFirst ? rightDistance : leftDistance;
+                stackSize++;
+                nodeIndex = leftFirst ? node.index : node.index + 1;
+                continue;
+            }
+            if (left || right)
+            {
+                nodeIndex = left ? node.index : node.index + 1;
+                continue;
+            }
+        }
+
+        do
+        {
+            if (stackSize == 0)
+            {
+                return found;
+            }
+            stackSize--;
+        } while (stackDistances[stackSize] >= distance * distance);
+        nodeIndex = stack[stackSize];
+    }
+}
+
+template <typename VisitPrimitive>
+void BoundingVolumeHierarchy::QueryPlanes(const float (*planes)[4], uint32_t planeCount, VisitPrimitive&& visit) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    uint32_t stack[StackSize];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        const uint32_t entry = stack[--stackSize];
+        const Node& node = m_nodes[entry & ~InsideBit];
+        bool inside = (entry & InsideBit) != 0;
+        if (!inside)
+        {
+            // The node is outside if even its corner with the smallest distance to a plane is on the outer side, and inside if the
+            // corner with the largest distance is on the inner side of all planes.
+            inside = true;
+            bool outside = false;
+            for (uint32_t i = 0; i < planeCount && !outside; i++)
+            {
+                const float* plane = planes[i];
+                float nearest = plane[3];
+                float farthest = plane[3];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    const float a = plane[axis] * node.min[axis];
+                    const float b = plane[axis] * node.max[axis];
+                    nearest += std::min(a, b);
+                    farthest += std::max(a, b);
+                }
+                outside = nearest > 0.0f;
+                inside &= farthest <= 0.0f;
+            }
+            if (outside)
+            {
+                continue;
+            }
+        }
+
+        if (node.count != 0)
+        {
+            for (uint32_t i = node.index; i < node.index + node.count; i++)
+            {
+                visit(m_primitiveIndices[i]);
+            }
+        }
+        else
+        {
+            const uint32_t insideBit = inside ? InsideBit : 0;
+            stack[stackSize++] = (node.index + 1) | insideBit;
+            stack[stackSize++] = node.index | insideBit;
+        }
+    }
+}
@@ -0,0 +1,156 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <BoundingVolumePolicy.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    using Vector3 = BoundingVolumePolicy::Vector3;
+
+    Vector3 Subtract(const Vector3& a, const Vector3& b)
+    {
+        return {a.x - b.x, a.y - b.y, a.z - b.z};
+    }
+
+    Vector3 Scale(const Vector3& v, float s)
+    {
+        return {v.x * s, v.y * s, v.z * s};
+    }
+
+    Vector3 Lerp(const Vector3& a, const Vector3& b, float t)
+    {
+        return {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t};
+    }
+
+    float Length(const Vector3& v)
+    {
+        return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    }
+
+    float AngleBetween(const Vector3& a, const Vector3& b)
+    {
+        const float lengths = Length(a) * Length(b);
+        if (lengths <= 0.0f)
+        {
+            return 0.0f;
+        }
+
+        const float cosine = (a.x * b.x + a.y * b.y + a.z * b.z) / lengths;
+        return std::acos(std::min(std::max(cosine, -1.0f), 1.0f));
+    }
+} // namespace
+
+BoundingVolumePolicy::BoundingVolumePolicy()
+    : BoundingVolumePolicy(Settings{})
+{
+}
+
+BoundingVolumePolicy::BoundingVolumePolicy(const Settings& settings)
+    : m_settings(settings)
+{
+}
+
+bool BoundingVolumePolicy::Update(double time, const Vector3& headPosition, const Vector3& headForward)
+{
+    m_statistics.sampleCount++;
+
+    if (m_hasSample && time > m_lastSampleTime)
+    {
+        const float deltaTime = static_cast<float>(time - m_lastSampleTime);
+        const Vector3 velocity = Scale(Subtract(headPosition, m_lastPosition), 1.0f / deltaTime);
+        const float angularSpeed = AngleBetween(headForward, m_lastForward) / deltaTime;
+
+        // Exponential smoothing, independent of the frame rate.
+        const float blend = 1.0f - std::exp(-deltaTime / m_settings.velocitySmoothing);
+        m_velocity = Lerp(m_velocity, velocity, blend);
+        m_angularSpeed += (angularSpeed - m_angularSpeed) * blend;
+    }
+
+    m_hasSample = true;
+    m_lastSampleTime = time;
+    m_lastPosition = headPosition;
+    m_lastForward = headForward;
+
+    const float speed = Length(m_velocity);
+    if (speed > m_settings.movingSpeed || m_angularSpeed > m_settings.movingAngularSpeed)
+    {
+        m_moving = true;
+        m_slowSince = time;
+    }
+    else if (speed > m_settings.stationarySpeed || m_angularSpeed > m_settings.stationaryAngularSpeed)
+    {
+        // In between the thresholds, the current state sticks.
+        m_slowSince = time;
+    }
+    else if (m_moving && time - m_slowSince >= m_settings.stationaryDelay)
+    {
+        m_moving = false;
+    }
+
+    if (m_moving)
+    {
+        m_statistics.movingSampleCount++;
+    }
+
+    const Box target = ComputeTargetBox(headPosition);
+    if (m_hasBox && (time - m_lastUpdateTime < m_settings.minUpdateInterval || !NeedsUpdate(target)))
+    {
+        return false;
+    }
+
+    m_box = target;
+    m_boxMoving = m_moving;
+    m_hasBox = true;
+    m_lastUpdateTime = time;
+    m_statistics.updateCount++;
+    return true;
+}
+
+BoundingVolumePolicy::Box BoundingVolumePolicy::ComputeTargetBox(const Vector3& headPosition) const
+{
+    if (!m_moving)
+    {
+        return {headPosition, m_settings.stationaryHalfExtents};
+    }
+
+    // Look ahead horizontally only, vertical head motion is mostly noise.
+    Vector3 lookAhead = Scale({m_velocity.x, 0.0f, m_velocity.z}, m_settings.lookAheadTime);
+    const float lookAheadDistance = Length(lookAhead);
+    if (lookAheadDistance > m_settings.maxLookAhead)
+    {
+        lookAhead = Scale(lookAhead, m_settings.maxLookAhead / lookAheadDistance);
+    }
+
+    // Shift the center by half the look ahead and grow by the other half, so the box covers the head and the look ahead point.
+    const Vector3 halfLookAhead = Scale(lookAhead, 0.5f);
+    return {
+        {headPosition.x + halfLookAhead.x, headPosition.y, headPosition.z + halfLookAhead.z},
+        {m_settings.movingHalfExtents.x + std::abs(halfLookAhead.x),
+         m_settings.movingHalfExtents.y,
+         m_settings.movingHalfExtents.z + std::abs(halfLookAhead.z)}};
+}
+
+bool BoundingVolumePolicy::NeedsUpdate(const Box& target) const
+{
+    // Growing or shrinking the box is always worth an update, in particular when the user starts moving.
+    if (m_boxMoving != m_moving)
+    {
+        return true;
+    }
+
+    const Vector3 offset = Subtract(target.center, m_box.center);
+    const float fraction = m_settings.recenterFraction;
+    return std::abs(offset.x) > target.halfExtents.x * fraction || std::abs(offset.y) > target.halfExtents.y * fraction ||
+           std::abs(offset.z) > target.halfExtents.z * fraction;
+}
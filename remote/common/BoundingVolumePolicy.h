@@ -0,0 +1,124 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// Decides when and where to move the bounding volume of a spatial surface observer, based on the motion of the head.
+//
+// Every change of the bounding volume makes the observer report changed surfaces, which are then recomputed. So while the user stands
+// still the box stays where it is, and it is kept small. Once the head translates or rotates fast enough, the box grows, and it is
+// shifted ahead of the head in the direction of travel, so surfaces are available before the user gets there. Entering and leaving the
+// moving state use different thresholds, and leaving requires the motion to stay low for a while, so the box does not flip between the
+// two sizes. The box is only replaced if it moved or changed its size noticeably.
+//
+// All positions and directions are in one stationary coordinate system with +y up, time is in seconds.
+class BoundingVolumePolicy
+{
+public:
+    struct Vector3
+    {
+        float x, y, z;
+    };
+
+    // Axis aligned box.
+    struct Box
+    {
+        Vector3 center;
+        Vector3 halfExtents;
+    };
+
+    struct Settings
+    {
+        // Enter the moving state above either speed, leave it after staying below both for stationaryDelay.
+        float movingSpeed = 0.3f;
+        float stationarySpeed = 0.1f;
+        float movingAngularSpeed = 1.0f; // radians per second
+        float stationaryAngularSpeed = 0.35f;
+        float stationaryDelay = 1.5f;
+
+        // Smoothing time constant for the measured velocities.
+        float velocitySmoothing = 0.2f;
+
+        Vector3 stationaryHalfExtents = {3.0f, 2.5f, 3.0f};
+        Vector3 movingHalfExtents = {5.0f, 2.5f, 5.0f};
+
+        // While moving, the box is shifted by the distance travelled within lookAheadTime, up to maxLookAhead meters, and extended by
+        // the same amount in the direction of travel.
+        float lookAheadTime = 1.5f;
+        float maxLookAhead = 3.0f;
+
+        // The box is replaced once its center is off by more than this fraction of the new half extents, or when switching between the
+        // stationary and the moving size.
+        float recenterFraction = 0.2f;
+
+        // Never replace the box more often than this.
+        float minUpdateInterval = 0.25f;
+    };
+
+    struct Statistics
+    {
+        uint64_t sampleCount = 0;
+        uint64_t updateCount = 0;
+        uint64_t movingSampleCount = 0;
+    };
+
+    BoundingVolumePolicy();
+    explicit BoundingVolumePolicy(const Settings& settings);
+
+    // Feeds the latest head pose. Returns true if the bounding volume should be replaced by GetBox().
+    bool Update(double time, const Vector3& headPosition, const Vector3& headForward);
+
+    // Forgets the current box, e.g. because the observer was recreated. The next Update() returns true.
+    void Reset()
+    {
+        m_hasBox = false;
+    }
+
+    // The box to observe, valid after Update() returned true once.
+    const Box& GetBox() const
+    {
+        return m_box;
+    }
+
+    bool IsMoving() const
+    {
+        return m_moving;
+    }
+
+    const Statistics& GetStatistics() const
+    {
+        return m_statistics;
+    }
+
+private:
+    Box ComputeTargetBox(const Vector3& headPosition) const;
+    bool NeedsUpdate(const Box& target) const;
+
+    Settings m_settings;
+    Statistics m_statistics;
+
+    bool m_hasSample = false;
+    double m_lastSampleTime = 0.0;
+    Vector3 m_lastPosition = {};
+    Vector3 m_lastForward = {};
+
+    Vector3 m_velocity = {};
+    float m_angularSpeed = 0.0f;
+    bool m_moving = false;
+    double m_slowSince = 0.0;
+
+    bool m_hasBox = false;
+    bool m_boxMoving = false;
+    double m_lastUpdateTime = 0.0;
+    Box m_box = {};
+};
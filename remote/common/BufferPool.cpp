@@ -0,0 +1,40 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <BufferPool.h>
+
+#include <bit>
+
+namespace
+{
+    // The classes of a power of two are this far apart.
+    constexpr uint64_t ClassStep = BufferSizeClasses::MinCapacity / 4;
+} // namespace
+
+uint32_t BufferSizeClasses::GetClass(uint64_t size)
+{
+    if (size <= MinCapacity)
+    {
+        return 0;
+    }
+
+    // The size in steps is in [2^k, 2^(k + 1)) with k >= 2, which is split into the four classes (4 + j) * 2^(k - 2).
+    const uint64_t steps = (size + ClassStep - 1) / ClassStep;
+    const uint32_t k = 63 - std::countl_zero(steps);
+    const uint64_t classSteps = uint64_t(1) << (k - 2);
+    const uint64_t j = (steps + classSteps - 1) / classSteps - 4;
+    return (k - 2) * 4 + static_cast<uint32_t>(j);
+}
+
+uint64_t BufferSizeClasses::GetCapacity(uint32_t sizeClass)
+{
+    return ((4 + uint64_t(sizeClass % 4)) << (sizeClass / 4)) * ClassStep;
+}
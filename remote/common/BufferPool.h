@@ -0,0 +1,274 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// The capacities BufferPool creates buffers with. They grow geometrically, with four classes per power of two, so a buffer is less than
+// 25% larger than the size it was created for, and any buffer of a class fits every size of the class.
+namespace BufferSizeClasses
+{
+    // The capacity of the smallest class, in bytes.
+    constexpr uint64_t MinCapacity = 4096;
+
+    // Returns the smallest class whose capacity is at least size.
+    uint32_t GetClass(uint64_t size);
+
+    uint64_t GetCapacity(uint32_t sizeClass);
+} // namespace BufferSizeClasses
+
+// Recycles the buffers of a graphics API, e.g. vertex and index buffers, instead of creating new ones for every update of the data.
+//
+// Acquire() returns a lease on a buffer of the requested usage, e.g. bind flags, with the capacity of the size class of the requested size
+// or of the next larger class. Released buffers are reused, the most recently released one first. Only if there is none a new one is
+// created by a callback, which keeps the pool independent of the graphics API. When a lease is destroyed its buffer goes back to the
+// pool. The pool keeps up to maxPooledBytes of unused buffers, beyond that it destroys the ones which were released the longest time ago.
+//
+// The pool must be owned by a std::shared_ptr, the leases keep it alive. It is thread safe, buffers may be acquired and leases released
+// on any thread. The buffers are destroyed outside of the lock.
+template <typename Buffer>
+class BufferPool : public std::enable_shared_from_this<BufferPool<Buffer>>
+{
+public:
+    struct Statistics
+    {
+        // Buffers created by the callback.
+        uint64_t allocatedBytes = 0;
+        uint64_t allocationCount = 0;
+        // Buffers handed out again.
+        uint64_t reusedBytes = 0;
+        uint64_t reuseCount = 0;
+        // Buffers destroyed by the pool, because it was full or cleared.
+        uint64_t churnedBytes = 0;
+        uint64_t churnCount = 0;
+        // Unused buffers currently in the pool.
+        uint64_t pooledBytes = 0;
+        uint32_t pooledCount = 0;
+    };
+
+    // A buffer of the pool, which is given back to it when the lease is destroyed.
+    class Lease
+    {
+    public:
+        Lease() = default;
+
+        Lease(Lease&& other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        Lease& operator=(Lease&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Release();
+                m_pool = std::move(other.m_pool);
+                m_buffer = std::exchange(other.m_buffer, Buffer{});
+                m_usage = other.m_usage;
+                m_sizeClass = other.m_sizeClass;
+                m_generation = other.m_generation;
+            }
+            return *this;
+        }
+
+        ~Lease()
+        {
+            Release();
+        }
+
+        explicit operator bool() const
+        {
+            return m_pool != nullptr;
+        }
+
+        const Buffer& Get() const
+        {
+            return m_buffer;
+        }
+
+        uint64_t GetCapacity() const
+        {
+            return BufferSizeClasses::GetCapacity(m_sizeClass);
+        }
+
+        // Gives the buffer back to the pool.
+        void Release()
+        {
+            if (m_pool)
+            {
+                std::shared_ptr<BufferPool> pool = std::move(m_pool);
+                pool->Return(std::exchange(m_buffer, Buffer{}), m_usage, m_sizeClass, m_generation);
+            }
+        }
+
+    private:
+        friend class BufferPool;
+
+        std::shared_ptr<BufferPool> m_pool;
+        Buffer m_buffer{};
+        uint32_t m_usage = 0;
+        uint32_t m_sizeClass = 0;
+        uint32_t m_generation = 0;
+    };
+
+    explicit BufferPool(uint64_t maxPooledBytes)
+        : m_maxPooledBytes(maxPooledBytes)
+    {
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Returns a buffer of at least size bytes for the usage. Calls create(capacity) to create a new one if none can be reused, which
+    // returns the buffer or throws.
+    template <typename CreateBuffer>
+    Lease Acquire(uint32_t usage, uint64_t size, CreateBuffer&& create);
+
+    // Destroys the unused buffers. The buffers of the current leases are destroyed when they are released, e.g. after the device they
+    // were created on was lost.
+    void Clear();
+
+    Statistics GetStatistics() const;
+
+private:
+    struct PooledBuffer
+    {
+        Buffer buffer;
+        uint32_t usage;
+        uint32_t sizeClass;
+    };
+
+    void Return(Buffer&& buffer, uint32_t usage, uint32_t sizeClass, uint32_t generation);
+
+    const uint64_t m_maxPooledBytes;
+
+    mutable std::mutex m_mutex;
+    // Released the longest time ago first. There are only a few, so they are searched linearly.
+    std::vector<PooledBuffer> m_pooledBuffers;
+    // Incremented by Clear(), buffers leased before are not taken back.
+    uint32_t m_generation = 0;
+    Statistics m_statistics;
+};
+
+template <typename Buffer>
+template <typename CreateBuffer>
+typename BufferPool<Buffer>::Lease BufferPool<Buffer>::Acquire(uint32_t usage, uint64_t size, CreateBuffer&& create)
+{
+    Lease lease;
+    lease.m_usage = usage;
+    lease.m_sizeClass = BufferSizeClasses::GetClass(size);
+
+    bool reused = false;
+    {
+        std::lock_guard lock(m_mutex);
+        lease.m_generation = m_generation;
+
+        // Prefer a buffer of the class of the size, otherwise take one of the next class, so that sizes which shrink a little below a class
+        // boundary still find the buffer they used before.
+        size_t found = m_pooledBuffers.size();
+        for (size_t i = m_pooledBuffers.size(); i-- > 0;)
+        {
+            const PooledBuffer& pooled = m_pooledBuffers[i];
+            if (pooled.usage == usage && pooled.sizeClass - lease.m_sizeClass <= 1 &&
+                (found == m_pooledBuffers.size() || pooled.sizeClass < m_pooledBuffers[found].sizeClass))
+            {
+                found = i;
+            }
+        }
+        if (found != m_pooledBuffers.size())
+        {
+            PooledBuffer& pooled = m_pooledBuffers[found];
+            const uint64_t capacity = BufferSizeClasses::GetCapacity(pooled.sizeClass);
+            lease.m_buffer = std::move(pooled.buffer);
+            lease.m_sizeClass = pooled.sizeClass;
+            m_pooledBuffers.erase(m_pooledBuffers.begin() + found);
+            m_statistics.pooledBytes -= capacity;
+            m_statistics.pooledCount--;
+            m_statistics.reusedBytes += capacity;
+            m_statistics.reuseCount++;
+            reused = true;
+        }
+    }
+
+    if (!reused)
+    {
+        const uint64_t capacity = BufferSizeClasses::GetCapacity(lease.m_sizeClass);
+        lease.m_buffer = create(capacity);
+
+        std::lock_guard lock(m_mutex);
+        m_statistics.allocatedBytes += capacity;
+        m_statistics.allocationCount++;
+    }
+
+    lease.m_pool = this->shared_from_this();
+    return lease;
+}
+
+template <typename Buffer>
+void BufferPool<Buffer>::Return(Buffer&& buffer, uint32_t usage, uint32_t sizeClass, uint32_t generation)
+{
+    const uint64_t capacity = BufferSizeClasses::GetCapacity(sizeClass);
+    std::vector<Buffer> destroyedBuffers;
+    {
+        std::lock_guard lock(m_mutex);
+        if (generation != m_generation || capacity > m_maxPooledBytes)
+        {
+            destroyedBuffers.push_back(std::move(buffer));
+            m_statistics.churnedBytes += capacity;
+            m_statistics.churnCount++;
+        }
+        else
+        {
+            m_pooledBuffers.push_back({std::move(buffer), usage, sizeClass});
+            m_statistics.pooledBytes += capacity;
+            m_statistics.pooledCount++;
+
+            // Make room by destroying the buffers released the longest time ago.
+            size_t destroyedCount = 0;
+            while (m_statistics.pooledBytes > m_maxPooledBytes)
+            {
+                PooledBuffer& oldest = m_pooledBuffers[destroyedCount++];
+                const uint64_t oldestCapacity = BufferSizeClasses::GetCapacity(oldest.sizeClass);
+                destroyedBuffers.push_back(std::move(oldest.buffer));
+                m_statistics.pooledBytes -= oldestCapacity;
+                m_statistics.pooledCount--;
+                m_statistics.churnedBytes += oldestCapacity;
+                m_statistics.churnCount++;
+            }
+            m_pooledBuffers.erase(m_pooledBuffers.begin(), m_pooledBuffers.begin() + destroyedCount);
+        }
+    }
+}
+
+template <typename Buffer>
+void BufferPool<Buffer>::Clear()
+{
+    std::vector<PooledBuffer> destroyedBuffers;
+    std::lock_guard lock(m_mutex);
+    m_generation++;
+    destroyedBuffers.swap(m_pooledBuffers);
+    m_statistics.churnedBytes += m_statistics.pooledBytes;
+    m_statistics.churnCount += m_statistics.pooledCount;
+    m_statistics.pooledBytes = 0;
+    m_statistics.pooledCount = 0;
+}
+
+template <typename Buffer>
+typename BufferPool<Buffer>::Statistics BufferPool<Buffer>::GetStatistics() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_statistics;
+}
@@ -0,0 +1,258 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <ContentHash.h>
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONTENT_HASH_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__) || defined(__ARM_NEON)
+#define CONTENT_HASH_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
+namespace
+{
+    constexpr uint32_t Prime32 = 0x9E3779B1u;
+    constexpr uint64_t Prime64 = 0x9E3779B97F4A7C15ull;
+
+    // Stripe n of a block uses the keys starting at n, so equal data at different positions of a block accumulates differently.
+    constexpr uint64_t StripeKeys[23] = {
+        0x6E789E6AA1B965F4ull,
+        0x06C45D188009454Full,
+        0xF88BB8A8724C81ECull,
+        0x1B39896A51A8749Bull,
+        0x53CB9F0C747EA2EAull,
+        0x2C829ABE1F4532E1ull,
+        0xC584133AC916AB3Cull,
+        0x3EE5789041C98AC3ull,
+        0x935E82F1DB4C4F7Bull,
+        0x69B82EBC92233300ull,
+        0x40D29EB57DE1D510ull,
+        0xA2F09DABB45C6316ull,
+        0xEE521D7A0F4D3872ull,
+        0xF16952EE72F3454Full,
+        0x377D35DEA8E40225ull,
+        0x0C7DE8064963BAB0ull,
+        0x05582D37111AC529ull,
+        0xD254741F599DC6F7ull,
+        0x69630F7593D108C3ull,
+        0x417EF96181DAA383ull,
+        0x3C3C41A3B43343A1ull,
+        0x6E19905DCBE531DFull,
+        0x4FA9FA7324851729ull};
+
+    alignas(16) constexpr uint64_t ScrambleKeys[8] = {
+        0xF3B8488C368CB0A6ull,
+        0x657EECDD3CB13D09ull,
+        0xC2D326E0055BDEF6ull,
+        0x8621A03FE0BBDB7Bull,
+        0x8E1F7555983AA92Full,
+        0xB54E0F1600CC4D19ull,
+        0x84BB3F97971D80ABull,
+        0x7D29825C75521255ull};
+
+    constexpr uint64_t FinishKeys[8] = {
+        0xC3CF17102B7F7F86ull,
+        0x3466E9A083914F64ull,
+        0xD81A8D2B5A4485ACull,
+        0xDB01602B100B9ED7ull,
+        0xA9038A921825F10Dull,
+        0xEDF5F1D90DCA2F6Aull,
+        0x54496AD67BD2634Cull,
+        0xDD7C01D4F5407269ull};
+
+    // Full 128 bit product, folded to 64 bits.
+    uint64_t MultiplyFold(uint64_t a, uint64_t b)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        uint64_t high;
+        const uint64_t low = _umul128(a, b, &high);
+        return low ^ high;
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+        return (a * b) ^ __umulh(a, b);
+#elif defined(__SIZEOF_INT128__)
+        const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+        const uint64_t lowLow = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+        const uint64_t highLow = (a >> 32) * (b & 0xFFFFFFFF);
+        const uint64_t lowHigh = (a & 0xFFFFFFFF) * (b >> 32);
+        const uint64_t highHigh = (a >> 32) * (b >> 32);
+        const uint64_t cross = (lowLow >> 32) + (highLow & 0xFFFFFFFF) + lowHigh;
+        const uint64_t high = highHigh + (highLow >> 32) + (cross >> 32);
+        const uint64_t low = (cross << 32) | (lowLow & 0xFFFFFFFF);
+        return low ^ high;
+#endif
+    }
+
+    void AccumulateStripe(uint64_t* accumulators, const uint8_t* data, const uint64_t* keys)
+    {
+#if defined(CONTENT_HASH_SSE2)
+        __m128i* acc = reinterpret_cast<__m128i*>(accumulators);
+        for (int i = 0; i < 4; i++)
+        {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data) + i);
+            const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys) + i);
+            const __m128i keyed = _mm_xor_si128(value, key);
+            const __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(3, 3, 1, 1)));
+            const __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(swapped, product));
+        }
+#elif defined(CONTENT_HASH_NEON)
+        for (int i = 0; i < 4; i++)
+        {
+            const uint64x2_t value = vreinterpretq_u64_u8(vld1q_u8(data + i * 16));
+            const uint64x2_t key = vld1q_u64(keys + i * 2);
+            const uint64x2_t keyed = veorq_u64(value, key);
+            const uint64x2_t product = vmull_u32(vmovn_u64(keyed), vshrn_n_u64(keyed, 32));
+            const uint64x2_t swapped = vextq_u64(value, value, 1);
+            uint64x2_t acc = vld1q_u64(accumulators + i * 2);
+            acc = vaddq_u64(acc, vaddq_u64(swapped, product));
+            vst1q_u64(accumulators + i * 2, acc);
+        }
+#else
+        for (int i = 0; i < 8; i++)
+        {
+            uint64_t value;
+            memcpy(&value, data + i * 8, sizeof(value));
+            const uint64_t keyed = value ^ keys[i];
+
+            // The raw value goes into the neighboring lane, so no input bits are lost if the product is zero.
+            accumulators[i ^ 1] += value;
+            accumulators[i] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+        }
+#endif
+    }
+
+    void Scramble(uint64_t* accumulators)
+    {
+#if defined(CONTENT_HASH_SSE2)
+        __m128i* acc = reinterpret_cast<__m128i*>(accumulators);
+        const __m128i prime = _mm_set1_epi32(static_cast<int>(Prime32));
+        for (int i = 0; i < 4; i++)
+        {
+            const __m128i key = _mm_load_si128(reinterpret_cast<const __m128i*>(ScrambleKeys) + i);
+            const __m128i value = _mm_xor_si128(_mm_xor_si128(acc[i], _mm_srli_epi64(acc[i], 47)), key);
+            const __m128i productLow = _mm_mul_epu32(value, prime);
+            const __m128i productHigh = _mm_mul_epu32(_mm_srli_epi64(value, 32), prime);
+            acc[i] = _mm_add_epi64(productLow, _mm_slli_epi64(productHigh, 32));
+        }
+#elif defined(CONTENT_HASH_NEON)
+        for (int i = 0; i < 4; i++)
+        {
+            const uint64x2_t acc = vld1q_u64(accumulators + i * 2);
+            const uint64x2_t key = vld1q_u64(ScrambleKeys + i * 2);
+            const uint64x2_t value = veorq_u64(veorq_u64(acc, vshrq_n_u64(acc, 47)), key);
+            const uint64x2_t productLow = vmull_n_u32(vmovn_u64(value), Prime32);
+            const uint64x2_t productHigh = vmull_n_u32(vshrn_n_u64(value, 32), Prime32);
+            vst1q_u64(accumulators + i * 2, vaddq_u64(productLow, vshlq_n_u64(productHigh, 32)));
+        }
+#else
+        for (int i = 0; i < 8; i++)
+        {
+            const uint64_t value = accumulators[i] ^ (accumulators[i] >> 47) ^ ScrambleKeys[i];
+            accumulators[i] = value * Prime32;
+        }
+#endif
+    }
+} // namespace
+
+ContentHash::ContentHash(uint64_t seed)
+{
+    for (size_t i = 0; i < LaneCount; i++)
+    {
+        m_accumulators[i] = FinishKeys[i] ^ (seed * Prime64 + i);
+    }
+}
+
+void ContentHash::ConsumeStripes(const uint8_t* data, size_t stripeCount)
+{
+    for (size_t i = 0; i < stripeCount; i++)
+    {
+        AccumulateStripe(m_accumulators, data + i * StripeSize, StripeKeys + m_stripesInBlock);
+        if (++m_stripesInBlock == StripesPerBlock)
+        {
+            Scramble(m_accumulators);
+            m_stripesInBlock = 0;
+        }
+    }
+}
+
+void ContentHash::Update(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    m_totalSize += size;
+
+    // Complete a partially filled stripe first.
+    if (m_bufferSize > 0)
+    {
+        const size_t count = size < StripeSize - m_bufferSize ? size : StripeSize - m_bufferSize;
+        memcpy(m_buffer + m_bufferSize, bytes, count);
+        m_bufferSize += count;
+        bytes += count;
+        size -= count;
+
+        if (m_bufferSize < StripeSize)
+        {
+            return;
+        }
+
+        ConsumeStripes(m_buffer, 1);
+        m_bufferSize = 0;
+    }
+
+    const size_t stripeCount = size / StripeSize;
+    ConsumeStripes(bytes, stripeCount);
+    bytes += stripeCount * StripeSize;
+    size -= stripeCount * StripeSize;
+
+    memcpy(m_buffer, bytes, size);
+    m_bufferSize = size;
+}
+
+uint64_t ContentHash::Finish() const
+{
+    alignas(16) uint64_t accumulators[LaneCount];
+    memcpy(accumulators, m_accumulators, sizeof(accumulators));
+
+    if (m_bufferSize > 0)
+    {
+        // The last partial stripe is padded with zeros, the total size below tells it apart from real zeros.
+        uint8_t stripe[StripeSize] = {};
+        memcpy(stripe, m_buffer, m_bufferSize);
+        AccumulateStripe(accumulators, stripe, StripeKeys + m_stripesInBlock);
+    }
+
+    uint64_t hash = m_totalSize * Prime64;
+    for (size_t i = 0; i < LaneCount; i += 2)
+    {
+        hash += MultiplyFold(accumulators[i] ^ FinishKeys[i], accumulators[i + 1] ^ FinishKeys[i + 1]);
+    }
+
+    hash ^= hash >> 37;
+    hash *= 0x165667919E3779F9ull;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t ContentHash::Compute(const void* data, size_t size, uint64_t seed)
+{
+    ContentHash hash(seed);
+    hash.Update(data, size);
+    return hash.Finish();
+}
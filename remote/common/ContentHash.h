@@ -0,0 +1,53 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Fast non-cryptographic 64 bit hash for detecting changes in large buffers.
+//
+// Follows the structure of XXH3: the input is consumed in 64 byte stripes by eight independent 64 bit accumulators, each of which adds
+// the product of the low and high half of its input word combined with a key. Every 1 KB the accumulators are scrambled, and at the end
+// they are folded with a full 64x64 bit multiply. The stripe loop uses SSE2 or NEON where available, all code paths produce the same
+// hash. Data can be fed in pieces, the result only depends on the concatenated bytes.
+class ContentHash
+{
+public:
+    explicit ContentHash(uint64_t seed = 0);
+
+    void Update(const void* data, size_t size);
+
+    template <typename T>
+    void UpdateValue(const T& value)
+    {
+        Update(&value, sizeof(T));
+    }
+
+    // Returns the hash of all data passed to Update so far. Does not change the state, more data can be added afterwards.
+    uint64_t Finish() const;
+
+    static uint64_t Compute(const void* data, size_t size, uint64_t seed = 0);
+
+private:
+    static constexpr size_t LaneCount = 8;
+    static constexpr size_t StripeSize = LaneCount * sizeof(uint64_t);
+    static constexpr size_t StripesPerBlock = 16;
+
+    void ConsumeStripes(const uint8_t* data, size_t stripeCount);
+
+    alignas(16) uint64_t m_accumulators[LaneCount];
+    uint8_t m_buffer[StripeSize];
+    size_t m_bufferSize = 0;
+    size_t m_stripesInBlock = 0;
+    uint64_t m_totalSize = 0;
+};
@@ -0,0 +1,332 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <CoplanarQuadMerger.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+    float Dot(const float* a, const float* b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    void Cross(const float* a, const float* b, float* result)
+    {
+        result[0] = a[1] * b[2] - a[2] * b[1];
+        result[1] = a[2] * b[0] - a[0] * b[2];
+        result[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    void Normalize(float* v)
+    {
+        const float length = std::sqrt(Dot(v, v));
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+
+    // A run of covered cells along a row, or a column if transposed, which started at firstLine.
+    struct Run
+    {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t firstLine;
+    };
+} // namespace
+
+void CoplanarQuadMerger::Merge(const Quad* quads, uint32_t count, const Settings& settings)
+{
+    m_clusters.clear();
+    m_rects.clear();
+    m_statistics = {};
+
+    // Each quad joins the first cluster it fits into, or starts a new one with the frame of the quad.
+    const float cosMaxAngle = std::cos(settings.maxAngle);
+    std::vector<std::vector<uint32_t>> clusterQuads;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const Quad& quad = quads[i];
+        if (!(quad.width > 0.0f && quad.height > 0.0f))
+        {
+            continue;
+        }
+        m_statistics.quadCount++;
+        m_statistics.quadArea += static_cast<double>(quad.width) * quad.height;
+
+        bool fitted = false;
+        for (size_t c = 0; c < m_clusters.size() && !fitted; c++)
+        {
+            if (m_clusters[c].group == quad.group && FitQuad(m_clusters[c], quad, cosMaxAngle, settings.maxPlaneDistance))
+            {
+                clusterQuads[c].push_back(i);
+                m_clusters[c].quadCount++;
+                fitted = true;
+            }
+        }
+        if (!fitted)
+        {
+            Cluster& cluster = m_clusters.emplace_back();
+            cluster.group = quad.group;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                cluster.origin[axis] = quad.center[axis] - quad.xAxis[axis] * quad.width / 2 - quad.yAxis[axis] * quad.height / 2;
+                cluster.xAxis[axis] = quad.xAxis[axis];
+                cluster.yAxis[axis] = quad.yAxis[axis];
+            }
+            cluster.quadCount = 1;
+            clusterQuads.push_back({i});
+        }
+    }
+
+    std::vector<Rect> rects;
+    for (size_t c = 0; c < m_clusters.size(); c++)
+    {
+        Cluster& cluster = m_clusters[c];
+        if (cluster.quadCount > 1)
+        {
+            AverageFrame(cluster, quads, clusterQuads[c]);
+        }
+
+        rects.clear();
+        for (uint32_t i : clusterQuads[c])
+        {
+            rects.push_back(ProjectQuad(cluster, quads[i]));
+        }
+        cluster.firstRect = static_cast<uint32_t>(m_rects.size());
+        MergeRects(rects, settings.snapDistance);
+        cluster.rectCount = static_cast<uint32_t>(m_rects.size()) - cluster.firstRect;
+    }
+
+    m_statistics.rectCount = static_cast<uint32_t>(m_rects.size());
+    for (const Rect& rect : m_rects)
+    {
+        m_statistics.rectArea += static_cast<double>(rect.max[0] - rect.min[0]) * (rect.max[1] - rect.min[1]);
+    }
+}
+
+bool CoplanarQuadMerger::FitQuad(const Cluster& cluster, const Quad& quad, float cosMaxAngle, float maxPlaneDistance)
+{
+    float normal[3];
+    float quadNormal[3];
+    Cross(cluster.xAxis, cluster.yAxis, normal);
+    Cross(quad.xAxis, quad.yAxis, quadNormal);
+    if (Dot(normal, quadNormal) < cosMaxAngle)
+    {
+        return false;
+    }
+
+    const float offset[3] = {
+        quad.center[0] - cluster.origin[0], quad.center[1] - cluster.origin[1], quad.center[2] - cluster.origin[2]};
+    if (std::abs(Dot(offset, normal)) > maxPlaneDistance)
+    {
+        return false;
+    }
+
+    // The edges of the quad must be parallel to the axes of the cluster, either way around.
+    return std::abs(Dot(quad.xAxis, cluster.xAxis)) >= cosMaxAngle || std::abs(Dot(quad.xAxis, cluster.yAxis)) >= cosMaxAngle;
+}
+
+void CoplanarQuadMerger::AverageFrame(Cluster& cluster, const Quad* quads, const std::vector<uint32_t>& clusterQuads)
+{
+    // The edge of each quad along the x axis of the cluster, pointing the same way, and the normals are summed up weighted by the area
+    // of the quads. The plane is moved to the area weighted mean distance of the centers.
+    float normal[3];
+    Cross(cluster.xAxis, cluster.yAxis, normal);
+    float xSum[3] = {0.0f, 0.0f, 0.0f};
+    float normalSum[3] = {0.0f, 0.0f, 0.0f};
+    float distanceSum = 0.0f;
+    float areaSum = 0.0f;
+    for (uint32_t i : clusterQuads)
+    {
+        const Quad& quad = quads[i];
+        const float area = quad.width * quad.height;
+        const bool swapped = std::abs(Dot(quad.xAxis, cluster.xAxis)) < std::abs(Dot(quad.xAxis, cluster.yAxis));
+        const float* edge = swapped ? quad.yAxis : quad.xAxis;
+        const float weight = Dot(edge, cluster.xAxis) < 0.0f ? -area : area;
+        float quadNormal[3];
+        Cross(quad.xAxis, quad.yAxis, quadNormal);
+        const float offset[3] = {
+            quad.center[0] - cluster.origin[0], quad.center[1] - cluster.origin[1], quad.center[2] - cluster.origin[2]};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            xSum[axis] += edge[axis] * weight;
+            normalSum[axis] += quadNormal[axis] * area;
+        }
+        distanceSum += Dot(offset, normal) * area;
+        areaSum += area;
+    }
+
+    Normalize(normalSum);
+    const float xDistance = Dot(xSum, normalSum);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        cluster.origin[axis] += normal[axis] * distanceSum / areaSum;
+        cluster.xAxis[axis] = xSum[axis] - normalSum[axis] * xDistance;
+    }
+    Normalize(cluster.xAxis);
+    Cross(normalSum, cluster.xAxis, cluster.yAxis);
+}
+
+CoplanarQuadMerger::Rect CoplanarQuadMerger::ProjectQuad(const Cluster& cluster, const Quad& quad)
+{
+    const float offset[3] = {
+        quad.center[0] - cluster.origin[0], quad.center[1] - cluster.origin[1], quad.center[2] - cluster.origin[2]};
+    const float center[2] = {Dot(offset, cluster.xAxis), Dot(offset, cluster.yAxis)};
+    const bool swapped = std::abs(Dot(quad.xAxis, cluster.xAxis)) < std::abs(Dot(quad.xAxis, cluster.yAxis));
+    const float halfSize[2] = {(swapped ? quad.height : quad.width) / 2, (swapped ? quad.width : quad.height) / 2};
+    return {{center[0] - halfSize[0], center[1] - halfSize[1]}, {center[0] + halfSize[0], center[1] + halfSize[1]}};
+}
+
+void CoplanarQuadMerger::SnapEdges(
+    const std::vector<Rect>& rects, int axis, float snapDistance, std::vector<float>& edges, std::vector<uint32_t>& indices)
+{
+    // The coordinate of min of rect i is at 2 * i, of max at 2 * i + 1.
+    std::vector<std::pair<float, uint32_t>> coordinates(rects.size() * 2);
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        coordinates[2 * i] = {rects[i].min[axis], static_cast<uint32_t>(2 * i)};
+        coordinates[2 * i + 1] = {rects[i].max[axis], static_cast<uint32_t>(2 * i + 1)};
+    }
+    std::sort(coordinates.begin(), coordinates.end());
+
+    // Coordinates within the snap distance of the first one of a run are snapped to it, so the runs don't creep.
+    edges.clear();
+    indices.resize(coordinates.size());
+    for (const auto& [coordinate, index] : coordinates)
+    {
+        if (edges.empty() || coordinate - edges.back() > snapDistance)
+        {
+            edges.push_back(coordinate);
+        }
+        indices[index] = static_cast<uint32_t>(edges.size() - 1);
+    }
+}
+
+void CoplanarQuadMerger::MergeRects(const std::vector<Rect>& rects, float snapDistance)
+{
+    if (rects.size() == 1)
+    {
+        m_rects.push_back(rects[0]);
+        return;
+    }
+
+    std::vector<float> edges[2];
+    std::vector<uint32_t> indices[2];
+    SnapEdges(rects, 0, snapDistance, edges[0], indices[0]);
+    SnapEdges(rects, 1, snapDistance, edges[1], indices[1]);
+    if (edges[0].size() < 2 || edges[1].size() < 2)
+    {
+        return;
+    }
+
+    // The cells of the grid between the edges which the rectangles cover. Rectangles thinner than the snap distance collapse and cover
+    // none.
+    const uint32_t columnCount = static_cast<uint32_t>(edges[0].size() - 1);
+    const uint32_t rowCount = static_cast<uint32_t>(edges[1].size() - 1);
+    std::vector<uint8_t> covered(static_cast<size_t>(columnCount) * rowCount, 0);
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        for (uint32_t row = indices[1][2 * i]; row < indices[1][2 * i + 1]; row++)
+        {
+            std::fill(
+                covered.begin() + static_cast<size_t>(row) * columnCount + indices[0][2 * i],
+                covered.begin() + static_cast<size_t>(row) * columnCount + indices[0][2 * i + 1],
+                uint8_t(1));
+        }
+    }
+
+    std::vector<uint32_t> cellRects[2];
+    SplitCells(covered, columnCount, rowCount, false, cellRects[0]);
+    SplitCells(covered, columnCount, rowCount, true, cellRects[1]);
+    const std::vector<uint32_t>& fewer = cellRects[1].size() < cellRects[0].size() ? cellRects[1] : cellRects[0];
+    for (size_t i = 0; i < fewer.size(); i += 4)
+    {
+        m_rects.push_back({{edges[0][fewer[i]], edges[1][fewer[i + 1]]}, {edges[0][fewer[i + 2]], edges[1][fewer[i + 3]]}});
+    }
+}
+
+void CoplanarQuadMerger::SplitCells(
+    const std::vector<uint8_t>& covered, uint32_t columnCount, uint32_t rowCount, bool transposed, std::vector<uint32_t>& cellRects)
+{
+    const uint32_t lineCount = transposed ? columnCount : rowCount;
+    const uint32_t lineLength = transposed ? rowCount : columnCount;
+    auto isCovered = [&](uint32_t line, uint32_t position) {
+        const uint32_t row = transposed ? position : line;
+        const uint32_t column = transposed ? line : position;
+        return covered[static_cast<size_t>(row) * columnCount + column] != 0;
+    };
+    // Appends the cells of a run from its first line to before line as column, row, end column, end row.
+    auto closeRun = [&](const Run& run, uint32_t line) {
+        if (transposed)
+        {
+            cellRects.insert(cellRects.end(), {run.firstLine, run.begin, line, run.end});
+        }
+        else
+        {
+            cellRects.insert(cellRects.end(), {run.begin, run.firstLine, run.end, line});
+        }
+    };
+
+    // The runs of the previous line, and of the current one. Both are sorted and don't overlap, so the runs which continue a run of the
+    // same columns are found by walking both at once.
+    std::vector<Run> open;
+    std::vector<Run> current;
+    for (uint32_t line = 0; line < lineCount; line++)
+    {
+        current.clear();
+        size_t previous = 0;
+        for (uint32_t position = 0; position < lineLength;)
+        {
+            if (!isCovered(line, position))
+            {
+                position++;
+                continue;
+            }
+            Run run = {position, position, line};
+            while (run.end < lineLength && isCovered(line, run.end))
+            {
+                run.end++;
+            }
+            position = run.end;
+
+            while (previous < open.size() && open[previous].begin < run.begin)
+            {
+                closeRun(open[previous++], line);
+            }
+            if (previous < open.size() && open[previous].begin == run.begin && open[previous].end == run.end)
+            {
+                run.firstLine = open[previous++].firstLine;
+            }
+            current.push_back(run);
+        }
+        while (previous < open.size())
+        {
+            closeRun(open[previous++], line);
+        }
+        std::swap(open, current);
+    }
+    for (const Run& run : open)
+    {
+        closeRun(run, lineCount);
+    }
+}
+
+void CoplanarQuadMerger::GetPosition(const Cluster& cluster, float x, float y, float position[3])
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        position[axis] = cluster.origin[axis] + cluster.xAxis[axis] * x + cluster.yAxis[axis] * y;
+    }
+}
@@ -0,0 +1,131 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Merges rectangles in 3D which lie in the same plane, e.g. the quads of a wall which scene understanding returns in pieces, into fewer
+// rectangles which don't overlap.
+//
+// The quads are clustered by their group, e.g. the kind of their object, by their plane within a normal angle and distance tolerance, and
+// by their orientation in the plane, which must be the same up to multiples of 90 degrees. A cluster has a frame in its plane, with the
+// origin at the corner of its first quad and the average orientation of its quads. The quads of a cluster are projected into the frame,
+// and their edges which are closer than the snap distance are moved onto each other, which closes small gaps and removes slivers. The
+// union of the quads is then split into rectangles along rows and along columns of the grid of the edges, whichever gives fewer. That is
+// optimal for the usual shapes, e.g. a floor around a pillar, though not for all. Positions are x, y, z floats, the axes must be unit
+// vectors orthogonal to each other.
+class CoplanarQuadMerger
+{
+public:
+    struct Settings
+    {
+        // The largest angle between the normals of the quads of a cluster, and between their edges up to multiples of 90 degrees, in
+        // radians.
+        float maxAngle = 0.02f;
+        // The largest distance of the center of a quad to the plane of a cluster.
+        float maxPlaneDistance = 0.02f;
+        // Edges closer than this are moved onto each other.
+        float snapDistance = 0.005f;
+    };
+
+    // A rectangle of width along xAxis and height along yAxis around the center, facing cross(xAxis, yAxis).
+    struct Quad
+    {
+        uint32_t group = 0;
+        float center[3];
+        float xAxis[3];
+        float yAxis[3];
+        float width = 0.0f;
+        float height = 0.0f;
+    };
+
+    // A rectangle in the frame of its cluster.
+    struct Rect
+    {
+        float min[2];
+        float max[2];
+    };
+
+    // The rectangles of a cluster are [firstRect, firstRect + rectCount) of GetRects().
+    struct Cluster
+    {
+        uint32_t group;
+        float origin[3];
+        float xAxis[3];
+        float yAxis[3];
+        uint32_t firstRect;
+        uint32_t rectCount;
+        uint32_t quadCount;
+    };
+
+    struct Statistics
+    {
+        uint32_t quadCount = 0;
+        uint32_t rectCount = 0;
+        // The area of the quads, which is drawn more than once where they overlap, and the area of the rectangles, drawn once.
+        double quadArea = 0.0;
+        double rectArea = 0.0;
+    };
+
+    // Merges count quads, replacing the previous clusters.
+    void Merge(const Quad* quads, uint32_t count, const Settings& settings);
+
+    const std::vector<Cluster>& GetClusters() const
+    {
+        return m_clusters;
+    }
+
+    const std::vector<Rect>& GetRects() const
+    {
+        return m_rects;
+    }
+
+    const Statistics& GetStatistics() const
+    {
+        return m_statistics;
+    }
+
+    // Returns the position of the point x, y in the frame of the cluster.
+    static void GetPosition(const Cluster& cluster, float x, float y, float position[3]);
+
+private:
+    // Returns true if the quad is in the plane of the cluster and its edges are parallel to the axes.
+    static bool FitQuad(const Cluster& cluster, const Quad& quad, float cosMaxAngle, float maxPlaneDistance);
+
+    // Replaces the frame of the cluster, which is the one of its first quad, by the average of the quads, so that the quads far from the
+    // first one are projected into it as accurately as the ones near it.
+    static void AverageFrame(Cluster& cluster, const Quad* quads, const std::vector<uint32_t>& clusterQuads);
+
+    // Returns the rectangle of the quad in the frame of the cluster.
+    static Rect ProjectQuad(const Cluster& cluster, const Quad& quad);
+
+    // Appends the rectangles of the union of the rectangles of a cluster to m_rects.
+    void MergeRects(const std::vector<Rect>& rects, float snapDistance);
+
+    // Sorts the coordinates of an axis of the rectangles, and maps each one to the index of its snapped value in edges.
+    static void SnapEdges(
+        const std::vector<Rect>& rects, int axis, float snapDistance, std::vector<float>& edges, std::vector<uint32_t>& indices);
+
+    // Splits the covered cells of the grid into runs along the rows, and merges the runs of the same columns of consecutive rows.
+    // transposed swaps the rows and the columns.
+    static void SplitCells(
+        const std::vector<uint8_t>& covered,
+        uint32_t columnCount,
+        uint32_t rowCount,
+        bool transposed,
+        std::vector<uint32_t>& cellRects);
+
+    std::vector<Cluster> m_clusters;
+    std::vector<Rect> m_rects;
+    Statistics m_statistics;
+};
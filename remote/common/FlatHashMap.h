@@ -0,0 +1,341 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace Utils
+{
+    // Open addressing hash map which stores its values densely packed in a single array.
+    //
+    // Lookups use linear probing over a power of two sized bucket array that only holds the cached hash and a slot index, so probing
+    // never touches the values. Values are kept contiguous (erase swaps the last value into the hole), which makes iteration a plain
+    // array walk. Since values move on erase, pointers to values are only valid until the next insert or erase. Use a Handle to refer
+    // to an entry over a longer period of time, handles stay valid until the entry itself is erased.
+    template <typename Key, typename Value, typename Hash, typename KeyEqual = std::equal_to<Key>>
+    class FlatHashMap
+    {
+    public:
+        struct Handle
+        {
+            uint32_t index = InvalidIndex;
+            uint32_t generation = 0;
+
+            bool IsValid() const
+            {
+                return index != InvalidIndex;
+            }
+        };
+
+        using iterator = typename std::vector<Value>::iterator;
+        using const_iterator = typename std::vector<Value>::const_iterator;
+
+        FlatHashMap() = default;
+
+        // Returns the handle of the entry with the given key or an invalid handle if there is none.
+        Handle Find(const Key& key) const
+        {
+            const uint32_t bucket = FindBucket(key, HashKey(key));
+            if (bucket == InvalidIndex)
+            {
+                return {};
+            }
+
+            const uint32_t slot = m_buckets[bucket].slot;
+            return {slot, m_slots[slot].generation};
+        }
+
+        // Returns the value referenced by the handle or nullptr if the entry was erased in the meantime.
+        Value* Get(Handle handle)
+        {
+            return IsAlive(handle) ? &m_values[m_slots[handle.index].denseIndex] : nullptr;
+        }
+
+        const Value* Get(Handle handle) const
+        {
+            return IsAlive(handle) ? &m_values[m_slots[handle.index].denseIndex] : nullptr;
+        }
+
+        Value* Get(const Key& key)
+        {
+            return Get(Find(key));
+        }
+
+        // Inserts a value constructed from args if the key is not present yet. Returns the handle of the entry and whether it was inserted.
+        template <typename... Args>
+        std::pair<Handle, bool> TryEmplace(const Key& key, Args&&... args)
+        {
+            const uint32_t hash = HashKey(key);
+            const uint32_t existing = FindBucket(key, hash);
+            if (existing != InvalidIndex)
+            {
+                const uint32_t slot = m_buckets[existing].slot;
+                return {{slot, m_slots[slot].generation}, false};
+            }
+
+            if ((m_values.size() + 1) * 2 > m_buckets.size())
+            {
+                Rehash(m_buckets.empty() ? MinBucketCount : static_cast<uint32_t>(m_buckets.size()) * 2);
+            }
+
+            uint32_t slot;
+            if (!m_freeSlots.empty())
+            {
+                slot = m_freeSlots.back();
+                m_freeSlots.pop_back();
+            }
+            else
+            {
+                slot = static_cast<uint32_t>(m_slots.size());
+                m_slots.push_back({});
+            }
+
+            m_slots[slot].denseIndex = static_cast<uint32_t>(m_values.size());
+            m_values.emplace_back(std::forward<Args>(args)...);
+            m_keys.push_back(key);
+            m_denseToSlot.push_back(slot);
+
+            InsertBucket(hash, slot);
+
+            return {{slot, m_slots[slot].generation}, true};
+        }
+
+        // Erases the entry with the given key. Returns false if there is no such entry.
+        bool Erase(const Key& key)
+        {
+            const uint32_t bucket = FindBucket(key, HashKey(key));
+            if (bucket == InvalidIndex)
+            {
+                return false;
+            }
+
+            EraseBucket(bucket);
+            return true;
+        }
+
+        // Erases all entries for which predicate(value) returns true. Returns the number of erased entries.
+        template <typename Predicate>
+        size_t EraseIf(Predicate predicate)
+        {
+            size_t erased = 0;
+            for (size_t i = m_values.size(); i-- > 0;)
+            {
+                if (predicate(m_values[i]))
+                {
+                    Erase(Key(m_keys[i]));
+                    erased++;
+                }
+            }
+            return erased;
+        }
+
+        void Clear()
+        {
+            // Invalidate all outstanding handles.
+            for (uint32_t slot : m_denseToSlot)
+            {
+                m_slots[slot].generation++;
+                m_freeSlots.push_back(slot);
+            }
+
+            m_values.clear();
+            m_keys.clear();
+            m_denseToSlot.clear();
+            std::fill(m_buckets.begin(), m_buckets.end(), Bucket{});
+        }
+
+        void Reserve(size_t count)
+        {
+            uint32_t bucketCount = MinBucketCount;
+            while (bucketCount < count * 2)
+            {
+                bucketCount *= 2;
+            }
+
+            if (bucketCount > m_buckets.size())
+            {
+                Rehash(bucketCount);
+            }
+
+            m_values.reserve(count);
+            m_keys.reserve(count);
+            m_denseToSlot.reserve(count);
+        }
+
+        size_t Size() const
+        {
+            return m_values.size();
+        }
+
+        bool Empty() const
+        {
+            return m_values.empty();
+        }
+
+        // Key of the value at the given position in the dense value array.
+        const Key& KeyAt(size_t denseIndex) const
+        {
+            return m_keys[denseIndex];
+        }
+
+        // Handle of the value at the given position in the dense value array.
+        Handle HandleAt(size_t denseIndex) const
+        {
+            const uint32_t slot = m_denseToSlot[denseIndex];
+            return {slot, m_slots[slot].generation};
+        }
+
+        iterator begin()
+        {
+            return m_values.begin();
+        }
+
+        iterator end()
+        {
+            return m_values.end();
+        }
+
+        const_iterator begin() const
+        {
+            return m_values.begin();
+        }
+
+        const_iterator end() const
+        {
+            return m_values.end();
+        }
+
+    private:
+        static constexpr uint32_t InvalidIndex = ~0u;
+        static constexpr uint32_t MinBucketCount = 16;
+
+        struct Bucket
+        {
+            uint32_t hash = 0;
+            uint32_t slot = InvalidIndex;
+        };
+
+        struct Slot
+        {
+            uint32_t denseIndex = InvalidIndex;
+            uint32_t generation = 0;
+        };
+
+        static uint32_t HashKey(const Key& key)
+        {
+            return static_cast<uint32_t>(Hash{}(key));
+        }
+
+        bool IsAlive(Handle handle) const
+        {
+            return handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation &&
+                   m_slots[handle.index].denseIndex != InvalidIndex;
+        }
+
+        uint32_t FindBucket(const Key& key, uint32_t hash) const
+        {
+            if (m_buckets.empty())
+            {
+                return InvalidIndex;
+            }
+
+            const uint32_t mask = static_cast<uint32_t>(m_buckets.size()) - 1;
+            for (uint32_t bucket = hash & mask;; bucket = (bucket + 1) & mask)
+            {
+                const Bucket& entry = m_buckets[bucket];
+                if (entry.slot == InvalidIndex)
+                {
+                    return InvalidIndex;
+                }
+
+                if (entry.hash == hash && KeyEqual{}(m_keys[m_slots[entry.slot].denseIndex], key))
+                {
+                    return bucket;
+                }
+            }
+        }
+
+        void InsertBucket(uint32_t hash, uint32_t slot)
+        {
+            const uint32_t mask = static_cast<uint32_t>(m_buckets.size()) - 1;
+            uint32_t bucket = hash & mask;
+            while (m_buckets[bucket].slot != InvalidIndex)
+            {
+                bucket = (bucket + 1) & mask;
+            }
+            m_buckets[bucket] = {hash, slot};
+        }
+
+        void EraseBucket(uint32_t bucket)
+        {
+            const uint32_t slot = m_buckets[bucket].slot;
+            const uint32_t denseIndex = m_slots[slot].denseIndex;
+
+            // Backward shift deletion keeps the probe sequences intact without tombstones.
+            const uint32_t mask = static_cast<uint32_t>(m_buckets.size()) - 1;
+            uint32_t hole = bucket;
+            for (uint32_t next = (hole + 1) & mask; m_buckets[next].slot != InvalidIndex; next = (next + 1) & mask)
+            {
+                const uint32_t ideal = m_buckets[next].hash & mask;
+                const bool movable = (hole <= next) ? (ideal <= hole || ideal > next) : (ideal <= hole && ideal > next);
+                if (movable)
+                {
+                    m_buckets[hole] = m_buckets[next];
+                    hole = next;
+                }
+            }
+            m_buckets[hole] = Bucket{};
+
+            // Fill the gap in the dense arrays with the last element.
+            const uint32_t lastIndex = static_cast<uint32_t>(m_values.size()) - 1;
+            if (denseIndex != lastIndex)
+            {
+                m_values[denseIndex] = std::move(m_values[lastIndex]);
+                m_keys[denseIndex] = std::move(m_keys[lastIndex]);
+                m_denseToSlot[denseIndex] = m_denseToSlot[lastIndex];
+                m_slots[m_denseToSlot[denseIndex]].denseIndex = denseIndex;
+            }
+            m_values.pop_back();
+            m_keys.pop_back();
+            m_denseToSlot.pop_back();
+
+            m_slots[slot].denseIndex = InvalidIndex;
+            m_slots[slot].generation++;
+            m_freeSlots.push_back(slot);
+        }
+
+        void Rehash(uint32_t bucketCount)
+        {
+            assert((bucketCount & (bucketCount - 1)) == 0);
+
+            m_buckets.assign(bucketCount, Bucket{});
+            for (size_t i = 0; i < m_keys.size(); ++i)
+            {
+                InsertBucket(HashKey(m_keys[i]), m_denseToSlot[i]);
+            }
+        }
+
+        std::vector<Bucket> m_buckets;
+        std::vector<Slot> m_slots;
+        std::vector<uint32_t> m_freeSlots;
+
+        // Dense arrays, all indexed by the same dense index.
+        std::vector<Value> m_values;
+        std::vector<Key> m_keys;
+        std::vector<uint32_t> m_denseToSlot;
+    };
+} // namespace Utils
@@ -0,0 +1,94 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <FrameArena.h>
+
+#include <algorithm>
+#include <bit>
+
+FrameArena::FrameArena(size_t capacity)
+    : m_block(new uint8_t[capacity])
+    , m_capacity(capacity)
+{
+    m_statistics.heapAllocationCount = 1;
+}
+
+uint8_t* FrameArena::Bump(uint8_t* block, size_t capacity, size_t& offset, size_t size, size_t alignment)
+{
+    assert(std::has_single_bit(alignment));
+    const uintptr_t address = reinterpret_cast<uintptr_t>(block) + offset;
+    const size_t aligned = offset + ((alignment - address % alignment) % alignment);
+    if (aligned > capacity || size > capacity - aligned)
+    {
+        return nullptr;
+    }
+    offset = aligned + size;
+    return block + aligned;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    m_statistics.allocationCount++;
+    m_statistics.allocatedBytes += size;
+
+    const size_t previousOffset = m_offset;
+    uint8_t* memory = Bump(m_block.get(), m_capacity, m_offset, size, alignment);
+    if (memory)
+    {
+        m_statistics.usedBytes += m_offset - previousOffset;
+    }
+    else
+    {
+        // Only the last overflow block may have room left, the ones before were full when it was added.
+        m_statistics.overflowCount++;
+        OverflowBlock* overflow = m_overflowBlocks.empty() ? nullptr : &m_overflowBlocks.back();
+        const size_t previousOverflowOffset = overflow ? overflow->offset : 0;
+        memory = overflow ? Bump(overflow->memory.get(), overflow->capacity, overflow->offset, size, alignment) : nullptr;
+        if (memory)
+        {
+            m_statistics.usedBytes += overflow->offset - previousOverflowOffset;
+        }
+        else
+        {
+            const size_t capacity = std::max(m_capacity, size + alignment);
+            overflow = &m_overflowBlocks.emplace_back(OverflowBlock{std::unique_ptr<uint8_t[]>(new uint8_t[capacity]), capacity, 0});
+            m_statistics.heapAllocationCount++;
+            memory = Bump(overflow->memory.get(), overflow->capacity, overflow->offset, size, alignment);
+            m_statistics.usedBytes += overflow->offset;
+        }
+    }
+
+    m_statistics.peakUsedBytes = std::max(m_statistics.peakUsedBytes, m_statistics.usedBytes);
+    return memory;
+}
+
+void FrameArena::Reset()
+{
+    // After an overflow the block grows to twice what the frame used, so that frames which need a bit more still fit.
+    if (!m_overflowBlocks.empty())
+    {
+        m_capacity = std::bit_ceil(m_statistics.usedBytes * 2);
+        m_block.reset(new uint8_t[m_capacity]);
+        m_statistics.heapAllocationCount++;
+        m_overflowBlocks.clear();
+    }
+
+    m_offset = 0;
+    m_statistics.usedBytes = 0;
+    m_statistics.frameCount++;
+}
+
+FrameArena::Statistics FrameArena::GetStatistics() const
+{
+    Statistics statistics = m_statistics;
+    statistics.capacity = m_capacity;
+    return statistics;
+}
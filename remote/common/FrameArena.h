@@ -0,0 +1,199 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for data which only lives for one frame, e.g. the vertices a renderer builds for the frame.
+//
+// Allocations are carved from one block, front to back, and are never freed one by one. Reset() at the start of a frame takes all of them
+// back at once. An allocation which doesn't fit into the block falls back to an overflow block from the heap, and the next Reset() grows
+// the block to what the frame used, so that the following frames fit again. In steady state the arena doesn't allocate from the heap at
+// all. Destructors are never run, so only trivially destructible types can be stored. Not thread safe.
+class FrameArena
+{
+public:
+    // A growable array in the arena, which stays valid until the arena is reset. Growing copies the elements to a new allocation and leaves
+    // the old one unused until then, so the capacity should be reserved up front if it is known.
+    template <typename T>
+    class Array
+    {
+        static_assert(std::is_trivially_destructible_v<T> && std::is_trivially_copyable_v<T>, "FrameArena never destroys its contents");
+
+    public:
+        Array() = default;
+
+        explicit Array(FrameArena& arena, size_t capacity = 0)
+            : m_arena(&arena)
+        {
+            reserve(capacity);
+        }
+
+        void reserve(size_t capacity)
+        {
+            if (capacity > m_capacity)
+            {
+                T* data = m_arena->Allocate<T>(capacity);
+                std::uninitialized_copy(m_data, m_data + m_size, data);
+                m_data = data;
+                m_capacity = capacity;
+            }
+        }
+
+        template <typename... Args>
+        T& emplace_back(Args&&... args)
+        {
+            if (m_size == m_capacity)
+            {
+                reserve(m_capacity < 8 ? 8 : m_capacity * 2);
+            }
+            return *new (m_data + m_size++) T(std::forward<Args>(args)...);
+        }
+
+        void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        // Returns room for count more elements at the end, which the caller fills in.
+        T* grow(size_t count)
+        {
+            reserve(m_size + count);
+            T* end = m_data + m_size;
+            m_size += count;
+            return end;
+        }
+
+        void clear()
+        {
+            m_size = 0;
+        }
+
+        T* data()
+        {
+            return m_data;
+        }
+
+        const T* data() const
+        {
+            return m_data;
+        }
+
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        T& operator[](size_t index)
+        {
+            assert(index < m_size);
+            return m_data[index];
+        }
+
+        const T& operator[](size_t index) const
+        {
+            assert(index < m_size);
+            return m_data[index];
+        }
+
+        T* begin()
+        {
+            return m_data;
+        }
+
+        T* end()
+        {
+            return m_data + m_size;
+        }
+
+        const T* begin() const
+        {
+            return m_data;
+        }
+
+        const T* end() const
+        {
+            return m_data + m_size;
+        }
+
+    private:
+        FrameArena* m_arena = nullptr;
+        T* m_data = nullptr;
+        size_t m_size = 0;
+        size_t m_capacity = 0;
+    };
+
+    struct Statistics
+    {
+        uint64_t frameCount = 0;
+        uint64_t allocationCount = 0;
+        uint64_t allocatedBytes = 0;
+        // Allocations which didn't fit into the block and went to an overflow block.
+        uint64_t overflowCount = 0;
+        // Blocks the arena allocated from the heap, including the first one and the overflow blocks.
+        uint64_t heapAllocationCount = 0;
+        size_t capacity = 0;
+        // Bytes used in the current frame, including the overflow blocks and alignment padding.
+        size_t usedBytes = 0;
+        size_t peakUsedBytes = 0;
+    };
+
+    explicit FrameArena(size_t capacity);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Returns uninitialized memory. alignment must be a power of two.
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* Allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "FrameArena never destroys its contents");
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Starts a new frame, all allocations of the previous one become invalid.
+    void Reset();
+
+    Statistics GetStatistics() const;
+
+private:
+    // Returns the memory at the offset of the block aligned, or nullptr if size doesn't fit.
+    static uint8_t* Bump(uint8_t* block, size_t capacity, size_t& offset, size_t size, size_t alignment);
+
+    std::unique_ptr<uint8_t[]> m_block;
+    size_t m_capacity;
+    size_t m_offset = 0;
+
+    struct OverflowBlock
+    {
+        std::unique_ptr<uint8_t[]> memory;
+        size_t capacity;
+        size_t offset;
+    };
+    std::vector<OverflowBlock> m_overflowBlocks;
+
+    Statistics m_statistics;
+};
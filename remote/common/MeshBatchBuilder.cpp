@@ -0,0 +1,86 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <MeshBatchBuilder.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+void MeshBatchBuilder::RebaseIndices(uint32_t* destination, const uint16_t* indices, uint32_t indexCount, uint32_t slot)
+{
+    assert(slot < MaxSlotCount);
+
+    const uint32_t high = slot << 16;
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        destination[i] = high | indices[i];
+    }
+}
+
+void MeshBatchBuilder::Begin()
+{
+    std::swap(m_ranges, m_previousRanges);
+    m_ranges.clear();
+    m_partDataCount = 0;
+    m_indexCount = 0;
+}
+
+void MeshBatchBuilder::AddPart(uint32_t slot, const float* model, uint32_t baseVertex, uint32_t indexOffset, uint32_t indexCount)
+{
+    assert(slot < MaxSlotCount);
+
+    if (slot >= m_partData.size())
+    {
+        m_partData.resize(std::max<size_t>(slot + 1, m_partData.size() * 2));
+    }
+
+    PartData& partData = m_partData[slot];
+    memcpy(partData.model, model, sizeof(partData.model));
+    partData.baseVertex = baseVertex;
+    m_partDataCount = std::max(m_partDataCount, slot + 1);
+
+    if (indexCount > 0)
+    {
+        m_ranges.push_back({indexOffset, 0, indexCount});
+    }
+}
+
+bool MeshBatchBuilder::End()
+{
+    // In source order, ranges which continue each other (e.g. neighboring parts in the shared index buffer) become a single copy.
+    std::sort(m_ranges.begin(), m_ranges.end(), [](const CopyRange& a, const CopyRange& b) { return a.sourceOffset < b.sourceOffset; });
+
+    size_t rangeCount = 0;
+    for (size_t i = 0; i < m_ranges.size(); i++)
+    {
+        if (rangeCount > 0 && m_ranges[rangeCount - 1].sourceOffset + m_ranges[rangeCount - 1].count == m_ranges[i].sourceOffset)
+        {
+            m_ranges[rangeCount - 1].count += m_ranges[i].count;
+        }
+        else
+        {
+            m_ranges[rangeCount++] = m_ranges[i];
+        }
+    }
+    m_ranges.resize(rangeCount);
+
+    for (CopyRange& range : m_ranges)
+    {
+        range.destinationOffset = m_indexCount;
+        m_indexCount += range.count;
+    }
+
+    const bool changed = m_invalidated || m_ranges.size() != m_previousRanges.size() ||
+                         memcmp(m_ranges.data(), m_previousRanges.data(), m_ranges.size() * sizeof(CopyRange)) != 0;
+    m_invalidated = false;
+    return changed;
+}
@@ -0,0 +1,99 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// CPU side of drawing many mesh parts, which live in shared vertex and index buffers, with a single draw call.
+//
+// Every part has a small, stable slot number. Its 16 bit triangle indices are rebased once, when the mesh is uploaded, into 32 bit batch
+// indices which carry the slot in the high half (see RebaseIndices). The vertex shader splits them up again, looks up the transform and
+// first vertex of the part by slot, and fetches the vertex itself. So moving a part's vertices only changes its per part data, and the
+// index ranges of any set of parts can be concatenated and drawn at once.
+//
+// Each frame, the visible parts are added with their transform and the index range of their selected level of detail. End() packs the
+// per part data, and merges the index ranges into as few copies into the batch index buffer as possible. The copies only have to be
+// redone if the ranges differ from the previous frame.
+class MeshBatchBuilder
+{
+public:
+    static constexpr uint32_t MaxSlotCount = 1 << 16;
+    static constexpr uint32_t MaxPartVertexCount = 1 << 16;
+
+    // Per part data as read by the vertex shader, indexed by slot.
+    struct PartData
+    {
+        float model[16];
+        uint32_t baseVertex;
+        uint32_t padding[3];
+    };
+
+    // Copies count indices from sourceOffset in the shared index buffer to destinationOffset in the batch index buffer.
+    struct CopyRange
+    {
+        uint32_t sourceOffset;
+        uint32_t destinationOffset;
+        uint32_t count;
+    };
+
+    // Converts part local indices into batch indices of the part in slot.
+    static void RebaseIndices(uint32_t* destination, const uint16_t* indices, uint32_t indexCount, uint32_t slot);
+
+    void Begin();
+
+    // Adds a part to the batch. model is the 4x4 transform in the layout expected by the shader, baseVertex the position of the first
+    // vertex of the part in the shared vertex buffer, and [indexOffset, indexOffset + indexCount) the batch indices to draw from the
+    // shared index buffer.
+    void AddPart(uint32_t slot, const float* model, uint32_t baseVertex, uint32_t indexOffset, uint32_t indexCount);
+
+    // Finishes the batch. Returns true if the index ranges changed since the previous batch, or since Invalidate() was called, in which
+    // case all copy ranges have to be executed again.
+    bool End();
+
+    // Forces the next End() to report a change, e.g. because the content of the shared index buffer changed.
+    void Invalidate()
+    {
+        m_invalidated = true;
+    }
+
+    // Per part data of all slots up to the highest one in this batch. Slots which are not part of the batch hold stale data.
+    const PartData* GetPartData() const
+    {
+        return m_partData.data();
+    }
+
+    uint32_t GetPartDataCount() const
+    {
+        return m_partDataCount;
+    }
+
+    const std::vector<CopyRange>& GetCopyRanges() const
+    {
+        return m_ranges;
+    }
+
+    // Total number of batch indices to draw, after executing the copies.
+    uint32_t GetIndexCount() const
+    {
+        return m_indexCount;
+    }
+
+private:
+    std::vector<PartData> m_partData;
+    uint32_t m_partDataCount = 0;
+
+    std::vector<CopyRange> m_ranges;
+    std::vector<CopyRange> m_previousRanges;
+    uint32_t m_indexCount = 0;
+    bool m_invalidated = true;
+};
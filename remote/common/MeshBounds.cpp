@@ -0,0 +1,110 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <MeshBounds.h>
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_BOUNDS_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__) || defined(__ARM_NEON)
+#define MESH_BOUNDS_NEON
+#include <arm_neon.h>
+#endif
+
+SnormBounds ComputeSnormBounds(const int16_t* positions, uint32_t count)
+{
+    SnormBounds bounds;
+    uint32_t i = 0;
+
+#if defined(MESH_BOUNDS_SSE2)
+    // Each 128 bit register holds two vertices. Four independent loads per iteration keep the min/max chains short.
+    if (count >= 8)
+    {
+        const __m128i* data = reinterpret_cast<const __m128i*>(positions);
+        __m128i min0 = _mm_set1_epi16(INT16_MAX), min1 = min0;
+        __m128i max0 = _mm_set1_epi16(INT16_MIN), max1 = max0;
+        for (; i + 8 <= count; i += 8, data += 4)
+        {
+            const __m128i a = _mm_loadu_si128(data + 0);
+            const __m128i b = _mm_loadu_si128(data + 1);
+            const __m128i c = _mm_loadu_si128(data + 2);
+            const __m128i d = _mm_loadu_si128(data + 3);
+            min0 = _mm_min_epi16(min0, _mm_min_epi16(a, b));
+            min1 = _mm_min_epi16(min1, _mm_min_epi16(c, d));
+            max0 = _mm_max_epi16(max0, _mm_max_epi16(a, b));
+            max1 = _mm_max_epi16(max1, _mm_max_epi16(c, d));
+        }
+
+        // Fold the two vertices of each register into one.
+        __m128i min = _mm_min_epi16(min0, min1);
+        __m128i max = _mm_max_epi16(max0, max1);
+        min = _mm_min_epi16(min, _mm_unpackhi_epi64(min, min));
+        max = _mm_max_epi16(max, _mm_unpackhi_epi64(max, max));
+
+        alignas(16) int16_t minLanes[8];
+        alignas(16) int16_t maxLanes[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(minLanes), min);
+        _mm_store_si128(reinterpret_cast<__m128i*>(maxLanes), max);
+        for (int k = 0; k < 3; k++)
+        {
+            bounds.min[k] = minLanes[k];
+            bounds.max[k] = maxLanes[k];
+        }
+    }
+#elif defined(MESH_BOUNDS_NEON)
+    if (count >= 8)
+    {
+        int16x8_t min0 = vdupq_n_s16(INT16_MAX), min1 = min0;
+        int16x8_t max0 = vdupq_n_s16(INT16_MIN), max1 = max0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const int16_t* data = positions + size_t(i) * 4;
+            const int16x8_t a = vld1q_s16(data + 0);
+            const int16x8_t b = vld1q_s16(data + 8);
+            const int16x8_t c = vld1q_s16(data + 16);
+            const int16x8_t d = vld1q_s16(data + 24);
+            min0 = vminq_s16(min0, vminq_s16(a, b));
+            min1 = vminq_s16(min1, vminq_s16(c, d));
+            max0 = vmaxq_s16(max0, vmaxq_s16(a, b));
+            max1 = vmaxq_s16(max1, vmaxq_s16(c, d));
+        }
+
+        const int16x8_t min = vminq_s16(min0, min1);
+        const int16x8_t max = vmaxq_s16(max0, max1);
+        const int16x4_t minFolded = vmin_s16(vget_low_s16(min), vget_high_s16(min));
+        const int16x4_t maxFolded = vmax_s16(vget_low_s16(max), vget_high_s16(max));
+
+        int16_t minLanes[4];
+        int16_t maxLanes[4];
+        vst1_s16(minLanes, minFolded);
+        vst1_s16(maxLanes, maxFolded);
+        for (int k = 0; k < 3; k++)
+        {
+            bounds.min[k] = minLanes[k];
+            bounds.max[k] = maxLanes[k];
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        const int16_t* position = positions + size_t(i) * 4;
+        for (int k = 0; k < 3; k++)
+        {
+            bounds.min[k] = std::min(bounds.min[k], position[k]);
+            bounds.max[k] = std::max(bounds.max[k], position[k]);
+        }
+    }
+
+    return bounds;
+}
@@ -0,0 +1,30 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// Axis aligned bounds of quantized mesh positions, in SNORM units.
+struct SnormBounds
+{
+    int16_t min[3] = {INT16_MAX, INT16_MAX, INT16_MAX};
+    int16_t max[3] = {INT16_MIN, INT16_MIN, INT16_MIN};
+
+    bool IsEmpty() const
+    {
+        return min[0] > max[0];
+    }
+};
+
+// Computes the bounds of count positions stored as four int16 components each (xyzw, w is ignored), like the R16G16B16A16IntNormalized
+// vertex buffers of spatial mapping. Uses SSE2 or NEON where available, eight vertices per iteration.
+SnormBounds ComputeSnormBounds(const int16_t* positions, uint32_t count);
@@ -0,0 +1,594 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <MeshCache.h>
+
+#include <ContentHash.h>
+
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr uint32_t FileMagic = 0x434D5253;   // "SRMC"
+    constexpr uint32_t RecordMagic = 0x524D5253; // "SRMR"
+
+    // Superseded records are only dropped once there are at least this many bytes of them.
+    constexpr uint64_t MinCompactionSize = 1024 * 1024;
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t reserved;
+    };
+
+    struct RecordHeader
+    {
+        uint32_t magic;
+        uint32_t size;
+        uint8_t id[16];
+        int64_t updateTime;
+        uint64_t contentHash;
+        uint64_t payloadHash;
+        float vertexScale[3];
+        float center[3];
+        float extents[3];
+        float boundsCenter[3];
+        float boundsOrientation[4];
+        uint32_t vertexCount;
+        uint32_t lodCount;
+        uint32_t lodIndexCounts[MeshCache::MaxLodCount];
+    };
+
+    static_assert(std::endian::native == std::endian::little, "The cache file is read and written in native byte order.");
+    static_assert(sizeof(FileHeader) == 16 && sizeof(RecordHeader) == 136, "The layout of the file format must not change.");
+    static_assert(sizeof(RecordHeader) % 8 == 0, "Records are aligned to 8 bytes.");
+
+    uint64_t AlignRecordSize(uint64_t size)
+    {
+        return (size + 7) & ~uint64_t(7);
+    }
+
+    uint64_t GetPayloadSize(uint32_t vertexCount, uint64_t indexCount)
+    {
+        return vertexCount * 4ull * sizeof(int16_t) + indexCount * sizeof(uint16_t);
+    }
+
+    // Checks everything about a record which does not require reading its payload.
+    bool IsValidRecord(const RecordHeader& header, uint64_t offset, uint64_t fileSize)
+    {
+        if (header.magic != RecordMagic || header.lodCount > MeshCache::MaxLodCount || header.size < sizeof(RecordHeader) ||
+            header.size % 8 != 0 || offset + header.size > fileSize)
+        {
+            return false;
+        }
+
+        uint64_t indexCount = 0;
+        for (uint32_t lod = 0; lod < header.lodCount; lod++)
+        {
+            indexCount += header.lodIndexCounts[lod];
+        }
+
+        return header.size == AlignRecordSize(sizeof(RecordHeader) + GetPayloadSize(header.vertexCount, indexCount));
+    }
+} // namespace
+
+uint32_t MeshCache::Mesh::GetIndexCount() const
+{
+    uint32_t indexCount = 0;
+    for (uint32_t lod = 0; lod < lodCount; lod++)
+    {
+        indexCount += lodIndexCounts[lod];
+    }
+    return indexCount;
+}
+
+MeshCache::MeshCache(std::filesystem::path path)
+    : m_path(std::move(path))
+{
+    std::scoped_lock lock(m_mutex);
+    if (!Load())
+    {
+        UnmapCacheFile();
+        CloseCacheFile();
+        m_entries.Clear();
+        m_liveSize = 0;
+    }
+}
+
+MeshCache::~MeshCache()
+{
+    UnmapCacheFile();
+    CloseCacheFile();
+}
+
+bool MeshCache::IsOpen() const
+{
+    std::scoped_lock lock(m_mutex);
+    return m_file != -1;
+}
+
+bool MeshCache::Load()
+{
+    if (!OpenCacheFile(m_path))
+    {
+        return false;
+    }
+
+    FileHeader fileHeader = {};
+    if (m_fileSize >= sizeof(FileHeader))
+    {
+        if (!MapCacheFile())
+        {
+            return false;
+        }
+        memcpy(&fileHeader, m_mappedData, sizeof(FileHeader));
+    }
+
+    // start over if the file is new, or was written by a different version
+    if (fileHeader.magic != FileMagic || fileHeader.version != Version || fileHeader.headerSize != sizeof(FileHeader))
+    {
+        UnmapCacheFile();
+        fileHeader = {FileMagic, Version, sizeof(FileHeader), 0};
+        if (!TruncateCacheFile(0) || !WriteCacheFile(&fileHeader, sizeof(fileHeader), 0))
+        {
+            return false;
+        }
+        m_fileSize = sizeof(FileHeader);
+        return true;
+    }
+
+    const uint64_t offset = ScanRecords();
+
+    // cut off whatever follows the last valid record, most likely a record which was interrupted while it was written
+    if (offset < m_fileSize)
+    {
+        UnmapCacheFile();
+        if (!TruncateCacheFile(offset))
+        {
+            return false;
+        }
+        m_fileSize = offset;
+    }
+
+    const uint64_t supersededSize = m_fileSize - sizeof(FileHeader) - m_liveSize;
+    if (supersededSize >= MinCompactionSize && supersededSize > m_liveSize)
+    {
+        Compact();
+    }
+
+    return true;
+}
+
+void MeshCache::Compact()
+{
+    if (!m_mappedData || m_mappedSize < m_fileSize)
+    {
+        if (!MapCacheFile())
+        {
+            return;
+        }
+    }
+
+    // write the live records into a new file, which replaces the current one only once it is complete
+    std::filesystem::path compactedPath = m_path;
+    compactedPath += ".tmp";
+
+    std::vector<Entry> entries;
+    entries.reserve(m_entries.Size());
+    for (const Entry& entry : m_entries)
+    {
+        entries.push_back(entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.offset < b.offset; });
+
+    {
+        std::ofstream file(compactedPath, std::ios::binary | std::ios::trunc);
+        const FileHeader fileHeader = {FileMagic, Version, sizeof(FileHeader), 0};
+        file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+        for (const Entry& entry : entries)
+        {
+            file.write(reinterpret_cast<const char*>(m_mappedData + entry.offset), entry.size);
+        }
+
+        if (!file.flush())
+        {
+            std::error_code error;
+            std::filesystem::remove(compactedPath, error);
+            return;
+        }
+    }
+
+    UnmapCacheFile();
+    CloseCacheFile();
+    m_entries.Clear();
+    m_liveSize = 0;
+
+    std::error_code error;
+    std::filesystem::rename(compactedPath, m_path, error);
+    if (error)
+    {
+        std::filesystem::remove(compactedPath, error);
+    }
+
+    // reads back either the compacted file or, if it could not replace the old one, the old one again
+    if (!OpenCacheFile(m_path) || !MapCacheFile())
+    {
+        return;
+    }
+
+    m_fileSize = ScanRecords();
+}
+
+uint64_t MeshCache::ScanRecords()
+{
+    // the latest record of each id wins
+    uint64_t offset = sizeof(FileHeader);
+    while (offset + sizeof(RecordHeader) <= m_fileSize)
+    {
+        RecordHeader header;
+        memcpy(&header, m_mappedData + offset, sizeof(header));
+        if (!IsValidRecord(header, offset, m_fileSize))
+        {
+            break;
+        }
+
+        Id id;
+        memcpy(id.bytes, header.id, sizeof(id.bytes));
+        Entry& entry = *m_entries.Get(m_entries.TryEmplace(id).first);
+        m_liveSize -= entry.size;
+        m_liveSize += header.size;
+        entry = {offset, header.size, header.updateTime};
+
+        offset += header.size;
+    }
+    return offset;
+}
+
+bool MeshCache::Store(const Id& id, const Mesh& mesh)
+{
+    std::scoped_lock lock(m_mutex);
+    if (m_file == -1 || mesh.lodCount > MaxLodCount)
+    {
+        return false;
+    }
+
+    const uint32_t indexCount = mesh.GetIndexCount();
+    const uint64_t payloadSize = GetPayloadSize(mesh.vertexCount, indexCount);
+    const uint64_t recordSize = AlignRecordSize(sizeof(RecordHeader) + payloadSize);
+    if (recordSize > UINT32_MAX)
+    {
+        return false;
+    }
+
+    // build the whole record first, so it is written with a single call
+    thread_local std::vector<uint8_t> record;
+    record.assign(recordSize, 0);
+
+    uint8_t* payload = record.data() + sizeof(RecordHeader);
+    const size_t positionsSize = mesh.vertexCount * 4ull * sizeof(int16_t);
+    memcpy(payload, mesh.positions, positionsSize);
+
+    uint16_t* indices = reinterpret_cast<uint16_t*>(payload + positionsSize);
+    for (uint32_t lod = 0; lod < mesh.lodCount; lod++)
+    {
+        memcpy(indices, mesh.indices[lod], mesh.lodIndexCounts[lod] * sizeof(uint16_t));
+        indices += mesh.lodIndexCounts[lod];
+    }
+
+    RecordHeader header = {};
+    header.magic = RecordMagic;
+    header.size = static_cast<uint32_t>(recordSize);
+    memcpy(header.id, id.bytes, sizeof(header.id));
+    header.updateTime = mesh.updateTime;
+    header.contentHash = mesh.contentHash;
+    header.payloadHash = ContentHash::Compute(payload, payloadSize);
+    memcpy(header.vertexScale, mesh.vertexScale, sizeof(header.vertexScale));
+    memcpy(header.center, mesh.center, sizeof(header.center));
+    memcpy(header.extents, mesh.extents, sizeof(header.extents));
+    memcpy(header.boundsCenter, mesh.boundsCenter, sizeof(header.boundsCenter));
+    memcpy(header.boundsOrientation, mesh.boundsOrientation, sizeof(header.boundsOrientation));
+    header.vertexCount = mesh.vertexCount;
+    header.lodCount = mesh.lodCount;
+    memcpy(header.lodIndexCounts, mesh.lodIndexCounts, sizeof(header.lodIndexCounts));
+    memcpy(record.data(), &header, sizeof(header));
+
+    if (!WriteCacheFile(record.data(), record.size(), m_fileSize))
+    {
+        // whatever made it to the file is cut off when it is opened the next time
+        return false;
+    }
+
+    Entry& entry = *m_entries.Get(m_entries.TryEmplace(id).first);
+    m_liveSize -= entry.size;
+    m_liveSize += recordSize;
+    entry = {m_fileSize, static_cast<uint32_t>(recordSize), mesh.updateTime};
+
+    m_fileSize += recordSize;
+    m_statistics.storeCount++;
+    return true;
+}
+
+bool MeshCache::Find(const Id& id, int64_t updateTime, Mesh& mesh)
+{
+    const Entry* entry = m_entries.Get(m_entries.Find(id));
+    if (!entry || entry->updateTime != updateTime)
+    {
+        m_statistics.missCount++;
+        return false;
+    }
+
+    // records stored since the file was mapped are not visible yet
+    if (entry->offset + entry->size > m_mappedSize && !MapCacheFile())
+    {
+        m_statistics.missCount++;
+        return false;
+    }
+
+    RecordHeader header;
+    memcpy(&header, m_mappedData + entry->offset, sizeof(header));
+    const uint8_t* payload = m_mappedData + entry->offset + sizeof(RecordHeader);
+    uint64_t indexCount = 0;
+    for (uint32_t lod = 0; lod < header.lodCount; lod++)
+    {
+        indexCount += header.lodIndexCounts[lod];
+    }
+
+    const uint64_t payloadSize = GetPayloadSize(header.vertexCount, indexCount);
+    if (ContentHash::Compute(payload, payloadSize) != header.payloadHash)
+    {
+        m_liveSize -= entry->size;
+        m_entries.Erase(id);
+        m_statistics.corruptCount++;
+        m_statistics.missCount++;
+        return false;
+    }
+
+    mesh.updateTime = header.updateTime;
+    mesh.contentHash = header.contentHash;
+    memcpy(mesh.vertexScale, header.vertexScale, sizeof(mesh.vertexScale));
+    memcpy(mesh.center, header.center, sizeof(mesh.center));
+    memcpy(mesh.extents, header.extents, sizeof(mesh.extents));
+    memcpy(mesh.boundsCenter, header.boundsCenter, sizeof(mesh.boundsCenter));
+    memcpy(mesh.boundsOrientation, header.boundsOrientation, sizeof(mesh.boundsOrientation));
+    mesh.vertexCount = header.vertexCount;
+    mesh.lodCount = header.lodCount;
+    memcpy(mesh.lodIndexCounts, header.lodIndexCounts, sizeof(mesh.lodIndexCounts));
+
+    // records and the mapping are aligned to 8 bytes, so are the positions and the indices following them
+    mesh.positions = reinterpret_cast<const int16_t*>(payload);
+    const uint16_t* indices = reinterpret_cast<const uint16_t*>(payload + header.vertexCount * 4ull * sizeof(int16_t));
+    for (uint32_t lod = 0; lod < header.lodCount; lod++)
+    {
+        mesh.indices[lod] = indices;
+        indices += header.lodIndexCounts[lod];
+    }
+
+    m_statistics.hitCount++;
+    return true;
+}
+
+MeshCache::Statistics MeshCache::GetStatistics() const
+{
+    std::scoped_lock lock(m_mutex);
+    Statistics statistics = m_statistics;
+    statistics.meshCount = static_cast<uint32_t>(m_entries.Size());
+    statistics.fileSize = m_fileSize;
+    statistics.liveSize = m_liveSize;
+    return statistics;
+}
+
+#ifdef _WIN32
+
+bool MeshCache::OpenCacheFile(const std::filesystem::path& path)
+{
+    const HANDLE file =
+        CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = reinterpret_cast<intptr_t>(file);
+    m_fileSize = static_cast<uint64_t>(size.QuadPart);
+    return true;
+}
+
+void MeshCache::CloseCacheFile()
+{
+    if (m_file != -1)
+    {
+        CloseHandle(reinterpret_cast<HANDLE>(m_file));
+        m_file = -1;
+    }
+}
+
+bool MeshCache::MapCacheFile()
+{
+    UnmapCacheFile();
+    if (m_fileSize == 0)
+    {
+        return true;
+    }
+
+    const HANDLE mapping = CreateFileMappingW(reinterpret_cast<HANDLE>(m_file), nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        return false;
+    }
+
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    m_mapping = reinterpret_cast<intptr_t>(mapping);
+    m_mappedData = static_cast<const uint8_t*>(data);
+    m_mappedSize = m_fileSize;
+    return true;
+}
+
+void MeshCache::UnmapCacheFile()
+{
+    if (m_mappedData)
+    {
+        UnmapViewOfFile(m_mappedData);
+        CloseHandle(reinterpret_cast<HANDLE>(m_mapping));
+        m_mappedData = nullptr;
+        m_mapping = 0;
+        m_mappedSize = 0;
+    }
+}
+
+bool MeshCache::WriteCacheFile(const void* data, size_t size, uint64_t offset)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0)
+    {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD written = 0;
+        const DWORD count = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+        if (!::WriteFile(reinterpret_cast<HANDLE>(m_file), bytes, count, &written, &overlapped) || written == 0)
+        {
+            return false;
+        }
+
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+    return true;
+}
+
+bool MeshCache::TruncateCacheFile(uint64_t size)
+{
+    // requires the file to be unmapped
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(size);
+    return SetFilePointerEx(reinterpret_cast<HANDLE>(m_file), position, nullptr, FILE_BEGIN) &&
+           SetEndOfFile(reinterpret_cast<HANDLE>(m_file));
+}
+
+#else
+
+bool MeshCache::OpenCacheFile(const std::filesystem::path& path)
+{
+    const int file = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (file == -1)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        close(file);
+        return false;
+    }
+
+    m_file = file;
+    m_fileSize = static_cast<uint64_t>(status.st_size);
+    return true;
+}
+
+void MeshCache::CloseCacheFile()
+{
+    if (m_file != -1)
+    {
+        close(static_cast<int>(m_file));
+        m_file = -1;
+    }
+}
+
+bool MeshCache::MapCacheFile()
+{
+    UnmapCacheFile();
+    if (m_fileSize == 0)
+    {
+        return true;
+    }
+
+    void* data = mmap(nullptr, m_fileSize, PROT_READ, MAP_SHARED, static_cast<int>(m_file), 0);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    m_mappedData = static_cast<const uint8_t*>(data);
+    m_mappedSize = m_fileSize;
+    return true;
+}
+
+void MeshCache::UnmapCacheFile()
+{
+    if (m_mappedData)
+    {
+        munmap(const_cast<uint8_t*>(m_mappedData), m_mappedSize);
+        m_mappedData = nullptr;
+        m_mappedSize = 0;
+    }
+}
+
+bool MeshCache::WriteCacheFile(const void* data, size_t size, uint64_t offset)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0)
+    {
+        const ssize_t written = pwrite(static_cast<int>(m_file), bytes, size, static_cast<off_t>(offset));
+        if (written <= 0)
+        {
+            return false;
+        }
+
+        bytes += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+bool MeshCache::TruncateCacheFile(uint64_t size)
+{
+    return ftruncate(static_cast<int>(m_file), static_cast<off_t>(size)) == 0;
+}
+
+#endif
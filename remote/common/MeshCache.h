@@ -0,0 +1,169 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <FlatHashMap.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+
+// Persistent cache of computed surface meshes, so that meshes which did not change since the last session or since tracking was lost
+// can be shown right away instead of being computed again.
+//
+// The cache is a single file which is only ever appended to, and which is mapped into memory for reading. Meshes are keyed by the id of
+// their surface, together with the update time of the surface they were computed for, so a cached mesh is only used as long as the
+// surface did not change. Storing a mesh for an id again supersedes the previous one. Superseded meshes are dropped when the file is
+// opened the next time, if they take up more space than the live ones.
+//
+// File format, all values little endian, all offsets and sizes in bytes:
+//
+//   FileHeader   magic "SRMC", version, header size, reserved
+//   Record...    one per stored mesh, in the order they were stored, each aligned to 8 bytes:
+//     RecordHeader   magic "SRMR", record size (including header and padding), id, update time, content hash, payload hash,
+//                    vertex scale, center and extents of the bounding box in the mesh coordinate system, center and orientation
+//                    (quaternion x, y, z, w) of the bounds of the surface in the mesh coordinate system, vertex count, level of
+//                    detail count, index count per level of detail
+//     Payload        vertex count * 4 int16 positions (SNORM, x, y, z, w), followed by the uint16 indices of all levels of detail back
+//                    to back, padded with zeros to a multiple of 8
+//
+// A file with an unknown magic or version is discarded. A record with a bad magic or size ends the file, which truncates a record that
+// was only written partially. A record whose payload does not match the payload hash is ignored.
+//
+// All functions are thread safe.
+class MeshCache
+{
+public:
+    static constexpr uint32_t Version = 1;
+    static constexpr uint32_t MaxLodCount = 4;
+
+    struct Id
+    {
+        uint8_t bytes[16] = {};
+
+        bool operator==(const Id& other) const = default;
+    };
+
+    struct Mesh
+    {
+        int64_t updateTime = 0;
+        uint64_t contentHash = 0;
+        float vertexScale[3] = {1.0f, 1.0f, 1.0f};
+        float center[3] = {};
+        float extents[3] = {};
+        float boundsCenter[3] = {};
+        float boundsOrientation[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        uint32_t vertexCount = 0;
+        uint32_t lodCount = 0;
+        uint32_t lodIndexCounts[MaxLodCount] = {};
+
+        // 4 components per vertex
+        const int16_t* positions = nullptr;
+        const uint16_t* indices[MaxLodCount] = {};
+
+        uint32_t GetIndexCount() const;
+    };
+
+    struct Statistics
+    {
+        uint32_t meshCount = 0;
+        uint64_t fileSize = 0;
+        uint64_t liveSize = 0;
+        uint64_t storeCount = 0;
+        uint64_t hitCount = 0;
+        uint64_t missCount = 0;
+        uint64_t corruptCount = 0;
+    };
+
+    // Opens the cache file at path, or creates it if it does not exist. If the file can't be opened the cache stays empty and ignores
+    // all stores.
+    explicit MeshCache(std::filesystem::path path);
+    ~MeshCache();
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    bool IsOpen() const;
+
+    // Appends mesh to the file. Returns false if it could not be written.
+    bool Store(const Id& id, const Mesh& mesh);
+
+    // Looks up the mesh of id, which has to be computed for updateTime. If there is one, calls read(const Mesh&) and returns true. The
+    // positions and indices point into the mapped file and are only valid during the call.
+    template <typename Func>
+    bool Read(const Id& id, int64_t updateTime, Func&& read)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        Mesh mesh;
+        if (!Find(id, updateTime, mesh))
+        {
+            return false;
+        }
+
+        read(static_cast<const Mesh&>(mesh));
+        return true;
+    }
+
+    Statistics GetStatistics() const;
+
+private:
+    struct IdHasher
+    {
+        size_t operator()(const Id& id) const
+        {
+            uint64_t parts[2];
+            memcpy(parts, id.bytes, sizeof(parts));
+
+            uint64_t hash = parts[0] ^ (parts[1] * 0x9E3779B97F4A7C15ull);
+            hash ^= hash >> 32;
+            hash *= 0xD6E8FEB86659FD93ull;
+            hash ^= hash >> 32;
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    struct Entry
+    {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+        int64_t updateTime = 0;
+    };
+
+    // platform specific file access
+    bool OpenCacheFile(const std::filesystem::path& path);
+    void CloseCacheFile();
+    bool MapCacheFile();
+    void UnmapCacheFile();
+    bool WriteCacheFile(const void* data, size_t size, uint64_t offset);
+    bool TruncateCacheFile(uint64_t size);
+
+    bool Load();
+    // Reads the directory of records from the mapped file, returns the offset after the last valid one.
+    uint64_t ScanRecords();
+    void Compact();
+    bool Find(const Id& id, int64_t updateTime, Mesh& mesh);
+
+    const std::filesystem::path m_path;
+    mutable std::mutex m_mutex;
+
+    intptr_t m_file = -1;
+    intptr_t m_mapping = 0;
+    const uint8_t* m_mappedData = nullptr;
+    uint64_t m_mappedSize = 0;
+    uint64_t m_fileSize = 0;
+
+    Utils::FlatHashMap<Id, Entry, IdHasher> m_entries;
+    uint64_t m_liveSize = 0;
+    Statistics m_statistics;
+};
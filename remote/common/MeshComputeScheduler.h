@@ -0,0 +1,331 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <FlatHashMap.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Limits and orders asynchronous mesh computations.
+//
+// Callers request a computation per key (e.g. a surface GUID) whenever its source data changed. Requests for a key which is already
+// queued are coalesced into one, and a request for a key which is currently being computed is deferred until that computation completed,
+// so there is never more than one computation per key in flight. Dispatch() starts the queued computations with the highest priority
+// while the number of computations in flight is below the limit. The priority prefers near and visible keys, and rises with the time
+// a request is waiting and with the time since the key was last computed, so nothing starves.
+//
+// A computation keeps its slot until Complete() is called for it, even if its key is removed while it is running. Remove() and Clear()
+// turn such computations into retiring ones, which still count towards the limit but are dropped when they complete. The caller therefore
+// has to call Complete() for every started computation, also after removing its key. A key which is requested again while its retiring
+// computation is still running is queued once that computation completed.
+//
+// The scheduler is not thread safe, all calls are expected to come from the same thread. Time is passed in by the caller in seconds.
+template <typename Key, typename Hash, typename KeyEqual = std::equal_to<Key>>
+class MeshComputeScheduler
+{
+public:
+    struct Policy
+    {
+        uint32_t maxInFlight = 4;
+
+        // Priority = visibleBonus (if visible) - distanceWeight * distance + waitWeight * waiting time + stalenessWeight * time since
+        // the last computation. Distances are clamped to maxDistance (meters) and staleness to maxStaleness (seconds), keys which
+        // were never computed count as maximally stale.
+        float visibleBonus = 4.0f;
+        float distanceWeight = 1.0f;
+        float maxDistance = 20.0f;
+        float waitWeight = 2.0f;
+        float stalenessWeight = 0.5f;
+        float maxStaleness = 10.0f;
+    };
+
+    struct PriorityInputs
+    {
+        float distance = 0.0f;
+        bool visible = true;
+    };
+
+    struct Statistics
+    {
+        uint64_t requestCount = 0;
+        uint64_t coalescedCount = 0;
+        uint64_t startedCount = 0;
+        uint64_t completedCount = 0;
+        uint64_t retiredCount = 0;
+        uint32_t queuedCount = 0;
+        // Includes the retiring computations.
+        uint32_t inFlightCount = 0;
+        uint32_t retiringCount = 0;
+        uint32_t peakInFlightCount = 0;
+
+        // Seconds from the (first coalesced) request to the completion of the computation which served it.
+        double totalLatency = 0.0;
+        double maxLatency = 0.0;
+
+        double AverageLatency() const
+        {
+            return completedCount > 0 ? totalLatency / completedCount : 0.0;
+        }
+    };
+
+    explicit MeshComputeScheduler(const Policy& policy = {})
+        : m_policy(policy)
+    {
+    }
+
+    void SetPolicy(const Policy& policy)
+    {
+        m_policy = policy;
+    }
+
+    const Policy& GetPolicy() const
+    {
+        return m_policy;
+    }
+
+    // Requests a computation for key.
+    void Request(const Key& key, double now)
+    {
+        m_statistics.requestCount++;
+
+        Entry& entry = *m_entries.Get(m_entries.TryEmplace(key).first);
+        switch (entry.state)
+        {
+            case State::Idle:
+                entry.state = State::Queued;
+                entry.requestTime = now;
+                m_statistics.queuedCount++;
+                break;
+
+            case State::Queued:
+                m_statistics.coalescedCount++;
+                break;
+
+            case State::InFlight:
+            case State::Retiring:
+                // The running computation might have picked up the data too late, compute once more after it completed.
+                if (entry.requeue)
+                {
+                    m_statistics.coalescedCount++;
+                }
+                else
+                {
+                    entry.requeue = true;
+                    entry.requeueTime = now;
+                }
+                break;
+        }
+    }
+
+    // Marks the computation for key as done, which frees its slot.
+    void Complete(const Key& key, double now)
+    {
+        Entry* entry = m_entries.Get(key);
+        if (!entry || (entry->state != State::InFlight && entry->state != State::Retiring))
+        {
+            return;
+        }
+
+        m_statistics.inFlightCount--;
+
+        if (entry->state == State::Retiring)
+        {
+            m_statistics.retiringCount--;
+            m_statistics.retiredCount++;
+            if (!entry->requeue)
+            {
+                m_entries.Erase(key);
+                return;
+            }
+        }
+        else
+        {
+            const double latency = now - entry->requestTime;
+            m_statistics.completedCount++;
+            m_statistics.totalLatency += latency;
+            m_statistics.maxLatency = std::max(m_statistics.maxLatency, latency);
+
+            entry->hasCompleted = true;
+            entry->lastCompletionTime = now;
+        }
+
+        entry->state = State::Idle;
+
+        if (entry->requeue)
+        {
+            entry->requeue = false;
+            entry->state = State::Queued;
+            entry->requestTime = entry->requeueTime;
+            m_statistics.queuedCount++;
+        }
+    }
+
+    // Forgets key, e.g. because the surface is gone. A computation in flight keeps its slot until it is completed.
+    void Remove(const Key& key)
+    {
+        Entry* entry = m_entries.Get(key);
+        if (!entry)
+        {
+            return;
+        }
+
+        switch (entry->state)
+        {
+            case State::Idle:
+                m_entries.Erase(key);
+                break;
+
+            case State::Queued:
+                m_statistics.queuedCount--;
+                m_entries.Erase(key);
+                break;
+
+            case State::InFlight:
+                Retire(*entry);
+                break;
+
+            case State::Retiring:
+                entry->requeue = false;
+                break;
+        }
+    }
+
+    // Forgets all keys. Computations in flight keep their slots until they are completed.
+    void Clear()
+    {
+        m_entries.EraseIf([this](Entry& entry) {
+            if (entry.state == State::InFlight)
+            {
+                Retire(entry);
+            }
+            else if (entry.state == State::Retiring)
+            {
+                entry.requeue = false;
+            }
+            return entry.state != State::Retiring;
+        });
+        m_statistics.queuedCount = 0;
+    }
+
+    bool IsInFlight(const Key& key) const
+    {
+        const Entry* entry = m_entries.Get(m_entries.Find(key));
+        return entry && entry->state == State::InFlight;
+    }
+
+    // Starts the queued computations with the highest priority until the limit of computations in flight is reached.
+    // getInputs(key) returns the PriorityInputs of a queued key, start(key) kicks off its computation. Returns the number of started
+    // computations.
+    template <typename GetInputs, typename Start>
+    uint32_t Dispatch(double now, GetInputs&& getInputs, Start&& start)
+    {
+        if (m_statistics.queuedCount == 0 || m_statistics.inFlightCount >= m_policy.maxInFlight)
+        {
+            return 0;
+        }
+
+        m_candidates.clear();
+        for (size_t i = 0; i < m_entries.Size(); i++)
+        {
+            const Entry& entry = *m_entries.Get(m_entries.HandleAt(i));
+            if (entry.state == State::Queued)
+            {
+                m_candidates.push_back({Score(entry, getInputs(m_entries.KeyAt(i)), now), static_cast<uint32_t>(i)});
+            }
+        }
+
+        const size_t startCount = std::min<size_t>(m_candidates.size(), m_policy.maxInFlight - m_statistics.inFlightCount);
+        std::partial_sort(
+            m_candidates.begin(), m_candidates.begin() + startCount, m_candidates.end(), [](const Candidate& a, const Candidate& b) {
+                return a.score > b.score;
+            });
+
+        // Update all states first, start() must not see a half updated scheduler.
+        m_startKeys.clear();
+        for (size_t i = 0; i < startCount; i++)
+        {
+            Entry& entry = *m_entries.Get(m_entries.HandleAt(m_candidates[i].index));
+            entry.state = State::InFlight;
+            m_startKeys.push_back(m_entries.KeyAt(m_candidates[i].index));
+        }
+
+        m_statistics.queuedCount -= static_cast<uint32_t>(startCount);
+        m_statistics.inFlightCount += static_cast<uint32_t>(startCount);
+        m_statistics.startedCount += startCount;
+        m_statistics.peakInFlightCount = std::max(m_statistics.peakInFlightCount, m_statistics.inFlightCount);
+
+        for (const Key& key : m_startKeys)
+        {
+            start(key);
+        }
+
+        return static_cast<uint32_t>(startCount);
+    }
+
+    const Statistics& GetStatistics() const
+    {
+        return m_statistics;
+    }
+
+private:
+    enum class State : uint8_t
+    {
+        Idle,
+        Queued,
+        InFlight,
+        // In flight, but the key was removed.
+        Retiring
+    };
+
+    struct Entry
+    {
+        State state = State::Idle;
+        bool requeue = false;
+        bool hasCompleted = false;
+        double requestTime = 0.0;
+        double requeueTime = 0.0;
+        double lastCompletionTime = 0.0;
+    };
+
+    struct Candidate
+    {
+        float score;
+        uint32_t index;
+    };
+
+    void Retire(Entry& entry)
+    {
+        entry.state = State::Retiring;
+        entry.requeue = false;
+        m_statistics.retiringCount++;
+    }
+
+    float Score(const Entry& entry, const PriorityInputs& inputs, double now) const
+    {
+        const float distance = std::min(std::max(inputs.distance, 0.0f), m_policy.maxDistance);
+        const float waiting = static_cast<float>(now - entry.requestTime);
+        const float staleness = entry.hasCompleted ? std::min(static_cast<float>(now - entry.lastCompletionTime), m_policy.maxStaleness)
+                                                   : m_policy.maxStaleness;
+
+        return (inputs.visible ? m_policy.visibleBonus : 0.0f) - m_policy.distanceWeight * distance + m_policy.waitWeight * waiting +
+               m_policy.stalenessWeight * staleness;
+    }
+
+    Policy m_policy;
+    Statistics m_statistics;
+    Utils::FlatHashMap<Key, Entry, Hash, KeyEqual> m_entries;
+    std::vector<Candidate> m_candidates;
+    std::vector<Key> m_startKeys;
+};
@@ -0,0 +1,342 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <MeshSimplifier.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    template <typename T>
+    T Cross(const T& a, const T& b)
+    {
+        return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+
+    template <typename T>
+    T Subtract(const T& a, const T& b)
+    {
+        return {a.x - b.x, a.y - b.y, a.z - b.z};
+    }
+
+    template <typename T>
+    float Dot(const T& a, const T& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+} // namespace
+
+void MeshSimplifier::Quadric::AddPlane(const Vector3& normal, float distance, float planeWeight)
+{
+    a00 += planeWeight * normal.x * normal.x;
+    a11 += planeWeight * normal.y * normal.y;
+    a22 += planeWeight * normal.z * normal.z;
+    a01 += planeWeight * normal.x * normal.y;
+    a02 += planeWeight * normal.x * normal.z;
+    a12 += planeWeight * normal.y * normal.z;
+    b0 += planeWeight * normal.x * distance;
+    b1 += planeWeight * normal.y * distance;
+    b2 += planeWeight * normal.z * distance;
+    c += planeWeight * distance * distance;
+    weight += planeWeight;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric& other)
+{
+    a00 += other.a00;
+    a11 += other.a11;
+    a22 += other.a22;
+    a01 += other.a01;
+    a02 += other.a02;
+    a12 += other.a12;
+    b0 += other.b0;
+    b1 += other.b1;
+    b2 += other.b2;
+    c += other.c;
+    weight += other.weight;
+}
+
+float MeshSimplifier::Quadric::Evaluate(const Vector3& p) const
+{
+    // p^T A p + 2 b^T p + c, normalized by the total area so the result is a mean squared distance.
+    const float rx = a00 * p.x + a01 * p.y + a02 * p.z;
+    const float ry = a01 * p.x + a11 * p.y + a12 * p.z;
+    const float rz = a02 * p.x + a12 * p.y + a22 * p.z;
+    const float result = rx * p.x + ry * p.y + rz * p.z + 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+
+    return weight > 0.0f ? std::max(result, 0.0f) / weight : 0.0f;
+}
+
+void MeshSimplifier::ComputeQuadrics(const uint16_t* indices, uint32_t indexCount)
+{
+    m_quadrics.assign(m_positions.size(), Quadric{});
+
+    for (uint32_t i = 0; i < indexCount; i += 3)
+    {
+        const Vector3& p0 = m_positions[indices[i + 0]];
+        const Vector3& p1 = m_positions[indices[i + 1]];
+        const Vector3& p2 = m_positions[indices[i + 2]];
+
+        Vector3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+        const float length = std::sqrt(Dot(normal, normal));
+        if (length == 0.0f)
+        {
+            continue;
+        }
+
+        normal = {normal.x / length, normal.y / length, normal.z / length};
+        const float distance = -Dot(normal, p0);
+        const float area = length * 0.5f;
+
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            m_quadrics[indices[i + k]].AddPlane(normal, distance, area);
+        }
+    }
+}
+
+void MeshSimplifier::LockBorders(const uint16_t* indices, uint32_t indexCount)
+{
+    m_locked.assign(m_positions.size(), 0);
+
+    // An edge is on the border if no triangle uses it in the opposite direction. Requires the adjacency of the input triangles.
+    for (uint32_t i = 0; i < indexCount; i += 3)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint16_t a = indices[i + k];
+            const uint16_t b = indices[i + (k + 1) % 3];
+
+            bool hasOpposite = false;
+            for (uint32_t j = m_adjacencyOffsets[b]; j < m_adjacencyOffsets[b + 1] && !hasOpposite; j++)
+            {
+                const uint16_t* triangle = indices + m_adjacency[j] * 3;
+                hasOpposite = (triangle[0] == b && triangle[1] == a) || (triangle[1] == b && triangle[2] == a) ||
+                              (triangle[2] == b && triangle[0] == a);
+            }
+
+            if (!hasOpposite)
+            {
+                m_locked[a] = 1;
+                m_locked[b] = 1;
+            }
+        }
+    }
+}
+
+void MeshSimplifier::BuildAdjacency(const uint16_t* indices, uint32_t indexCount)
+{
+    const size_t vertexCount = m_positions.size();
+    m_adjacencyOffsets.assign(vertexCount + 1, 0);
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        m_adjacencyOffsets[indices[i] + 1]++;
+    }
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        m_adjacencyOffsets[v + 1] += m_adjacencyOffsets[v];
+    }
+
+    m_adjacency.resize(indexCount);
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        // Temporarily use the start offsets as write cursors, they are shifted back below.
+        m_adjacency[m_adjacencyOffsets[indices[i]]++] = i / 3;
+    }
+
+    for (size_t v = vertexCount; v > 0; v--)
+    {
+        m_adjacencyOffsets[v] = m_adjacencyOffsets[v - 1];
+    }
+    m_adjacencyOffsets[0] = 0;
+}
+
+bool MeshSimplifier::FlipsTriangle(const uint16_t* indices, uint16_t from, uint16_t to) const
+{
+    for (uint32_t j = m_adjacencyOffsets[from]; j < m_adjacencyOffsets[from + 1]; j++)
+    {
+        const uint16_t* triangle = indices + m_adjacency[j] * 3;
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+            // This triangle degenerates and is removed.
+            continue;
+        }
+
+        const Vector3& p0 = m_positions[triangle[0]];
+        const Vector3& p1 = m_positions[triangle[1]];
+        const Vector3& p2 = m_positions[triangle[2]];
+        const Vector3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+
+        const Vector3& q0 = m_positions[triangle[0] == from ? to : triangle[0]];
+        const Vector3& q1 = m_positions[triangle[1] == from ? to : triangle[1]];
+        const Vector3& q2 = m_positions[triangle[2] == from ? to : triangle[2]];
+        const Vector3 collapsedNormal = Cross(Subtract(q1, q0), Subtract(q2, q0));
+
+        if (Dot(normal, collapsedNormal) <= 0.0f)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t MeshSimplifier::Simplify(
+    uint16_t* destination,
+    const uint16_t* indices,
+    uint32_t indexCount,
+    const Positions& positions,
+    uint32_t targetIndexCount,
+    float maxError,
+    float* error)
+{
+    assert(indexCount % 3 == 0 && positions.stride >= 3);
+
+    m_positions.resize(positions.count);
+    for (uint32_t v = 0; v < positions.count; v++)
+    {
+        const int16_t* position = positions.data + size_t(v) * positions.stride;
+        m_positions[v] = {
+            std::max(position[0] / 32767.0f, -1.0f) * positions.scale[0],
+            std::max(position[1] / 32767.0f, -1.0f) * positions.scale[1],
+            std::max(position[2] / 32767.0f, -1.0f) * positions.scale[2]};
+    }
+
+    if (destination != indices)
+    {
+        memcpy(destination, indices, indexCount * sizeof(uint16_t));
+    }
+
+    ComputeQuadrics(destination, indexCount);
+    BuildAdjacency(destination, indexCount);
+    LockBorders(destination, indexCount);
+
+    const float maxCost = maxError * maxError;
+    float worstCost = 0.0f;
+
+    // Each pass collapses a set of independent edges, cheapest first, and then rewrites the index list.
+    for (bool firstPass = true; indexCount > targetIndexCount; firstPass = false)
+    {
+        if (!firstPass)
+        {
+            BuildAdjacency(destination, indexCount);
+        }
+
+        // Find the cheapest collapse of every vertex.
+        m_bestCollapses.assign(m_positions.size(), Collapse{maxCost, 0, 0});
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint16_t a = destination[i + k];
+                const uint16_t b = destination[i + (k + 1) % 3];
+
+                // Every interior edge is seen twice, once per direction, so only consider collapsing its first vertex here.
+                if (m_locked[a])
+                {
+                    continue;
+                }
+
+                Quadric quadric = m_quadrics[a];
+                quadric.Add(m_quadrics[b]);
+                const float cost = quadric.Evaluate(m_positions[b]);
+                if (cost <= m_bestCollapses[a].cost)
+                {
+                    m_bestCollapses[a] = {cost, a, b};
+                }
+            }
+        }
+
+        m_collapses.clear();
+        for (const Collapse& collapse : m_bestCollapses)
+        {
+            if (collapse.from != collapse.to)
+            {
+                m_collapses.push_back(collapse);
+            }
+        }
+
+        if (m_collapses.empty())
+        {
+            break;
+        }
+
+        std::sort(m_collapses.begin(), m_collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        m_touched.assign(m_positions.size(), 0);
+        m_remap.resize(m_positions.size());
+        for (size_t v = 0; v < m_remap.size(); v++)
+        {
+            m_remap[v] = static_cast<uint16_t>(v);
+        }
+
+        // A collapse removes about two triangles, do not overshoot the target by much.
+        const uint32_t collapseGoal = (indexCount - targetIndexCount) / 6 + 1;
+        uint32_t collapseCount = 0;
+
+        for (const Collapse& collapse : m_collapses)
+        {
+            if (m_touched[collapse.from] || m_touched[collapse.to] || FlipsTriangle(destination, collapse.from, collapse.to))
+            {
+                continue;
+            }
+
+            m_remap[collapse.from] = collapse.to;
+            m_quadrics[collapse.to].Add(m_quadrics[collapse.from]);
+            worstCost = std::max(worstCost, collapse.cost);
+
+            // Lock the whole neighborhood for this pass, so no two collapses modify the same triangle.
+            m_touched[collapse.to] = 1;
+            for (uint32_t j = m_adjacencyOffsets[collapse.from]; j < m_adjacencyOffsets[collapse.from + 1]; j++)
+            {
+                const uint16_t* triangle = destination + m_adjacency[j] * 3;
+                m_touched[triangle[0]] = m_touched[triangle[1]] = m_touched[triangle[2]] = 1;
+            }
+
+            if (++collapseCount >= collapseGoal)
+            {
+                break;
+            }
+        }
+
+        if (collapseCount == 0)
+        {
+            break;
+        }
+
+        // Apply the collapses and drop the triangles which became degenerate.
+        uint32_t writeIndex = 0;
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            const uint16_t a = m_remap[destination[i + 0]];
+            const uint16_t b = m_remap[destination[i + 1]];
+            const uint16_t c = m_remap[destination[i + 2]];
+            if (a != b && b != c && c != a)
+            {
+                destination[writeIndex++] = a;
+                destination[writeIndex++] = b;
+                destination[writeIndex++] = c;
+            }
+        }
+        indexCount = writeIndex;
+    }
+
+    if (error)
+    {
+        *error = std::sqrt(worstCost);
+    }
+
+    return indexCount;
+}
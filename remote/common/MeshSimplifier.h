@@ -0,0 +1,92 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Triangle mesh simplification based on quadric error metrics (Garland and Heckbert).
+//
+// Works directly on the quantized meshes produced by spatial mapping: int16 SNORM positions with a per mesh scale and 16 bit triangle
+// lists. Edges are collapsed into one of their existing end points, so a simplified mesh is just a new index list into the original
+// vertices and all levels of detail of a mesh can share one vertex buffer. Vertices on open borders never move, which keeps the seams
+// between neighboring meshes closed.
+//
+// The simplifier keeps its scratch memory between calls, use one instance per thread.
+class MeshSimplifier
+{
+public:
+    struct Positions
+    {
+        // xyz of every vertex as SNORM, followed by (stride - 3) ignored components.
+        const int16_t* data = nullptr;
+        uint32_t stride = 4;
+        uint32_t count = 0;
+        // Converts SNORM positions to meters.
+        float scale[3] = {1.0f, 1.0f, 1.0f};
+    };
+
+    // Simplifies the triangle list until it has at most targetIndexCount indices left, or until the next collapse would move the
+    // surface by more than maxError meters. Writes the result to destination, which must have room for indexCount indices, and returns
+    // the number of indices written. If error is not null, it receives the largest distance (in meters) introduced by the collapses.
+    uint32_t Simplify(
+        uint16_t* destination,
+        const uint16_t* indices,
+        uint32_t indexCount,
+        const Positions& positions,
+        uint32_t targetIndexCount,
+        float maxError,
+        float* error = nullptr);
+
+private:
+    struct Vector3
+    {
+        float x, y, z;
+    };
+
+    // Sum of squared distances to a set of planes, weighted by triangle area.
+    struct Quadric
+    {
+        float a00, a11, a22, a01, a02, a12;
+        float b0, b1, b2;
+        float c;
+        float weight;
+
+        void AddPlane(const Vector3& normal, float distance, float planeWeight);
+        void Add(const Quadric& other);
+        float Evaluate(const Vector3& point) const;
+    };
+
+    struct Collapse
+    {
+        float cost;
+        uint16_t from;
+        uint16_t to;
+    };
+
+    void ComputeQuadrics(const uint16_t* indices, uint32_t indexCount);
+    void LockBorders(const uint16_t* indices, uint32_t indexCount);
+    void BuildAdjacency(const uint16_t* indices, uint32_t indexCount);
+    bool FlipsTriangle(const uint16_t* indices, uint16_t from, uint16_t to) const;
+
+    std::vector<Vector3> m_positions;
+    std::vector<Quadric> m_quadrics;
+    std::vector<uint8_t> m_locked;
+    std::vector<uint8_t> m_touched;
+    std::vector<uint16_t> m_remap;
+    std::vector<Collapse> m_bestCollapses;
+    std::vector<Collapse> m_collapses;
+
+    // Triangles around each vertex: m_adjacency[m_adjacencyOffsets[v] .. m_adjacencyOffsets[v + 1]] are triangle indices.
+    std::vector<uint32_t> m_adjacencyOffsets;
+    std::vector<uint32_t> m_adjacency;
+};
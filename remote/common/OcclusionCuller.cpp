@@ -0,0 +1,748 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <OcclusionCuller.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define OCCLUSION_CULLER_SSE2
+#define OCCLUSION_CULLER_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+// The AVX2 kernel is compiled for AVX2 regardless of the target of the build, it is only called if the processor supports it. MSVC always
+// allows the intrinsics, GCC and Clang need the target attribute.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define OCCLUSION_CULLER_AVX2_TARGET
+#else
+#define OCCLUSION_CULLER_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#elif defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_CULLER_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define OCCLUSION_CULLER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Occluders are clipped at this view distance in meters, objects which reach closer are always visible.
+    constexpr float NearDistance = 0.05f;
+
+    // Position of the edges which a triangle does not have, far enough off screen to never limit its spans.
+    constexpr float Unbounded = 1.0e30f;
+
+    // Depth of an empty working layer, behind which any triangle starts a new one.
+    constexpr float EmptyWorkingDepth = std::numeric_limits<float>::max();
+
+    constexpr uint32_t FullMask = ~0u;
+
+    // The non horizontal edges of a triangle in screen space, as x = a + y * s. The pixels whose centers are right of both left edges,
+    // left of both right edges and within [yMin, yMax) are covered. A triangle has one or two edges on each side, a missing one is
+    // pushed out of the way.
+    struct EdgeSetup
+    {
+        float leftA[2] = {-Unbounded, -Unbounded};
+        float leftS[2] = {};
+        float rightA[2] = {Unbounded, Unbounded};
+        float rightS[2] = {};
+        float yMin = 0.0f;
+        float yMax = 0.0f;
+    };
+
+    float MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
+
+    // bits [start, end) set, both in [0, 32]
+    uint32_t SpanMask(int32_t start, int32_t end)
+    {
+        const uint32_t low = start < 32 ? FullMask << start : 0;
+        const uint32_t high = end > 0 ? FullMask >> (32 - end) : 0;
+        return low & high;
+    }
+
+    constexpr uint32_t TileWidth = OcclusionCuller::TileWidth;
+    constexpr uint32_t TileHeight = OcclusionCuller::TileHeight;
+    static_assert(TileHeight == 8, "the kernels process the rows of a tile in eight lanes");
+
+    // The kernels compute the coverage masks of the rows of the tiles [tileBegin, tileEnd) in tile row tileY, masks[(tile - tileBegin) * 8
+    // + row]. The spans of the eight rows are computed once, in one SIMD lane each, and only shifted by the position of each tile.
+    using RasterizeTileRowFunction
+ = void (*)(const EdgeSetup&, uint32_t, uint32_t, uint32_t, uint32_t*);
+
+    void RasterizeTileRowScalar(const EdgeSetup& edges, uint32_t tileY, uint32_t tileBegin, uint32_t tileEnd, uint32_t* masks)
+    {
+        // pixel centers are at .5, the spans are made relative to them
+        const float firstRowY = static_cast<float>(tileY * TileHeight) + 0.5f;
+
+        float leftCenter[TileHeight];
+        float rightCenter[TileHeight];
+        for (uint32_t row = 0; row < TileHeight; row++)
+        {
+            const float y = firstRowY + row;
+            const float left = std::max(edges.leftA[0] + y * edges.leftS[0], edges.leftA[1] + y * edges.leftS[1]);
+            const float right = std::min(edges.rightA[0] + y * edges.rightS[0], edges.rightA[1] + y * edges.rightS[1]);
+            const bool inside = y >= edges.yMin && y < edges.yMax;
+            leftCenter[row] = left - 0.5f;
+            rightCenter[row] = inside ? right - 0.5f : -Unbounded;
+        }
+
+        for (uint32_t tile = tileBegin; tile < tileEnd; tile++, masks += TileHeight)
+        {
+            const float offset = static_cast<float>(tile * TileWidth);
+            for (uint32_t row = 0; row < TileHeight; row++)
+            {
+                const float start = std::ceil(std::clamp(leftCenter[row] - offset, 0.0f, static_cast<float>(TileWidth)));
+                const float end = std::ceil(std::clamp(rightCenter[row] - offset, 0.0f, static_cast<float>(TileWidth)));
+                masks[row] = SpanMask(static_cast<int32_t>(start), static_cast<int32_t>(end));
+            }
+        }
+    }
+
+#if defined(OCCLUSION_CULLER_SSE2)
+    void RasterizeTileRowSse2(const EdgeSetup& edges, uint32_t tileY, uint32_t tileBegin, uint32_t tileEnd, uint32_t* masks)
+    {
+        // pixel centers are at .5, the spans are made relative to them
+        const float firstRowY = static_cast<float>(tileY * TileHeight) + 0.5f;
+
+        // two registers of four rows each
+        __m128 leftCenter[2];
+        __m128 rightCenter[2];
+        for (uint32_t half = 0; half < 2; half++)
+        {
+            const __m128 y = _mm_add_ps(_mm_set1_ps(firstRowY + half * 4.0f), _mm_setr_ps(0, 1, 2, 3));
+            const __m128 left = _mm_max_ps(
+                _mm_add_ps(_mm_set1_ps(edges.leftA[0]), _mm_mul_ps(y, _mm_set1_ps(edges.leftS[0]))),
+                _mm_add_ps(_mm_set1_ps(edges.leftA[1]), _mm_mul_ps(y, _mm_set1_ps(edges.leftS[1]))));
+            __m128 right = _mm_min_ps(
+                _mm_add_ps(_mm_set1_ps(edges.rightA[0]), _mm_mul_ps(y, _mm_set1_ps(edges.rightS[0]))),
+                _mm_add_ps(_mm_set1_ps(edges.rightA[1]), _mm_mul_ps(y, _mm_set1_ps(edges.rightS[1]))));
+
+            const __m128 inside = _mm_and_ps(_mm_cmpge_ps(y, _mm_set1_ps(edges.yMin)), _mm_cmplt_ps(y, _mm_set1_ps(edges.yMax)));
+            right = _mm_or_ps(_mm_and_ps(inside, right), _mm_andnot_ps(inside, _mm_set1_ps(-Unbounded)));
+
+            leftCenter[half] = _mm_sub_ps(left, _mm_set1_ps(0.5f));
+            rightCenter[half] = _mm_sub_ps(right, _mm_set1_ps(0.5f));
+        }
+
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 width = _mm_set1_ps(static_cast<float>(TileWidth));
+
+        // ceil of values in [0, 32], SSE2 only truncates
+        auto ceilToInt = [&](__m128 value) {
+            value = _mm_min_ps(_mm_max_ps(value, zero), width);
+            const __m128i truncated = _mm_cvttps_epi32(value);
+            const __m128i fraction = _mm_castps_si128(_mm_cmplt_ps(_mm_cvtepi32_ps(truncated), value));
+            return _mm_sub_epi32(truncated, fraction);
+        };
+
+        for (uint32_t tile = tileBegin; tile < tileEnd; tile++, masks += TileHeight)
+        {
+            const __m128 offset = _mm_set1_ps(static_cast<float>(tile * TileWidth));
+
+            // there are no variable shifts before AVX2, the masks are put together one row at a time
+            alignas(16) int32_t start[TileHeight];
+            alignas(16) int32_t end[TileHeight];
+            for (uint32_t half = 0; half < 2; half++)
+            {
+                _mm_store_si128(reinterpret_cast<__m128i*>(start + half * 4), ceilToInt(_mm_sub_ps(leftCenter[half], offset)));
+                _mm_store_si128(reinterpret_cast<__m128i*>(end + half * 4), ceilToInt(_mm_sub_ps(rightCenter[half], offset)));
+            }
+
+            for (uint32_t row = 0; row < TileHeight; row++)
+            {
+                masks[row] = SpanMask(start[row], end[row]);
+            }
+        }
+    }
+#endif
+
+#if defined(OCCLUSION_CULLER_AVX2)
+    OCCLUSION_CULLER_AVX2_TARGET void RasterizeTileRowAvx2(
+        const EdgeSetup& edges, uint32_t tileY, uint32_t tileBegin, uint32_t tileEnd, uint32_t* masks)
+    {
+        // pixel centers are at .5, the spans are made relative to them
+        const float firstRowY = static_cast<float>(tileY * TileHeight) + 0.5f;
+
+        const __m256 y = _mm256_add_ps(_mm256_set1_ps(firstRowY), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m256 left = _mm256_max_ps(
+            _mm256_add_ps(_mm256_set1_ps(edges.leftA[0]), _mm256_mul_ps(y, _mm256_set1_ps(edges.leftS[0]))),
+            _mm256_add_ps(_mm256_set1_ps(edges.leftA[1]), _mm256_mul_ps(y, _mm256_set1_ps(edges.leftS[1]))));
+        __m256 right = _mm256_min_ps(
+            _mm256_add_ps(_mm256_set1_ps(edges.rightA[0]), _mm256_mul_ps(y, _mm256_set1_ps(edges.rightS[0]))),
+            _mm256_add_ps(_mm256_set1_ps(edges.rightA[1]), _mm256_mul_ps(y, _mm256_set1_ps(edges.rightS[1]))));
+
+        // rows outside of the triangle get an empty span
+        const __m256 inside = _mm256_and_ps(
+            _mm256_cmp_ps(y, _mm256_set1_ps(edges.yMin), _CMP_GE_OQ), _mm256_cmp_ps(y, _mm256_set1_ps(edges.yMax), _CMP_LT_OQ));
+        right = _mm256_blendv_ps(_mm256_set1_ps(-Unbounded), right, inside);
+
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 leftCenter = _mm256_sub_ps(left, half);
+        const __m256 rightCenter = _mm256_sub_ps(right, half);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 width = _mm256_set1_ps(static_cast<float>(TileWidth));
+        const __m256i full = _mm256_set1_epi32(-1);
+        const __m256i widthInt = _mm256_set1_epi32(TileWidth);
+
+        for (uint32_t tile = tileBegin; tile < tileEnd; tile++, masks += TileHeight)
+        {
+            const __m256 offset = _mm256_set1_ps(static_cast<float>(tile * TileWidth));
+            const __m256i start = _mm256_cvttps_epi32(
+                _mm256_ceil_ps(_mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(leftCenter, offset), zero), width)));
+            const __m256i end = _mm256_cvttps_epi32(
+                _mm256_ceil_ps(_mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(rightCenter, offset), zero), width)));
+
+            // shifts by 32 give 0, which takes care of empty spans at either end of the tile
+            const __m256i mask =
+                _mm256_and_si256(_mm256_sllv_epi32(full, start), _mm256_srlv_epi32(full, _mm256_sub_epi32(widthInt, end)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(masks), mask);
+        }
+    }
+
+    bool IsAvx2Supported()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        // AVX2, and the operating system saving the AVX registers.
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+#if defined(OCCLUSION_CULLER_NEON)
+    void RasterizeTileRowNeon(const EdgeSetup& edges, uint32_t tileY, uint32_t tileBegin, uint32_t tileEnd, uint32_t* masks)
+    {
+        // pixel centers are at .5, the spans are made relative to them
+        const float firstRowY = static_cast<float>(tileY * TileHeight) + 0.5f;
+
+        float32x4_t leftCenter[2];
+        float32x4_t rightCenter[2];
+        for (uint32_t half = 0; half < 2; half++)
+        {
+            const float rowOffsets[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+            const float32x4_t y = vaddq_f32(vdupq_n_f32(firstRowY + half * 4.0f), vld1q_f32(rowOffsets));
+            const float32x4_t left = vmaxq_f32(
+                vmlaq_n_f32(vdupq_n_f32(edges.leftA[0]), y, edges.leftS[0]), vmlaq_n_f32(vdupq_n_f32(edges.leftA[1]), y, edges.leftS[1]));
+            float32x4_t right = vminq_f32(
+                vmlaq_n_f32(vdupq_n_f32(edges.rightA[0]), y, edges.rightS[0]),
+                vmlaq_n_f32(vdupq_n_f32(edges.rightA[1]), y, edges.rightS[1]));
+
+            const uint32x4_t inside = vandq_u32(vcgeq_f32(y, vdupq_n_f32(edges.yMin)), vcltq_f32(y, vdupq_n_f32(edges.yMax)));
+            right = vbslq_f32(inside, right, vdupq_n_f32(-Unbounded));
+
+            leftCenter[half] = vsubq_f32(left, vdupq_n_f32(0.5f));
+            rightCenter[half] = vsubq_f32(right, vdupq_n_f32(0.5f));
+        }
+
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t width = vdupq_n_f32(static_cast<float>(TileWidth));
+        const uint32x4_t full = vdupq_n_u32(FullMask);
+        const int32x4_t widthInt = vdupq_n_s32(TileWidth);
+
+        for (uint32_t tile = tileBegin; tile < tileEnd; tile++, masks += TileHeight)
+        {
+            const float32x4_t offset = vdupq_n_f32(static_cast<float>(tile * TileWidth));
+            for (uint32_t half = 0; half < 2; half++)
+            {
+                const int32x4_t start =
+                    vcvtq_s32_f32(vrndpq_f32(vminq_f32(vmaxq_f32(vsubq_f32(leftCenter[half], offset), zero), width)));
+                const int32x4_t end =
+                    vcvtq_s32_f32(vrndpq_f32(vminq_f32(vmaxq_f32(vsubq_f32(rightCenter[half], offset), zero), width)));
+
+                // negative shift counts shift right, shifts by 32 give 0
+                const uint32x4_t mask = vandq_u32(vshlq_u32(full, start), vshlq_u32(full, vsubq_s32(end, widthInt)));
+                vst1q_u32(masks + half * 4, mask);
+            }
+        }
+    }
+#endif
+
+    RasterizeTileRowFunction GetRasterizeTileRow(OcclusionCuller::InstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+#if defined(OCCLUSION_CULLER_SSE2)
+            case OcclusionCuller::InstructionSet::Sse2:
+                return RasterizeTileRowSse2;
+#endif
+#if defined(OCCLUSION_CULLER_AVX2)
+            case OcclusionCuller::InstructionSet::Avx2:
+                return RasterizeTileRowAvx2;
+#endif
+#if defined(OCCLUSION_CULLER_NEON)
+            case OcclusionCuller::InstructionSet::Neon:
+                return RasterizeTileRowNeon;
+#endif
+            default:
+                return RasterizeTileRowScalar;
+        }
+    }
+
+    bool IsFullyCovered(const uint32_t* mask)
+    {
+        uint32_t covered = FullMask;
+        for (uint32_t row = 0; row < OcclusionCuller::TileHeight; row++)
+        {
+            covered &= mask[row];
+        }
+        return covered == FullMask;
+    }
+
+    // result = a * b, for row vectors
+    void MultiplyMatrices(float* result, const float* a, const float* b)
+    {
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                result[row * 4 + column] = a[row * 4 + 0] * b[0 * 4 + column] + a[row * 4 + 1] * b[1 * 4 + column] +
+                                           a[row * 4 + 2] * b[2 * 4 + column] + a[row * 4 + 3] * b[3 * 4 + column];
+            }
+        }
+    }
+} // namespace
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height, float depthBias)
+    : m_tileCountX(std::max((width + TileWidth - 1) / TileWidth, 1u))
+    , m_tileCountY(std::max((height + TileHeight - 1) / TileHeight, 1u))
+    , m_depthBias(depthBias)
+{
+    for (std::vector<Tile>& tiles : m_tiles)
+    {
+        tiles.resize(m_tileCountX * m_tileCountY);
+    }
+    m_rowMasks.resize(m_tileCountX * TileHeight);
+
+#if defined(OCCLUSION_CULLER_AVX2)
+    m_instructionSet = IsAvx2Supported() ? InstructionSet::Avx2 : InstructionSet::Sse2;
+#elif defined(OCCLUSION_CULLER_SSE2)
+    m_instructionSet = InstructionSet::Sse2;
+#elif defined(OCCLUSION_CULLER_NEON)
+    m_instructionSet = InstructionSet::Neon;
+#endif
+}
+
+OcclusionCuller::InstructionSet OcclusionCuller::SetInstructionSet(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+#if defined(OCCLUSION_CULLER_SSE2)
+        case InstructionSet::Sse2:
+            // SSE2 is part of x64, and required by the build on x86.
+            m_instructionSet = instructionSet;
+            break;
+#endif
+#if defined(OCCLUSION_CULLER_AVX2)
+        case InstructionSet::Avx2:
+            m_instructionSet = IsAvx2Supported() ? instructionSet : InstructionSet::Scalar;
+            break;
+#endif
+#if defined(OCCLUSION_CULLER_NEON)
+        case InstructionSet::Neon:
+            // NEON is part of ARM64.
+            m_instructionSet = instructionSet;
+            break;
+#endif
+        default:
+            m_instructionSet = InstructionSet::Scalar;
+            break;
+    }
+    return m_instructionSet;
+}
+
+void OcclusionCuller::BeginFrame(uint32_t viewCount, const float* viewProjections)
+{
+    const Clock::time_point start = Clock::now();
+    m_statistics = {};
+
+    assert(viewCount <= MaxViewCount);
+    m_viewCount = std::min(viewCount, MaxViewCount);
+    for (uint32_t view = 0; view < m_viewCount; view++)
+    {
+        memcpy(m_viewProjections[view], viewProjections + view * 16, sizeof(m_viewProjections[view]));
+
+        for (Tile& tile : m_tiles[view])
+        {
+            memset(tile.mask, 0, sizeof(tile.mask));
+            tile.referenceDepth = 0.0f;
+            tile.workingDepth = EmptyWorkingDepth;
+        }
+    }
+
+    m_statistics.clearTime = MillisecondsSince(start);
+}
+
+void OcclusionCuller::RenderOccluder(
+    const float* positions, uint32_t vertexCount, uint32_t stride, const uint16_t* indices, uint32_t indexCount, const float* model)
+{
+    const Clock::time_point start = Clock::now();
+    m_statistics.occluderTriangleCount += indexCount / 3;
+
+    m_clipVertices.resize(vertexCount);
+    m_screenVertices.resize(vertexCount);
+    for (uint32_t view = 0; view < m_viewCount; view++)
+    {
+        float matrix[16];
+        MultiplyMatrices(matrix, model, m_viewProjections[view]);
+
+        // only x, y and w are needed, the depth buffer stores 1 / w. the vertices are shared by several triangles, so they are
+        // projected up front, unless they are too close to be projected
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            const float* p = positions + i * stride;
+            const ClipVertex vertex = {
+                p[0] * matrix[0] + p[1] * matrix[4] + p[2] * matrix[8] + matrix[12],
+                p[0] * matrix[1] + p[1] * matrix[5] + p[2] * matrix[9] + matrix[13],
+                p[0] * matrix[3] + p[1] * matrix[7] + p[2] * matrix[11] + matrix[15]};
+            m_clipVertices[i] = vertex;
+            if (vertex.w >= NearDistance)
+            {
+                m_screenVertices[i] = Project(vertex);
+            }
+        }
+
+        Tile* tiles = m_tiles[view].data();
+        for (uint32_t i = 0; i + 3 <= indexCount; i += 3)
+        {
+            const uint16_t corners[3] = {indices[i], indices[i + 1], indices[i + 2]};
+            const bool inFront[3] = {
+                m_clipVertices[corners[0]].w >= NearDistance,
+                m_clipVertices[corners[1]].w >= NearDistance,
+                m_clipVertices[corners[2]].w >= NearDistance};
+            if (inFront[0] && inFront[1] && inFront[2])
+            {
+                const ScreenVertex triangle[3] = {m_screenVertices[corners[0]], m_screenVertices[corners[1]], m_screenVertices[corners[2]]};
+                RasterizeTriangle(tiles, triangle);
+                continue;
+            }
+
+            if (!inFront[0] && !inFront[1] && !inFront[2])
+            {
+                continue;
+            }
+
+            // clip against the near plane, which leaves a triangle or a quad
+            ScreenVertex polygon[4];
+            uint32_t polygonCount = 0;
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                const uint32_t next = (corner + 1) % 3;
+                const ClipVertex& a = m_clipVertices[corners[corner]];
+                const ClipVertex& b = m_clipVertices[corners[next]];
+                if (inFront[corner])
+                {
+                    polygon[polygonCount++] = m_screenVertices[corners[corner]];
+                }
+
+                if (inFront[corner] != inFront[next])
+                {
+                    const float t = (NearDistance - a.w) / (b.w - a.w);
+                    polygon[polygonCount++] = Project({a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, NearDistance});
+                }
+            }
+
+            RasterizeTriangle(tiles, polygon);
+            if (polygonCount == 4)
+            {
+                const ScreenVertex second[3] = {polygon[0], polygon[2], polygon[3]};
+                RasterizeTriangle(tiles, second);
+            }
+        }
+    }
+
+    m_statistics.rasterizeTime += MillisecondsSince(start);
+}
+
+OcclusionCuller::ScreenVertex OcclusionCuller::Project(const ClipVertex& vertex) const
+{
+    const float depth = 1.0f / vertex.w;
+    return {(vertex.x * depth + 1.0f) * GetWidth() * 0.5f, (1.0f - vertex.y * depth) * GetHeight() * 0.5f, depth};
+}
+
+void OcclusionCuller::RasterizeTriangle(Tile* tiles, const ScreenVertex* triangle)
+{
+    float x[3], y[3], depth[3];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        x[i] = triangle[i].x;
+        y[i] = triangle[i].y;
+        depth[i] = triangle[i].depth;
+    }
+
+    // make the winding clockwise on screen, so that edges going down are right edges
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(std::abs(area) > 0.0f))
+    {
+        return;
+    }
+
+    if (area < 0.0f)
+    {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(depth[1], depth[2]);
+        area = -area;
+    }
+
+    // pixels whose centers are inside the bounding box
+    const float minX = std::min({x[0], x[1], x[2]});
+    const float maxX = std::max({x[0], x[1], x[2]});
+    const float minY = std::min({y[0], y[1], y[2]});
+    const float maxY = std::max({y[0], y[1], y[2]});
+    const float firstPixelX = std::max(std::ceil(minX - 0.5f), 0.0f);
+    const float lastPixelX = std::min(std::ceil(maxX - 0.5f) - 1.0f, static_cast<float>(GetWidth() - 1));
+    const float firstPixelY = std::max(std::ceil(minY - 0.5f), 0.0f);
+    const float lastPixelY = std::min(std::ceil(maxY - 0.5f) - 1.0f, static_cast<float>(GetHeight() - 1));
+    if (firstPixelX > lastPixelX || firstPixelY > lastPixelY)
+    {
+        return;
+    }
+
+    const uint32_t firstTileX = static_cast<uint32_t>(firstPixelX) / TileWidth;
+    const uint32_t lastTileX = static_cast<uint32_t>(lastPixelX) / TileWidth;
+    const uint32_t firstTileY = static_cast<uint32_t>(firstPixelY) / TileHeight;
+    const uint32_t lastTileY = static_cast<uint32_t>(lastPixelY) / TileHeight;
+
+    const RasterizeTileRowFunction rasterizeTileRow = GetRasterizeTileRow(m_instructionSet);
+
+    EdgeSetup edges;
+    edges.yMin = minY;
+    edges.yMax = maxY;
+    uint32_t leftCount = 0;
+    uint32_t rightCount = 0;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        const uint32_t j = (i + 1) % 3;
+        const float dy = y[j] - y[i];
+        if (dy == 0.0f)
+        {
+            continue;
+        }
+
+        const float s = (x[j] - x[i]) / dy;
+        const float a = x[i] - y[i] * s;
+        if (dy > 0.0f)
+        {
+            edges.rightA[rightCount] = a;
+            edges.rightS[rightCount] = s;
+            rightCount++;
+        }
+        else
+        {
+            edges.leftA[leftCount] = a;
+            edges.leftS[leftCount] = s;
+            leftCount++;
+        }
+    }
+
+    // depth = c + dx * x + dy * y, its farthest value in the part of a tile within the bounding box is the depth of the triangle there.
+    // no point of the triangle is farther than its farthest vertex either
+    const float depthDx = ((depth[1] - depth[0]) * (y[2] - y[0]) - (depth[2] - depth[0]) * (y[1] - y[0])) / area;
+    const float depthDy = ((depth[2] - depth[0]) * (x[1] - x[0]) - (depth[1] - depth[0]) * (x[2] - x[0])) / area;
+    const float depthC = depth[0] - depthDx * x[0] - depthDy * y[0];
+    const float farthestDepth = std::min({depth[0], depth[1], depth[2]});
+
+    bool rasterized = false;
+    for (uint32_t tileY = firstTileY; tileY <= lastTileY; tileY++)
+    {
+        uint32_t* masks = m_rowMasks.data();
+        rasterizeTileRow(edges, tileY, firstTileX, lastTileX + 1, masks);
+
+        const float rectMinY = std::max(static_cast<float>(tileY * TileHeight) + 0.5f, minY);
+        const float rectMaxY = std::min(static_cast<float>(tileY * TileHeight + TileHeight) - 0.5f, maxY);
+        const float farthestY = depthDy > 0.0f ? rectMinY : rectMaxY;
+
+        for (uint32_t tileX = firstTileX; tileX <= lastTileX; tileX++, masks += TileHeight)
+        {
+            uint32_t covered = 0;
+            for (uint32_t row = 0; row < TileHeight; row++)
+            {
+                covered |= masks[row];
+            }
+            if (covered == 0)
+            {
+                continue;
+            }
+
+            rasterized = true;
+
+            const float rectMinX = std::max(static_cast<float>(tileX * TileWidth) + 0.5f, minX);
+            const float rectMaxX = std::min(static_cast<float>(tileX * TileWidth + TileWidth) - 0.5f, maxX);
+            const float farthestX = depthDx > 0.0f ? rectMinX : rectMaxX;
+            const float triangleDepth = std::max(depthC + depthDx * farthestX + depthDy * farthestY, farthestDepth);
+
+            // the triangle is completely behind what the tile is known to be covered by already
+            Tile& tile = tiles[tileY * m_tileCountX + tileX];
+            if (triangleDepth <= tile.referenceDepth)
+            {
+                continue;
+            }
+
+            // a triangle which is closer to the reference layer than to the working layer would push the working layer back too far,
+            // start a new one from it instead
+            if (tile.workingDepth - triangleDepth > triangleDepth - tile.referenceDepth)
+            {
+                memset(tile.mask, 0, sizeof(tile.mask));
+                tile.workingDepth = EmptyWorkingDepth;
+            }
+
+            tile.workingDepth = std::min(tile.workingDepth, triangleDepth);
+            for (uint32_t row = 0; row < TileHeight; row++)
+            {
+                tile.mask[row] |= masks[row];
+            }
+
+            // all triangles in the working layer are closer than the reference layer
+            if (IsFullyCovered(tile.mask))
+            {
+                tile.referenceDepth = tile.workingDepth;
+                memset(tile.mask, 0, sizeof(tile.mask));
+                tile.workingDepth = EmptyWorkingDepth;
+            }
+        }
+    }
+
+    if (rasterized)
+    {
+        m_statistics.rasterizedTriangleCount++;
+    }
+}
+
+bool OcclusionCuller::IsBoxVisible(const float* center, const float* halfAxisX, const float* halfAxisY, const float* halfAxisZ)
+{
+    const Clock::time_point start = Clock::now();
+    m_statistics.testedCount++;
+
+    bool visible = m_viewCount == 0;
+    for (uint32_t view = 0; view < m_viewCount && !visible; view++)
+    {
+        const float* matrix = m_viewProjections[view];
+
+        // the corners are the center plus or minus each half axis, which are transformed without the translation
+        float clipCenter[4];
+        float clipAxes[3][4];
+        const float* axes[3] = {halfAxisX, halfAxisY, halfAxisZ};
+        for (uint32_t column = 0; column < 4; column++)
+        {
+            clipCenter[column] =
+                center[0] * matrix[column] + center[1] * matrix[4 + column] + center[2] * matrix[8 + column] + matrix[12 + column];
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                clipAxes[axis][column] =
+                    axes[axis][0] * matrix[column] + axes[axis][1] * matrix[4 + column] + axes[axis][2] * matrix[8 + column];
+            }
+        }
+
+        const float closestW =
+            clipCenter[3] - std::abs(clipAxes[0][3]) - std::abs(clipAxes[1][3]) - std::abs(clipAxes[2][3]) - m_depthBias;
+        if (closestW < NearDistance)
+        {
+            visible = true;
+            break;
+        }
+
+        float minX = Unbounded, minY = Unbounded;
+        float maxX = -Unbounded, maxY = -Unbounded;
+        for (uint32_t corner = 0; corner < 8; corner++)
+        {
+            float clip[4];
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                clip[column] = clipCenter[column];
+                for (uint32_t axis = 0; axis < 3; axis++)
+                {
+                    clip[column] += (corner & (1 << axis)) ? clipAxes[axis][column] : -clipAxes[axis][column];
+                }
+            }
+
+            const float x = (clip[0] / clip[3] + 1.0f) * GetWidth() * 0.5f;
+            const float y = (1.0f - clip[1] / clip[3]) * GetHeight() * 0.5f;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+        }
+
+        visible = IsRectVisible(m_tiles[view].data(), minX, minY, maxX, maxY, 1.0f / closestW);
+    }
+
+    if (!visible)
+    {
+        m_statistics.occludedCount++;
+    }
+
+    m_statistics.testTime += MillisecondsSince(start);
+    return visible;
+}
+
+bool OcclusionCuller::IsSphereVisible(const float* center, float radius)
+{
+    const float halfAxisX[3] = {radius, 0.0f, 0.0f};
+    const float halfAxisY[3] = {0.0f, radius, 0.0f};
+    const float halfAxisZ[3] = {0.0f, 0.0f, radius};
+    return IsBoxVisible(center, halfAxisX, halfAxisY, halfAxisZ);
+}
+
+bool OcclusionCuller::IsRectVisible(const Tile* tiles, float minX, float minY, float maxX, float maxY, float depth) const
+{
+    // off screen is up to frustum culling, the part on screen is tested
+    if (maxX < 0.0f || maxY < 0.0f || minX >= GetWidth() || minY >= GetHeight())
+    {
+        return true;
+    }
+
+    const uint32_t firstTileX = static_cast<uint32_t>(std::max(minX, 0.0f)) / TileWidth;
+    const uint32_t lastTileX = static_cast<uint32_t>(std::min(maxX, GetWidth() - 1.0f)) / TileWidth;
+    const uint32_t firstTileY = static_cast<uint32_t>(std::max(minY, 0.0f)) / TileHeight;
+    const uint32_t lastTileY = static_cast<uint32_t>(std::min(maxY, GetHeight() - 1.0f)) / TileHeight;
+
+    for (uint32_t tileY = firstTileY; tileY <= lastTileY; tileY++)
+    {
+        const Tile* row = tiles + tileY * m_tileCountX;
+        for (uint32_t tileX = firstTileX; tileX <= lastTileX; tileX++)
+        {
+            if (row[tileX].referenceDepth < depth)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
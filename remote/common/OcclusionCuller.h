@@ -0,0 +1,146 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Software occlusion culling against a low resolution depth buffer, which is rasterized on the CPU from occluder meshes (e.g. the
+// spatial surface mesh), so that objects hidden behind them can be skipped before their draw calls are even submitted.
+//
+// The depth buffer follows "Masked Software Occlusion Culling" (Hasselgren, Andersson, Akenine-Möller): instead of a depth value per
+// pixel, the screen is divided into tiles of 32x8 pixels, and each tile stores a coverage mask with one bit per pixel and two
+// conservative depth values. The reference layer holds a depth which all pixels of the tile are at least as close as. The working layer
+// collects triangles, with the farthest depth of them and the union of their coverage, until it covers the whole tile and replaces the
+// reference layer. A triangle which is far behind the working layer starts a new one. The coverage masks of the eight rows of a tile are
+// computed at once, by kernels which are picked at runtime: AVX2 if the processor supports it, otherwise SSE2 on x86 and x64, NEON on
+// ARM64, and scalar code everywhere else. All of them follow the same coverage rules.
+
+//
+// Depth is stored as 1 / w, the reciprocal of the view distance, which is linear in screen space, larger values are closer. Objects are
+// tested with the closest depth of their bounding box against the reference layers of the tiles it overlaps, they are visible if any of
+// them is farther. Only the tiles on screen are tested, what lies off screen is up to frustum culling.
+//
+// Matrices are 4x4 row major and transform row vectors, like the ones of Windows.Foundation.Numerics: clip = (x, y, z, 1) * matrix, with
+// the view distance in clip w. The culler keeps its buffers between frames, use one instance per thread.
+class OcclusionCuller
+{
+public:
+    static constexpr uint32_t TileWidth = 32;
+    static constexpr uint32_t TileHeight = 8;
+    static constexpr uint32_t MaxViewCount = 2;
+
+    enum class InstructionSet
+    {
+        Scalar,
+        Sse2,
+        Avx2,
+        Neon
+    };
+
+    struct Statistics
+    {
+        // triangles passed to RenderOccluder, and the ones which covered any pixel, per view
+        uint32_t occluderTriangleCount = 0;
+        uint32_t rasterizedTriangleCount = 0;
+        uint32_t testedCount = 0;
+        uint32_t occludedCount = 0;
+
+        // time spent on clearing, rasterizing and testing during the frame, in milliseconds
+        float clearTime = 0.0f;
+        float rasterizeTime = 0.0f;
+        float testTime = 0.0f;
+    };
+
+    // The resolution is rounded up to whole tiles. Objects are tested depthBias meters closer than they are, so that objects on the
+    // surface of an occluder (or slightly behind it, as its mesh is only an approximation) stay visible.
+    OcclusionCuller(uint32_t width = 320, uint32_t height = 176, float depthBias = 0.1f);
+
+    // Clears the depth buffers of viewCount views, viewProjections holds their 16 floats each.
+    void BeginFrame(uint32_t viewCount, const float* viewProjections);
+
+    // Rasterizes an indexed triangle list into all views. positions are x, y, z, stride floats apart, model transforms them into the
+    // space of the view projections. Triangles are rasterized regardless of their winding.
+    void RenderOccluder(
+        const float* positions, uint32_t vertexCount, uint32_t stride, const uint16_t* indices, uint32_t indexCount, const float* model);
+
+    // Returns false if the box, given by its center and its three half axes, is hidden behind the occluders in all views. Boxes which
+    // reach in front of the near plane, and boxes which are entirely off screen, are always visible. Of a box which is partly off
+    // screen, only the part on screen is tested.
+    bool IsBoxVisible(const float* center, const float* halfAxisX, const float* halfAxisY, const float* halfAxisZ);
+
+    bool IsSphereVisible(const float* center, float radius);
+
+    uint32_t GetWidth() const
+    {
+        return m_tileCountX * TileWidth;
+    }
+
+    uint32_t GetHeight() const
+    {
+        return m_tileCountY * TileHeight;
+    }
+
+    const Statistics& GetStatistics() const
+    {
+        return m_statistics;
+    }
+
+    // Returns the instruction set the coverage kernels in use are written for.
+    InstructionSet GetInstructionSet() const
+    {
+        return m_instructionSet;
+    }
+
+    // Replaces the coverage kernels, e.g. to compare them. Falls back to the scalar kernels if the processor doesn't support the
+    // instruction set, and returns the one selected.
+    InstructionSet SetInstructionSet(InstructionSet instructionSet);
+
+private:
+    struct Tile
+    {
+        uint32_t mask[TileHeight];
+        float referenceDepth;
+        float workingDepth;
+    };
+
+    struct ClipVertex
+    {
+        float x, y, w;
+    };
+
+    // pixel coordinates, y down, and 1 / w
+    struct ScreenVertex
+    {
+        float x, y, depth;
+    };
+
+    ScreenVertex Project(const ClipVertex& vertex) const;
+    void RasterizeTriangle(Tile* tiles, const ScreenVertex* triangle);
+    bool IsRectVisible(const Tile* tiles, float minX, float minY, float maxX, float maxY, float depth) const;
+
+    const uint32_t m_tileCountX;
+    const uint32_t m_tileCountY;
+    const float m_depthBias;
+    InstructionSet m_instructionSet = InstructionSet::Scalar;
+
+    uint32_t m_viewCount = 0;
+    float m_viewProjections[MaxViewCount][16] = {};
+    std::vector<Tile> m_tiles[MaxViewCount];
+
+    // occluder vertices in clip space and projected, and the coverage masks of one row of tiles of a triangle
+    std::vector<ClipVertex> m_clipVertices;
+    std::vector<ScreenVertex> m_screenVertices;
+    std::vector<uint32_t> m_rowMasks;
+
+    Statistics m_statistics;
+};
@@ -0,0 +1,397 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <PointTransform.h>
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define POINT_TRANSFORM_X64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+// The AVX2 kernels are compiled for AVX2 and FMA regardless of the target of the build, they are only called if the processor supports
+// them. MSVC always allows the intrinsics, GCC and Clang need the target attribute.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define POINT_TRANSFORM_AVX2_TARGET
+#else
+#define POINT_TRANSFORM_AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define POINT_TRANSFORM_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace PointTransform;
+
+namespace
+{
+    using TransformPointsAosFunction = void (*)(const float*, const uint8_t*, size_t, uint8_t*, size_t, size_t);
+    using TransformPointsSoaFunction =
+        void (*)(const float*, const float*, const float*, const float*, float*, float*, float*, size_t);
+
+    struct Kernels
+    {
+        InstructionSet instructionSet;
+        TransformPointsAosFunction transformPointsAos;
+        TransformPointsSoaFunction transformPointsSoa;
+    };
+
+    // The source point is read completely before the destination is written, so that points can be transformed in place.
+    void TransformPointsAosScalar(
+        const float* m, const uint8_t* source, size_t sourceStride, uint8_t* destination, size_t destinationStride, size_t count)
+    {
+        for (size_t i = 0; i < count; i++, source += sourceStride, destination += destinationStride)
+        {
+            const float* p = reinterpret_cast<const float*>(source);
+            const float x = p[0], y = p[1], z = p[2];
+
+            float* d = reinterpret_cast<float*>(destination);
+            d[0] = x * m[0] + y * m[4] + z * m[8] + m[12];
+            d[1] = x * m[1] + y * m[5] + z * m[9] + m[13];
+            d[2] = x * m[2] + y * m[6] + z * m[10] + m[14];
+        }
+    }
+
+    void TransformPointsSoaScalar(
+        const float* m,
+        const float* sourceX,
+        const float* sourceY,
+        const float* sourceZ,
+        float* destinationX,
+        float* destinationY,
+        float* destinationZ,
+        size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const float x = sourceX[i], y = sourceY[i], z = sourceZ[i];
+            destinationX[i] = x * m[0] + y * m[4] + z * m[8] + m[12];
+            destinationY[i] = x * m[1] + y * m[5] + z * m[9] + m[13];
+            destinationZ[i] = x * m[2] + y * m[6] + z * m[10] + m[14];
+        }
+    }
+
+#if defined(POINT_TRANSFORM_X64)
+    // Points are loaded and stored with exactly 12 bytes, as the 4 bytes behind them may be the end of the buffer, or the next point of an
+    // in place transform which has not been read yet.
+    inline __m128 LoadPoint(const uint8_t* source)
+    {
+        const float* p = reinterpret_cast<const float*>(source);
+        return _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p)), _mm_load_ss(p + 2));
+    }
+
+    inline void StorePoint(uint8_t* destination, __m128 point)
+    {
+        float* d = reinterpret_cast<float*>(destination);
+        _mm_storel_pi(reinterpret_cast<__m64*>(d), point);
+        _mm_store_ss(d + 2, _mm_movehl_ps(point, point));
+    }
+
+    // One point per register: its coordinates are broadcast and multiplied with the matrix rows.
+    void TransformPointsAosSse2(
+        const float* m, const uint8_t* source, size_t sourceStride, uint8_t* destination, size_t destinationStride, size_t count)
+    {
+        const __m128 row0 = _mm_loadu_ps(m);
+        const __m128 row1 = _mm_loadu_ps(m + 4);
+        const __m128 row2 = _mm_loadu_ps(m + 8);
+        const __m128 row3 = _mm_loadu_ps(m + 12);
+
+        for (size_t i = 0; i < count; i++, source += sourceStride, destination += destinationStride)
+        {
+            const __m128 p = LoadPoint(source);
+            __m128 r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), row0), row3);
+            r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), row1), r);
+            r = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), row2), r);
+            StorePoint(destination, r);
+        }
+    }
+
+    // Four points per register, with one register per coordinate.
+    void TransformPointsSoaSse2(
+        const float* m,
+        const float* sourceX,
+        const float* sourceY,
+        const float* sourceZ,
+        float* destinationX,
+        float* destinationY,
+        float* destinationZ,
+        size_t count)
+    {
+        __m128 mm[12];
+        for (int i = 0; i < 12; i++)
+        {
+            mm[i] = _mm_set1_ps(m[i + i / 3]);
+        }
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(sourceX + i);
+            const __m128 y = _mm_loadu_ps(sourceY + i);
+            const __m128 z = _mm_loadu_ps(sourceZ + i);
+            // mm holds the matrix without its fourth column: m[0], m[1], m[2], m[4], ...
+            const __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, mm[0]), _mm_mul_ps(y, mm[3])), _mm_add_ps(_mm_mul_ps(z, mm[6]), mm[9]));
+            const __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, mm[1]), _mm_mul_ps(y, mm[4])), _mm_add_ps(_mm_mul_ps(z, mm[7]), mm[10]));
+            const __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, mm[2]), _mm_mul_ps(y, mm[5])), _mm_add_ps(_mm_mul_ps(z, mm[8]), mm[11]));
+            _mm_storeu_ps(destinationX + i, rx);
+            _mm_storeu_ps(destinationY + i, ry);
+            _mm_storeu_ps(destinationZ + i, rz);
+        }
+
+        TransformPointsSoaScalar(
+            m, sourceX + i, sourceY + i, sourceZ + i, destinationX + i, destinationY + i, destinationZ + i, count - i);
+    }
+
+    // Two points per register, one in each 128 bit lane.
+    POINT_TRANSFORM_AVX2_TARGET void TransformPointsAosAvx2(
+        const float* m, const uint8_t* source, size_t sourceStride, uint8_t* destination, size_t destinationStride, size_t count)
+    {
+        const __m256 row0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m));
+        const __m256 row1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 4));
+        const __m256 row2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 8));
+        const __m256 row3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 12));
+
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2, source += 2 * sourceStride, destination += 2 * destinationStride)
+        {
+            const __m256 p = _mm256_insertf128_ps(_mm256_castps128_ps256(LoadPoint(source)), LoadPoint(source + sourceStride), 1);
+            __m256 r = _mm256_fmadd_ps(_mm256_permute_ps(p, _MM_SHUFFLE(0, 0, 0, 0)), row0, row3);
+            r = _mm256_fmadd_ps(_mm256_permute_ps(p, _MM_SHUFFLE(1, 1, 1, 1)), row1, r);
+            r = _mm256_fmadd_ps(_mm256_permute_ps(p, _MM_SHUFFLE(2, 2, 2, 2)), row2, r);
+            StorePoint(destination, _mm256_castps256_ps128(r));
+            StorePoint(destination + destinationStride, _mm256_extractf128_ps(r, 1));
+        }
+
+        if (i < count)
+        {
+            const __m128 p = LoadPoint(source);
+            __m128 r = _mm_fmadd_ps(_mm_permute_ps(p, _MM_SHUFFLE(0, 0, 0, 0)), _mm256_castps256_ps128(row0), _mm256_castps256_ps128(row3));
+            r = _mm_fmadd_ps(_mm_permute_ps(p, _MM_SHUFFLE(1, 1, 1, 1)), _mm256_castps256_ps128(row1), r);
+            r = _mm_fmadd_ps(_mm_permute_ps(p, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_castps256_ps128(row2), r);
+            StorePoint(destination, r);
+        }
+
+        _mm256_zeroupper();
+    }
+
+    // Eight points per register, with one register per coordinate.
+    POINT_TRANSFORM_AVX2_TARGET void TransformPointsSoaAvx2(
+        const float* m,
+        const float* sourceX,
+        const float* sourceY,
+        const float* sourceZ,
+        float* destinationX,
+        float* destinationY,
+        float* destinationZ,
+        size_t count)
+    {
+        __m256 mm[12];
+        for (int i = 0; i < 12; i++)
+        {
+            mm[i] = _mm256_set1_ps(m[i + i / 3]);
+        }
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(sourceX + i);
+            const __m256 y = _mm256_loadu_ps(sourceY + i);
+            const __m256 z = _mm256_loadu_ps(sourceZ + i);
+            _mm256_storeu_ps(destinationX + i, _mm256_fmadd_ps(x, mm[0], _mm256_fmadd_ps(y, mm[3], _mm256_fmadd_ps(z, mm[6], mm[9]))));
+            _mm256_storeu_ps(destinationY + i, _mm256_fmadd_ps(x, mm[1], _mm256_fmadd_ps(y, mm[4], _mm256_fmadd_ps(z, mm[7], mm[10]))));
+            _mm256_storeu_ps(destinationZ + i, _mm256_fmadd_ps(x, mm[2], _mm256_fmadd_ps(y, mm[5], _mm256_fmadd_ps(z, mm[8], mm[11]))));
+        }
+
+        _mm256_zeroupper();
+
+        TransformPointsSoaSse2(
+            m, sourceX + i, sourceY + i, sourceZ + i, destinationX + i, destinationY + i, destinationZ + i, count - i);
+    }
+
+    bool IsAvx2Supported()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        // AVX2 and FMA, and the operating system saving the AVX registers.
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        __cpuid(info, 1);
+        const bool fma = (info[2] & (1 << 12)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!fma || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    }
+#endif
+
+#if defined(POINT_TRANSFORM_NEON)
+    // One point per register, multiplied with the matrix rows by lane.
+    void TransformPointsAosNeon(
+        const float* m, const uint8_t* source, size_t sourceStride, uint8_t* destination, size_t destinationStride, size_t count)
+    {
+        const float32x4_t row0 = vld1q_f32(m);
+        const float32x4_t row1 = vld1q_f32(m + 4);
+        const float32x4_t row2 = vld1q_f32(m + 8);
+        const float32x4_t row3 = vld1q_f32(m + 12);
+
+        for (size_t i = 0; i < count; i++, source += sourceStride, destination += destinationStride)
+        {
+            // Exactly 12 bytes are loaded and stored, see LoadPoint of x64.
+            const float* p = reinterpret_cast<const float*>(source);
+            const float32x2_t xy = vld1_f32(p);
+            const float z = p[2];
+
+            float32x4_t r = vfmaq_lane_f32(row3, row0, xy, 0);
+            r = vfmaq_lane_f32(r, row1, xy, 1);
+            r = vfmaq_n_f32(r, row2, z);
+
+            float* d = reinterpret_cast<float*>(destination);
+            vst1_f32(d, vget_low_f32(r));
+            vst1q_lane_f32(d + 2, r, 2);
+        }
+    }
+
+    // Four points per register, with one register per coordinate.
+    void TransformPointsSoaNeon(
+        const float* m,
+        const float* sourceX,
+        const float* sourceY,
+        const float* sourceZ,
+        float* destinationX,
+        float* destinationY,
+        float* destinationZ,
+        size_t count)
+    {
+        float32x4_t mm[12];
+        for (int i = 0; i < 12; i++)
+        {
+            mm[i] = vdupq_n_f32(m[i + i / 3]);
+        }
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const float32x4_t x = vld1q_f32(sourceX + i);
+            const float32x4_t y = vld1q_f32(sourceY + i);
+            const float32x4_t z = vld1q_f32(sourceZ + i);
+            vst1q_f32(destinationX + i, vfmaq_f32(vfmaq_f32(vfmaq_f32(mm[9], z, mm[6]), y, mm[3]), x, mm[0]));
+            vst1q_f32(destinationY + i, vfmaq_f32(vfmaq_f32(vfmaq_f32(mm[10], z, mm[7]), y, mm[4]), x, mm[1]));
+            vst1q_f32(destinationZ + i, vfmaq_f32(vfmaq_f32(vfmaq_f32(mm[11], z, mm[8]), y, mm[5]), x, mm[2]));
+        }
+
+        TransformPointsSoaScalar(
+            m, sourceX + i, sourceY + i, sourceZ + i, destinationX + i, destinationY + i, destinationZ + i, count - i);
+    }
+#endif
+
+    constexpr Kernels ScalarKernels = {InstructionSet::Scalar, TransformPointsAosScalar, TransformPointsSoaScalar};
+#if defined(POINT_TRANSFORM_X64)
+    constexpr Kernels Sse2Kernels = {InstructionSet::Sse2, TransformPointsAosSse2, TransformPointsSoaSse2};
+    constexpr Kernels Avx2Kernels = {InstructionSet::Avx2, TransformPointsAosAvx2, TransformPointsSoaAvx2};
+#endif
+#if defined(POINT_TRANSFORM_NEON)
+    constexpr Kernels NeonKernels = {InstructionSet::Neon, TransformPointsAosNeon, TransformPointsSoaNeon};
+#endif
+
+    const Kernels* SelectKernels(InstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+#if defined(POINT_TRANSFORM_X64)
+            case InstructionSet::Sse2:
+                // SSE2 is part of x64.
+                return &Sse2Kernels;
+            case InstructionSet::Avx2:
+                return IsAvx2Supported() ? &Avx2Kernels : &ScalarKernels;
+#endif
+#if defined(POINT_TRANSFORM_NEON)
+            case InstructionSet::Neon:
+                // NEON is part of ARM64.
+                return &NeonKernels;
+#endif
+            default:
+                return &ScalarKernels;
+        }
+    }
+
+    const Kernels* SelectBestKernels()
+    {
+#if defined(POINT_TRANSFORM_X64)
+        return IsAvx2Supported() ? &Avx2Kernels : &Sse2Kernels;
+#elif defined(POINT_TRANSFORM_NEON)
+        return &NeonKernels;
+#else
+        return &ScalarKernels;
+#endif
+    }
+
+    std::atomic<const Kernels*> g_kernels = nullptr;
+
+    const Kernels& GetKernels()
+    {
+        const Kernels* kernels = g_kernels.load(std::memory_order_acquire);
+        if (!kernels)
+        {
+            // Threads racing here all select the same kernels.
+            kernels = SelectBestKernels();
+            g_kernels.store(kernels, std::memory_order_release);
+        }
+        return *kernels;
+    }
+} // namespace
+
+namespace PointTransform
+{
+    InstructionSet GetInstructionSet()
+    {
+        return GetKernels().instructionSet;
+    }
+
+    InstructionSet SetInstructionSet(InstructionSet instructionSet)
+    {
+        const Kernels* kernels = SelectKernels(instructionSet);
+        g_kernels.store(kernels, std::memory_order_release);
+        return kernels->instructionSet;
+    }
+
+    void TransformPoints(
+        const float* matrix, const void* source, size_t sourceStride, void* destination, size_t destinationStride, size_t count)
+    {
+        GetKernels().transformPointsAos(
+            matrix, static_cast<const uint8_t*>(source), sourceStride, static_cast<uint8_t*>(destination), destinationStride, count);
+    }
+
+    void TransformPoints(
+        const float* matrix,
+        const float* sourceX,
+        const float* sourceY,
+        const float* sourceZ,
+        float* destinationX,
+        float* destinationY,
+        float* destinationZ,
+        size_t count)
+    {
+        GetKernels().transformPointsSoa(matrix, sourceX, sourceY, sourceZ, destinationX, destinationY, destinationZ, count);
+    }
+} // namespace PointTransform
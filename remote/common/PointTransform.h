@@ -0,0 +1,54 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+
+// Transforms batches of points by a 4x4 matrix, with the same result as transform(float3, float4x4) of Windows.Foundation.Numerics
+// applied to each of them: (x, y, z, 1) * matrix, without a division by w. Matrices are 16 floats, row major, for row vectors.
+//
+// The kernels are picked once at runtime: AVX2 with FMA if the processor supports it, otherwise SSE2 on x64, NEON on ARM64, and scalar
+// code everywhere else. Results may differ from the scalar code in the last bit, as the AVX2 and NEON kernels use fused multiply adds.
+namespace PointTransform
+{
+    enum class InstructionSet
+    {
+        Scalar,
+        Sse2,
+        Avx2,
+        Neon
+    };
+
+    // Returns the instruction set the kernels in use are written for.
+    InstructionSet GetInstructionSet();
+
+    // Replaces the kernels in use, e.g. to compare them. Falls back to the scalar kernels if the processor doesn't support the instruction
+    // set, and returns the one selected. Must not be called while points are transformed on other threads.
+    InstructionSet SetInstructionSet(InstructionSet instructionSet);
+
+    // Transforms count points stored as x, y, z floats, sourceStride bytes apart, to x, y, z floats destinationStride bytes apart, e.g. the
+    // positions in an array of vertices. The points may be transformed in place, otherwise source and destination must not overlap.
+    void TransformPoints(
+        const float* matrix, const void* source, size_t sourceStride, void* destination, size_t destinationStride, size_t count);
+
+    // Transforms count points stored as separate arrays of their coordinates. Each destination array may be the same as the corresponding
+    // source array, otherwise the arrays must not overlap.
+    void TransformPoints(
+        const float* matrix,
+        const float* sourceX,
+        const float* sourceY,
+        const float* sourceZ,
+        float* destinationX,
+        float* destinationY,
+        float* destinationZ,
+        size_t count);
+} // namespace PointTransform
@@ -0,0 +1,49 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <SceneGeometryBuilder.h>
+
+#include <PointTransform.h>
+
+#include <algorithm>
+
+size_t SceneGeometryBuilder::GetChunkCount(size_t objectCount, size_t threadCount)
+{
+    return std::min(objectCount, std::max<size_t>(threadCount, 1) * ChunksPerThread);
+}
+
+size_t SceneGeometryBuilder::GetChunkBegin(size_t objectCount, size_t chunkCount, size_t chunk)
+{
+    return objectCount * chunk / chunkCount;
+}
+
+void SceneGeometryBuilder::AppendMesh(
+    const float* matrix,
+    const float* positions,
+    uint32_t vertexCount,
+    const uint32_t* indices,
+    uint32_t indexCount,
+    uint32_t baseVertex,
+    float* destinationPositions,
+    size_t destinationStride,
+    uint32_t* destinationIndices)
+{
+    PointTransform::TransformPoints(matrix, positions, 3 * sizeof(float), destinationPositions, destinationStride, vertexCount);
+    OffsetIndices(indices, indexCount, baseVertex, destinationIndices);
+}
+
+void SceneGeometryBuilder::OffsetIndices(const uint32_t* indices, size_t count, uint32_t baseVertex, uint32_t* destination)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        destination[i] = indices[i] + baseVertex;
+    }
+}
@@ -0,0 +1,65 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The steps of building the scene understanding geometry which don't depend on the scene understanding runtime or Direct3D.
+//
+// Meshes stay indexed: every vertex of a scene mesh is transformed once, and its triangles index the transformed vertices, offset by
+// the vertices of the meshes before it in the same buffer.
+//
+// The geometry of the scene objects is created in parallel, in contiguous chunks of objects. The geometries are then concatenated in
+// the order of the objects, at the offsets of the parts before them, so the result is the same as building all objects on one thread.
+namespace SceneGeometryBuilder
+{
+    // The objects are split into this many chunks per thread, so that chunks with many or large meshes don't leave the other threads
+    // idle.
+    constexpr size_t ChunksPerThread = 4;
+
+    // Returns the number of chunks to split objectCount objects into for threadCount threads.
+    size_t GetChunkCount(size_t objectCount, size_t threadCount);
+
+    // Returns the first object of the chunk. The chunk ends at the first object of the next chunk, the last one at objectCount.
+    size_t GetChunkBegin(size_t objectCount, size_t chunkCount, size_t chunk);
+
+    // Returns the offsets of the parts in their concatenation, the sums of the sizes of the parts before them, followed by the total size.
+    template <typename Part, typename GetSize>
+    std::vector<size_t> GetPartOffsets(const std::vector<Part>& parts, GetSize&& getSize)
+    {
+        std::vector<size_t> offsets(parts.size() + 1, 0);
+        for (size_t i = 0; i < parts.size(); i++)
+        {
+            offsets[i + 1] = offsets[i] + getSize(parts[i]);
+        }
+        return offsets;
+    }
+
+    // Appends a mesh in object space to the mesh of a scene. The vertexCount positions, x, y, z floats each, are transformed by
+    // matrix (see PointTransform) into the positions of the destination vertices, destinationStride bytes apart. The indexCount
+    // triangle indices are offset by baseVertex, the number of vertices in front of the destination vertices.
+    void AppendMesh(
+        const float* matrix,
+        const float* positions,
+        uint32_t vertexCount,
+        const uint32_t* indices,
+        uint32_t indexCount,
+        uint32_t baseVertex,
+        float* destinationPositions,
+        size_t destinationStride,
+        uint32_t* destinationIndices);
+
+    // Copies count indices, adding baseVertex to each of them.
+    void OffsetIndices(const uint32_t* indices, size_t count, uint32_t baseVertex, uint32_t* destination);
+} // namespace SceneGeometryBuilder
@@ -0,0 +1,66 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <FlatHashMap.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// What was created from the objects of a scene, e.g. their vertices, so that for the next snapshot of the scene it only has to be
+// created for the objects which are new or changed. Objects keep their ids across snapshots, their kind and a hash of everything the
+// value was created from tell whether they changed.
+//
+// A cache holds the objects of one snapshot and doesn't change once filled. The objects of the next snapshot are looked up in it, from
+// any number of threads, and go into a new cache, which then replaces it. So objects which are not part of the scene anymore drop out.
+template <typename Key, typename Kind, typename Value, typename Hash, typename KeyEqual = std::equal_to<Key>>
+class SceneObjectCache
+{
+public:
+    void Reserve(size_t count)
+    {
+        m_entries.Reserve(count);
+    }
+
+    // Returns the value of the object if it has the same kind and geometry hash in this cache, otherwise nullptr.
+    std::shared_ptr<const Value> Find(const Key& id, Kind kind, uint64_t geometryHash) const
+    {
+        const Entry* entry = m_entries.Get(m_entries.Find(id));
+        if (entry && entry->kind == kind && entry->geometryHash == geometryHash)
+        {
+            return entry->value;
+        }
+        return nullptr;
+    }
+
+    // Adds the value of an object. Returns false if there already is an object with the id.
+    bool Insert(const Key& id, Kind kind, uint64_t geometryHash, std::shared_ptr<const Value> value)
+    {
+        return m_entries.TryEmplace(id, Entry{kind, geometryHash, std::move(value)}).second;
+    }
+
+    size_t Size() const
+    {
+        return m_entries.Size();
+    }
+
+private:
+    struct Entry
+    {
+        Kind kind;
+        uint64_t geometryHash;
+        std::shared_ptr<const Value> value;
+    };
+
+    Utils::FlatHashMap<Key, Entry, Hash, KeyEqual> m_entries;
+};
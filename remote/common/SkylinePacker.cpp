@@ -0,0 +1,161 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <SkylinePacker.h>
+
+#include <algorithm>
+#include <numeric>
+
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t maxHeight, uint32_t padding)
+    : m_width(width)
+    , m_maxHeight(maxHeight)
+    , m_padding(padding)
+{
+    Reset();
+}
+
+void SkylinePacker::Reset()
+{
+    m_skyline.clear();
+    m_skyline.push_back({0, 0, m_width});
+    m_usedHeight = 0;
+    m_usedArea = 0;
+}
+
+bool SkylinePacker::Fit(size_t segment, uint32_t width, uint32_t height, uint32_t& y, uint64_t& gap) const
+{
+    const uint32_t x = m_skyline[segment].x;
+    if (width > m_width - x)
+    {
+        return false;
+    }
+
+    // The rectangle rests on the highest segment below it, including its padding, which may be cut off by the right edge.
+    const uint32_t end = std::min(x + width + m_padding, m_width);
+    y = 0;
+    for (size_t i = segment; i < m_skyline.size() && m_skyline[i].x < end; i++)
+    {
+        y = std::max(y, m_skyline[i].y);
+    }
+    if (height > m_maxHeight || y > m_maxHeight - height)
+    {
+        return false;
+    }
+
+    gap = 0;
+    for (size_t i = segment; i < m_skyline.size() && m_skyline[i].x < end; i++)
+    {
+        const uint32_t overlap = std::min(m_skyline[i].x + m_skyline[i].width, end) - m_skyline[i].x;
+        gap += static_cast<uint64_t>(y - m_skyline[i].y) * overlap;
+    }
+    return true;
+}
+
+bool SkylinePacker::Insert(uint32_t width, uint32_t height, Rect& rect)
+{
+    rect = {0, 0, width, height};
+    if (width == 0 || height == 0)
+    {
+        return true;
+    }
+
+    size_t bestSegment = m_skyline.size();
+    uint32_t bestY = 0;
+    uint64_t bestGap = 0;
+    for (size_t segment = 0; segment < m_skyline.size(); segment++)
+    {
+        uint32_t y;
+        uint64_t gap;
+        if (Fit(segment, width, height, y, gap) && (bestSegment == m_skyline.size() || y < bestY || (y == bestY && gap < bestGap)))
+        {
+            bestSegment = segment;
+            bestY = y;
+            bestGap = gap;
+        }
+    }
+    if (bestSegment == m_skyline.size())
+    {
+        return false;
+    }
+
+    rect.x = m_skyline[bestSegment].x;
+    rect.y = bestY;
+    const uint32_t end = std::min(rect.x + width + m_padding, m_width);
+    AddSegment(bestSegment, rect.x, std::min(bestY + height + m_padding, m_maxHeight), end - rect.x);
+
+    m_usedHeight = std::max(m_usedHeight, bestY + height);
+    m_usedArea += static_cast<uint64_t>(width) * height;
+    return true;
+}
+
+void SkylinePacker::AddSegment(size_t segment, uint32_t x, uint32_t y, uint32_t width)
+{
+    m_skyline.insert(m_skyline.begin() + segment, {x, y, width});
+
+    // Cut the segments the new one covers.
+    const uint32_t end = x + width;
+    size_t next = segment + 1;
+    while (next < m_skyline.size() && m_skyline[next].x < end)
+    {
+        Segment& covered = m_skyline[next];
+        if (covered.x + covered.width <= end)
+        {
+            m_skyline.erase(m_skyline.begin() + next);
+        }
+        else
+        {
+            covered.width -= end - covered.x;
+            covered.x = end;
+            break;
+        }
+    }
+
+    // Merge the new segment with neighbors of the same height, which keeps the skyline short.
+    if (next < m_skyline.size() && m_skyline[next].y == y)
+    {
+        m_skyline[segment].width += m_skyline[next].width;
+        m_skyline.erase(m_skyline.begin() + next);
+    }
+    if (segment > 0 && m_skyline[segment - 1].y == y)
+    {
+        m_skyline[segment - 1].width += m_skyline[segment].width;
+        m_skyline.erase(m_skyline.begin() + segment);
+    }
+}
+
+bool SkylinePacker::InsertAll(const Size* sizes, uint32_t count, Rect* rects)
+{
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return sizes[a].height != sizes[b].height ? sizes[a].height > sizes[b].height : sizes[a].width > sizes[b].width;
+    });
+
+    bool allInserted = true;
+    for (uint32_t i : order)
+    {
+        allInserted &= Insert(sizes[i].width, sizes[i].height, rects[i]);
+    }
+    return allInserted;
+}
+
+float SkylinePacker::GetOccupancy() const
+{
+    return m_usedHeight == 0 ? 0.0f : static_cast<float>(static_cast<double>(m_usedArea) / (static_cast<double>(m_width) * m_usedHeight));
+}
+
+void SkylinePacker::GetUVRect(const Rect& rect, uint32_t width, uint32_t height, float uvRect[4])
+{
+    uvRect[0] = static_cast<float>(rect.x) / width;
+    uvRect[1] = static_cast<float>(rect.y) / height;
+    uvRect[2] = static_cast<float>(rect.x + rect.width) / width;
+    uvRect[3] = static_cast<float>(rect.y + rect.height) / height;
+}
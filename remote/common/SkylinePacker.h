@@ -0,0 +1,96 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Packs rectangles into an atlas of a fixed width and a maximum height, e.g. text labels or glyphs into one texture.
+//
+// The packer keeps the skyline, the upper outline of the rectangles placed so far, as a list of horizontal segments from left to right. A
+// rectangle is placed on top of the skyline where its top ends lowest, and of those places where it leaves the least gap below it. The
+// space below the skyline is never used again, which wastes some of the area, but keeps insertion O(segments). Rectangles are
+// kept padding texels apart, so that filtering doesn't bleed from one into the other. Units are up to the caller, usually texels.
+class SkylinePacker
+{
+public:
+    struct Rect
+    {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    struct Size
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    SkylinePacker(uint32_t width, uint32_t maxHeight, uint32_t padding = 0);
+
+    // Places a rectangle, returns false if there is no room for it.
+    bool Insert(uint32_t width, uint32_t height, Rect& rect);
+
+    // Places all rectangles, taller ones first, which packs them tighter than in any order. rects[i] is the place of sizes[i]. Returns
+    // false if any one does not fit, the others are placed anyway.
+    bool InsertAll(const Size* sizes, uint32_t count, Rect* rects);
+
+    // Removes all rectangles.
+    void Reset();
+
+    uint32_t GetWidth() const
+    {
+        return m_width;
+    }
+
+    uint32_t GetMaxHeight() const
+    {
+        return m_maxHeight;
+    }
+
+    // The height the atlas needs to hold all rectangles placed so far.
+    uint32_t GetUsedHeight() const
+    {
+        return m_usedHeight;
+    }
+
+    // The area of the rectangles relative to the area of the atlas up to the used height.
+    float GetOccupancy() const;
+
+    // The texture coordinates of the corners of the rectangle in an atlas of width x height texels, as u, v of the top left and of the
+    // bottom right corner.
+    static void GetUVRect(const Rect& rect, uint32_t width, uint32_t height, float uvRect[4]);
+
+private:
+    struct Segment
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    // Returns the top of a rectangle which starts at the segment and the gap it leaves below, or false if it doesn't fit there.
+    bool Fit(size_t segment, uint32_t width, uint32_t height, uint32_t& y, uint64_t& gap) const;
+
+    void AddSegment(size_t segment, uint32_t x, uint32_t y, uint32_t width);
+
+    uint32_t m_width;
+    uint32_t m_maxHeight;
+    uint32_t m_padding;
+
+    std::vector<Segment> m_skyline;
+    uint32_t m_usedHeight = 0;
+    uint64_t m_usedArea = 0;
+};
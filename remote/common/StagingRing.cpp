@@ -0,0 +1,101 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <StagingRing.h>
+
+#include <algorithm>
+#include <cassert>
+
+StagingRing::StagingRing(size_t capacity)
+    : m_capacity(capacity)
+    , m_memory(new uint8_t[capacity])
+{
+}
+
+StagingRing::Allocation StagingRing::Allocate(size_t size, size_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && (m_capacity % alignment) == 0);
+
+    std::scoped_lock lock(m_mutex);
+
+    uint64_t begin = (m_head + alignment - 1) & ~static_cast<uint64_t>(alignment - 1);
+
+    // Never split a block at the end of the ring, skip to the start instead.
+    const uint64_t ringOffset = begin % m_capacity;
+    if (ringOffset + size > m_capacity)
+    {
+        begin += m_capacity - ringOffset;
+    }
+
+    const uint64_t end = begin + size;
+    if (size == 0 || end - m_tail > m_capacity)
+    {
+        m_statistics.failedAllocationCount++;
+        return {};
+    }
+
+    // Padding in front of the block is owned by the block itself, so it is reclaimed together with it.
+    m_blocks.push_back({m_head, end, 0, false});
+    m_head = end;
+
+    m_statistics.allocationCount++;
+    m_statistics.allocatedBytes += size;
+    m_statistics.usedBytes = static_cast<size_t>(m_head - m_tail);
+    m_statistics.peakUsedBytes = std::max(m_statistics.peakUsedBytes, m_statistics.usedBytes);
+
+    return {m_memory.get() + (begin % m_capacity), begin, static_cast<uint32_t>(size)};
+}
+
+void StagingRing::Release(const Allocation& allocation, uint64_t fence)
+{
+    if (!allocation)
+    {
+        return;
+    }
+
+    std::scoped_lock lock(m_mutex);
+
+    // Blocks are sorted by position, find the one which contains the allocation.
+    auto it = std::upper_bound(
+        m_blocks.begin(), m_blocks.end(), allocation.position, [](uint64_t position, const Block& block) { return position < block.end; });
+    assert(it != m_blocks.end() && it->begin <= allocation.position && !it->released);
+
+    if (it != m_blocks.end())
+    {
+        it->fence = fence;
+        it->released = true;
+    }
+}
+
+void StagingRing::Retire(uint64_t completedFence)
+{
+    std::scoped_lock lock(m_mutex);
+
+    while (!m_blocks.empty() && m_blocks.front().released && m_blocks.front().fence <= completedFence)
+    {
+        m_tail = m_blocks.front().end;
+        m_blocks.pop_front();
+    }
+
+    if (m_blocks.empty())
+    {
+        // Nothing is in flight, restart at the beginning of the ring to avoid needless wrap arounds.
+        m_head = m_tail = (m_tail + m_capacity - 1) / m_capacity * m_capacity;
+    }
+
+    m_statistics.usedBytes = static_cast<size_t>(m_head - m_tail);
+}
+
+StagingRing::Statistics StagingRing::GetStatistics() const
+{
+    std::scoped_lock lock(m_mutex);
+    return m_statistics;
+}
@@ -0,0 +1,88 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+// Fixed size ring of staging memory.
+//
+// Producers (any thread) allocate a block, write into it and hand it over to the consumer. Once the consumer is done with the data it
+// releases the block together with a fence value, e.g. the index of the frame which submitted the data. Memory is reclaimed in
+// allocation order by Retire() as soon as the completed fence passes the fence of the oldest released blocks. Blocks which are released
+// out of order simply stay in the ring until all older blocks are retired as well.
+class StagingRing
+{
+public:
+    struct Allocation
+    {
+        uint8_t* data = nullptr;
+        uint64_t position = 0;
+        uint32_t size = 0;
+
+        explicit operator bool() const
+        {
+            return data != nullptr;
+        }
+    };
+
+    struct Statistics
+    {
+        uint64_t allocationCount = 0;
+        uint64_t failedAllocationCount = 0;
+        uint64_t allocatedBytes = 0;
+        size_t usedBytes = 0;
+        size_t peakUsedBytes = 0;
+    };
+
+    explicit StagingRing(size_t capacity);
+
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    // Returns an empty allocation if the ring does not have enough free space left.
+    Allocation Allocate(size_t size, size_t alignment = 16);
+
+    // Hands the block back to the ring. The memory is reused once Retire() was called with a completed fence >= fence.
+    void Release(const Allocation& allocation, uint64_t fence = 0);
+
+    // Reclaims all released blocks at the tail of the ring whose fence is <= completedFence.
+    void Retire(uint64_t completedFence);
+
+    size_t GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    Statistics GetStatistics() const;
+
+private:
+    struct Block
+    {
+        uint64_t begin;
+        uint64_t end;
+        uint64_t fence;
+        bool released;
+    };
+
+    const size_t m_capacity;
+    std::unique_ptr<uint8_t[]> m_memory;
+
+    mutable std::mutex m_mutex;
+    // Monotonic positions, the ring offset is position % capacity.
+    uint64_t m_head = 0;
+    uint64_t m_tail = 0;
+    std::deque<Block> m_blocks;
+    Statistics m_statistics;
+};
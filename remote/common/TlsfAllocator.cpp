@@ -0,0 +1,504 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <TlsfAllocator.h>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace
+{
+    uint32_t AlignUp(uint32_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+} // namespace
+
+TlsfAllocator::TlsfAllocator(uint32_t capacity, uint32_t minBlockSize)
+    : m_minBlockSize(std::max(minBlockSize, 1u))
+{
+    Reset(capacity);
+}
+
+void TlsfAllocator::MappingInsert(uint32_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    if (size < SecondLevelCount)
+    {
+        // Small blocks share the first class, with one linear sub class per size.
+        firstLevel = 0;
+        secondLevel = size;
+    }
+    else
+    {
+        const uint32_t highestBit = 31 - std::countl_zero(size);
+        firstLevel = highestBit - SecondLevelLog2 + 1;
+        secondLevel = (size >> (highestBit - SecondLevelLog2)) - SecondLevelCount;
+    }
+}
+
+void TlsfAllocator::MappingSearch(uint32_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    // Round up to the next sub class boundary, so every block in the resulting class is large enough.
+    if (size >= SecondLevelCount)
+    {
+        const uint32_t highestBit = 31 - std::countl_zero(size);
+        const uint64_t rounded = static_cast<uint64_t>(size) + (1ull << (highestBit - SecondLevelLog2)) - 1;
+        size = static_cast<uint32_t>(std::min<uint64_t>(rounded, ~0u));
+    }
+    MappingInsert(size, firstLevel, secondLevel);
+}
+
+uint32_t TlsfAllocator::CreateNode()
+{
+    if (!m_unusedNodes.empty())
+    {
+        const uint32_t node = m_unusedNodes.back();
+        m_unusedNodes.pop_back();
+        m_nodes[node] = Node{};
+        return node;
+    }
+
+    m_nodes.push_back(Node{});
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void TlsfAllocator::DestroyNode(uint32_t node)
+{
+    m_nodes[node].size = 0;
+    m_unusedNodes.push_back(node);
+}
+
+void TlsfAllocator::InsertFreeNode(uint32_t node)
+{
+    Node& block = m_nodes[node];
+    uint32_t firstLevel, secondLevel;
+    MappingInsert(block.size, firstLevel, secondLevel);
+
+    block.isFree = true;
+    block.prevFree = InvalidNode;
+    block.nextFree = m_freeHeads[firstLevel][secondLevel];
+    if (block.nextFree != InvalidNode)
+    {
+        m_nodes[block.nextFree].prevFree = node;
+    }
+    m_freeHeads[firstLevel][secondLevel] = node;
+
+    m_firstLevelBitmap |= 1u << firstLevel;
+    m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfAllocator::RemoveFreeNode(uint32_t node)
+{
+    Node& block = m_nodes[node];
+    assert(block.isFree);
+
+    if (block.prevFree != InvalidNode)
+    {
+        m_nodes[block.prevFree].nextFree = block.nextFree;
+    }
+    else
+    {
+        uint32_t firstLevel, secondLevel;
+        MappingInsert(block.size, firstLevel, secondLevel);
+
+        m_freeHeads[firstLevel][secondLevel] = block.nextFree;
+        if (block.nextFree == InvalidNode)
+        {
+            m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+            if (m_secondLevelBitmaps[firstLevel] == 0)
+            {
+                m_firstLevelBitmap &= ~(1u << firstLevel);
+            }
+        }
+    }
+
+    if (block.nextFree != InvalidNode)
+    {
+        m_nodes[block.nextFree].prevFree = block.prevFree;
+    }
+
+    block.isFree = false;
+    block.prevFree = block.nextFree = InvalidNode;
+}
+
+uint32_t TlsfAllocator::FindFreeNode(uint32_t size)
+{
+    uint32_t firstLevel, secondLevel;
+    MappingSearch(size, firstLevel, secondLevel);
+    if (firstLevel >= FirstLevelCount)
+    {
+        return InvalidNode;
+    }
+
+    uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0)
+    {
+        const uint32_t firstLevelMap = firstLevel + 1 < 32 ? m_firstLevelBitmap & (~0u << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0)
+        {
+            return InvalidNode;
+        }
+
+        firstLevel = std::countr_zero(firstLevelMap);
+        secondLevelMap = m_secondLevelBitmaps[firstLevel];
+    }
+
+    secondLevel = std::countr_zero(secondLevelMap);
+    return m_freeHeads[firstLevel][secondLevel];
+}
+
+uint32_t TlsfAllocator::SplitFront(uint32_t node, uint32_t size)
+{
+    // Moves the first size units of node into a new node in front of it, returns the new node.
+    const uint32_t front = CreateNode();
+    Node& block = m_nodes[node];
+    Node& frontBlock = m_nodes[front];
+
+    frontBlock.offset = block.offset;
+    frontBlock.size = size;
+    frontBlock.prevPhysical = block.prevPhysical;
+    frontBlock.nextPhysical = node;
+
+    if (block.prevPhysical != InvalidNode)
+    {
+        m_nodes[block.prevPhysical].nextPhysical = front;
+    }
+    else
+    {
+        m_firstPhysical = front;
+    }
+
+    block.offset += size;
+    block.size -= size;
+    block.prevPhysical = front;
+    return front;
+}
+
+void TlsfAllocator::SplitBack(uint32_t node, uint32_t size)
+{
+    // Shrinks node to size units and turns the remainder into a new free node behind it.
+    const uint32_t back = CreateNode();
+    Node& block = m_nodes[node];
+    Node& backBlock = m_nodes[back];
+
+    backBlock.offset = block.offset + size;
+    backBlock.size = block.size - size;
+    backBlock.prevPhysical = node;
+    backBlock.nextPhysical = block.nextPhysical;
+
+    if (block.nextPhysical != InvalidNode)
+    {
+        m_nodes[block.nextPhysical].prevPhysical = back;
+    }
+    else
+    {
+        m_lastPhysical = back;
+    }
+
+    block.size = size;
+    block.nextPhysical = back;
+    InsertFreeNode(back);
+}
+
+TlsfAllocator::Allocation TlsfAllocator::Allocate(uint32_t size, uint32_t alignment)
+{
+    assert(alignment != 0);
+    if (size == 0)
+    {
+        return {};
+    }
+
+    // Worst case padding is needed to align an arbitrary free block.
+    const uint64_t searchSize = static_cast<uint64_t>(size) + alignment - 1;
+    if (searchSize > m_capacity)
+    {
+        return {};
+    }
+
+    const uint32_t node = FindFreeNode(static_cast<uint32_t>(searchSize));
+    if (node == InvalidNode)
+    {
+        return {};
+    }
+
+    RemoveFreeNode(node);
+
+    uint32_t padding = AlignUp(m_nodes[node].offset, alignment) - m_nodes[node].offset;
+    if (padding >= m_minBlockSize)
+    {
+        // The previous physical block is always allocated (free neighbors are coalesced), so the padding can become a free block of its
+        // own.
+
+        InsertFreeNode(SplitFront(node, padding));
+        padding = 0;
+    }
+
+    if (m_nodes[node].size - padding - size >= m_minBlockSize)
+    {
+        SplitBack(node, padding + size);
+    }
+
+    Node& block = m_nodes[node];
+    block.dataSize = size;
+    block.padding = padding;
+    block.alignment = alignment;
+
+    m_usedSize += block.size;
+    m_allocationCount++;
+    m_alignmentWaste += block.size - size;
+
+    return {node};
+}
+
+void TlsfAllocator::Free(Allocation allocation)
+{
+    if (!allocation)
+    {
+        return;
+    }
+
+    uint32_t node = allocation.node;
+    assert(node < m_nodes.size() && !m_nodes[node].isFree && m_nodes[node].size != 0);
+
+    m_usedSize -= m_nodes[node].size;
+    m_allocationCount--;
+    m_alignmentWaste -= m_nodes[node].size - m_nodes[node].dataSize;
+
+    // Coalesce with the previous block.
+    const uint32_t prev = m_nodes[node].prevPhysical;
+    if (prev != InvalidNode && m_nodes[prev].isFree)
+    {
+        RemoveFreeNode(prev);
+
+        Node& block = m_nodes[node];
+        block.offset = m_nodes[prev].offset;
+        block.size += m_nodes[prev].size;
+        block.prevPhysical = m_nodes[prev].prevPhysical;
+        if (block.prevPhysical != InvalidNode)
+        {
+            m_nodes[block.prevPhysical].nextPhysical = node;
+        }
+        else
+        {
+            m_firstPhysical = node;
+        }
+        DestroyNode(prev);
+    }
+
+    // Coalesce with the next block.
+    const uint32_t next = m_nodes[node].nextPhysical;
+    if (next != InvalidNode && m_nodes[next].isFree)
+    {
+        RemoveFreeNode(next);
+
+        Node& block = m_nodes[node];
+        block.size += m_nodes[next].size;
+        block.nextPhysical = m_nodes[next].nextPhysical;
+        if (block.nextPhysical != InvalidNode)
+        {
+            m_nodes[block.nextPhysical].prevPhysical = node;
+        }
+        else
+        {
+            m_lastPhysical = node;
+        }
+        DestroyNode(next);
+    }
+
+    Node& block = m_nodes[node];
+    block.dataSize = block.padding = 0;
+    block.alignment = 1;
+    InsertFreeNode(node);
+}
+
+void TlsfAllocator::Reset(uint32_t capacity)
+{
+    m_capacity = capacity;
+    m_nodes.clear();
+    m_unusedNodes.clear();
+    m_firstPhysical = m_lastPhysical = InvalidNode;
+
+    m_firstLevelBitmap = 0;
+    std::fill(std::begin(m_secondLevelBitmaps), std::end(m_secondLevelBitmaps), 0u);
+    std::fill(&m_freeHeads[0][0], &m_freeHeads[0][0] + FirstLevelCount * SecondLevelCount, InvalidNode);
+
+    m_usedSize = 0;
+    m_allocationCount = 0;
+    m_alignmentWaste = 0;
+
+    if (capacity > 0)
+    {
+        const uint32_t node = CreateNode();
+        m_nodes[node].size = capacity;
+        m_firstPhysical = m_lastPhysical = node;
+        InsertFreeNode(node);
+    }
+}
+
+void TlsfAllocator::Grow(uint32_t capacity)
+{
+    assert(capacity >= m_capacity);
+    if (capacity <= m_capacity)
+    {
+        return;
+    }
+
+    const uint32_t added = capacity - m_capacity;
+    m_capacity = capacity;
+
+    if (m_lastPhysical != InvalidNode && m_nodes[m_lastPhysical].isFree)
+    {
+        RemoveFreeNode(m_lastPhysical);
+        m_nodes[m_lastPhysical].size += added;
+        InsertFreeNode(m_lastPhysical);
+        return;
+    }
+
+    const uint32_t node = CreateNode();
+    Node& block = m_nodes[node];
+    block.offset = capacity - added;
+    block.size = added;
+    block.prevPhysical = m_lastPhysical;
+
+    if (m_lastPhysical != InvalidNode)
+    {
+        m_nodes[m_lastPhysical].nextPhysical = node;
+    }
+    else
+    {
+        m_firstPhysical = node;
+    }
+    m_lastPhysical = node;
+    InsertFreeNode(node);
+}
+
+std::vector<TlsfAllocator::Relocation> TlsfAllocator::Defragment()
+{
+    std::vector<Relocation> relocations;
+    relocations.reserve(m_allocationCount);
+
+    // Collect the allocated blocks in address order and recycle all free ones.
+    std::vector<uint32_t> allocated;
+    allocated.reserve(m_allocationCount);
+    for (uint32_t node = m_firstPhysical; node != InvalidNode;)
+    {
+        const uint32_t next = m_nodes[node].nextPhysical;
+        if (m_nodes[node].isFree)
+        {
+            DestroyNode(node);
+        }
+        else
+        {
+            allocated.push_back(node);
+        }
+        node = next;
+    }
+
+    m_firstLevelBitmap = 0;
+    std::fill(std::begin(m_secondLevelBitmaps), std::end(m_secondLevelBitmaps), 0u);
+    std::fill(&m_freeHeads[0][0], &m_freeHeads[0][0] + FirstLevelCount * SecondLevelCount, InvalidNode);
+    m_firstPhysical = m_lastPhysical = InvalidNode;
+    m_usedSize = 0;
+    m_alignmentWaste = 0;
+
+    auto append = [this](uint32_t node) {
+        m_nodes[node].prevPhysical = m_lastPhysical;
+        m_nodes[node].nextPhysical = InvalidNode;
+        if (m_lastPhysical != InvalidNode)
+        {
+            m_nodes[m_lastPhysical].nextPhysical = node;
+        }
+        else
+        {
+            m_firstPhysical = node;
+        }
+        m_lastPhysical = node;
+    };
+
+    uint32_t cursor = 0;
+    for (uint32_t node : allocated)
+    {
+        Node& block = m_nodes[node];
+        const uint32_t sourceOffset = block.offset + block.padding;
+
+        uint32_t offset = cursor;
+        uint32_t padding = AlignUp(cursor, block.alignment) - cursor;
+        if (padding >= m_minBlockSize)
+        {
+            const uint32_t gap = CreateNode();
+            m_nodes[gap].offset = cursor;
+            m_nodes[gap].size = padding;
+            append(gap);
+            InsertFreeNode(gap);
+
+            offset += padding;
+            padding = 0;
+        }
+
+        // Pointer may have been invalidated by CreateNode.
+        Node& moved = m_nodes[node];
+        moved.offset = offset;
+        moved.padding = padding;
+        moved.size = padding + moved.dataSize;
+        append(node);
+
+        m_usedSize += moved.size;
+        m_alignmentWaste += padding;
+        cursor = offset + moved.size;
+
+        relocations.push_back({{node}, sourceOffset, offset + padding, moved.dataSize});
+    }
+
+    if (cursor < m_capacity)
+    {
+        const uint32_t tail = CreateNode();
+        m_nodes[tail].offset = cursor;
+        m_nodes[tail].size = m_capacity - cursor;
+        append(tail);
+        InsertFreeNode(tail);
+    }
+
+    return relocations;
+}
+
+uint32_t TlsfAllocator::GetOffset(Allocation allocation) const
+{
+    assert(allocation && !m_nodes[allocation.node].isFree);
+    return m_nodes[allocation.node].offset + m_nodes[allocation.node].padding;
+}
+
+uint32_t TlsfAllocator::GetSize(Allocation allocation) const
+{
+    assert(allocation && !m_nodes[allocation.node].isFree);
+    return m_nodes[allocation.node].dataSize;
+}
+
+TlsfAllocator::Statistics TlsfAllocator::GetStatistics() const
+{
+    Statistics statistics;
+    statistics.capacity = m_capacity;
+    statistics.usedSize = m_usedSize;
+    statistics.freeSize = m_capacity - m_usedSize;
+    statistics.allocationCount = m_allocationCount;
+    statistics.alignmentWaste = m_alignmentWaste;
+
+    for (uint32_t node = m_firstPhysical; node != InvalidNode; node = m_nodes[node].nextPhysical)
+    {
+        if (m_nodes[node].isFree)
+        {
+            statistics.freeBlockCount++;
+            statistics.largestFreeBlock = std::max(statistics.largestFreeBlock, m_nodes[node].size);
+        }
+    }
+
+    return statistics;
+}
@@ -0,0 +1,137 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit (TLSF) allocator for ranges of an external resource, e.g. a GPU buffer.
+//
+// The allocator only hands out offsets, it never touches the memory it manages, and all bookkeeping lives in a separate node array.
+// Units are up to the caller (bytes, vertices, indices, ...). Allocation and free are O(1): free blocks are binned by a coarse power of
+// two class and 16 linear sub classes, and two bitmaps find the first non empty bin which is guaranteed to fit. Free neighbors are
+// coalesced immediately.
+class TlsfAllocator
+{
+public:
+    struct Allocation
+    {
+        uint32_t node = InvalidNode;
+
+        explicit operator bool() const
+        {
+            return node != InvalidNode;
+        }
+    };
+
+    struct Statistics
+    {
+        uint32_t capacity = 0;
+        uint32_t usedSize = 0;
+        uint32_t freeSize = 0;
+        uint32_t largestFreeBlock = 0;
+        uint32_t allocationCount = 0;
+        uint32_t freeBlockCount = 0;
+        // Units inside allocations which are not part of the requested size (alignment padding and slack too small to split off).
+        uint32_t alignmentWaste = 0;
+
+        // 0 if all free space is in one block, approaching 1 the more the free space is scattered.
+        float FragmentationRatio() const
+        {
+            return freeSize == 0 ? 0.0f : 1.0f - static_cast<float>(largestFreeBlock) / static_cast<float>(freeSize);
+        }
+    };
+
+    // Describes where the data of an allocation moved to during Defragment().
+    struct Relocation
+    {
+        Allocation allocation;
+        uint32_t sourceOffset;
+        uint32_t destinationOffset;
+        uint32_t size;
+    };
+
+    // Blocks smaller than minBlockSize are never split off, they stay attached to the allocation instead.
+    explicit TlsfAllocator(uint32_t capacity, uint32_t minBlockSize = 1);
+
+    // Returns an invalid allocation if no free block is large enough.
+    Allocation Allocate(uint32_t size, uint32_t alignment = 1);
+    void Free(Allocation allocation);
+
+    // Releases all allocations.
+    void Reset(uint32_t capacity);
+
+    // Appends free space at the end, capacity must not shrink.
+    void Grow(uint32_t capacity);
+
+    // Packs all allocations to the front, in their current order, leaving a single free block at the end. Returns the relocation of
+    // every live allocation (including the ones which did not move), so the caller can copy the data to a new resource.
+    std::vector<Relocation> Defragment();
+
+    uint32_t GetOffset(Allocation allocation) const;
+    uint32_t GetSize(Allocation allocation) const;
+
+    uint32_t GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    Statistics GetStatistics() const;
+
+private:
+    static constexpr uint32_t InvalidNode = ~0u;
+    static constexpr uint32_t SecondLevelLog2 = 4;
+    static constexpr uint32_t SecondLevelCount = 1u << SecondLevelLog2;
+    static constexpr uint32_t FirstLevelCount = 32 - SecondLevelLog2 + 1;
+
+    struct Node
+    {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        // Only for allocated nodes: the requested size and the distance from offset to the aligned start of the data.
+        uint32_t dataSize = 0;
+        uint32_t padding = 0;
+        uint32_t alignment = 1;
+        uint32_t prevPhysical = InvalidNode;
+        uint32_t nextPhysical = InvalidNode;
+        uint32_t prevFree = InvalidNode;
+        uint32_t nextFree = InvalidNode;
+        bool isFree = false;
+    };
+
+    static void MappingInsert(uint32_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+    static void MappingSearch(uint32_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+    uint32_t CreateNode();
+    void DestroyNode(uint32_t node);
+    void InsertFreeNode(uint32_t node);
+    void RemoveFreeNode(uint32_t node);
+    uint32_t FindFreeNode(uint32_t size);
+    uint32_t SplitFront(uint32_t node, uint32_t size);
+    void SplitBack(uint32_t node, uint32_t size);
+
+    uint32_t m_capacity = 0;
+    uint32_t m_minBlockSize = 1;
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_unusedNodes;
+    uint32_t m_firstPhysical = InvalidNode;
+    uint32_t m_lastPhysical = InvalidNode;
+
+    uint32_t m_firstLevelBitmap = 0;
+    uint32_t m_secondLevelBitmaps[FirstLevelCount] = {};
+    uint32_t m_freeHeads[FirstLevelCount][SecondLevelCount];
+
+    uint32_t m_usedSize = 0;
+    uint32_t m_allocationCount = 0;
+    uint32_t m_alignmentWaste = 0;
+};
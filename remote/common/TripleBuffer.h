@@ -0,0 +1,100 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free handoff of the latest value from one producer thread to one consumer thread.
+//
+// There are three slots: the producer owns one to write into, the consumer owns one to read from, and the third one holds the most
+// recently published value. Publishing and acquiring swap the owned slot with the shared one in a single atomic exchange, so neither
+// side ever waits for the other, and the consumer never sees a partially written value. If the producer publishes more than once before
+// the consumer acquires, the older values are skipped: their slots come back to the producer, which has to reset them before reuse.
+//
+// Only one thread at a time may call the producer functions, and only one thread at a time the consumer functions.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Producer: the slot to write the next value into. Holds whatever value was last written to it.
+    T& GetWriteSlot()
+    {
+        return m_slots[m_writeIndex].value;
+    }
+
+    // Producer: makes the write slot the latest value and takes over the previously shared slot for writing.
+    void Publish()
+    {
+        const uint8_t previous = m_shared.exchange(static_cast<uint8_t>(m_writeIndex | PublishedBit), std::memory_order_acq_rel);
+        m_writeIndex = previous & IndexMask;
+    }
+
+    // Consumer: returns true if a value was published since the last call.
+    bool HasPublished() const
+    {
+        return (m_shared.load(std::memory_order_relaxed) & PublishedBit) != 0;
+    }
+
+    // Consumer: takes over the latest published value, which is then available from GetReadSlot(). Returns false, and keeps the
+    // current read slot, if nothing new was published.
+    bool Acquire()
+    {
+        if (!HasPublished())
+        {
+            return false;
+        }
+
+        const uint8_t previous = m_shared.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = previous & IndexMask;
+        return true;
+    }
+
+    // Consumer: the slot holding the last acquired value.
+    T& GetReadSlot()
+    {
+        return m_slots[m_readIndex].value;
+    }
+
+    // Visits all three slots, e.g. to free resources they refer to. Neither the producer nor the consumer may be active.
+    template <typename Func>
+    void ForEachSlot(Func&& func)
+    {
+        for (Slot& slot : m_slots)
+        {
+            func(slot.value);
+        }
+    }
+
+private:
+    static constexpr uint8_t IndexMask = 0x3;
+    static constexpr uint8_t PublishedBit = 0x4;
+
+    // Keep the slots, and the state of both sides, on separate cache lines so the threads don't slow each other down.
+    static constexpr size_t CacheLineSize = 64;
+
+    struct alignas(CacheLineSize) Slot
+    {
+        T value{};
+    };
+
+    Slot m_slots[3];
+    alignas(CacheLineSize) std::atomic<uint8_t> m_shared = 1;
+    alignas(CacheLineSize) uint8_t m_writeIndex = 0;
+    alignas(CacheLineSize) uint8_t m_readIndex = 2;
+};
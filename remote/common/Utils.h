@@ -11,6 +11,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 
 namespace Utils
@@ -20,12 +22,12 @@ namespace Utils
     {
         inline static int compare(const GUID& Left, const GUID& Right)
         {
-            return memcmp(&Left, &Right, sizeof(GUID));
+            return std::memcmp(&Left, &Right, sizeof(GUID));
         }
 
         inline static bool equals(const GUID& Left, const GUID& Right)
         {
-            return memcmp(&Left, &Right, sizeof(GUID)) == 0;
+            return std::memcmp(&Left, &Right, sizeof(GUID)) == 0;
         }
 
         bool operator()(const GUID& Left, const GUID& Right) const
@@ -34,5 +36,22 @@ namespace Utils
         }
     };
 
+    // hash function to allow for GUID as a key of an unordered (hash) map
+    struct GUIDHasher
+    {
+        size_t operator()(const GUID& guid) const
+        {
+            uint64_t parts[2];
+            std::memcpy(parts, &guid, sizeof(GUID));
+
+            // GUIDs are mostly random already, a cheap 64 bit mix of both halves is sufficient.
+            uint64_t hash = parts[0] ^ (parts[1] * 0x9E3779B97F4A7C15ull);
+            hash ^= hash >> 32;
+            hash *= 0xD6E8FEB86659FD93ull;
+            hash ^= hash >> 32;
+            return static_cast<size_t>(hash);
+        }
+    };
+
     std::wstring SplitHostnameAndPortString(const std::wstring& address, uint16_t& port);
 } // namespace Utils
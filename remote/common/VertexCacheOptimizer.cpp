@@ -0,0 +1,279 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <VertexCacheOptimizer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Scoring parameters from the paper.
+    constexpr float LastTriangleScore = 0.75f;
+    constexpr float CacheDecayPower = 1.5f;
+    constexpr float ValenceBoostScale = 2.0f;
+    constexpr float ValenceBoostPower = 0.5f;
+
+    // Size of the simulated LRU cache. Valences above MaxScoredValence get the same (tiny) boost.
+    constexpr uint32_t CacheSize = 32;
+    constexpr uint32_t MaxScoredValence = 32;
+
+    constexpr uint32_t InvalidTriangle = ~0u;
+
+    struct ScoreTables
+    {
+        float cache[CacheSize];
+        float valence[MaxScoredValence + 1];
+
+        ScoreTables()
+        {
+            for (uint32_t position = 0; position < CacheSize; position++)
+            {
+                // the vertices of the last triangle get a fixed score, so the same triangle's neighbors are not always preferred
+                cache[position] = position < 3 ? LastTriangleScore
+                                               : std::pow(1.0f - static_cast<float>(position - 3) / (CacheSize - 3), CacheDecayPower);
+            }
+
+            valence[0] = 0.0f;
+            for (uint32_t count = 1; count <= MaxScoredValence; count++)
+            {
+                valence[count] = ValenceBoostScale * std::pow(static_cast<float>(count), -ValenceBoostPower);
+            }
+        }
+    };
+
+    const ScoreTables Scores;
+} // namespace
+
+float VertexCacheOptimizer::GetVertexScore(uint32_t vertex) const
+{
+    const uint32_t liveTriangleCount = m_liveTriangleCounts[vertex];
+    if (liveTriangleCount == 0)
+    {
+        // no triangles left to emit, the vertex no longer matters
+        return -1.0f;
+    }
+
+    const int32_t position = m_cachePositions[vertex];
+    return (position >= 0 ? Scores.cache[position] : 0.0f) + Scores.valence[std::min(liveTriangleCount, MaxScoredValence)];
+}
+
+void VertexCacheOptimizer::OptimizeTriangleOrder(uint16_t* destination, const uint16_t* indices, uint32_t indexCount, uint32_t vertexCount)
+{
+    assert(destination + indexCount <= indices || indices + indexCount <= destination);
+
+    const uint32_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // triangles around each vertex
+    m_liveTriangleCounts.assign(vertexCount, 0);
+    for (uint32_t i = 0; i < triangleCount * 3; i++)
+    {
+        m_liveTriangleCounts[indices[i]]++;
+    }
+
+    m_adjacencyOffsets.resize(vertexCount + 1);
+    uint32_t offset = 0;
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        m_adjacencyOffsets[v] = offset;
+        offset += m_liveTriangleCounts[v];
+    }
+    m_adjacencyOffsets[vertexCount] = offset;
+
+    m_adjacency.resize(triangleCount * 3);
+    m_liveTriangleCounts.assign(vertexCount, 0);
+    for (uint32_t t = 0; t < triangleCount; t++)
+    {
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            const uint16_t v = indices[t * 3 + corner];
+            m_adjacency[m_adjacencyOffsets[v] + m_liveTriangleCounts[v]++] = t;
+        }
+    }
+
+    m_cachePositions.assign(vertexCount, -1);
+    m_vertexScores.resize(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        m_vertexScores[v] = GetVertexScore(v);
+    }
+
+    m_triangleScores.resize(triangleCount);
+    m_emitted.assign(triangleCount, 0);
+    for (uint32_t t = 0; t < triangleCount; t++)
+    {
+        m_triangleScores[t] = m_vertexScores[indices[t * 3]] + m_vertexScores[indices[t * 3 + 1]] + m_vertexScores[indices[t * 3 + 2]];
+    }
+
+    // the cache holds up to three more vertices while a triangle is being added
+    uint32_t cache[CacheSize + 3];
+    uint32_t cacheCount = 0;
+    uint32_t nextInputTriangle = 0;
+
+    uint32_t bestTriangle =
+        static_cast<uint32_t>(std::max_element(m_triangleScores.begin(), m_triangleScores.end()) - m_triangleScores.begin());
+
+    for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+    {
+        if (bestTriangle == InvalidTriangle)
+        {
+            // nothing left around the cached vertices, continue with the next triangle in input order. this is rare enough that
+            // looking for the best score over all triangles is not worth it
+            while (m_emitted[nextInputTriangle])
+            {
+                nextInputTriangle++;
+            }
+            bestTriangle = nextInputTriangle;
+        }
+
+        const uint16_t* triangle = indices + bestTriangle * 3;
+        memcpy(destination + emittedCount * 3, triangle, 3 * sizeof(uint16_t));
+        m_emitted[bestTriangle] = 1;
+
+        // move the triangle behind the live triangles of its vertices
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            const uint16_t v = triangle[corner];
+            uint32_t* adjacency = m_adjacency.data() + m_adjacencyOffsets[v];
+            const uint32_t liveCount = m_liveTriangleCounts[v];
+            uint32_t* found = std::find(adjacency, adjacency + liveCount, bestTriangle);
+            assert(found != adjacency + liveCount);
+            std::swap(*found, adjacency[liveCount - 1]);
+            m_liveTriangleCounts[v]--;
+        }
+
+        // the triangle's vertices go to the front of the cache, followed by the previous contents without them
+        uint32_t newCache[CacheSize + 3];
+        uint32_t newCacheCount = 0;
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            newCache[newCacheCount++] = triangle[corner];
+        }
+        for (uint32_t i = 0; i < cacheCount; i++)
+        {
+            const uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+            {
+                newCache[newCacheCount++] = v;
+            }
+        }
+
+        // rescore all vertices which were or are in the cache, and the live triangles around them
+        for (uint32_t i = 0; i < newCacheCount; i++)
+        {
+            const uint32_t v = newCache[i];
+            m_cachePositions[v] = i < CacheSize ? static_cast<int32_t>(i) : -1;
+
+            const float score = GetVertexScore(v);
+            const float delta = score - m_vertexScores[v];
+            m_vertexScores[v] = score;
+
+            const uint32_t* adjacency = m_adjacency.data() + m_adjacencyOffsets[v];
+            for (uint32_t j = 0; j < m_liveTriangleCounts[v]; j++)
+            {
+                m_triangleScores[adjacency[j]] += delta;
+            }
+        }
+
+        // the best live triangle around the cached vertices is emitted next
+        bestTriangle = InvalidTriangle;
+        float bestScore = -1.0f;
+        for (uint32_t i = 0; i < std::min(newCacheCount, CacheSize); i++)
+        {
+            const uint32_t v = newCache[i];
+            const uint32_t* adjacency = m_adjacency.data() + m_adjacencyOffsets[v];
+            for (uint32_t j = 0; j < m_liveTriangleCounts[v]; j++)
+            {
+                const uint32_t t = adjacency[j];
+                if (m_triangleScores[t] > bestScore)
+                {
+                    bestScore = m_triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        cacheCount = std::min(newCacheCount, CacheSize);
+        memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+    }
+}
+
+uint32_t VertexCacheOptimizer::OptimizeVertexFetch(
+    void* destination,
+    const void* vertices,
+    uint32_t vertexCount,
+    uint32_t vertexSize,
+    uint16_t* const* indexLists,
+    const uint32_t* indexCounts,
+    uint32_t listCount)
+{
+    constexpr uint32_t Unused = ~0u;
+    m_remap.assign(vertexCount, Unused);
+
+    uint8_t* destinationBytes = static_cast<uint8_t*>(destination);
+    const uint8_t* vertexBytes = static_cast<const uint8_t*>(vertices);
+
+    uint32_t newVertexCount = 0;
+    for (uint32_t list = 0; list < listCount; list++)
+    {
+        uint16_t* indices = indexLists[list];
+        for (uint32_t i = 0; i < indexCounts[list]; i++)
+        {
+            const uint16_t v = indices[i];
+            if (m_remap[v] == Unused)
+            {
+                memcpy(destinationBytes + newVertexCount * vertexSize, vertexBytes + v * vertexSize, vertexSize);
+                m_remap[v] = newVertexCount++;
+            }
+            indices[i] = static_cast<uint16_t>(m_remap[v]);
+        }
+    }
+
+    return newVertexCount;
+}
+
+VertexCacheOptimizer::Statistics VertexCacheOptimizer::Analyze(
+    const uint16_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+    // a vertex is in the FIFO cache if fewer than cacheSize vertices were transformed after it
+    m_remap.assign(vertexCount, 0);
+
+    const uint32_t triangleCount = indexCount / 3;
+    uint32_t referencedCount = 0;
+    uint32_t transformedCount = 0;
+    for (uint32_t i = 0; i < triangleCount * 3; i++)
+    {
+        const uint16_t v = indices[i];
+        const uint32_t transformedAt = m_remap[v];
+        if (transformedAt == 0)
+        {
+            referencedCount++;
+        }
+
+        if (transformedAt == 0 || transformedCount - transformedAt >= cacheSize)
+        {
+            m_remap[v] = ++transformedCount;
+        }
+    }
+
+    Statistics statistics;
+    statistics.triangleCount = triangleCount;
+    statistics.vertexCount = referencedCount;
+    statistics.transformedCount = transformedCount;
+
+    return statistics;
+}
@@ -0,0 +1,82 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Reorders indexed triangle lists for the GPU's post transform vertex cache, and vertices for linear vertex fetch.
+//
+// The triangle order follows Tom Forsyth's "Linear-Speed Vertex Cache Optimisation": triangles are emitted greedily by a score which
+// favors vertices recently used in a simulated LRU cache, and vertices with few triangles left, so that they are finished off and leave
+// the cache for good. The result does not depend on the exact cache size of the hardware.
+//
+// The optimizer keeps its scratch memory between calls, use one instance per thread.
+class VertexCacheOptimizer
+{
+public:
+    // Vertex shader invocations of a triangle list on a simulated FIFO cache.
+    struct Statistics
+    {
+        uint64_t triangleCount = 0;
+        // number of distinct vertices referenced by the triangles
+        uint64_t vertexCount = 0;
+        uint64_t transformedCount = 0;
+
+        // average cache miss ratio, vertex shader invocations per triangle (0.5 is the best possible for large regular meshes, 3 the worst)
+        float Acmr() const
+        {
+            return triangleCount > 0 ? static_cast<float>(transformedCount) / triangleCount : 0.0f;
+        }
+
+        // average transformed vertex ratio, vertex shader invocations per vertex (1 is the best possible)
+        float Atvr() const
+        {
+            return vertexCount > 0 ? static_cast<float>(transformedCount) / vertexCount : 0.0f;
+        }
+    };
+
+    // Writes the triangles of indices in cache friendly order to destination, which must have room for indexCount indices and must not
+    // overlap indices. All indices must be less than vertexCount.
+    void OptimizeTriangleOrder(uint16_t* destination, const uint16_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+    // Writes the vertices to destination in the order they are first used by the index lists, which are remapped in place. Index lists
+    // which share the vertices (e.g. levels of detail) are passed together, vertices used by none of them are dropped. destination must
+    // have room for vertexCount vertices of vertexSize bytes and must not overlap vertices. Returns the number of vertices written.
+    uint32_t OptimizeVertexFetch(
+        void* destination,
+        const void* vertices,
+        uint32_t vertexCount,
+        uint32_t vertexSize,
+        uint16_t* const* indexLists,
+        const uint32_t* indexCounts,
+        uint32_t listCount);
+
+    // Simulates a FIFO vertex cache of cacheSize entries, which is what most GPUs come closest to.
+    Statistics Analyze(const uint16_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+private:
+    float GetVertexScore(uint32_t vertex) const;
+
+    // Live triangles around each vertex: m_adjacency[m_adjacencyOffsets[v] .. m_adjacencyOffsets[v] + m_liveTriangleCounts[v]] are
+    // triangle indices, emitted triangles are moved behind the live ones.
+    std::vector<uint32_t> m_adjacencyOffsets;
+    std::vector<uint32_t> m_adjacency;
+    std::vector<uint32_t> m_liveTriangleCounts;
+
+    std::vector<int32_t> m_cachePositions;
+    std::vector<float> m_vertexScores;
+    std::vector<float> m_triangleScores;
+    std::vector<uint8_t> m_emitted;
+
+    std::vector<uint32_t> m_remap;
+};
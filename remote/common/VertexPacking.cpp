@@ -0,0 +1,395 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <VertexPacking.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_PACKING_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define VERTEX_PACKING_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace VertexPacking;
+
+namespace
+{
+    // Extent of flat or empty bounds.
+    constexpr float MinExtent = 1.0e-4f;
+
+    // Floats per unpacked vertex: position, uv and color.
+    constexpr size_t VertexFloatCount = 8;
+
+    // Floats per unpacked joint: position, orientation, length and radius.
+    constexpr size_t JointFloatCount = 9;
+
+    // The float to half conversion follows Fabian Giesen's "float_to_half_fast3_rtne": normal results round their mantissa by adding a
+    // bias, subnormal results are rounded by the floating point adder itself. It is written the same way for the scalar and SSE2 code.
+    constexpr uint32_t HalfOverflow = (127 + 16) << 23;
+    constexpr uint32_t HalfMinNormal = (127 - 14) << 23;
+    constexpr uint32_t HalfSubnormalMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+    constexpr uint32_t HalfNormalBias = 0xfff - ((127 - 15) << 23);
+
+    void PackVertex(const float* vertex, const float* origin, const float* scale, PackedVertex& destination)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            const float position = std::nearbyint((vertex[i] - origin[i]) * scale[i]);
+            destination.position[i] = static_cast<int16_t>(std::clamp(position, -32767.0f, 32767.0f));
+        }
+        destination.position[3] = 0;
+
+        destination.uv[0] = FloatToHalf(vertex[3]);
+        destination.uv[1] = FloatToHalf(vertex[4]);
+
+        for (int i = 0; i < 3; i++)
+        {
+            const float color = std::nearbyint(vertex[5 + i] * 255.0f);
+            destination.color[i] = static_cast<uint8_t>(std::clamp(color, 0.0f, 255.0f));
+        }
+        destination.color[3] = 255;
+    }
+
+    void PackJoint(const float* joint, PackedJoint& destination)
+    {
+        std::memcpy(destination.position, joint, sizeof(destination.position));
+
+        for (int i = 0; i < 4; i++)
+        {
+            const float orientation = std::nearbyint(joint[3 + i] * 32767.0f);
+            destination.orientation[i] = static_cast<int16_t>(std::clamp(orientation, -32767.0f, 32767.0f));
+        }
+
+        destination.size[0] = FloatToHalf(joint[7]);
+        destination.size[1] = FloatToHalf(joint[8]);
+    }
+
+#if defined(VERTEX_PACKING_SSE2)
+    // Returns the half floats in the low 16 bits of the lanes, sign extended, so that _mm_packs_epi32 keeps them as they are.
+    inline __m128i FloatToHalf4(__m128 value)
+    {
+        const __m128 sign = _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u))));
+        const __m128 absValue = _mm_xor_ps(value, sign);
+        const __m128i absBits = _mm_castps_si128(absValue);
+
+        const __m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absValue, absValue));
+        const __m128i isRegular = _mm_cmpgt_epi32(_mm_set1_epi32(HalfOverflow), absBits);
+        const __m128i infOrNan = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00));
+
+        const __m128i isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32(HalfMinNormal), absBits);
+        const __m128 subnormalMagic = _mm_castsi128_ps(_mm_set1_epi32(HalfSubnormalMagic));
+        const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absValue, subnormalMagic)), _mm_set1_epi32(HalfSubnormalMagic));
+
+        // If the mantissa of the half is odd, round up ties (to even).
+        const __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+        const __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, _mm_set1_epi32(HalfNormalBias)), mantissaOdd), 13);
+
+        const __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+        const __m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, infOrNan));
+        return _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+    }
+#endif
+} // namespace
+
+namespace VertexPacking
+{
+    void ExtendBounds(const float* vertices, size_t count, float* minimum, float* maximum)
+    {
+        size_t i = 0;
+#if defined(VERTEX_PACKING_SSE2)
+        // The fourth lane holds the u coordinate and is ignored.
+        __m128 mn = _mm_setr_ps(minimum[0], minimum[1], minimum[2], 0.0f);
+        __m128 mx = _mm_setr_ps(maximum[0], maximum[1], maximum[2], 0.0f);
+        for (; i < count; i++)
+        {
+            const __m128 position = _mm_loadu_ps(vertices + i * VertexFloatCount);
+            mn = _mm_min_ps(mn, position);
+            mx = _mm_max_ps(mx, position);
+        }
+
+        float result[4];
+        _mm_storeu_ps(result, mn);
+        std::memcpy(minimum, result, 3 * sizeof(float));
+        _mm_storeu_ps(result, mx);
+        std::memcpy(maximum, result, 3 * sizeof(float));
+#elif defined(VERTEX_PACKING_NEON)
+        float32x4_t mn = {minimum[0], minimum[1], minimum[2], 0.0f};
+        float32x4_t mx = {maximum[0], maximum[1], maximum[2], 0.0f};
+        for (; i < count; i++)
+        {
+            const float32x4_t position = vld1q_f32(vertices + i * VertexFloatCount);
+            mn = vminq_f32(mn, position);
+            mx = vmaxq_f32(mx, position);
+        }
+
+        float result[4];
+        vst1q_f32(result, mn);
+        std::memcpy(minimum, result, 3 * sizeof(float));
+        vst1q_f32(result, mx);
+        std::memcpy(maximum, result, 3 * sizeof(float));
+#endif
+
+        for (; i < count; i++)
+        {
+            const float* position = vertices + i * VertexFloatCount;
+            for (int j = 0; j < 3; j++)
+            {
+                minimum[j] = std::min(minimum[j], position[j]);
+                maximum[j] = std::max(maximum[j], position[j]);
+            }
+        }
+    }
+
+    Quantization GetQuantization(const float* minimum, const float* maximum)
+    {
+        Quantization quantization = {};
+        const bool empty = minimum[0] > maximum[0] || minimum[1] > maximum[1] || minimum[2] > maximum[2];
+        for (int i = 0; i < 3; i++)
+        {
+            quantization.origin[i] = empty ? 0.0f : 0.5f * (minimum[i] + maximum[i]);
+            quantization.extent[i] = empty ? MinExtent : std::max(0.5f * (maximum[i] - minimum[i]), MinExtent);
+        }
+        return quantization;
+    }
+
+    void PackVertices(const float* vertices, size_t count, const Quantization& quantization, PackedVertex* destination)
+    {
+        const float* origin = quantization.origin;
+        const float scale[3] = {
+            32767.0f / quantization.extent[0], 32767.0f / quantization.extent[1], 32767.0f / quantization.extent[2]};
+
+        size_t i = 0;
+#if defined(VERTEX_PACKING_SSE2)
+        // Two vertices at a time, which fill the registers with their positions as int16 and their uvs and colors as int32.
+        const __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        const __m128 originXyz = _mm_setr_ps(origin[0], origin[1], origin[2], 0.0f);
+        const __m128 scaleXyz = _mm_setr_ps(scale[0], scale[1], scale[2], 0.0f);
+        const __m128 colorScale = _mm_setr_ps(255.0f, 255.0f, 255.0f, 0.0f);
+        const __m128 alpha = _mm_setr_ps(0.0f, 0.0f, 0.0f, 255.0f);
+        const __m128i minSnorm = _mm_set1_epi16(-32767);
+
+        for (; i + 2 <= count; i += 2)
+        {
+            // x, y, z, u and v, r, g, b of both vertices
+            const float* vertex = vertices + i * VertexFloatCount;
+            const __m128 a0 = _mm_loadu_ps(vertex);
+            const __m128 b0 = _mm_loadu_ps(vertex + 4);
+            const __m128 a1 = _mm_loadu_ps(vertex + 8);
+            const __m128 b1 = _mm_loadu_ps(vertex + 12);
+
+            const __m128i p0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_and_ps(a0, xyzMask), originXyz), scaleXyz));
+            const __m128i p1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_and_ps(a1, xyzMask), originXyz), scaleXyz));
+            const __m128i positions = _mm_max_epi16(_mm_packs_epi32(p0, p1), minSnorm);
+
+            const __m128 uv = _mm_shuffle_ps(
+                _mm_shuffle_ps(a0, b0, _MM_SHUFFLE(0, 0, 3, 3)), _mm_shuffle_ps(a1, b1, _MM_SHUFFLE(0, 0, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128i uvs = _mm_packs_epi32(FloatToHalf4(uv), _mm_setzero_si128());
+
+            // r, g, b, v, with v replaced by the alpha
+            const __m128 rgb0 = _mm_mul_ps(_mm_shuffle_ps(b0, b0, _MM_SHUFFLE(0, 3, 2, 1)), colorScale);
+            const __m128 rgb1 = _mm_mul_ps(_mm_shuffle_ps(b1, b1, _MM_SHUFFLE(0, 3, 2, 1)), colorScale);
+            const __m128 c0 = _mm_add_ps(_mm_and_ps(rgb0, xyzMask), alpha);
+            const __m128 c1 = _mm_add_ps(_mm_and_ps(rgb1, xyzMask), alpha);
+            const __m128i colors = _mm_packus_epi16(_mm_packs_epi32(_mm_cvtps_epi32(c0), _mm_cvtps_epi32(c1)), _mm_setzero_si128());
+
+            const __m128i uvsAndColors = _mm_unpacklo_epi32(uvs, colors);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_unpacklo_epi64(positions, uvsAndColors));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 1), _mm_unpackhi_epi64(positions, uvsAndColors));
+        }
+#elif defined(VERTEX_PACKING_NEON)
+        const uint32x4_t xyzMask = {0xffffffffu, 0xffffffffu, 0xffffffffu, 0};
+        const float32x4_t originXyz = {origin[0], origin[1], origin[2], 0.0f};
+        const float32x4_t scaleXyz = {scale[0], scale[1], scale[2], 0.0f};
+        const float32x4_t colorScale = {255.0f, 255.0f, 255.0f, 0.0f};
+        const float32x4_t alpha = {0.0f, 0.0f, 0.0f, 255.0f};
+
+        for (; i + 2 <= count; i += 2)
+        {
+            const float* vertex = vertices + i * VertexFloatCount;
+            const float32x4_t a0 = vld1q_f32(vertex);
+            const float32x4_t b0 = vld1q_f32(vertex + 4);
+            const float32x4_t a1 = vld1q_f32(vertex + 8);
+            const float32x4_t b1 = vld1q_f32(vertex + 12);
+
+            const float32x4_t xyz0 = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a0), xyzMask));
+            const float32x4_t xyz1 = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a1), xyzMask));
+            const int32x4_t p0 = vcvtnq_s32_f32(vmulq_f32(vsubq_f32(xyz0, originXyz), scaleXyz));
+            const int32x4_t p1 = vcvtnq_s32_f32(vmulq_f32(vsubq_f32(xyz1, originXyz), scaleXyz));
+            const int16x8_t positions = vmaxq_s16(vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1)), vdupq_n_s16(-32767));
+
+            // u of the first register and v of the second, see vextq
+            const float32x4_t uv = vcombine_f32(vget_low_f32(vextq_f32(a0, b0, 3)), vget_low_f32(vextq_f32(a1, b1, 3)));
+            const uint32x2_t uvs = vreinterpret_u32_u16(vreinterpret_u16_f16(vcvt_f16_f32(uv)));
+
+            const uint32x4_t scaled0 = vreinterpretq_u32_f32(vmulq_f32(vextq_f32(b0, b0, 1), colorScale));
+            const uint32x4_t scaled1 = vreinterpretq_u32_f32(vmulq_f32(vextq_f32(b1, b1, 1), colorScale));
+            const float32x4_t rgb0 = vreinterpretq_f32_u32(vandq_u32(scaled0, xyzMask));
+            const float32x4_t rgb1 = vreinterpretq_f32_u32(vandq_u32(scaled1, xyzMask));
+
+            const uint16x8_t colors16 = vcombine_u16(
+                vqmovun_s32(vcvtnq_s32_f32(vaddq_f32(rgb0, alpha))), vqmovun_s32(vcvtnq_s32_f32(vaddq_f32(rgb1, alpha))));
+            const uint32x2_t colors = vreinterpret_u32_u8(vqmovn_u16(colors16));
+
+            const uint32x2x2_t uvsAndColors = vzip_u32(uvs, colors);
+            vst1q_u32(
+                reinterpret_cast<uint32_t*>(destination + i),
+                vcombine_u32(vreinterpret_u32_s16(vget_low_s16(positions)), uvsAndColors.val[0]));
+            vst1q_u32(
+                reinterpret_cast<uint32_t*>(destination + i + 1),
+                vcombine_u32(vreinterpret_u32_s16(vget_high_s16(positions)), uvsAndColors.val[1]));
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            PackVertex(vertices + i * VertexFloatCount, origin, scale, destination[i]);
+        }
+    }
+
+    void PackJoints(const float* joints, size_t count, PackedJoint* destination)
+    {
+        static_assert(sizeof(PackedJoint) == 24);
+
+        size_t i = 0;
+#if defined(VERTEX_PACKING_SSE2)
+        // Two joints at a time, which fill three registers. The 32 bit lanes of the orientations and sizes are moved with float shuffles.
+        const __m128 snormScale = _mm_set1_ps(32767.0f);
+        const __m128i minSnorm = _mm_set1_epi16(-32767);
+
+        for (; i + 2 <= count; i += 2)
+        {
+            const float* joint0 = joints + i * JointFloatCount;
+            const float* joint1 = joint0 + JointFloatCount;
+
+            // p0, p1: x, y, z of the position and the x of the orientation
+            const __m128 p0 = _mm_loadu_ps(joint0);
+            const __m128 p1 = _mm_loadu_ps(joint1);
+
+            const __m128i q0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(joint0 + 3), snormScale));
+            const __m128i q1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(joint1 + 3), snormScale));
+            const __m128 orientations = _mm_castsi128_ps(_mm_max_epi16(_mm_packs_epi32(q0, q1), minSnorm));
+
+            __m128 lengthsAndRadii = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(joint0 + 7));
+            lengthsAndRadii = _mm_loadh_pi(lengthsAndRadii, reinterpret_cast<const __m64*>(joint1 + 7));
+            const __m128 sizes = _mm_castsi128_ps(_mm_packs_epi32(FloatToHalf4(lengthsAndRadii), _mm_setzero_si128()));
+
+            // p0.x, p0.y, p0.z, o0.xy | o0.zw, s0, p1.x, p1.y | p1.z, o1.xy, o1.zw, s1
+            const __m128 out0 = _mm_shuffle_ps(p0, _mm_shuffle_ps(orientations, p0, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(0, 2, 1, 0));
+            const __m128 out1 = _mm_shuffle_ps(_mm_shuffle_ps(orientations, sizes, _MM_SHUFFLE(0, 0, 1, 1)), p1, _MM_SHUFFLE(1, 0, 2, 0));
+            const __m128 out2 = _mm_shuffle_ps(
+                _mm_shuffle_ps(p1, orientations, _MM_SHUFFLE(2, 2, 2, 2)),
+                _mm_shuffle_ps(orientations, sizes, _MM_SHUFFLE(1, 1, 3, 3)),
+                _MM_SHUFFLE(2, 0, 2, 0));
+
+            float* packed = reinterpret_cast<float*>(destination + i);
+            _mm_storeu_ps(packed, out0);
+            _mm_storeu_ps(packed + 4, out1);
+            _mm_storeu_ps(packed + 8, out2);
+        }
+#elif defined(VERTEX_PACKING_NEON)
+        const int16x8_t minSnorm = vdupq_n_s16(-32767);
+
+        for (; i + 2 <= count; i += 2)
+        {
+            const float* joint0 = joints + i * JointFloatCount;
+            const float* joint1 = joint0 + JointFloatCount;
+
+            const uint32x4_t p0 = vreinterpretq_u32_f32(vld1q_f32(joint0));
+            const uint32x4_t p1 = vreinterpretq_u32_f32(vld1q_f32(joint1));
+
+            const int32x4_t q0 = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(joint0 + 3), 32767.0f));
+            const int32x4_t q1 = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(joint1 + 3), 32767.0f));
+            const uint32x4_t orientations = vreinterpretq_u32_s16(vmaxq_s16(vcombine_s16(vqmovn_s32(q0), vqmovn_s32(q1)), minSnorm));
+
+            const float32x4_t lengthsAndRadii = vcombine_f32(vld1_f32(joint0 + 7), vld1_f32(joint1 + 7));
+            const uint32x2_t sizes = vreinterpret_u32_f16(vcvt_f16_f32(lengthsAndRadii));
+
+            // The same lanes as the SSE2 code.
+            const uint32x4_t out0 =
+                vcombine_u32(vget_low_u32(p0), vzip_u32(vget_high_u32(p0), vget_low_u32(orientations)).val[0]);
+            const uint32x4_t out1 = vcombine_u32(vext_u32(vget_low_u32(orientations), sizes, 1), vget_low_u32(p1));
+            const uint32x4_t out2 = vcombine_u32(
+                vzip_u32(vget_high_u32(p1), vget_high_u32(orientations)).val[0], vzip_u32(vget_high_u32(orientations), sizes).val[1]);
+
+            uint32_t* packed = reinterpret_cast<uint32_t*>(destination + i);
+            vst1q_u32(packed, out0);
+            vst1q_u32(packed + 4, out1);
+            vst1q_u32(packed + 8, out2);
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            PackJoint(joints + i * JointFloatCount, destination[i]);
+        }
+    }
+
+    uint16_t FloatToHalf(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        const uint32_t sign = bits & 0x80000000u;
+        bits ^= sign;
+
+        uint32_t result;
+        if (bits >= HalfOverflow)
+        {
+            // infinity, or a quiet NaN
+            result = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+        }
+        else if (bits < HalfMinNormal)
+        {
+            float absValue, magic;
+            std::memcpy(&absValue, &bits, sizeof(absValue));
+            std::memcpy(&magic, &HalfSubnormalMagic, sizeof(magic));
+            absValue += magic;
+            std::memcpy(&result, &absValue, sizeof(result));
+            result -= HalfSubnormalMagic;
+        }
+        else
+        {
+            const uint32_t mantissaOdd = (bits >> 13) & 1;
+            result = (bits + HalfNormalBias + mantissaOdd) >> 13;
+        }
+
+        return static_cast<uint16_t>(result | (sign >> 16));
+    }
+
+    float HalfToFloat(uint16_t value)
+    {
+        const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+        const uint32_t exponent = (value >> 10) & 0x1f;
+        const uint32_t mantissa = value & 0x3ff;
+
+        float result;
+        if (exponent == 0)
+        {
+            // zero or subnormal: mantissa * 2^-24
+            result = std::ldexp(static_cast<float>(mantissa), -24);
+        }
+        else
+        {
+            const uint32_t bits = exponent == 0x1f ? (0xff << 23) | (mantissa << 13) : ((exponent + 127 - 15) << 23) | (mantissa << 13);
+            std::memcpy(&result, &bits, sizeof(result));
+        }
+
+        uint32_t bits;
+        std::memcpy(&bits, &result, sizeof(bits));
+        bits |= sign;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+} // namespace VertexPacking
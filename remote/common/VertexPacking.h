@@ -0,0 +1,71 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Packs vertices of a float3 position, a float2 uv and a float3 color (32 bytes) into 16 bytes for the GPU:
+// - the position as R16G16B16A16_SNORM, relative to the bounds of the batch of vertices it belongs to,
+// - the uv as R16G16_FLOAT,
+// - the color as R8G8B8A8_UNORM, with an alpha of 1.
+//
+// The position is reconstructed as snorm * extent + origin, which the vertex shader does with the Quantization of the batch. Its error is
+// at most half a step of 2 * extent / 65534 per axis. The uv keeps 11 significant bits, the color 8 bits per channel. Packing uses SSE2
+// or NEON where available, all code paths produce the same result.
+namespace VertexPacking
+{
+    struct PackedVertex
+    {
+        int16_t position[4];
+        uint16_t uv[2];
+        uint8_t color[4];
+    };
+
+    // Center and half size of the bounds of a batch of vertices, padded to 16 bytes to be uploaded as two float4.
+    struct Quantization
+    {
+        float origin[3];
+        float padding0;
+        float extent[3];
+        float padding1;
+    };
+
+    // Grows the bounds by the positions of count vertices, 8 floats each.
+    void ExtendBounds(const float* vertices, size_t count, float* minimum, float* maximum);
+
+    // Returns the quantization for the bounds. Empty bounds (minimum greater than maximum) and flat axes get a small extent, so that the
+    // positions can be divided by it.
+    Quantization GetQuantization(const float* minimum, const float* maximum);
+
+    // Packs count vertices, 8 floats each, which must be within the bounds of the quantization.
+    void PackVertices(const float* vertices, size_t count, const Quantization& quantization, PackedVertex* destination);
+
+    // A joint of a hand, drawn as an instance of a prototype mesh, packed from 9 floats (36 bytes) into 24 bytes:
+    // - the position as R32G32B32_FLOAT, as a joint may be far from any origin the vertex shader could quantize it to,
+    // - the orientation quaternion as R16G16B16A16_SNORM,
+    // - the length and the radius as R16G16_FLOAT.
+    struct PackedJoint
+    {
+        float position[3];
+        int16_t orientation[4];
+        uint16_t size[2];
+    };
+
+    // Packs count joints of 9 floats each: the position, the orientation quaternion x, y, z, w, which must be normalized, the length and
+    // the radius.
+    void PackJoints(const float* joints, size_t count, PackedJoint* destination);
+
+    // Conversions between float and half float, rounding to the nearest even half float. Values beyond the half range become infinity.
+    uint16_t FloatToHalf(float value);
+    float HalfToFloat(uint16_t value);
+} // namespace VertexPacking
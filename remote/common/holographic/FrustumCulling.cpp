@@ -13,6 +13,8 @@
 
 #include <holographic/FrustumCulling.h>
 
+#include <cmath>
+
 using namespace FrustumCulling;
 
 bool FrustumCulling::PointInFrustum(
@@ -87,3 +89,29 @@ bool FrustumCulling::SphereInFrustum(
     }
     return true;
 }
+
+bool FrustumCulling::OrientedBoxInFrustum(
+    const winrt::Windows::Foundation::Numerics::float3& boxCenter,
+    const winrt::Windows::Foundation::Numerics::float3& halfAxisX,
+    const winrt::Windows::Foundation::Numerics::float3& halfAxisY,
+    const winrt::Windows::Foundation::Numerics::float3& halfAxisZ,
+    const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum)
+{
+    if (!cullingFrustum)
+    {
+        return true;
+    }
+    SpatialBoundingFrustum frustum = cullingFrustum.Value();
+    for (const winrt::Windows::Foundation::Numerics::plane& plane :
+         {frustum.Bottom, frustum.Far, frustum.Left, frustum.Near, frustum.Right, frustum.Top})
+    {
+        // the box is outside if even its corner closest to the plane is on the outer side
+        const float radius =
+            std::abs(dot(plane.normal, halfAxisX)) + std::abs(dot(plane.normal, halfAxisY)) + std::abs(dot(plane.normal, halfAxisZ));
+        if (dot_coordinate(plane, boxCenter) - radius > 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -27,4 +27,13 @@ namespace FrustumCulling
         const winrt::Windows::Foundation::Numerics::float3& sphereCenter,
         float sphereRadius,
         const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum);
+
+    // Returns true if the oriented box intersects the frustum, or if no cullingFrustum is available. The box is given by its center and
+    // its three half axes, i.e. the vectors from the center to the centers of three adjacent faces.
+    bool OrientedBoxInFrustum(
+        const winrt::Windows::Foundation::Numerics::float3& boxCenter,
+        const winrt::Windows::Foundation::Numerics::float3& halfAxisX,
+        const winrt::Windows::Foundation::Numerics::float3& halfAxisY,
+        const winrt::Windows::Foundation::Numerics::float3& halfAxisZ,
+        const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum);
 }; // namespace FrustumCulling
@@ -14,6 +14,7 @@
 #include <chrono>
 
 #include <DirectXHelper.h>
+#include <PointTransform.h>
 #include <holographic/FrustumCulling.h>
 #include <holographic/QRCodeRenderer.h>
 
@@ -96,20 +97,18 @@ void QRCodeRenderer::Draw(unsigned int numInstances, winrt::Windows::Foundation:
 
     for (auto renderableCode : m_renderableQrCodes)
     {
-        // Apply frustum culling.
+        // Apply frustum and occlusion culling.
         const float size = renderableCode.size;
         winrt::Windows::Foundation::Numerics::float3 center =
             winrt::Windows::Foundation::Numerics::transform({0, 0, 0}, renderableCode.codeToRendering);
         float radius = sqrtf(2 * size * size);
 
-        if (FrustumCulling::SphereInFrustum(center, radius, cullingFrustum))
+        if (FrustumCulling::SphereInFrustum(center, radius, cullingFrustum) &&
+            (!m_occlusionCuller || m_occlusionCuller->IsSphereVisible(&center.x, radius)))
         {
             float3 positions[4] = {{0.0f, 0.0f, 0.0f}, {0.0f, size, 0.0f}, {size, size, 0.0f}, {size, 0.0f, 0.0f}};
-            for (int i = 0; i < 4; ++i)
-            {
-                // Transform from entity to rendering space.
-                positions[i] = transform(positions[i], renderableCode.codeToRendering);
-            }
+            // Transform from entity to rendering space.
+            PointTransform::TransformPoints(&renderableCode.codeToRendering.m11, positions, sizeof(float3), positions, sizeof(float3), 4);
 
             float3 col{1.0f, 0.76f, 0.0f};
             AppendColoredTriangle(positions[0], positions[2], positions[1], col, m_vertices);
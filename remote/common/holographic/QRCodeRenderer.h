@@ -13,6 +13,7 @@
 
 #include <vector>
 
+#include <OcclusionCuller.h>
 #include <holographic/RenderableObject.h>
 
 #include <winrt/Microsoft.MixedReality.QR.h>
@@ -36,6 +37,12 @@ public:
 
     void Reset();
 
+    // Optional, codes which are hidden behind the occluders rendered into the culler for the current camera are not drawn.
+    void SetOcclusionCuller(std::shared_ptr<OcclusionCuller> occlusionCuller)
+    {
+        m_occlusionCuller = std::move(occlusionCuller);
+    }
+
 private:
     void Draw(
         unsigned int numInstances,
@@ -47,5 +54,7 @@ private:
     std::map<winrt::Microsoft::MixedReality::QR::QRCode, winrt::Windows::Perception::Spatial::SpatialCoordinateSystem> m_qrCodes{};
     std::vector<RenderableQRCode> m_renderableQrCodes{};
 
+    std::shared_ptr<OcclusionCuller> m_occlusionCuller;
+
     std::mutex m_mutex;
 };
@@ -17,6 +17,24 @@
 
 using namespace winrt::Windows::Perception::Spatial;
 
+namespace
+{
+    void SetColoredTriangle(
+        DirectX::XMFLOAT3 p0, DirectX::XMFLOAT3 p1, DirectX::XMFLOAT3 p2, DirectX::XMFLOAT3 color, VertexPositionNormalColor* triangle)
+    {
+        VertexPositionNormalColor vertex;
+        vertex.color = color;
+        vertex.normal = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+        vertex.pos = p0;
+        triangle[0] = vertex;
+        vertex.pos = p1;
+        triangle[1] = vertex;
+        vertex.pos = p2;
+        triangle[2] = vertex;
+    }
+} // namespace
+
 RenderableObject::RenderableObject(const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources)
     : m_deviceResources(deviceResources)
 {
@@ -155,16 +173,18 @@ void RenderableObject::AppendColoredTriangle(
     DirectX::XMFLOAT3 color,
     std::vector<VertexPositionNormalColor>& vertices)
 {
-    VertexPositionNormalColor vertex;
-    vertex.color = color;
-    vertex.normal = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
-
-    vertex.pos = p0;
-    vertices.push_back(vertex);
-    vertex.pos = p1;
-    vertices.push_back(vertex);
-    vertex.pos = p2;
-    vertices.push_back(vertex);
+    vertices.resize(vertices.size() + 3);
+    SetColoredTriangle(p0, p1, p2, color, vertices.data() + vertices.size() - 3);
+}
+
+void RenderableObject::AppendColoredTriangle(
+    DirectX::XMFLOAT3 p0,
+    DirectX::XMFLOAT3 p1,
+    DirectX::XMFLOAT3 p2,
+    DirectX::XMFLOAT3 color,
+    FrameArena::Array<VertexPositionNormalColor>& vertices)
+{
+    SetColoredTriangle(p0, p1, p2, color, vertices.grow(3));
 }
 
 void RenderableObject::AppendColoredTriangle(
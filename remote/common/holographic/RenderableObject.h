@@ -12,6 +12,7 @@
 #pragma once
 
 #include <DeviceResourcesD3D11.h>
+#include <FrameArena.h>
 #include <SimpleColor_ShaderStructures.h>
 
 #include <future>
@@ -51,6 +52,14 @@ protected:
         winrt::Windows::Foundation::Numerics::float3 color,
         std::vector<VertexPositionNormalColor>& vertices);
 
+    // Appends to an array of the frame arena, which doesn't allocate from the heap once the arena is large enough.
+    static void AppendColoredTriangle(
+        DirectX::XMFLOAT3 p0,
+        DirectX::XMFLOAT3 p1,
+        DirectX::XMFLOAT3 p2,
+        DirectX::XMFLOAT3 color,
+        FrameArena::Array<VertexPositionNormalColor>& vertices);
+
     // Cached pointer to device resources.
     std::shared_ptr<DXHelper::DeviceResourcesD3D11> m_deviceResources;
 
@@ -13,12 +13,23 @@
 
 #include <holographic/SceneUnderstandingRenderer.h>
 
+#include <ContentHash.h>
 #include <DbgLog.h>
 #include <DirectXColors.h>
 #include <DirectXHelper.h>
+#include <PointTransform.h>
+#include <SceneGeometryBuilder.h>
+#include <VertexPacking.h>
 
 #include <winrt/Windows.Perception.Spatial.Preview.h>
 
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <ppl.h>
+#include <thread>
+
 using namespace DirectX;
 
 using namespace winrt::Windows::Foundation;
@@ -29,13 +40,61 @@ using namespace Microsoft::MixedReality::SceneUnderstanding;
 
 namespace
 {
-    // The size of the label quads in rendering space.
-    constexpr float LabelQuadWidth = 0.6f;
-    constexpr float LabelQuadHeight = 0.3f;
+    // Number of vertices packed by one task.
+    constexpr size_t PackBlockSize = 64 * 1024;
+
+    // Unused vertex and index buffers kept for the next updates, in bytes.
+    constexpr uint64_t MaxPooledBufferBytes = 64 * 1024 * 1024;
 
-    // The texture size in pixels.
-    constexpr int TextTextureWidth = 256;
-    constexpr int TextTextureHeight = 128;
+    // Bytes uploaded to a buffer while holding the device context.
+    constexpr UINT UploadChunkSize = 1024 * 1024;
+
+    // Returns true if the kind is one of the kinds, or if there are none.
+    bool IsKindIncluded(SceneObjectKind kind, std::initializer_list<SceneObjectKind> kinds)
+    {
+        return kinds.size() == 0 || std::find(kinds.begin(), kinds.end(), kind) != kinds.end();
+    }
+
+    // Calls draw(first, count) for the runs of adjacent ranges of the objects, which getRange(object) returns as first and count. The
+    // objects are sorted by the position of their ranges, so consecutive objects in view are drawn with one call.
+    template <typename GetRange, typename Draw>
+    void DrawRuns(const std::vector<uint32_t>& objects, GetRange&& getRange, Draw&& draw)
+    {
+        UINT runFirst = 0;
+        UINT runCount = 0;
+        for (uint32_t object : objects)
+        {
+            const auto [first, count] = getRange(object);
+            if (count == 0)
+            {
+                continue;
+            }
+            if (runCount != 0 && runFirst + runCount == first)
+            {
+                runCount += count;
+                continue;
+            }
+            if (runCount != 0)
+            {
+                draw(runFirst, runCount);
+            }
+            runFirst = first;
+            runCount = count;
+        }
+        if (runCount != 0)
+        {
+            draw(runFirst, runCount);
+        }
+    }
+
+    // The size of the label atlas in pixels. It is as high as the labels need, up to the maximum. The labels are kept some pixels apart,
+    // so that they don't bleed into each other when sampled.
+    constexpr uint32_t LabelAtlasWidth = 512;
+    constexpr uint32_t LabelAtlasMaxHeight = 512;
+    constexpr uint32_t LabelAtlasPadding = 2;
+
+    // The size of a label atlas pixel in rendering space.
+    constexpr float LabelPixelSize = 0.6f / 256.0f;
 
     // Logical size of the font in DIP.
     constexpr float LabelFontSize = 40.0f;
@@ -72,7 +131,9 @@ namespace
 
 SceneUnderstandingRenderer::SceneUnderstandingRenderer(const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources)
     : m_deviceResources(deviceResources)
+    , m_bufferPool(std::make_shared<BufferPoolD3D11>(MaxPooledBufferBytes))
 {
+    CreateLabelAtlasLayout();
     CreateDeviceDependentResources();
 }
 
@@ -85,74 +146,46 @@ void SceneUnderstandingRenderer::CreateDeviceDependentResources()
 {
     // Create the resources for label texture rendering before any thread switch occurs.
     {
-        // Create texture description.
+        // Create the label atlas texture.
         CD3D11_TEXTURE2D_DESC textureDesc(
-            DXGI_FORMAT_B8G8R8A8_UNORM, TextTextureWidth, TextTextureHeight, 1, 1, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET);
-
-        // Create font.
-        winrt::check_hresult(m_deviceResources->GetDWriteFactory()->CreateTextFormat(
-            L"Segoe UI",
-            nullptr,
-            DWRITE_FONT_WEIGHT_MEDIUM,
-            DWRITE_FONT_STYLE_NORMAL,
-            DWRITE_FONT_STRETCH_NORMAL,
-            LabelFontSize,
-            L"en-US",
-            m_textFormat.put()));
-        winrt::check_hresult(m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR));
-        winrt::check_hresult(m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER));
+            DXGI_FORMAT_B8G8R8A8_UNORM, LabelAtlasWidth, m_labelAtlasHeight, 1, 1, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET);
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateTexture2D(&textureDesc, nullptr, m_labelAtlasTexture.put()));
 
         // Create text sampler state.
         CD3D11_SAMPLER_DESC samplerDesc(D3D11_DEFAULT);
         winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateSamplerState(&samplerDesc, m_textSamplerState.put()));
 
-        // Create a single texture for every label.
-        for (auto const& [kind, label] : m_sceneQuadsLabels)
-        {
-            // Create the texture.
-            winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateTexture2D(&textureDesc, nullptr, m_textTextures[kind].put()));
-
-            // Create the shader resource view.
-            winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(
-                m_textTextures[kind].get(), nullptr, m_textShaderResourceViews[kind].put()));
-
-            // Create the render target view.
-            winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateRenderTargetView(
-                m_textTextures[kind].get(), nullptr, m_textRenderTargets[kind].put()));
-
-            // Create the DXGI render targets.
-            D2D1_RENDER_TARGET_PROPERTIES props = D2D1::RenderTargetProperties(
-                D2D1_RENDER_TARGET_TYPE_DEFAULT, D2D1::PixelFormat(DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED), 96, 96);
-            winrt::com_ptr<IDXGISurface> dxgiSurface;
-            m_textTextures[kind].as(dxgiSurface);
-            winrt::check_hresult(m_deviceResources->GetD2DFactory()->CreateDxgiSurfaceRenderTarget(
-                dxgiSurface.get(), &props, m_d2dTextRenderTargets[kind].put()));
-
-            // Create the brush.
-            winrt::check_hresult(
-                m_d2dTextRenderTargets[kind]->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), m_brushes[kind].put()));
-
-            // Create the layout.
-            winrt::check_hresult(m_deviceResources->GetDWriteFactory()->CreateTextLayout(
-                label.name.c_str(),
-                static_cast<UINT32>(label.name.size()),
-                m_textFormat.get(),
-                static_cast<float>(TextTextureWidth),  // Max width of the input text.
-                static_cast<float>(TextTextureHeight), // Max height of the input text.
-                m_layouts[kind].put()));
-
-            m_deviceResources->UseD3DDeviceContext([&](auto context) {
-                context->ClearRenderTargetView(m_textRenderTargets[kind].get(), DirectX::Colors::Transparent);
-
-                // Draw the label name to the texture.
-                m_d2dTextRenderTargets[kind]->BeginDraw();
-                m_d2dTextRenderTargets[kind]->DrawTextLayout(
-                    D2D1::Point2F(0, (m_layouts[kind]->GetMaxHeight() / 2.0f) - LabelFontSize),
-                    m_layouts[kind].get(),
-                    m_brushes[kind].get());
-                m_d2dTextRenderTargets[kind]->EndDraw();
-            });
-        }
+        // Create the shader resource view.
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(
+            m_labelAtlasTexture.get(), nullptr, m_labelAtlasShaderResourceView.put()));
+
+        // Create the render target view.
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateRenderTargetView(
+            m_labelAtlasTexture.get(), nullptr, m_labelAtlasRenderTarget.put()));
+
+        // Create the DXGI render target.
+        D2D1_RENDER_TARGET_PROPERTIES props = D2D1::RenderTargetProperties(
+            D2D1_RENDER_TARGET_TYPE_DEFAULT, D2D1::PixelFormat(DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED), 96, 96);
+        winrt::com_ptr<IDXGISurface> dxgiSurface;
+        m_labelAtlasTexture.as(dxgiSurface);
+        winrt::check_hresult(m_deviceResources->GetD2DFactory()->CreateDxgiSurfaceRenderTarget(
+            dxgiSurface.get(), &props, m_d2dLabelAtlasRenderTarget.put()));
+
+        // Create the brush.
+        winrt::check_hresult(m_d2dLabelAtlasRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), m_brush.put()));
+
+        m_deviceResources->UseD3DDeviceContext([&](auto context) {
+            context->ClearRenderTargetView(m_labelAtlasRenderTarget.get(), DirectX::Colors::Transparent);
+
+            // Draw the label names to their places in the atlas.
+            m_d2dLabelAtlasRenderTarget->BeginDraw();
+            for (auto const& [kind, entry] : m_labelAtlasEntries)
+            {
+                m_d2dLabelAtlasRenderTarget->DrawTextLayout(
+                    D2D1::Point2F(static_cast<float>(entry.rect.x), static_cast<float>(entry.rect.y)), entry.layout.get(), m_brush.get());
+            }
+            m_d2dLabelAtlasRenderTarget->EndDraw();
+        });
     }
 
     // Vertex shader.
@@ -161,10 +194,11 @@ void SceneUnderstandingRenderer::CreateDeviceDependentResources()
         winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateVertexShader(
             vertexShaderFileData.data(), vertexShaderFileData.size(), nullptr, m_vertexShader.put()));
 
+        // See VertexPacking.
         constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 3> vertexDesc = {{
-            {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-            {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
-            {"COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
         }};
 
         winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
@@ -250,34 +284,77 @@ void SceneUnderstandingRenderer::ReleaseDeviceDependentResources()
     m_meshPixelShader = nullptr;
     m_rasterizerState = nullptr;
     m_modelConstantBuffer = nullptr;
+    m_bufferPool->Clear();
 
-    for (auto const& [kind, label] : m_sceneQuadsLabels)
-    {
-        m_textTextures[kind] = nullptr;
-        m_textShaderResourceViews[kind] = nullptr;
-        m_textRenderTargets[kind] = nullptr;
-        m_d2dTextRenderTargets[kind] = nullptr;
-        m_brushes[kind] = nullptr;
-        m_layouts[kind] = nullptr;
-    }
+    m_labelAtlasTexture = nullptr;
+    m_labelAtlasShaderResourceView = nullptr;
+    m_labelAtlasRenderTarget = nullptr;
+    m_d2dLabelAtlasRenderTarget = nullptr;
+    m_brush = nullptr;
 
-    m_textFormat = nullptr;
     m_textSamplerState = nullptr;
     m_labelPixelShader = nullptr;
     m_blendState = nullptr;
 }
 
-void SceneUnderstandingRenderer::SetScene(std::shared_ptr<Scene> scene, SpatialStationaryFrameOfReference lastUpdateLocation)
+void SceneUnderstandingRenderer::CreateLabelAtlasLayout()
 {
-    // While the vertices are updated asynchronously the scene cannot be set.
-    std::lock_guard lock(m_mutex);
+    // Create font.
+    winrt::check_hresult(m_deviceResources->GetDWriteFactory()->CreateTextFormat(
+        L"Segoe UI",
+        nullptr,
+        DWRITE_FONT_WEIGHT_MEDIUM,
+        DWRITE_FONT_STYLE_NORMAL,
+        DWRITE_FONT_STRETCH_NORMAL,
+        LabelFontSize,
+        L"en-US",
+        m_textFormat.put()));
+    winrt::check_hresult(m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR));
+    winrt::check_hresult(m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING));
+
+    // Measure the names. The layouts are drawn at the top left of their places in the atlas, so the places are as large as the text.
+    std::vector<SkylinePacker::Size> sizes;
+    for (auto const& [kind, label] : m_sceneQuadsLabels)
+    {
+        LabelAtlasEntry& entry = m_labelAtlasEntries[kind];
+        winrt::check_hresult(m_deviceResources->GetDWriteFactory()->CreateTextLayout(
+            label.name.c_str(),
+            static_cast<UINT32>(label.name.size()),
+            m_textFormat.get(),
+            static_cast<float>(LabelAtlasWidth),     // Max width of the input text.
+            static_cast<float>(LabelAtlasMaxHeight), // Max height of the input text.
+            entry.layout.put()));
+
+        DWRITE_TEXT_METRICS metrics;
+        winrt::check_hresult(entry.layout->GetMetrics(&metrics));
+        sizes.push_back(
+            {std::min(static_cast<uint32_t>(std::ceil(metrics.width)), LabelAtlasWidth),
+             std::min(static_cast<uint32_t>(std::ceil(metrics.height)), LabelAtlasMaxHeight)});
+    }
 
-    m_scene = scene;
-    m_sceneLastUpdateLocation = lastUpdateLocation;
+    // There are only a few names, which always fit.
+    SkylinePacker packer(LabelAtlasWidth, LabelAtlasMaxHeight, LabelAtlasPadding);
+    std::vector<SkylinePacker::Rect> rects(sizes.size());
+    [[maybe_unused]] const bool allInserted = packer.InsertAll(sizes.data(), static_cast<uint32_t>(sizes.size()), rects.data());
+    assert(allInserted);
+    m_labelAtlasHeight = std::max(packer.GetUsedHeight(), 1u);
 
-    m_verticesOutdated = true;
+    size_t i = 0;
+    for (auto& [kind, entry] : m_labelAtlasEntries)
+    {
+        entry.rect = rects[i++];
+        float uvRect[4];
+        SkylinePacker::GetUVRect(entry.rect, LabelAtlasWidth, m_labelAtlasHeight, uvRect);
+        entry.uvTopLeft = {uvRect[0], uvRect[1]};
+        entry.uvBottomRight = {uvRect[2], uvRect[3]};
+        entry.quadSize = {entry.rect.width * LabelPixelSize, entry.rect.height * LabelPixelSize};
+    }
+}
 
-    m_coordinateSystem = nullptr;
+void SceneUnderstandingRenderer::SetScene(std::shared_ptr<Scene> scene, SpatialStationaryFrameOfReference lastUpdateLocation)
+{
+    // Update() creates the vertices for the new scene, once a running update is done. Until then the previous scene is rendered.
+    m_geometryPublisher.SetSource(std::make_shared<const SceneSource>(SceneSource{scene, lastUpdateLocation}));
 }
 
 void SceneUnderstandingRenderer::Update(SpatialCoordinateSystem renderingCoordinateSystem)
@@ -289,23 +366,31 @@ void SceneUnderstandingRenderer::Update(SpatialCoordinateSystem renderingCoordin
     }
 
     // Only create the vertices once if the scene was updated.
-    std::lock_guard lock(m_mutex);
-    if (m_verticesOutdated && !m_verticesUpdating)
+    // The vertices are created on background threads, which publish them when done, so this neither waits for that nor for SetScene().
+    AsyncUpdatePublisher<SceneSource, SceneRenderGeometry>::Update update;
+    if (m_geometryPublisher.BeginUpdate(update))
     {
-        m_verticesUpdating = true;
-        CreateVerticesAsync(renderingCoordinateSystem, m_sceneLastUpdateLocation);
+        CreateVerticesAsync(update.id, std::move(update.source), renderingCoordinateSystem);
     }
 
+    // Keep the published geometry for this frame, so that the transform below and Render() use the same one.
+    m_frameGeometry = m_geometryPublisher.GetResult();
+
     m_validSceneToRenderingTransform = false;
 
-    if (m_scene)
+    if (m_frameGeometry)
     {
+        if (m_coordinateSystemNodeId != m_frameGeometry->originNodeId)
+        {
+            m_coordinateSystem = nullptr;
+            m_coordinateSystemNodeId = m_frameGeometry->originNodeId;
+        }
+
         if (m_coordinateSystem == nullptr)
         {
             try
             {
-                m_coordinateSystem =
-                    Preview::SpatialGraphInteropPreview::CreateCoordinateSystemForNode(m_scene->GetOriginSpatialGraphNodeId());
+                m_coordinateSystem = Preview::SpatialGraphInteropPreview::CreateCoordinateSystemForNode(m_coordinateSystemNodeId);
             }
             catch (winrt::hresult_error const&)
             {
@@ -332,183 +417,507 @@ void SceneUnderstandingRenderer::Update(SpatialCoordinateSystem renderingCoordin
                     context->UpdateSubresource(m_modelConstantBuffer.get(), 0, nullptr, &model, 0, 0);
                 });
 
-                m_validSceneToRenderingTransform = true;
+                m_sceneToRenderingTransform = sceneToRenderingTransform;
+                m_validSceneToRenderingTransform = invert(sceneToRenderingTransform, &m_renderingToSceneTransform);
             }
         }
     }
 }
 
+SceneUnderstandingRenderer::BufferPoolD3D11::Lease SceneUnderstandingRenderer::UploadBuffer(UINT bindFlags, const void* data, UINT size)
+{
+    BufferPoolD3D11::Lease buffer = m_bufferPool->Acquire(bindFlags, size, [&](uint64_t capacity) {
+        winrt::com_ptr<ID3D11Buffer> created;
+        const CD3D11_BUFFER_DESC bufferDesc(static_cast<UINT>(capacity), bindFlags);
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&bufferDesc, nullptr, created.put()));
+        return created;
+    });
+
+    // A reused buffer may still be read by frames in flight, the device context takes care of that.
+    for (UINT offset = 0; offset < size; offset += UploadChunkSize)
+    {
+        const D3D11_BOX box = {offset, 0, 0, std::min(offset + UploadChunkSize, size), 1, 1};
+        m_deviceResources->UseD3DDeviceContext([&](auto context) {
+            context->UpdateSubresource(buffer.Get().get(), 0, &box, static_cast<const uint8_t*>(data) + offset, 0, 0);
+        });
+    }
+    return buffer;
+}
+
 winrt::fire_and_forget SceneUnderstandingRenderer::CreateVerticesAsync(
-    SpatialCoordinateSystem renderingCoordinateSystem, SpatialStationaryFrameOfReference lastUpdateLocation)
+    uint32_t updateId, std::shared_ptr<const SceneSource> source, SpatialCoordinateSystem renderingCoordinateSystem)
 {
     auto weakThis = weak_from_this();
     co_await winrt::resume_background();
 
     if (auto strongThis = weakThis.lock())
     {
-        std::lock_guard lock(m_mutex);
-
-        // Clear the vertices.
-        m_quadVertices.clear();
-        m_quadLabelsVertices.clear();
-        m_meshVertices.clear();
-
-        // Collect all scene objects, then iterate to find quad entities
-        for (const std::shared_ptr<SceneObject> object : m_scene->GetSceneObjects())
-        {
-            // Check if the object is in the quads labels.
-            auto quadLabelPos = m_sceneQuadsLabels.find(object->GetKind());
-            if (quadLabelPos != m_sceneQuadsLabels.end())
+        const std::shared_ptr<const ObjectGeometryCache> previousCache = m_objectCache.load();
+
+        // Split the scene objects into a few more contiguous chunks than there are processors, see SceneGeometryBuilder. The geometry of
+        // each object is taken from the previous update if the object did not change, otherwise it is created.
+        const auto objects = source->scene->GetSceneObjects();
+        const size_t objectCount = objects.size();
+        const size_t chunkCount = SceneGeometryBuilder::GetChunkCount(objectCount, std::thread::hardware_concurrency());
+
+        std::vector<std::shared_ptr<const CachedSceneObject>> objectGeometries(objectCount);
+        std::vector<uint64_t> geometryHashes(objectCount);
+        std::atomic<uint64_t> rebuiltCount = 0;
+        Concurrency::parallel_for(size_t(0), chunkCount, [&](size_t chunk) {
+            const size_t begin = SceneGeometryBuilder::GetChunkBegin(objectCount, chunkCount, chunk);
+            const size_t end = SceneGeometryBuilder::GetChunkBegin(objectCount, chunkCount, chunk + 1);
+            uint64_t chunkRebuiltCount = 0;
+            for (size_t i = begin; i < end; i++)
             {
-                const SceneObjectLabel& label = quadLabelPos->second;
-                auto [r, g, b] = label.color;
-                float3 color = {r / 255.0f, g / 255.0f, b / 255.0f};
-
-                // Adds the quads to the vertex buffer for rendering, using the color indicated by the label dictionary for the quad's owner
-                // entity's type.
-                AddSceneQuadsVertices(*object, color);
-
-                // Adds the label quads to the vertex buffer for rendering.
-                AddSceneQuadLabelVertices(*object, color);
+                bool rebuilt = false;
+                objectGeometries[i] = GetSceneObjectGeometry(*objects[i], previousCache.get(), geometryHashes[i], rebuilt);
+                chunkRebuiltCount += rebuilt ? 1 : 0;
             }
-
-            // Check if the object is in the mesh labels.
-            auto meshLabelPos = m_sceneMeshLabels.find(object->GetKind());
-            if (meshLabelPos != m_sceneMeshLabels.end())
+            rebuiltCount += chunkRebuiltCount;
+        });
+
+        // The quads of all objects are merged across the objects, the clusters follow the objects.
+        const std::vector<std::shared_ptr<const CachedSceneObject>> quadClusters = MergeSceneQuads(objectGeometries);
+
+        // Objects which are not part of this scene anymore drop out of the cache. The objects with any geometry are indexed, with the
+        // ranges their geometry will have in the merged buffers.
+        ObjectGeometryCache objectCache;
+        std::vector<const SceneGeometry*> parts;
+        SceneSpatialIndex spatialIndex;
+        std::vector<BoundingVolumeHierarchy::Bounds> objectBounds;
+        objectCache.Reserve(objectCount);
+        parts.reserve(objectCount + quadClusters.size());
+        SceneObjectRange offsets;
+        auto addPart = [&](const std::shared_ptr<const CachedSceneObject>& object) {
+            parts.push_back(&object->geometry);
+
+            SceneObjectRange range;
+            range.quadFirstVertex = offsets.quadFirstVertex;
+            range.quadVertexCount = static_cast<UINT>(object->geometry.quadVertices.size());
+            range.labelFirstVertex = offsets.labelFirstVertex;
+            range.labelVertexCount = static_cast<UINT>(object->geometry.labelVertices.size());
+            range.meshFirstIndex = offsets.meshFirstIndex;
+            range.meshIndexCount = static_cast<UINT>(object->geometry.meshIndices.size());
+            offsets.quadFirstVertex += range.quadVertexCount;
+            offsets.labelFirstVertex += range.labelVertexCount;
+            offsets.meshFirstIndex += range.meshIndexCount;
+
+            if (range.quadVertexCount + range.labelVertexCount + range.meshIndexCount != 0)
             {
-                const SceneObjectLabel& label = meshLabelPos->second;
-                auto [r, g, b] = label.color;
-                float3 color = {r / 255.0f, g / 255.0f, b / 255.0f};
-
-                // Adds the sceneMeshes to the vertex buffer for rendering, using the color indicated by the label dictionary for the quad's
-                // owner entity's type.
-                AddSceneMeshVertices(*object, color);
+                spatialIndex.objects.push_back(object);
+                spatialIndex.ranges.push_back(range);
+                objectBounds.push_back(object->bounds);
             }
+        };
+        for (size_t i = 0; i < objectCount; i++)
+        {
+            if (objectGeometries[i])
+            {
+                objectCache.Insert(objects[i]->GetId(), objectGeometries[i]->kind, geometryHashes[i], objectGeometries[i]);
+                addPart(objectGeometries[i]);
+            }
+        }
+        for (const std::shared_ptr<const CachedSceneObject>& cluster : quadClusters)
+        {
+            addPart(cluster);
         }
+        m_rebuiltObjectCount += rebuiltCount;
+        m_reusedObjectCount += parts.size() - quadClusters.size() - rebuiltCount;
 
-        // Create the d3d11 vertex buffers.
-        const UINT stride = sizeof(VertexPositionUVColor);
-        const UINT offset = 0;
+        spatialIndex.objectHierarchy.Build(objectBounds.data(), static_cast<uint32_t>(objectBounds.size()));
+
+        SceneGeometry geometry;
+        MergeSceneGeometry(parts, geometry);
+        std::shared_ptr<const ObjectGeometryCache> cache = std::make_shared<const ObjectGeometryCache>(std::move(objectCache));
+
+        // Pack the vertices for the GPU, the unpacked ones are not needed anymore.
+        PackedSceneGeometry packed;
+        PackSceneGeometry(geometry, packed);
+        packed.meshIndices = std::move(geometry.meshIndices);
+        geometry = {};
+
+        // Create the d3d11 vertex buffers into a new geometry next to the one which is currently rendered.
+        auto renderGeometry = std::make_shared<SceneRenderGeometry>();
+        renderGeometry->originNodeId = source->scene->GetOriginSpatialGraphNodeId();
+        renderGeometry->spatialIndex = std::move(spatialIndex);
+        const UINT stride = sizeof(PackedVertex);
 
         // Quads.
-        if (!m_quadVertices.empty())
+        if (!packed.quadVertices.empty())
         {
-            m_quadVerticesBuffer = nullptr;
-            D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-            vertexBufferData.pSysMem = m_quadVertices.data();
-            const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(m_quadVertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-            winrt::check_hresult(
-                m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_quadVerticesBuffer.put()));
+            renderGeometry->quadVerticesBuffer = UploadBuffer(
+                D3D11_BIND_VERTEX_BUFFER, packed.quadVertices.data(), static_cast<UINT>(packed.quadVertices.size() * stride));
+            renderGeometry->quadVertexCount = static_cast<UINT>(packed.quadVertices.size());
         }
         // Labels.
-        for (auto const& [kind, vertices] : m_quadLabelsVertices)
+        if (!packed.labelVertices.empty())
         {
-            if (!vertices.empty())
-            {
-                m_quadLabelsVerticesBuffer[kind] = nullptr;
-                D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-                vertexBufferData.pSysMem = vertices.data();
-                const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(vertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-                winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(
-                    &vertexBufferDesc, &vertexBufferData, m_quadLabelsVerticesBuffer[kind].put()));
-            }
+            renderGeometry->labelVerticesBuffer = UploadBuffer(
+                D3D11_BIND_VERTEX_BUFFER, packed.labelVertices.data(), static_cast<UINT>(packed.labelVertices.size() * stride));
+            renderGeometry->labelVertexCount = static_cast<UINT>(packed.labelVertices.size());
         }
         // Mesh.
-        if (!m_meshVertices.empty())
+        if (!packed.meshIndices.empty())
         {
-            m_meshVerticesBuffer = nullptr;
-            D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-            vertexBufferData.pSysMem = m_meshVertices.data();
-            const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(m_meshVertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-            winrt::check_hresult(
-                m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_meshVerticesBuffer.put()));
+            renderGeometry->meshVerticesBuffer = UploadBuffer(
+                D3D11_BIND_VERTEX_BUFFER, packed.meshVertices.data(), static_cast<UINT>(packed.meshVertices.size() * stride));
+            renderGeometry->meshIndicesBuffer = UploadBuffer(
+                D3D11_BIND_INDEX_BUFFER, packed.meshIndices.data(), static_cast<UINT>(packed.meshIndices.size() * sizeof(uint32_t)));
+            renderGeometry->meshIndexCount = static_cast<UINT>(packed.meshIndices.size());
         }
 
-        // Done with updating.
-        m_verticesUpdating = false;
-        // All the vertices are now up to date and can be used for rendering.
-        m_verticesOutdated = false;
+        // The quantization of the positions, which the vertex shader reconstructs them with.
+        {
+            D3D11_SUBRESOURCE_DATA constantBufferData = {0};
+            constantBufferData.pSysMem = &packed.quantization;
+            const CD3D11_BUFFER_DESC constantBufferDesc(sizeof(packed.quantization), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_IMMUTABLE);
+            winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(
+                &constantBufferDesc, &constantBufferData, renderGeometry->quantizationConstantBuffer.put()));
+        }
+        packed = {};
+
+        // Publish the geometry. The render thread picks it up with its next Update() and keeps the previous one alive as long as it still
+        // renders it. If the renderer was reset in the meantime, the update is stale and a newer one may be running, so nothing is changed.
+        // If a new scene was set in the meantime, the geometry is published anyway and rendered until the one of the new scene is done.
+        // The objects stay cached even if the scene was replaced, most of them are likely part of the new one as well. The previous
+        // objects are swapped out, so that they are freed after the lock of the publisher is released.
+        m_geometryPublisher.Publish(updateId, std::move(renderGeometry), [&] { cache = m_objectCache.exchange(std::move(cache)); });
     }
 }
 
-void SceneUnderstandingRenderer::AddSceneQuadsVertices(const SceneObject& object, const float3& color)
+std::shared_ptr<const SceneUnderstandingRenderer::CachedSceneObject> SceneUnderstandingRenderer::GetSceneObjectGeometry(
+    const SceneObject& object, const ObjectGeometryCache* previousCache, uint64_t& geometryHash, bool& rebuilt) const
 {
-    float4x4 objectToSceneTransform = GetLocationAsFloat4x4(object);
-    const std::shared_ptr<SceneQuad> quad = object.GetQuad();
-    // Create the quad's corner points in object space.
-    const float width = quad->GetExtents().X;
-    const float height = quad->GetExtents().Y;
-    float3 positions[4] = {
-        {-width / 2, -height / 2, 0.0f}, {width / 2, -height / 2, 0.0f}, {-width / 2, height / 2, 0.0f}, {width / 2, height / 2, 0.0f}};
+    geometryHash = 0;
+    rebuilt = false;
+
+    // Check if the object is in the quads labels or in the mesh labels, other objects are not rendered.
+    const SceneObjectKind kind = object.GetKind();
+    auto quadLabelPos = m_sceneQuadsLabels.find(kind);
+    auto meshLabelPos = m_sceneMeshLabels.find(kind);
+    if (quadLabelPos == m_sceneQuadsLabels.end() && meshLabelPos == m_sceneMeshLabels.end())
+    {
+        return nullptr;
+    }
 
-    // Transform the vertices to scene space.
-    for (int i = 0; i < 4; ++i)
+    // Hash everything the vertices are created from. The meshes are read only once, they are needed to create the vertices if they
+    // changed.
+    const float4x4 objectToSceneTransform = GetLocationAsFloat4x4(object);
+    ContentHash hash;
+    hash.UpdateValue(kind);
+    hash.UpdateValue(objectToSceneTransform);
+
+    if (quadLabelPos != m_sceneQuadsLabels.end())
+    {
+        hash.UpdateValue(object.GetQuad()->GetExtents());
+    }
+
+    std::vector<SceneMeshData> meshes;
+    if (meshLabelPos != m_sceneMeshLabels.end())
+    {
+        for (const std::shared_ptr<SceneMesh> mesh : object.GetMeshes())
+        {
+            SceneMeshData& meshData = meshes.emplace_back();
+            meshData.indices.resize(mesh->GetTriangleIndexCount());
+            mesh->GetTriangleIndices(meshData.indices);
+
+            // Get the mesh's vertices in object space.
+            uint32_t vertexCount = mesh->GetVertexCount();
+            meshData.vertices.resize(vertexCount);
+            float3* ptr = meshData.vertices.data();
+            mesh->GetVertexPositions(ptr, vertexCount);
+
+            hash.UpdateValue(meshData.indices.size());
+            hash.Update(meshData.indices.data(), meshData.indices.size() * sizeof(uint32_t));
+            hash.UpdateValue(meshData.vertices.size());
+            hash.Update(meshData.vertices.data(), meshData.vertices.size() * sizeof(float3));
+        }
+    }
+
+    geometryHash = hash.Finish();
+    if (previousCache)
+    {
+        if (std::shared_ptr<const CachedSceneObject> previous = previousCache->Find(object.GetId(), kind, geometryHash))
+        {
+            return previous;
+        }
+    }
+
+    rebuilt = true;
+    auto cachedObject = std::make_shared<CachedSceneObject>();
+    cachedObject->kind = kind;
+
+    if (quadLabelPos != m_sceneQuadsLabels.end())
+    {
+        const SceneObjectLabel& label = quadLabelPos->second;
+        auto [r, g, b] = label.color;
+        float3 color = {r / 255.0f, g / 255.0f, b / 255.0f};
+
+        // The quad is merged with the coplanar quads of the other objects of the same kind, see MergeSceneQuads().
+        cachedObject->hasQuad = true;
+        cachedObject->quad = GetSceneQuad(object);
+
+        // Adds the label quads to the vertex buffer for rendering.
+        AddSceneQuadLabelVertices(object, color, m_labelAtlasEntries.at(kind), cachedObject->geometry);
+    }
+
+    if (meshLabelPos != m_sceneMeshLabels.end())
+    {
+        const SceneObjectLabel& label = meshLabelPos->second;
+        auto [r, g, b] = label.color;
+        float3 color = {r / 255.0f, g / 255.0f, b / 255.0f};
+
+        // Adds the sceneMeshes to the vertex buffer for rendering, using the color indicated by the label dictionary for the quad's
+        // owner entity's type.
+        AddSceneMeshVertices(objectToSceneTransform, meshes, color, cachedObject->geometry);
+    }
+
+    BuildSceneObjectHierarchy(*cachedObject);
+
+    return cachedObject;
+}
+
+void SceneUnderstandingRenderer::BuildSceneObjectHierarchy(CachedSceneObject& object)
+{
+    static_assert(sizeof(VertexPositionUVColor) == 8 * sizeof(float), "VertexPacking expects 8 floats per vertex");
+
+    // The bounds are for culling, so they include the label, which is not hit by ray casts though.
+    const SceneGeometry& geometry = object.geometry;
+    BoundingVolumeHierarchy::Bounds& bounds = object.bounds;
+    bounds = {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+    VertexPacking::ExtendBounds(
+        reinterpret_cast<const float*>(geometry.quadVertices.data()), geometry.quadVertices.size(), bounds.min, bounds.max);
+    VertexPacking::ExtendBounds(
+        reinterpret_cast<const float*>(geometry.labelVertices.data()), geometry.labelVertices.size(), bounds.min, bounds.max);
+    VertexPacking::ExtendBounds(
+        reinterpret_cast<const float*>(geometry.meshVertices.data()), geometry.meshVertices.size(), bounds.min, bounds.max);
+
+    const uint32_t triangleCount = static_cast<uint32_t>((geometry.quadVertices.size() + geometry.meshIndices.size()) / 3);
+    std::vector<BoundingVolumeHierarchy::Bounds> triangleBounds(triangleCount);
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
     {
-        positions[i] = transform(positions[i], objectToSceneTransform);
+        float3 positions[3];
+        GetSceneObjectTriangle(object, triangle, positions);
+        const float3 minimum = min(min(positions[0], positions[1]), positions[2]);
+        const float3 maximum = max(max(positions[0], positions[1]), positions[2]);
+        triangleBounds[triangle] = {{minimum.x, minimum.y, minimum.z}, {maximum.x, maximum.y, maximum.z}};
     }
+    object.triangleHierarchy.Build(triangleBounds.data(), triangleCount);
+}
 
-    // Create uv coordinates so that the checkerboard pattern becomes uniformly.
-    float2 uvs[4] = {{0, 0}, {0, width}, {height, 0}, {height, width}};
+void SceneUnderstandingRenderer::GetSceneObjectTriangle(const CachedSceneObject& object, uint32_t triangle, float3 positions[3])
+{
+    // The quads are triangle lists, the mesh is indexed.
+    const SceneGeometry& geometry = object.geometry;
+    const uint32_t quadTriangleCount = static_cast<uint32_t>(geometry.quadVertices.size() / 3);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        const DirectX::XMFLOAT3& position = triangle < quadTriangleCount
+                                                ? geometry.quadVertices[3 * triangle + i].pos
+                                                : geometry.meshVertices[geometry.meshIndices[3 * (triangle - quadTriangleCount) + i]].pos;
+        positions[i] = {position.x, position.y, position.z};
+    }
+}
 
-    // Create the vertices with uv coordinates for the quad.
-    AppendQuad(positions, uvs, height, width, color, m_quadVertices);
+CoplanarQuadMerger::Quad SceneUnderstandingRenderer::GetSceneQuad(const SceneObject& object)
+{
+    // The quad is centered on the origin of the object, in its x y plane.
+    const float4x4 objectToSceneTransform = GetLocationAsFloat4x4(object);
+    const float3 xAxis = {objectToSceneTransform.m11, objectToSceneTransform.m12, objectToSceneTransform.m13};
+    const float3 yAxis = {objectToSceneTransform.m21, objectToSceneTransform.m22, objectToSceneTransform.m23};
+    const float3 center = {objectToSceneTransform.m41, objectToSceneTransform.m42, objectToSceneTransform.m43};
+    const float3 xDirection = normalize(xAxis);
+    const float3 yDirection = normalize(yAxis);
+
+    CoplanarQuadMerger::Quad quad;
+    quad.group = static_cast<uint32_t>(object.GetKind());
+    quad.center[0] = center.x;
+    quad.center[1] = center.y;
+    quad.center[2] = center.z;
+    quad.xAxis[0] = xDirection.x;
+    quad.xAxis[1] = xDirection.y;
+    quad.xAxis[2] = xDirection.z;
+    quad.yAxis[0] = yDirection.x;
+    quad.yAxis[1] = yDirection.y;
+    quad.yAxis[2] = yDirection.z;
+    quad.width = object.GetQuad()->GetExtents().X * length(xAxis);
+    quad.height = object.GetQuad()->GetExtents().Y * length(yAxis);
+    return quad;
 }
 
-void SceneUnderstandingRenderer::AddSceneQuadLabelVertices(const SceneObject& object, const float3& color)
+std::vector<std::shared_ptr<const SceneUnderstandingRenderer::CachedSceneObject>> SceneUnderstandingRenderer::MergeSceneQuads(
+    const std::vector<std::shared_ptr<const CachedSceneObject>>& objects)
+{
+    std::vector<CoplanarQuadMerger::Quad> quads;
+    for (const std::shared_ptr<const CachedSceneObject>& object : objects)
+    {
+        if (object && object->hasQuad)
+        {
+            quads.push_back(object->quad);
+        }
+    }
+
+    CoplanarQuadMerger merger;
+    merger.Merge(quads.data(), static_cast<uint32_t>(quads.size()), CoplanarQuadMerger::Settings());
+
+    // Each cluster gets the color of its kind, and a hierarchy over its triangles for the queries, like the objects.
+    std::vector<std::shared_ptr<const CachedSceneObject>> clusters;
+    clusters.reserve(merger.GetClusters().size());
+    for (const CoplanarQuadMerger::Cluster& cluster : merger.GetClusters())
+    {
+        auto clusterObject = std::make_shared<CachedSceneObject>();
+        clusterObject->kind = static_cast<SceneObjectKind>(cluster.group);
+        auto [r, g, b] = m_sceneQuadsLabels.at(clusterObject->kind).color;
+        float3 color = {r / 255.0f, g / 255.0f, b / 255.0f};
+        AddSceneQuadsVertices(merger, cluster, color, clusterObject->geometry);
+        BuildSceneObjectHierarchy(*clusterObject);
+        clusters.push_back(std::move(clusterObject));
+    }
+    return clusters;
+}
+
+void SceneUnderstandingRenderer::AddSceneQuadsVertices(
+    const CoplanarQuadMerger& merger, const CoplanarQuadMerger::Cluster& cluster, const float3& color, SceneGeometry& geometry)
+{
+    const std::vector<CoplanarQuadMerger::Rect>& rects = merger.GetRects();
+    for (uint32_t i = cluster.firstRect; i < cluster.firstRect + cluster.rectCount; i++)
+    {
+        const CoplanarQuadMerger::Rect& rect = rects[i];
+        const float width = rect.max[0] - rect.min[0];
+        const float height = rect.max[1] - rect.min[1];
+        float3 positions[4];
+        CoplanarQuadMerger::GetPosition(cluster, rect.min[0], rect.min[1], &positions[0].x);
+        CoplanarQuadMerger::GetPosition(cluster, rect.max[0], rect.min[1], &positions[1].x);
+        CoplanarQuadMerger::GetPosition(cluster, rect.min[0], rect.max[1], &positions[2].x);
+        CoplanarQuadMerger::GetPosition(cluster, rect.max[0], rect.max[1], &positions[3].x);
+
+        // Create uv coordinates so that the checkerboard pattern becomes uniformly. They are the position in the frame of the cluster,
+        // whose origin is at a corner of its first quad, so a quad which is not merged with others looks the same as on its own.
+        float2 uvs[4] = {{rect.min[1], rect.min[0]}, {rect.min[1], rect.max[0]}, {rect.max[1], rect.min[0]}, {rect.max[1], rect.max[0]}};
+
+        AppendQuad(positions, uvs, height, width, color, geometry.quadVertices);
+    }
+}
+
+void SceneUnderstandingRenderer::AddSceneQuadLabelVertices(
+    const SceneObject& object, const float3& color, const LabelAtlasEntry& atlasEntry, SceneGeometry& geometry)
 {
     float4x4 objectToSceneTransform = GetLocationAsFloat4x4(object);
     const std::shared_ptr<SceneQuad> quad = object.GetQuad();
     // Create the quad's corner points in object space with a slight offset in the z-direction.
+    const float width = atlasEntry.quadSize.x;
+    const float height = atlasEntry.quadSize.y;
     float3 positions[4] = {
-        {-LabelQuadWidth / 2, -LabelQuadHeight / 2, 0.01f},
-        {LabelQuadWidth / 2, -LabelQuadHeight / 2, 0.01f},
-        {-LabelQuadWidth / 2, LabelQuadHeight / 2, 0.01f},
-        {LabelQuadWidth / 2, LabelQuadHeight / 2, 0.01f}};
+        {-width / 2, -height / 2, 0.01f}, {width / 2, -height / 2, 0.01f}, {-width / 2, height / 2, 0.01f}, {width / 2, height / 2, 0.01f}};
 
     // Transform the vertices to scene space.
-    for (int i = 0; i < 4; ++i)
-    {
-        positions[i] = transform(positions[i], objectToSceneTransform);
-    }
-    // Create uv coordinates.
-    float2 uvs[4] = {{0, 1}, {1, 1}, {0, 0}, {1, 0}};
+    PointTransform::TransformPoints(&objectToSceneTransform.m11, positions, sizeof(float3), positions, sizeof(float3), 4);
+    // Create uv coordinates of the label's name in the atlas.
+    const float2 topLeft = atlasEntry.uvTopLeft;
+    const float2 bottomRight = atlasEntry.uvBottomRight;
+    float2 uvs[4] = {{topLeft.x, bottomRight.y}, {bottomRight.x, bottomRight.y}, {topLeft.x, topLeft.y}, {bottomRight.x, topLeft.y}};
 
     // Create the vertices with uv coordinates for the quad labels.
-    AppendQuad(positions, uvs, LabelQuadHeight, LabelQuadWidth, color, m_quadLabelsVertices[object.GetKind()]);
+    AppendQuad(positions, uvs, height, width, color, geometry.labelVertices);
 }
 
-void SceneUnderstandingRenderer::AddSceneMeshVertices(const SceneObject& object, const float3& color)
+void SceneUnderstandingRenderer::AddSceneMeshVertices(
+    const float4x4& objectToSceneTransform, const std::vector<SceneMeshData>& meshes, const float3& color, SceneGeometry& geometry)
 {
-    float4x4 objectToSceneTransform = GetLocationAsFloat4x4(object);
-    for (const std::shared_ptr<SceneMesh> mesh : object.GetMeshes())
+    for (const SceneMeshData& mesh : meshes)
     {
-        const uint32_t indicesCount = mesh->GetTriangleIndexCount();
-        std::vector<uint32_t> indices(indicesCount);
-        mesh->GetTriangleIndices(indices);
-
-        // Get the mesh's vertices in object space.
-        uint32_t vertexCount = mesh->GetVertexCount();
-        std::vector<float3> vertices(vertexCount);
-        float3* ptr = vertices.data();
-        mesh->GetVertexPositions(ptr, vertexCount);
-
-        // Transform the vertices to scene space and create the triangles.
-        for (uint32_t i = 0; i < indices.size(); i += 3)
+        const uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        const uint32_t indicesCount = static_cast<uint32_t>(mesh.indices.size());
+
+        const uint32_t baseVertex = static_cast<uint32_t>(geometry.meshVertices.size());
+        geometry.meshVertices.resize(baseVertex + vertexCount);
+        VertexPositionUVColor* destVertices = geometry.meshVertices.data() + baseVertex;
+        const DirectX::XMFLOAT3 vertexColor = DXHelper::Float3ToXMFloat3(color);
+        for (uint32_t i = 0; i < vertexCount; i++)
         {
-            VertexPositionUVColor vertex;
-            vertex.color = DXHelper::Float3ToXMFloat3(color);
-            vertex.uv = {0, 0};
+            destVertices[i].uv = {0, 0};
+            destVertices[i].color = vertexColor;
+        }
+
+        // Transform the vertices to scene space, each one only once, straight into the positions of the rendering vertices. The triangles
+        // index the vertices of all meshes, so they are offset by the vertices of the previous meshes.
+        const size_t baseIndex = geometry.meshIndices.size();
+        geometry.meshIndices.resize(baseIndex + indicesCount);
+        SceneGeometryBuilder::AppendMesh(
+            &objectToSceneTransform.m11,
+            &mesh.vertices.data()->x,
+            vertexCount,
+            mesh.indices.data(),
+            indicesCount,
+            baseVertex,
+            &destVertices->pos.x,
+            sizeof(VertexPositionUVColor),
+            geometry.meshIndices.data() + baseIndex);
+    }
+}
 
-            vertex.pos = DXHelper::Float3ToXMFloat3(transform(vertices[indices[i]], objectToSceneTransform));
-            m_meshVertices.push_back(vertex);
+void SceneUnderstandingRenderer::MergeSceneGeometry(const std::vector<const SceneGeometry*>& parts, SceneGeometry& geometry)
+{
+    // The offsets of the parts in the merged collections are the sums of the sizes of the parts before them.
+    const size_t partCount = parts.size();
+    const std::vector<size_t> quadVerticesOffsets =
+        SceneGeometryBuilder::GetPartOffsets(parts, [](const SceneGeometry* part) { return part->quadVertices.size(); });
+    const std::vector<size_t> labelVerticesOffsets =
+        SceneGeometryBuilder::GetPartOffsets(parts, [](const SceneGeometry* part) { return part->labelVertices.size(); });
+    const std::vector<size_t> meshVerticesOffsets =
+        SceneGeometryBuilder::GetPartOffsets(parts, [](const SceneGeometry* part) { return part->meshVertices.size(); });
+    const std::vector<size_t> meshIndicesOffsets =
+        SceneGeometryBuilder::GetPartOffsets(parts, [](const SceneGeometry* part) { return part->meshIndices.size(); });
+
+    geometry.quadVertices.resize(quadVerticesOffsets[partCount]);
+    geometry.labelVertices.resize(labelVerticesOffsets[partCount]);
+    geometry.meshVertices.resize(meshVerticesOffsets[partCount]);
+    geometry.meshIndices.resize(meshIndicesOffsets[partCount]);
+
+    Concurrency::parallel_for(size_t(0), partCount, [&](size_t i) {
+        const SceneGeometry& part = *parts[i];
+        std::copy(part.quadVertices.begin(), part.quadVertices.end(), geometry.quadVertices.begin() + quadVerticesOffsets[i]);
+        std::copy(part.labelVertices.begin(), part.labelVertices.end(), geometry.labelVertices.begin() + labelVerticesOffsets[i]);
+        std::copy(part.meshVertices.begin(), part.meshVertices.end(), geometry.meshVertices.begin() + meshVerticesOffsets[i]);
+
+        SceneGeometryBuilder::OffsetIndices(
+            part.meshIndices.data(),
+            part.meshIndices.size(),
+            static_cast<uint32_t>(meshVerticesOffsets[i]),
+            geometry.meshIndices.data() + meshIndicesOffsets[i]);
+    });
+}
 
-            vertex.pos = DXHelper::Float3ToXMFloat3(transform(vertices[indices[i + 1]], objectToSceneTransform));
-            m_meshVertices.push_back(vertex);
+void SceneUnderstandingRenderer::PackSceneGeometry(const SceneGeometry& geometry, PackedSceneGeometry& packed)
+{
+    static_assert(sizeof(VertexPositionUVColor) == 8 * sizeof(float), "VertexPacking expects 8 floats per vertex");
+
+    float minimum[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float maximum[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    VertexPacking::ExtendBounds(
+        reinterpret_cast<const float*>(geometry.quadVertices.data()), geometry.quadVertices.size(), minimum, maximum);
+    VertexPacking::ExtendBounds(
+        reinterpret_cast<const float*>(geometry.labelVertices.data()), geometry.labelVertices.size(), minimum, maximum);
+    VertexPacking::ExtendBounds(
+        reinterpret_cast<const float*>(geometry.meshVertices.data()), geometry.meshVertices.size(), minimum, maximum);
+    packed.quantization = VertexPacking::GetQuantization(minimum, maximum);
+
+    // The mesh can have millions of vertices, so it is packed in blocks on several threads.
+    auto packVertices = [&quantization = packed.quantization](
+                            const std::vector<VertexPositionUVColor>& vertices, std::vector<PackedVertex>& packedVertices) {
+        packedVertices.resize(vertices.size());
+        const size_t blockCount = (vertices.size() + PackBlockSize - 1) / PackBlockSize;
+        Concurrency::parallel_for(size_t(0), blockCount, [&](size_t block) {
+            const size_t begin = block * PackBlockSize;
+            const size_t count = std::min(PackBlockSize, vertices.size() - begin);
+            VertexPacking::PackVertices(
+                reinterpret_cast<const float*>(vertices.data() + begin), count, quantization, packedVertices.data() + begin);
+        });
+    };
 
-            vertex.pos = DXHelper::Float3ToXMFloat3(transform(vertices[indices[i + 2]], objectToSceneTransform));
-            m_meshVertices.push_back(vertex);
-        }
-    }
+    packVertices(geometry.quadVertices, packed.quadVertices);
+    packVertices(geometry.labelVertices, packed.labelVertices);
+    packVertices(geometry.meshVertices, packed.meshVertices);
 }
 
 void SceneUnderstandingRenderer::ToggleRenderingType()
@@ -516,7 +925,7 @@ void SceneUnderstandingRenderer::ToggleRenderingType()
     m_renderingType = static_cast<RenderingType>((m_renderingType + 1) % RenderingType::Max);
 }
 
-void SceneUnderstandingRenderer::Render(bool isStereo)
+void SceneUnderstandingRenderer::Render(bool isStereo, const IReference<SpatialBoundingFrustum>& cullingFrustum)
 {
     // Loading is asynchronous. Resources must be created before drawing can occur.
     if (!m_loadingComplete)
@@ -524,19 +933,28 @@ void SceneUnderstandingRenderer::Render(bool isStereo)
         return;
     }
 
-    // Only render if the scene is not being updated and there is a valid scene to rendering transformation.
-    if (!m_verticesUpdating && m_validSceneToRenderingTransform)
+    // Only render if there is a geometry and a valid scene to rendering transformation for it. The geometry is the one Update() took for
+    // this frame, it stays valid while the next one is created.
+    if (m_frameGeometry && m_validSceneToRenderingTransform && m_renderingType != RenderingType::None)
     {
+        // Only the objects in the view are drawn.
+        const SceneRenderGeometry& geometry = *m_frameGeometry;
+        CullSceneObjects(geometry.spatialIndex, cullingFrustum);
+        if (m_visibleObjects.empty())
+        {
+            return;
+        }
+
         // For RenderingType::Mesh only render the scene mesh. In case of RenderingType::Quads only render the scene quads with labels. For
         // RenderingType::All render the scene mesh and the scene quads with labels.
         if (m_renderingType == RenderingType::Quads || m_renderingType == RenderingType::All)
         {
-            RenderSceneQuads(isStereo);
-            RenderSceneQuadsLabel(isStereo);
+            RenderSceneQuads(geometry, isStereo);
+            RenderSceneQuadsLabel(geometry, isStereo);
         }
         if (m_renderingType == RenderingType::Mesh || m_renderingType == RenderingType::All)
         {
-            RenderSceneMesh(isStereo);
+            RenderSceneMesh(geometry, isStereo);
         }
 
         // Disable the geometry shader.
@@ -544,10 +962,169 @@ void SceneUnderstandingRenderer::Render(bool isStereo)
     }
 }
 
-void SceneUnderstandingRenderer::RenderSceneQuads(bool isStereo)
+void SceneUnderstandingRenderer::CullSceneObjects(
+    const SceneSpatialIndex& spatialIndex, const IReference<SpatialBoundingFrustum>& cullingFrustum)
+{
+    if (!cullingFrustum)
+    {
+        m_visibleObjects.resize(spatialIndex.objects.size());
+        std::iota(m_visibleObjects.begin(), m_visibleObjects.end(), 0);
+        return;
+    }
+
+    // The frustum is in rendering space and the bounds are in scene space. A scene point p is outside of a plane if
+    // dot(plane, p * sceneToRendering) > 0, which is dot(sceneToRendering * plane, p) > 0, so the planes are transformed with the matrix
+    // instead of the bounds.
+    const SpatialBoundingFrustum frustum = cullingFrustum.Value();
+    const float4x4& m = m_sceneToRenderingTransform;
+    float planes[6][4];
+    uint32_t planeCount = 0;
+    for (const plane& renderingPlane : {frustum.Bottom, frustum.Far, frustum.Left, frustum.Near, frustum.Right, frustum.Top})
+    {
+        const float3& n = renderingPlane.normal;
+        const float d = renderingPlane.d;
+        float* scenePlane = planes[planeCount++];
+        scenePlane[0] = m.m11 * n.x + m.m12 * n.y + m.m13 * n.z + m.m14 * d;
+        scenePlane[1] = m.m21 * n.x + m.m22 * n.y + m.m23 * n.z + m.m24 * d;
+        scenePlane[2] = m.m31 * n.x + m.m32 * n.y + m.m33 * n.z + m.m34 * d;
+        scenePlane[3] = m.m41 * n.x + m.m42 * n.y + m.m43 * n.z + m.m44 * d;
+    }
+
+    m_visibleObjects.clear();
+    spatialIndex.objectHierarchy.QueryPlanes(planes, planeCount, [&](uint32_t object) { m_visibleObjects.push_back(object); });
+
+    // The hierarchy visits the objects in its own order, the draw calls need them in the order of their geometry.
+    std::sort(m_visibleObjects.begin(), m_visibleObjects.end());
+}
+
+bool SceneUnderstandingRenderer::Raycast(
+    const float3& origin,
+    const float3& direction,
+    float maxDistance,
+    SceneSurfaceHit& hit,
+    std::initializer_list<SceneObjectKind> kinds) const
+{
+    if (!m_frameGeometry || !m_validSceneToRenderingTransform)
+    {
+        return false;
+    }
+
+    // The hierarchies are in scene space. It only differs from rendering space by a rigid transform, so the distances are the same.
+    const float3 sceneOrigin = transform(origin, m_renderingToSceneTransform);
+    const float3 sceneDirection = transform_normal(direction, m_renderingToSceneTransform);
+    const SceneSpatialIndex& spatialIndex = m_frameGeometry->spatialIndex;
+
+    // The objects are tested nearest first, and each one only down to the closest hit so far.
+    float distance = maxDistance;
+    const CachedSceneObject* hitObject = nullptr;
+    uint32_t hitTriangle = 0;
+    spatialIndex.objectHierarchy.Raycast(&sceneOrigin.x, &sceneDirection.x, distance, [&](uint32_t objectIndex, float& objectDistance) {
+        const CachedSceneObject& object = *spatialIndex.objects[objectIndex];
+        if (!IsKindIncluded(object.kind, kinds))
+        {
+            return false;
+        }
+        return object.triangleHierarchy.Raycast(
+            &sceneOrigin.x, &sceneDirection.x, objectDistance, [&](uint32_t triangle, float& triangleDistance) {
+                float3 positions[3];
+                GetSceneObjectTriangle(object, triangle, positions);
+                if (!BoundingVolumeHierarchy::IntersectTriangle(
+                        &sceneOrigin.x, &sceneDirection.x, &positions[0].x, &positions[1].x, &positions[2].x, triangleDistance))
+                {
+                    return false;
+                }
+                hitObject = &object;
+                hitTriangle = triangle;
+                return true;
+            });
+    });
+    if (!hitObject)
+    {
+        return false;
+    }
+
+    SetSurfaceHit(*hitObject, hitTriangle, sceneOrigin + sceneDirection * distance, sceneOrigin, distance, hit);
+    return true;
+}
+
+bool SceneUnderstandingRenderer::FindNearestSurface(
+    const float3& point, float maxDistance, SceneSurfaceHit& hit, std::initializer_list<SceneObjectKind> kinds) const
+{
+    if (!m_frameGeometry || !m_validSceneToRenderingTransform)
+    {
+        return false;
+    }
+
+    const float3 scenePoint = transform(point, m_renderingToSceneTransform);
+    const SceneSpatialIndex& spatialIndex = m_frameGeometry->spatialIndex;
+
+    float distance = maxDistance;
+    const CachedSceneObject* nearestObject = nullptr;
+    uint32_t nearestTriangle = 0;
+    float3 nearestPosition;
+    spatialIndex.objectHierarchy.FindNearest(&scenePoint.x, distance, [&](uint32_t objectIndex, float& objectDistance) {
+        const CachedSceneObject& object = *spatialIndex.objects[objectIndex];
+        if (!IsKindIncluded(object.kind, kinds))
+        {
+            return false;
+        }
+        return object.triangleHierarchy.FindNearest(&scenePoint.x, objectDistance, [&](uint32_t triangle, float& triangleDistance) {
+            float3 positions[3];
+            GetSceneObjectTriangle(object, triangle, positions);
+            float3 position;
+            BoundingVolumeHierarchy::ClosestPointOnTriangle(&scenePoint.x, &positions[0].x, &positions[1].x, &positions[2].x, &position.x);
+            const float positionDistance = length(position - scenePoint);
+            if (positionDistance >= triangleDistance)
+            {
+                return false;
+            }
+            triangleDistance = positionDistance;
+            nearestObject = &object;
+            nearestTriangle = triangle;
+            nearestPosition = position;
+            return true;
+        });
+    });
+    if (!nearestObject)
+    {
+        return false;
+    }
+
+    SetSurfaceHit(*nearestObject, nearestTriangle, nearestPosition, scenePoint, distance, hit);
+    return true;
+}
+
+void SceneUnderstandingRenderer::SetSurfaceHit(
+    const CachedSceneObject& object,
+    uint32_t triangle,
+    const float3& scenePosition,
+    const float3& sceneViewpoint,
+    float distance,
+    SceneSurfaceHit& hit) const
+{
+    float3 positions[3];
+    GetSceneObjectTriangle(object, triangle, positions);
+    float3 normal = cross(positions[1] - positions[0], positions[2] - positions[0]);
+    if (length_squared(normal) == 0.0f)
+    {
+        // A degenerate triangle, which only the nearest point can be on.
+        normal = sceneViewpoint - scenePosition;
+    }
+    if (dot(normal, sceneViewpoint - positions[0]) < 0.0f)
+    {
+        normal = -normal;
+    }
+
+    hit.position = transform(scenePosition, m_sceneToRenderingTransform);
+    hit.normal = normalize(transform_normal(normal, m_sceneToRenderingTransform));
+    hit.distance = distance;
+    hit.kind = object.kind;
+}
+
+void SceneUnderstandingRenderer::RenderSceneQuads(const SceneRenderGeometry& geometry, bool isStereo)
 {
     // Only render if vertices are available.
-    if (m_quadVertices.empty())
+    if (geometry.quadVertexCount == 0)
     {
         return;
     }
@@ -561,6 +1138,8 @@ void SceneUnderstandingRenderer::RenderSceneQuads(bool isStereo)
         // Apply the model constant buffer to the vertex shader.
         ID3D11Buffer* modelBuffer = m_modelConstantBuffer.get();
         context->VSSetConstantBuffers(0, 1, &modelBuffer);
+        ID3D11Buffer* quantizationBuffer = geometry.quantizationConstantBuffer.get();
+        context->VSSetConstantBuffers(2, 1, &quantizationBuffer);
 
         context->GSSetShader(m_geometryShader.get(), nullptr, 0);
 
@@ -570,17 +1149,29 @@ void SceneUnderstandingRenderer::RenderSceneQuads(bool isStereo)
 
         context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-        const UINT stride = sizeof(VertexPositionUVColor);
+        const UINT stride = sizeof(PackedVertex);
         const UINT offset = 0;
-        ID3D11Buffer* pBuffer = m_quadVerticesBuffer.get();
+        ID3D11Buffer* pBuffer = geometry.quadVerticesBuffer.Get().get();
         context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
 
-        context->DrawInstanced(static_cast<UINT>(m_quadVertices.size()), isStereo ? 2 : 1, offset, 0);
+        DrawRuns(
+            m_visibleObjects,
+            [&](uint32_t object) {
+                const SceneObjectRange& range = geometry.spatialIndex.ranges[object];
+                return std::pair(range.quadFirstVertex, range.quadVertexCount);
+            },
+            [&](UINT first, UINT count) { context->DrawInstanced(count, isStereo ? 2 : 1, first, 0); });
     });
 }
 
-void SceneUnderstandingRenderer::RenderSceneQuadsLabel(bool isStereo)
+void SceneUnderstandingRenderer::RenderSceneQuadsLabel(const SceneRenderGeometry& geometry, bool isStereo)
 {
+    // Only render if vertices are available.
+    if (geometry.labelVertexCount == 0)
+    {
+        return;
+    }
+
     // Use the D3D device context to update Direct3D device-based resources.
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
         context->OMSetBlendState(m_blendState.get(), nullptr, 0xffffffff);
@@ -590,6 +1181,8 @@ void SceneUnderstandingRenderer::RenderSceneQuadsLabel(bool isStereo)
         context->VSSetShader(m_vertexShader.get(), nullptr, 0);
         ID3D11Buffer* modelBuffer = m_modelConstantBuffer.get();
         context->VSSetConstantBuffers(0, 1, &modelBuffer);
+        ID3D11Buffer* quantizationBuffer = geometry.quantizationConstantBuffer.get();
+        context->VSSetConstantBuffers(2, 1, &quantizationBuffer);
 
         context->GSSetShader(m_geometryShader.get(), nullptr, 0);
 
@@ -600,37 +1193,33 @@ void SceneUnderstandingRenderer::RenderSceneQuadsLabel(bool isStereo)
 
         context->RSSetState(m_rasterizerState.get());
 
-        // Render all quad labels with the same SceneObjectKind with a single draw call.
-        for (auto const& [kind, vertices] : m_quadLabelsVertices)
-        {
-            // Only render if vertices are available.
-            if (vertices.empty())
-            {
-                continue;
-            }
-
-            context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-            const UINT stride = sizeof(VertexPositionUVColor);
-            const UINT offset = 0;
-            ID3D11Buffer* pBuffer = m_quadLabelsVerticesBuffer[kind].get();
-            context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
+        const UINT stride = sizeof(PackedVertex);
+        const UINT offset = 0;
+        ID3D11Buffer* pBuffer = geometry.labelVerticesBuffer.Get().get();
+        context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
 
-            // Set the text label texture which contains the label name.
-            ID3D11ShaderResourceView* pShaderViewToSet = m_textShaderResourceViews[kind].get();
-            context->PSSetShaderResources(0, 1, &pShaderViewToSet);
+        // Set the label atlas, which contains the names of all labels, so that the labels of all kinds are rendered together.
+        ID3D11ShaderResourceView* pShaderViewToSet = m_labelAtlasShaderResourceView.get();
+        context->PSSetShaderResources(0, 1, &pShaderViewToSet);
 
-            context->DrawInstanced(static_cast<UINT>(vertices.size()), isStereo ? 2 : 1, offset, 0);
-        }
+        DrawRuns(
+            m_visibleObjects,
+            [&](uint32_t object) {
+                const SceneObjectRange& range = geometry.spatialIndex.ranges[object];
+                return std::pair(range.labelFirstVertex, range.labelVertexCount);
+            },
+            [&](UINT first, UINT count) { context->DrawInstanced(count, isStereo ? 2 : 1, first, 0); });
 
         context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
     });
 }
 
-void SceneUnderstandingRenderer::RenderSceneMesh(bool isStereo)
+void SceneUnderstandingRenderer::RenderSceneMesh(const SceneRenderGeometry& geometry, bool isStereo)
 {
-    // Only render if vertices are available.
-    if (m_meshVertices.empty())
+    // Only render if triangles are available.
+    if (geometry.meshIndexCount == 0)
     {
         return;
     }
@@ -644,6 +1233,8 @@ void SceneUnderstandingRenderer::RenderSceneMesh(bool isStereo)
         context->VSSetShader(m_vertexShader.get(), nullptr, 0);
         ID3D11Buffer* modelBuffer = m_modelConstantBuffer.get();
         context->VSSetConstantBuffers(0, 1, &modelBuffer);
+        ID3D11Buffer* quantizationBuffer = geometry.quantizationConstantBuffer.get();
+        context->VSSetConstantBuffers(2, 1, &quantizationBuffer);
 
         context->GSSetShader(m_geometryShader.get(), nullptr, 0);
 
@@ -653,12 +1244,19 @@ void SceneUnderstandingRenderer::RenderSceneMesh(bool isStereo)
 
         context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-        const UINT stride = sizeof(VertexPositionUVColor);
+        const UINT stride = sizeof(PackedVertex);
         const UINT offset = 0;
-        ID3D11Buffer* pBuffer = m_meshVerticesBuffer.get();
+        ID3D11Buffer* pBuffer = geometry.meshVerticesBuffer.Get().get();
         context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
+        context->IASetIndexBuffer(geometry.meshIndicesBuffer.Get().get(), DXGI_FORMAT_R32_UINT, 0);
 
-        context->DrawInstanced(static_cast<UINT>(m_meshVertices.size()), isStereo ? 2 : 1, offset, 0);
+        DrawRuns(
+            m_visibleObjects,
+            [&](uint32_t object) {
+                const SceneObjectRange& range = geometry.spatialIndex.ranges[object];
+                return std::pair(range.meshFirstIndex, range.meshIndexCount);
+            },
+            [&](UINT first, UINT count) { context->DrawIndexedInstanced(count, isStereo ? 2 : 1, first, 0, 0); });
 
         context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
     });
@@ -703,10 +1301,6 @@ void SceneUnderstandingRenderer::AppendQuad(
 
 void SceneUnderstandingRenderer::Reset()
 {
-    std::lock_guard lock(m_mutex);
-
-    m_scene = nullptr;
-    m_sceneLastUpdateLocation = nullptr;
-    m_verticesOutdated = false;
-    m_verticesUpdating = false;
+    // Clears the scene and the geometry, and leaves a running update stale, so that it doesn't publish its vertices anymore.
+    m_geometryPublisher.Reset([this] { m_objectCache.store(nullptr); });
 }
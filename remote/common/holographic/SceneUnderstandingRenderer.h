@@ -14,7 +14,15 @@
 #include <future>
 #include <string>
 
+#include <AsyncUpdatePublisher.h>
+#include <BoundingVolumeHierarchy.h>
+#include <BufferPool.h>
+#include <CoplanarQuadMerger.h>
 #include <DeviceResourcesD3D11.h>
+#include <SceneObjectCache.h>
+#include <SkylinePacker.h>
+#include <Utils.h>
+#include <VertexPacking.h>
 
 #include <Microsoft.MixedReality.SceneUnderstanding.h>
 #include <winrt/Windows.Perception.Spatial.h>
@@ -35,12 +43,60 @@ public:
 
     void Update(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
 
-    void Render(bool isStereo);
+    void Render(
+        bool isStereo,
+        const winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum>& cullingFrustum);
 
     void ToggleRenderingType();
 
     void Reset();
 
+    // A point on the quads or meshes of the scene, in the rendering coordinate system of the last Update().
+    struct SceneSurfaceHit
+    {
+        winrt::Windows::Foundation::Numerics::float3 position;
+        // The normal of the triangle, on the side of the ray origin or the query point.
+        winrt::Windows::Foundation::Numerics::float3 normal;
+        float distance = 0.0f;
+        Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind kind;
+    };
+
+    // Casts a ray against the quads and meshes of the rendered scene, e.g. to place a hologram on a wall or the floor along the gaze or a
+    // hand ray. The ray is in the rendering coordinate system of the last Update(), its direction normalized. Only objects of the kinds
+    // are hit, or any object if there are none. Must be called on the render thread, like Update().
+    bool Raycast(
+        const winrt::Windows::Foundation::Numerics::float3& origin,
+        const winrt::Windows::Foundation::Numerics::float3& direction,
+        float maxDistance,
+        SceneSurfaceHit& hit,
+        std::initializer_list<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind> kinds = {}) const;
+
+    // Finds the point on the quads and meshes of the rendered scene which is closest to the point, if it is less than maxDistance away.
+    bool FindNearestSurface(
+        const winrt::Windows::Foundation::Numerics::float3& point,
+        float maxDistance,
+        SceneSurfaceHit& hit,
+        std::initializer_list<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind> kinds = {}) const;
+
+    // Scene objects whose geometry was taken over from the previous scene, and the ones which were new or changed, over all updates.
+    uint64_t GetReusedObjectCount() const
+    {
+        return m_reusedObjectCount;
+    }
+
+    uint64_t GetRebuiltObjectCount() const
+    {
+        return m_rebuiltObjectCount;
+    }
+
+    using BufferPoolD3D11 = BufferPool<winrt::com_ptr<ID3D11Buffer>>;
+
+    // The vertex and index buffers created, reused and destroyed by the updates.
+    BufferPoolD3D11::Statistics GetBufferPoolStatistics() const
+    {
+        return m_bufferPool->GetStatistics();
+    }
+
 private:
     struct VertexPositionUVColor
     {
@@ -58,22 +114,195 @@ private:
         Max
     };
 
+    // The name of a label in the label atlas.
+    struct LabelAtlasEntry
+    {
+        winrt::com_ptr<IDWriteTextLayout> layout;
+        SkylinePacker::Rect rect;
+        // The texture coordinates of the top left and the bottom right corner of the rect.
+        winrt::Windows::Foundation::Numerics::float2 uvTopLeft;
+        winrt::Windows::Foundation::Numerics::float2 uvBottomRight;
+        // The size of the label quads in rendering space.
+        winrt::Windows::Foundation::Numerics::float2 quadSize;
+    };
+
+    // The geometry of (a part of) the scene, built on worker threads and then uploaded to the GPU.
+    struct SceneGeometry
+    {
+        std::vector<VertexPositionUVColor> quadVertices;
+        // The labels of all kinds, with texture coordinates into the label atlas.
+        std::vector<VertexPositionUVColor> labelVertices;
+        std::vector<VertexPositionUVColor> meshVertices;
+        std::vector<uint32_t> meshIndices;
+    };
+
+    // The geometry of a scene object. The mesh indices start at the object's first mesh vertex. The bounds include the label, the
+    // hierarchy is over the triangles of the quads and then of the mesh.
+    //
+    // The quad of a scene object is not part of its geometry, it is merged with the coplanar quads of the other objects of the same kind
+    // into clusters for each scene. The clusters are scene objects of their own, with only quads, which are not cached.
+    struct CachedSceneObject
+    {
+        Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind kind;
+        SceneGeometry geometry;
+        // The quad of the object in scene space, with the kind as its group.
+        bool hasQuad = false;
+        CoplanarQuadMerger::Quad quad;
+        BoundingVolumeHierarchy::Bounds bounds;
+        BoundingVolumeHierarchy triangleHierarchy;
+    };
+
+    // Where the geometry of a scene object is in the vertex and index buffers of the scene.
+    struct SceneObjectRange
+    {
+        UINT quadFirstVertex = 0;
+        UINT quadVertexCount = 0;
+        UINT labelFirstVertex = 0;
+        UINT labelVertexCount = 0;
+        UINT meshFirstIndex = 0;
+        UINT meshIndexCount = 0;
+    };
+
+    // The objects of a scene, in the order of their geometry in the buffers, and a hierarchy over their bounds. The hierarchies over the
+    // triangles of the objects are cached with their geometry, so only this one and the ones of the quad clusters are rebuilt for the
+    // objects which didn't change.
+    struct SceneSpatialIndex
+    {
+        std::vector<std::shared_ptr<const CachedSceneObject>> objects;
+        std::vector<SceneObjectRange> ranges;
+        BoundingVolumeHierarchy objectHierarchy;
+    };
+
+    // The geometry of the objects of the last scene by their id, with the hash of everything it was created from. The entries are shared
+    // with the updates which found the objects unchanged.
+    using ObjectGeometryCache =
+        SceneObjectCache<GUID, Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, CachedSceneObject, Utils::GUIDHasher>;
+
+    // A mesh of a scene object in object space.
+    struct SceneMeshData
+    {
+        std::vector<winrt::Windows::Foundation::Numerics::float3> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // A scene as set by SetScene(). Each call creates a new one, so that the updates can tell the scenes apart by the pointer.
+    struct SceneSource
+    {
+        std::shared_ptr<Microsoft::MixedReality::SceneUnderstanding::Scene> scene;
+        winrt::Windows::Perception::Spatial::SpatialStationaryFrameOfReference lastUpdateLocation = nullptr;
+    };
+
+    // The GPU resources of a scene. They are created on a background thread and never changed once published, so the render thread uses
+    // them without a lock while the next ones are created. They don't keep the scene alive, so that the render thread is cheap to be the
+    // last owner.
+    struct SceneRenderGeometry
+    {
+        // The spatial graph node of the scene origin, which the positions are relative to.
+        winrt::guid originNodeId;
+        // The quantization of the positions of the vertex buffers.
+        winrt::com_ptr<ID3D11Buffer> quantizationConstantBuffer;
+        // The buffers go back to the pool when the geometry is released.
+        BufferPoolD3D11::Lease quadVerticesBuffer;
+        UINT quadVertexCount = 0;
+        BufferPoolD3D11::Lease labelVerticesBuffer;
+        UINT labelVertexCount = 0;
+        BufferPoolD3D11::Lease meshVerticesBuffer;
+        BufferPoolD3D11::Lease meshIndicesBuffer;
+        UINT meshIndexCount = 0;
+        // For culling and queries.
+        SceneSpatialIndex spatialIndex;
+    };
+
+    // Measures the label names and packs them into the label atlas.
+    void CreateLabelAtlasLayout();
+
+    // Returns a buffer of the pool with the data in front. Uploads it in chunks, so that the render thread waits for the device context
+    // at most one chunk at a time.
+    BufferPoolD3D11::Lease UploadBuffer(UINT bindFlags, const void* data, UINT size);
+
     winrt::fire_and_forget CreateVerticesAsync(
-        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem,
-        winrt::Windows::Perception::Spatial::SpatialStationaryFrameOfReference lastUpdateLocation);
+        uint32_t updateId,
+        std::shared_ptr<const SceneSource> source,
+        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
+
+    // Returns the geometry of the object from previousCache if it has the same kind and geometry there, otherwise creates it and sets
+    // rebuilt. Returns nullptr for objects which are not rendered. Sets geometryHash to the hash of everything the geometry is created
+    // from.
+    std::shared_ptr<const CachedSceneObject> GetSceneObjectGeometry(
+        const Microsoft::MixedReality::SceneUnderstanding::SceneObject& object,
+        const ObjectGeometryCache* previousCache,
+        uint64_t& geometryHash,
+        bool& rebuilt) const;
+
+    // Sets the bounds of the object and builds the hierarchy over its triangles.
+    static void BuildSceneObjectHierarchy(CachedSceneObject& object);
+
+    // Returns the positions of a triangle of the hierarchy of the object.
+    static void GetSceneObjectTriangle(
+        const CachedSceneObject& object, uint32_t triangle, winrt::Windows::Foundation::Numerics::float3 positions[3]);
+
+    // Returns the quad of the object in scene space.
+    static CoplanarQuadMerger::Quad GetSceneQuad(const Microsoft::MixedReality::SceneUnderstanding::SceneObject& object);
+
+    // Merges the quads of the objects into a scene object for each cluster of coplanar quads of the same kind.
+    static std::vector<std::shared_ptr<const CachedSceneObject>> MergeSceneQuads(
+        const std::vector<std::shared_ptr<const CachedSceneObject>>& objects);
+
+    // Adds the rectangles of the cluster, with texture coordinates in the frame of the cluster, so that the checkerboard pattern continues
+    // from one rectangle to the next.
+    static void AddSceneQuadsVertices(
+        const CoplanarQuadMerger& merger,
+        const CoplanarQuadMerger::Cluster& cluster,
+        const winrt::Windows::Foundation::Numerics::float3& color,
+        SceneGeometry& geometry);
 
-    void AddSceneQuadsVertices(
-        const Microsoft::MixedReality::SceneUnderstanding::SceneObject& object, const winrt::Windows::Foundation::Numerics::float3& color);
+    static void AddSceneQuadLabelVertices(
+        const Microsoft::MixedReality::SceneUnderstanding::SceneObject& object,
+        const winrt::Windows::Foundation::Numerics::float3& color,
+        const LabelAtlasEntry& atlasEntry,
+        SceneGeometry& geometry);
 
-    void AddSceneQuadLabelVertices(
-        const Microsoft::MixedReality::SceneUnderstanding::SceneObject& object, const winrt::Windows::Foundation::Numerics::float3& color);
+    static void AddSceneMeshVertices(
+        const winrt::Windows::Foundation::Numerics::float4x4& objectToSceneTransform,
+        const std::vector<SceneMeshData>& meshes,
+        const winrt::Windows::Foundation::Numerics::float3& color,
+        SceneGeometry& geometry);
 
-    void AddSceneMeshVertices(
-        const Microsoft::MixedReality::SceneUnderstanding::SceneObject& object, const winrt::Windows::Foundation::Numerics::float3& color);
+    using PackedVertex = VertexPacking::PackedVertex;
 
-    void RenderSceneMesh(bool isStereo);
-    void RenderSceneQuads(bool isStereo);
-    void RenderSceneQuadsLabel(bool isStereo);
+    // The geometry of the scene as it is uploaded to the GPU.
+    struct PackedSceneGeometry
+    {
+        VertexPacking::Quantization quantization;
+        std::vector<PackedVertex> quadVertices;
+        std::vector<PackedVertex> labelVertices;
+        std::vector<PackedVertex> meshVertices;
+        std::vector<uint32_t> meshIndices;
+    };
+
+    // Concatenates the geometry of the parts in their order, offsetting the mesh indices of each part by the mesh vertices before it.
+    static void MergeSceneGeometry(const std::vector<const SceneGeometry*>& parts, SceneGeometry& geometry);
+
+    // Packs the vertices with positions relative to the bounds of all of them, except for the mesh indices, which stay the same.
+    static void PackSceneGeometry(const SceneGeometry& geometry, PackedSceneGeometry& packed);
+
+    // Fills in the hit on the triangle of the object, with the normal on the side of the viewpoint. The positions are in scene space.
+    void SetSurfaceHit(
+        const CachedSceneObject& object,
+        uint32_t triangle,
+        const winrt::Windows::Foundation::Numerics::float3& scenePosition,
+        const winrt::Windows::Foundation::Numerics::float3& sceneViewpoint,
+        float distance,
+        SceneSurfaceHit& hit) const;
+
+    // Collects the objects whose bounds intersect the culling frustum into m_visibleObjects, in the order of their geometry.
+    void CullSceneObjects(
+        const SceneSpatialIndex& spatialIndex,
+        const winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum>& cullingFrustum);
+
+    void RenderSceneMesh(const SceneRenderGeometry& geometry, bool isStereo);
+    void RenderSceneQuads(const SceneRenderGeometry& geometry, bool isStereo);
+    void RenderSceneQuadsLabel(const SceneRenderGeometry& geometry, bool isStereo);
 
     static void AppendQuad(
         const winrt::Windows::Foundation::Numerics::float3 positions[4],
@@ -86,22 +315,10 @@ private:
     // The current renderingType.
     RenderingType m_renderingType = RenderingType::None;
 
-    // The vertices for all scene quads.
-    std::vector<VertexPositionUVColor> m_quadVertices;
-
-    // The vertices for the same SceneObjectKind are stored in the same collection.
-    std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, std::vector<VertexPositionUVColor>> m_quadLabelsVertices;
-
-    // The vertices for the scene mesh.
-    std::vector<VertexPositionUVColor> m_meshVertices;
-
     // Cached pointer to device resources.
     std::shared_ptr<DXHelper::DeviceResourcesD3D11> m_deviceResources;
 
     // Direct3D resources.
-    winrt::com_ptr<ID3D11Buffer> m_quadVerticesBuffer;
-    std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11Buffer>> m_quadLabelsVerticesBuffer;
-    winrt::com_ptr<ID3D11Buffer> m_meshVerticesBuffer;
     winrt::com_ptr<ID3D11InputLayout> m_inputLayout = nullptr;
     winrt::com_ptr<ID3D11VertexShader> m_vertexShader = nullptr;
     winrt::com_ptr<ID3D11GeometryShader> m_geometryShader = nullptr;
@@ -112,34 +329,45 @@ private:
 
     // True if the model constant buffer up to date.
     bool m_validSceneToRenderingTransform = false;
+    // The transform of the model constant buffer and its inverse.
+    winrt::Windows::Foundation::Numerics::float4x4 m_sceneToRenderingTransform;
+    winrt::Windows::Foundation::Numerics::float4x4 m_renderingToSceneTransform;
+
+    // The objects to render in the current view.
+    std::vector<uint32_t> m_visibleObjects;
 
     // Variables used with the rendering loop.
     std::atomic<bool> m_loadingComplete = false;
 
-    // The scene understanding scene.
-    std::shared_ptr<Microsoft::MixedReality::SceneUnderstanding::Scene> m_scene = nullptr;
-    winrt::Windows::Perception::Spatial::SpatialStationaryFrameOfReference m_sceneLastUpdateLocation = nullptr;
-    // True if the scene was updated but the vertices for the rendering are not created yet.
-    bool m_verticesOutdated = false;
-    // True if the scene was updated and the vertices are currently asynchronously updated.
-    bool m_verticesUpdating = false;
-    // Mutex to prevent the scene from updating while the vertices are still updating.
-    std::mutex m_mutex;
+    // The scene set by SetScene(), and the GPU resources created for it in the background, which the render thread takes without a lock.
+    AsyncUpdatePublisher<SceneSource, SceneRenderGeometry> m_geometryPublisher;
+    // The GPU resources the render thread uses for the current frame.
+    std::shared_ptr<const SceneRenderGeometry> m_frameGeometry;
+    // The geometry of the objects of the last scene the vertices were created for. Only changed along with publishing the vertices.
+    std::atomic<std::shared_ptr<const ObjectGeometryCache>> m_objectCache;
+
+    std::atomic<uint64_t> m_reusedObjectCount = 0;
+    std::atomic<uint64_t> m_rebuiltObjectCount = 0;
+    // Recycles the vertex and index buffers of the updates.
+    std::shared_ptr<BufferPoolD3D11> m_bufferPool;
+
+    // The labels of all kinds in one texture. The layout is created once and never changes, so the updates read it without a lock.
+    std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, LabelAtlasEntry> m_labelAtlasEntries;
+    uint32_t m_labelAtlasHeight = 0;
 
     // DirectX resources for text rendering.
-    std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11Texture2D>> m_textTextures;
-    std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11ShaderResourceView>>
-        m_textShaderResourceViews;
-    std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11RenderTargetView>> m_textRenderTargets;
-    std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID2D1RenderTarget>> m_d2dTextRenderTargets;
-    std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID2D1SolidColorBrush>> m_brushes;
-    std::map<Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<IDWriteTextLayout>> m_layouts;
+    winrt::com_ptr<ID3D11Texture2D> m_labelAtlasTexture;
+    winrt::com_ptr<ID3D11ShaderResourceView> m_labelAtlasShaderResourceView;
+    winrt::com_ptr<ID3D11RenderTargetView> m_labelAtlasRenderTarget;
+    winrt::com_ptr<ID2D1RenderTarget> m_d2dLabelAtlasRenderTarget;
+    winrt::com_ptr<ID2D1SolidColorBrush> m_brush;
 
     winrt::com_ptr<IDWriteTextFormat> m_textFormat = nullptr;
     winrt::com_ptr<ID3D11SamplerState> m_textSamplerState = nullptr;
     winrt::com_ptr<ID3D11PixelShader> m_labelPixelShader = nullptr;
     winrt::com_ptr<ID3D11BlendState> m_blendState = nullptr;
 
-    // The spatial coordinate system.
+    // The spatial coordinate system of the origin of the rendered geometry.
     winrt::Windows::Perception::Spatial::SpatialCoordinateSystem m_coordinateSystem = nullptr;
+    winrt::guid m_coordinateSystemNodeId;
 };
@@ -17,6 +17,8 @@
 #include <holographic/FrustumCulling.h>
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
 #include <sstream>
 
 #include <winrt/Windows.Devices.Haptics.h>
@@ -27,23 +29,160 @@
 
 using namespace winrt::Windows::Perception::Spatial;
 
+namespace
+{
+    // Enough for two tracked hands with controllers, the arena grows if a frame needs more.
+    constexpr size_t FrameArenaCapacity = 64 * 1024;
+
+    // Triangles of the visualization of a joint.
+    constexpr size_t JointTriangleCount = 8;
+
+    // A vertex of the prototype joint mesh (see Joint_VertexShader.hlsl).
+    struct JointPrototypeVertex
+    {
+        DirectX::XMFLOAT4 pos;
+        DirectX::XMFLOAT3 color;
+    };
+
+    // The joint is a double pyramid from its position along -z, with four vertices around its center at the radius.
+    std::array<JointPrototypeVertex, 3 * JointTriangleCount> GetJointPrototypeVertices()
+    {
+        using namespace DirectX;
+
+        const XMFLOAT4 basePosition(0.0f, 0.0f, 0.0f, 0.0f);
+        const XMFLOAT4 centerPositions[4] = {
+            XMFLOAT4(-1.0f, -1.0f, 1.0f, 0.0f),
+            XMFLOAT4(-1.0f, +1.0f, 1.0f, 0.0f),
+            XMFLOAT4(+1.0f, +1.0f, 1.0f, 0.0f),
+            XMFLOAT4(+1.0f, -1.0f, 1.0f, 0.0f),
+        };
+        const XMFLOAT4 topPosition(0.0f, 0.0f, 0.0f, 1.0f);
+        const XMFLOAT3 colors[4] = {
+            XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 0.0f)};
+
+        std::array<JointPrototypeVertex, 3 * JointTriangleCount> vertices;
+        for (int i = 0; i < 4; i++)
+        {
+            const XMFLOAT4& center0 = centerPositions[i];
+            const XMFLOAT4& center1 = centerPositions[(i + 1) % 4];
+            const XMFLOAT3 baseColor(colors[i].x * 0.4f, colors[i].y * 0.4f, colors[i].z * 0.4f);
+            const XMFLOAT3 topColor(colors[i].x * 0.6f, colors[i].y * 0.6f, colors[i].z * 0.6f);
+
+            JointPrototypeVertex* baseTriangle = &vertices[3 * i];
+            baseTriangle[0] = {basePosition, baseColor};
+            baseTriangle[1] = {center0, baseColor};
+            baseTriangle[2] = {center1, baseColor};
+
+            JointPrototypeVertex* topTriangle = &vertices[3 * (4 + i)];
+            topTriangle[0] = {topPosition, topColor};
+            topTriangle[1] = {center1, topColor};
+            topTriangle[2] = {center0, topColor};
+        }
+        return vertices;
+    }
+} // namespace
+
 SpatialInputRenderer::SpatialInputRenderer(
     const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources,
     winrt::Windows::UI::Input::Spatial::SpatialInteractionManager interactionManager)
     : RenderableObject(deviceResources)
     , m_interactionManager(interactionManager)
+    , m_frameArena(FrameArenaCapacity)
 {
     m_referenceFrame = winrt::Windows::Perception::Spatial::SpatialLocator::GetDefault().CreateAttachedFrameOfReferenceAtCurrentHeading();
+
+    // The constructor of RenderableObject only creates its own resources.
+    CreateJointResources();
+}
+
+void SpatialInputRenderer::CreateDeviceDependentResources()
+{
+    RenderableObject::CreateDeviceDependentResources();
+    CreateJointResources();
+}
+
+void SpatialInputRenderer::ReleaseDeviceDependentResources()
+{
+    RenderableObject::ReleaseDeviceDependentResources();
+
+    m_jointVertexShader = nullptr;
+    for (int i = 0; i < 2; i++)
+    {
+        m_jointInputLayouts[i] = nullptr;
+        m_jointConstantBuffers[i] = nullptr;
+    }
+    m_jointPrototypeBuffer = nullptr;
+    m_jointInstanceBuffer = nullptr;
+    m_jointInstanceCapacity = 0;
+}
+
+void SpatialInputRenderer::CreateJointResources()
+{
+    auto device = m_deviceResources->GetD3DDevice();
+
+    // Like the shaders of RenderableObject, the VPRT variant sets the render target array index without a geometry shader.
+    std::wstring vertexShaderFileName =
+        m_deviceResources->GetDeviceSupportsVprt() ? L"Joint_VertexShaderVprt.cso" : L"Joint_VertexShader.cso";
+    std::vector<byte> vertexShaderFileData = DXHelper::ReadFromFile(vertexShaderFileName);
+    winrt::check_hresult(
+        device->CreateVertexShader(vertexShaderFileData.data(), vertexShaderFileData.size(), nullptr, m_jointVertexShader.put()));
+
+    for (UINT viewCount = 1; viewCount <= 2; viewCount++)
+    {
+        const std::array<D3D11_INPUT_ELEMENT_DESC, 5> vertexDesc = {{
+            {"POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(JointPrototypeVertex, pos), D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(JointPrototypeVertex, color), D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"JOINTPOSITION",
+             0,
+             DXGI_FORMAT_R32G32B32_FLOAT,
+             1,
+             offsetof(VertexPacking::PackedJoint, position),
+             D3D11_INPUT_PER_INSTANCE_DATA,
+             viewCount},
+            {"JOINTORIENTATION",
+             0,
+             DXGI_FORMAT_R16G16B16A16_SNORM,
+             1,
+             offsetof(VertexPacking::PackedJoint, orientation),
+             D3D11_INPUT_PER_INSTANCE_DATA,
+             viewCount},
+            {"JOINTSIZE",
+             0,
+             DXGI_FORMAT_R16G16_FLOAT,
+             1,
+             offsetof(VertexPacking::PackedJoint, size),
+             D3D11_INPUT_PER_INSTANCE_DATA,
+             viewCount},
+        }};
+        winrt::check_hresult(device->CreateInputLayout(
+            vertexDesc.data(),
+            static_cast<UINT>(vertexDesc.size()),
+            vertexShaderFileData.data(),
+            static_cast<UINT>(vertexShaderFileData.size()),
+            m_jointInputLayouts[viewCount - 1].put()));
+
+        const uint32_t constantBufferData[4] = {viewCount, 0, 0, 0};
+        const D3D11_SUBRESOURCE_DATA constantBufferInitData = {constantBufferData};
+        const CD3D11_BUFFER_DESC constantBufferDesc(sizeof(constantBufferData), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_IMMUTABLE);
+        winrt::check_hresult(
+            device->CreateBuffer(&constantBufferDesc, &constantBufferInitData, m_jointConstantBuffers[viewCount - 1].put()));
+    }
+
+    const std::array<JointPrototypeVertex, 3 * JointTriangleCount> prototypeVertices = GetJointPrototypeVertices();
+    const D3D11_SUBRESOURCE_DATA prototypeBufferData = {prototypeVertices.data()};
+    const CD3D11_BUFFER_DESC prototypeBufferDesc(sizeof(prototypeVertices), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+    winrt::check_hresult(device->CreateBuffer(&prototypeBufferDesc, &prototypeBufferData, m_jointPrototypeBuffer.put()));
 }
 
 void SpatialInputRenderer::Update(
     winrt::Windows::Perception::PerceptionTimestamp timestamp,
     winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem)
 {
-    m_transforms.clear();
-    m_joints.clear();
-
-    m_coloredTransforms.clear();
+    // The previous frame is drawn, its memory is reused for this one.
+    m_frameArena.Reset();
+    m_transforms = FrameArena::Array<QTransform>(m_frameArena);
+    m_joints = FrameArena::Array<Joint>(m_frameArena);
+    m_coloredTransforms = FrameArena::Array<ColoredTransform>(m_frameArena);
 
     auto coordinateSystem = m_referenceFrame.GetStationaryCoordinateSystemAtTimestamp(timestamp);
 
@@ -64,7 +203,11 @@ void SpatialInputRenderer::Update(
 
     auto states = m_interactionManager.GetDetectedSourcesAtTimestamp(timestamp);
 
-    m_transforms.reserve(states.Size());
+    m_transforms.reserve(m_transforms.size() + states.Size());
+
+    // The source pointer pose and the joints of the hand.
+    constexpr uint32_t c_maxJointCount = 1 + 26;
+    m_joints.reserve(c_maxJointCount * states.Size());
 
     constexpr uint32_t c_typicalControllerElementCount = 9;
     const uint32_t maxControllerCount = std::min(states.Size(), 2u);
@@ -276,19 +419,16 @@ void SpatialInputRenderer::Update(
 
 void SpatialInputRenderer::Draw(unsigned int numInstances, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum)
 {
-    std::vector<VertexPositionNormalColor> vertices;
+    FrameArena::Array<VertexPositionNormalColor> vertices(m_frameArena, 3 * (m_transforms.size() + 2 * m_coloredTransforms.size()));
+    FrameArena::Array<Joint> visibleJoints(m_frameArena, m_joints.size());
 
     for (const auto& transform : m_transforms)
     {
         DirectX::XMFLOAT3 trianglePositions[3] = {
             DirectX::XMFLOAT3(0.0f, 0.03f, 0.0f), DirectX::XMFLOAT3(0.01f, 0.0f, 0.0f), DirectX::XMFLOAT3(-0.01f, 0.0f, 0.0f)};
+        transform.TransformPositions(trianglePositions, trianglePositions, 3);
 
-        AppendColoredTriangle(
-            transform.TransformPosition(trianglePositions[0]),
-            transform.TransformPosition(trianglePositions[1]),
-            transform.TransformPosition(trianglePositions[2]),
-            DirectX::XMFLOAT3{0, 0, 1},
-            vertices);
+        AppendColoredTriangle(trianglePositions[0], trianglePositions[1], trianglePositions[2], DirectX::XMFLOAT3{0, 0, 1}, vertices);
     }
 
     for (const auto& joint : m_joints)
@@ -299,8 +439,7 @@ void SpatialInputRenderer::Draw(unsigned int numInstances, winrt::Windows::Found
         float jointCullingRadius = std::max<float>(joint.radius, joint.length / 2.0f);
         if (FrustumCulling::SphereInFrustum(transform(jointCenter, m_modelTransform), jointCullingRadius, cullingFrustum))
         {
-            auto jointVertices = CalculateJointVisualizationVertices(joint.position, joint.orientation, joint.length, joint.radius);
-            vertices.insert(vertices.end(), jointVertices.begin(), jointVertices.end());
+            visibleJoints.push_back(joint);
         }
     }
 
@@ -312,11 +451,7 @@ void SpatialInputRenderer::Draw(unsigned int numInstances, winrt::Windows::Found
             DirectX::XMFLOAT3(0.01f, 0.0f, 0.01f),
             DirectX::XMFLOAT3(-0.01f, 0.0f, 0.01f)};
         DirectX::XMFLOAT3 transformedPositions[4];
-
-        for (uint32_t i = 0; i < 4; ++i)
-        {
-            transformedPositions[i] = coloredTransform.m_transform.TransformPosition(quadPositions[i]);
-        }
+        coloredTransform.m_transform.TransformPositions(quadPositions, transformedPositions, 4);
 
         AppendColoredTriangle(
             transformedPositions[0], transformedPositions[1], transformedPositions[2], coloredTransform.m_color, vertices);
@@ -342,39 +477,52 @@ void SpatialInputRenderer::Draw(unsigned int numInstances, winrt::Windows::Found
             context->DrawInstanced(static_cast<UINT>(vertices.size()), numInstances, offset, 0);
         });
     }
+
+    // Last, as it replaces the input layout and the vertex shader set by Render().
+    DrawJoints(numInstances, visibleJoints);
 }
 
-std::vector<VertexPositionNormalColor> SpatialInputRenderer::CalculateJointVisualizationVertices(
-    float3 jointPosition, quaternion jointOrientation, float jointLength, float jointRadius)
+void SpatialInputRenderer::DrawJoints(unsigned int numInstances, const FrameArena::Array<Joint>& joints)
 {
-    using namespace DirectX;
+    static_assert(sizeof(Joint) == 9 * sizeof(float), "VertexPacking::PackJoints reads the joints as 9 floats each");
+    assert(numInstances == 1 || numInstances == 2);
 
-    constexpr const size_t verticesCount = 2 * 4 * 3;
-    std::vector<VertexPositionNormalColor> vertices;
-    vertices.reserve(verticesCount);
+    if (joints.empty())
+    {
+        return;
+    }
 
-    float centerHeight = std::min<float>(jointRadius, 0.5f * jointLength);
-    float centerXandY = jointRadius / sqrtf(2.0f);
+    const uint32_t jointCount = static_cast<uint32_t>(joints.size());
+    if (jointCount > m_jointInstanceCapacity)
+    {
+        m_jointInstanceCapacity = std::max(jointCount, m_jointInstanceCapacity * 2);
+        m_jointInstanceBuffer = nullptr;
 
-    QTransform jointTransform = QTransform(jointPosition, jointOrientation);
+        const CD3D11_BUFFER_DESC bufferDesc(
+            m_jointInstanceCapacity * static_cast<UINT>(sizeof(VertexPacking::PackedJoint)), D3D11_BIND_VERTEX_BUFFER);
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&bufferDesc, nullptr, m_jointInstanceBuffer.put()));
+    }
 
-    XMFLOAT3 baseVertexPosition = jointTransform.TransformPosition(XMFLOAT3(0.0f, 0.0f, 0.0f));
-    XMFLOAT3 centerVertexPositions[4] = {
-        jointTransform.TransformPosition(XMFLOAT3(-centerXandY, -centerXandY, -centerHeight)),
-        jointTransform.TransformPosition(XMFLOAT3(-centerXandY, +centerXandY, -centerHeight)),
-        jointTransform.TransformPosition(XMFLOAT3(+centerXandY, +centerXandY, -centerHeight)),
-        jointTransform.TransformPosition(XMFLOAT3(+centerXandY, -centerXandY, -centerHeight)),
-    };
-    XMFLOAT3 topVertexPosition = jointTransform.TransformPosition(XMFLOAT3(0.0f, 0.0f, -jointLength));
-
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[0], centerVertexPositions[1], XMFLOAT3(0.0f, 0.0f, 0.4f), vertices);
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[1], centerVertexPositions[2], XMFLOAT3(0.0f, 0.4f, 0.0f), vertices);
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[2], centerVertexPositions[3], XMFLOAT3(0.4f, 0.0f, 0.0f), vertices);
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[3], centerVertexPositions[0], XMFLOAT3(0.4f, 0.4f, 0.0f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[1], centerVertexPositions[0], XMFLOAT3(0.0f, 0.0f, 0.6f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[2], centerVertexPositions[1], XMFLOAT3(0.0f, 0.6f, 0.0f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[3], centerVertexPositions[2], XMFLOAT3(0.6f, 0.0f, 0.0f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[0], centerVertexPositions[3], XMFLOAT3(0.6f, 0.6f, 0.0f), vertices);
-
-    return vertices;
+    // The joints are the only data of the instances uploaded each frame, the prototype mesh is static.
+    VertexPacking::PackedJoint* packedJoints = m_frameArena.Allocate<VertexPacking::PackedJoint>(jointCount);
+    VertexPacking::PackJoints(reinterpret_cast<const float*>(joints.data()), jointCount, packedJoints);
+
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        const D3D11_BOX box = {0, 0, 0, jointCount * static_cast<UINT>(sizeof(VertexPacking::PackedJoint)), 1, 1};
+        context->UpdateSubresource(m_jointInstanceBuffer.get(), 0, &box, packedJoints, 0, 0);
+
+        ID3D11Buffer* buffers[2] = {m_jointPrototypeBuffer.get(), m_jointInstanceBuffer.get()};
+        const UINT strides[2] = {sizeof(JointPrototypeVertex), sizeof(VertexPacking::PackedJoint)};
+        const UINT offsets[2] = {0, 0};
+        context->IASetInputLayout(m_jointInputLayouts[numInstances - 1].get());
+        context->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+        // The model and view projection constant buffers stay bound.
+        context->VSSetShader(m_jointVertexShader.get(), nullptr, 0);
+        ID3D11Buffer* constantBuffer = m_jointConstantBuffers[numInstances - 1].get();
+        context->VSSetConstantBuffers(2, 1, &constantBuffer);
+
+        context->DrawInstanced(static_cast<UINT>(3 * JointTriangleCount), jointCount * numInstances, 0, 0);
+    });
 }
@@ -11,6 +11,8 @@
 
 #pragma once
 
+#include <PointTransform.h>
+#include <VertexPacking.h>
 #include <holographic/RenderableObject.h>
 
 #include <vector>
@@ -64,6 +66,17 @@ struct QTransform
         return float3(temp.x, temp.y, temp.z);
     }
 
+    // Transforms several positions at once, as a matrix, which is cheaper than rotating each of them by the quaternion. destination may be
+    // positions.
+    void TransformPositions(const DirectX::XMFLOAT3* positions, DirectX::XMFLOAT3* destination, size_t count) const
+    {
+        DirectX::XMFLOAT4X4 matrix;
+        const DirectX::XMMATRIX rotation = DirectX::XMMatrixRotationQuaternion(m_orientation);
+        DirectX::XMStoreFloat4x4(&matrix, DirectX::XMMatrixMultiply(rotation, DirectX::XMMatrixTranslationFromVector(m_position)));
+        PointTransform::TransformPoints(
+            &matrix.m[0][0], positions, sizeof(DirectX::XMFLOAT3), destination, sizeof(DirectX::XMFLOAT3), count);
+    }
+
     DirectX::XMVECTOR m_position;
     DirectX::XMVECTOR m_orientation;
 };
@@ -75,10 +88,19 @@ public:
         const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources,
         winrt::Windows::UI::Input::Spatial::SpatialInteractionManager interactionManager);
 
+    void CreateDeviceDependentResources() override;
+    void ReleaseDeviceDependentResources() override;
+
     void Update(
         winrt::Windows::Perception::PerceptionTimestamp timestamp,
         winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
 
+    // The memory of the transforms, joints and vertices of the frames.
+    FrameArena::Statistics GetFrameArenaStatistics() const
+    {
+        return m_frameArena.GetStatistics();
+    }
+
 private:
     struct Joint
     {
@@ -105,18 +127,31 @@ private:
     };
 
 private:
-    static std::vector<VertexPositionNormalColor> CalculateJointVisualizationVertices(
-        float3 jointPosition, quaternion jointOrientation, float jointLength, float jointRadius);
+    void CreateJointResources();
 
     void Draw(
         unsigned int numInstances,
         winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum> cullingFrustum) override;
 
+    // Draws the joints as instances of the prototype joint mesh, numInstances instances each, one for each view.
+    void DrawJoints(unsigned int numInstances, const FrameArena::Array<Joint>& joints);
+
     winrt::Windows::UI::Input::Spatial::SpatialInteractionManager m_interactionManager{nullptr};
     winrt::Windows::Perception::Spatial::SpatialLocatorAttachedFrameOfReference m_referenceFrame{nullptr};
-    std::vector<QTransform> m_transforms;
-    std::vector<Joint> m_joints;
-    std::vector<ColoredTransform> m_coloredTransforms;
+    // Everything built for a frame lives in the arena, from Update() until the next one.
+    FrameArena m_frameArena;
+    FrameArena::Array<QTransform> m_transforms;
+    FrameArena::Array<Joint> m_joints;
+    FrameArena::Array<ColoredTransform> m_coloredTransforms;
+
+    // Direct3D resources for the joints. The input layouts and the constant buffers are for drawing each joint to one view and to two
+    // views, i.e. for an instance step rate of 1 and 2.
+    winrt::com_ptr<ID3D11VertexShader> m_jointVertexShader;
+    winrt::com_ptr<ID3D11InputLayout> m_jointInputLayouts[2];
+    winrt::com_ptr<ID3D11Buffer> m_jointConstantBuffers[2];
+    winrt::com_ptr<ID3D11Buffer> m_jointPrototypeBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_jointInstanceBuffer;
+    uint32_t m_jointInstanceCapacity = 0;
 
     winrt::Windows::Foundation::Numerics::float4x4 m_modelTransform;
 };
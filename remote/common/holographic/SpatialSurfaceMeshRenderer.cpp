@@ -13,7 +13,16 @@
 
 #include <holographic/SpatialSurfaceMeshRenderer.h>
 
+#include <ContentHash.h>
 #include <DirectXHelper.h>
+#include <MeshBounds.h>
+#include <MeshSimplifier.h>
+#include <holographic/FrustumCulling.h>
+
+#include <winrt/Windows.UI.Input.Spatial.h>
+
+#include <algorithm>
+#include <chrono>
 
 using namespace winrt::Windows;
 using namespace winrt::Windows::Perception::Spatial;
@@ -21,13 +30,65 @@ using namespace winrt::Windows::Graphics::DirectX;
 using namespace winrt::Windows::Foundation::Numerics;
 using namespace Concurrency;
 
+namespace
+{
+    // Size of the staging memory for meshes which are computed but not yet uploaded.
+    constexpr size_t StagingRingSize = 16 * 1024 * 1024;
+
+    // Initial sizes of the shared vertex and index buffers in elements, they double whenever they run out of space.
+    constexpr uint32_t InitialVertexArenaCapacity = 256 * 1024;
+    constexpr uint32_t InitialIndexArenaCapacity = 3 * 256 * 1024;
+
+    // Free ranges smaller than this are not split off, to avoid scattering tiny unusable blocks across the arenas.
+    constexpr uint32_t MinArenaBlockSize = 64;
+
+    // Simplified levels of detail: fraction of the triangles of the full mesh to aim for, and the largest allowed error in meters.
+    constexpr float LodTriangleRatios[] = {0.25f, 0.0625f};
+    constexpr float LodMaxErrors[] = {0.02f, 0.06f};
+
+    // A simplified level is dropped if it does not get rid of at least this fraction of the triangles of the previous level.
+    constexpr float MinLodReduction = 0.25f;
+
+    // Viewing distances in meters at which parts switch to the next coarser level of detail, and the margin around them which avoids
+    // switching back and forth while moving along a threshold.
+    constexpr float LodDistances[] = {2.0f, 4.0f};
+    constexpr float LodHysteresis = 0.25f;
+
+    constexpr uint32_t DefaultTriangleBudget = 250000;
+
+    // Surfaces within this cone around the head direction (about 45 degrees) count as visible when ordering mesh computations.
+    constexpr float ViewConeCosine = 0.7f;
+
+    static_assert(
+        sizeof(SRMeshConstantBuffer) == sizeof(MeshBatchBuilder::PartData::model),
+        "The model matrix of a part is copied into the per part data of the batch as is.");
+
+    double GetTimeInSeconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+} // namespace
+
 // for debugging -> remove
 bool g_freeze = false;
 bool g_freezeOnFrame = false;
 
 // Initializes D2D resources used for text rendering.
-SpatialSurfaceMeshRenderer::SpatialSurfaceMeshRenderer(const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources)
+SpatialSurfaceMeshRenderer::SpatialSurfaceMeshRenderer(
+    const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources, const std::filesystem::path& meshCacheFile)
     : m_deviceResources(deviceResources)
+    , m_stagingRing(std::make_shared<StagingRing>(StagingRingSize))
+    , m_contentCounters(std::make_shared<SRMeshContentCounters>())
+    , m_vertexCacheCounters(std::make_shared<SRMeshVertexCacheCounters>())
+    , m_meshCache(meshCacheFile.empty() ? nullptr : std::make_shared<MeshCache>(meshCacheFile))
+    , m_vertexArena(
+          sizeof(SpatialSurfaceMeshPart::Vertex_t),
+          D3D11_BIND_SHADER_RESOURCE,
+          D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS,
+          InitialVertexArenaCapacity,
+          MinArenaBlockSize)
+    , m_indexArena(sizeof(uint32_t), D3D11_BIND_INDEX_BUFFER, 0, InitialIndexArenaCapacity, MinArenaBlockSize)
+    , m_triangleBudget(DefaultTriangleBudget)
 {
     CreateDeviceDependentResources();
 
@@ -36,8 +97,6 @@ SpatialSurfaceMeshRenderer::SpatialSurfaceMeshRenderer(const std::shared_ptr<DXH
     {
         m_spatialLocatorLocabilityChangedEventRevoker =
             m_spatialLocator.LocatabilityChanged(winrt::auto_revoke, {this, &SpatialSurfaceMeshRenderer::OnLocatibilityChanged});
-
-        m_attachedFrameOfReference = m_spatialLocator.CreateAttachedFrameOfReferenceAtCurrentHeading();
     }
 }
 
@@ -64,16 +123,7 @@ void SpatialSurfaceMeshRenderer::CreateDeviceDependentResources()
     winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateVertexShader(
         vertexShaderFileData.data(), vertexShaderFileData.size(), nullptr, m_vertexShader.put()));
 
-    constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 1> vertexDesc = {{
-        {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-    }};
-
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
-        vertexDesc.data(),
-        static_cast<UINT>(vertexDesc.size()),
-        vertexShaderFileData.data(),
-        static_cast<UINT>(vertexShaderFileData.size()),
-        m_inputLayout.put()));
+    // no input layout, the vertex shader fetches the vertices from the vertex arena
 
     std::vector<byte> geometryShaderFileData = DXHelper::ReadFromFile(L"SRMesh_GeometryShader.cso");
 
@@ -85,9 +135,6 @@ void SpatialSurfaceMeshRenderer::CreateDeviceDependentResources()
     winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreatePixelShader(
         pixelShaderFileData.data(), pixelShaderFileData.size(), nullptr, m_pixelShader.put()));
 
-    const CD3D11_BUFFER_DESC constantBufferDesc(sizeof(SRMeshConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, m_modelConstantBuffer.put()));
-
     m_loadingComplete = true;
 }
 
@@ -98,12 +145,24 @@ void SpatialSurfaceMeshRenderer::ReleaseDeviceDependentResources()
         m_surfaceObserver.ObservedSurfacesChanged(m_observedSurfaceChangedToken);
         m_surfaceObserver = nullptr;
     }
+    m_boundingVolumePolicy.Reset();
     m_loadingComplete = false;
-    m_inputLayout = nullptr;
     m_vertexShader = nullptr;
     m_geometryShader = nullptr;
     m_pixelShader = nullptr;
-    m_modelConstantBuffer = nullptr;
+
+    // the mesh data lives in the arena buffers, so the parts have to be recomputed
+    ClearMeshParts();
+    m_vertexArena.buffer = nullptr;
+    m_vertexArena.view = nullptr;
+    m_indexArena.buffer = nullptr;
+    m_indexArena.view = nullptr;
+
+    m_batchIndexBuffer = nullptr;
+    m_batchIndexCapacity = 0;
+    m_partDataBuffer = nullptr;
+    m_partDataView = nullptr;
+    m_partDataCapacity = 0;
 }
 
 void SpatialSurfaceMeshRenderer::OnObservedSurfaceChanged()
@@ -121,21 +180,64 @@ void SpatialSurfaceMeshRenderer::OnLocatibilityChanged(
     SpatialLocatability locatibility = spatialLocator.Locatability();
     if (locatibility != SpatialLocatability::PositionalTrackingActive)
     {
-        m_meshParts.clear();
+        // the arenas are owned by the render thread, defer the clear to the next update
+        m_clearMeshParts = true;
     }
 }
 
 SpatialSurfaceMeshPart* SpatialSurfaceMeshRenderer::GetOrCreateMeshPart(winrt::guid id)
 {
     GUID key = id;
-    auto found = m_meshParts.find(key);
-    if (found == m_meshParts.cend())
+    if (SpatialSurfaceMeshPart* part = m_meshParts.Get(key))
     {
-        m_meshParts[id] = std::make_unique<SpatialSurfaceMeshPart>(this);
-        return m_meshParts[id].get();
+        return part;
     }
 
-    return found->second.get();
+    return m_meshParts.Get(m_meshParts.TryEmplace(key, this, key, AllocatePartSlot()).first);
+}
+
+void SpatialSurfaceMeshRenderer::ClearMeshParts()
+{
+    for (const SpatialSurfaceMeshPart& part : m_meshParts)
+    {
+        RetireComputation(part);
+    }
+
+    m_meshParts.Clear();
+    m_computeScheduler.Clear();
+    m_vertexArena.allocator.Reset(m_vertexArena.allocator.GetCapacity());
+    m_indexArena.allocator.Reset(m_indexArena.allocator.GetCapacity());
+    m_freePartSlots.clear();
+    m_partSlotCount = 0;
+    m_batch.Invalidate();
+}
+
+void SpatialSurfaceMeshRenderer::RetireComputation(const SpatialSurfaceMeshPart& part)
+{
+    // the scheduler only frees the slot of a removed part once its computation completed, which is tracked here
+    if (m_computeScheduler.IsInFlight(part.m_id))
+    {
+        m_retiringComputations.push_back({part.m_id, part.m_meshData});
+    }
+}
+
+uint32_t SpatialSurfaceMeshRenderer::AllocatePartSlot()
+{
+    if (!m_freePartSlots.empty())
+    {
+        const uint32_t slot = m_freePartSlots.back();
+        m_freePartSlots.pop_back();
+        return slot;
+    }
+
+    // there are never remotely as many surfaces as slots
+    assert(m_partSlotCount < MeshBatchBuilder::MaxSlotCount);
+    return m_partSlotCount++;
+}
+
+void SpatialSurfaceMeshRenderer::FreePartSlot(uint32_t slot)
+{
+    m_freePartSlots.push_back(slot);
 }
 
 void SpatialSurfaceMeshRenderer::Update(
@@ -145,34 +247,51 @@ void SpatialSurfaceMeshRenderer::Update(
     if (m_surfaceObserver == nullptr)
         return;
 
-    // update bounding volume (every frame)
+    if (m_clearMeshParts.exchange(false))
     {
-        SpatialBoundingBox axisAlignedBoundingBox = {
-            {-5.0f, -5.0f, -2.5f},
-            {10.0f, 10.0f, 5.f},
-        };
+        ClearMeshParts();
+    }
 
-        using namespace std::chrono_literals;
-        auto now = std::chrono::high_resolution_clock::now();
-        auto delta = now - m_boundingVolumeUpdateTime;
+    // staging memory submitted during the previous frame can be reused
+    m_frameIndex++;
+    m_stagingRing->Retire(m_frameIndex - 1);
 
-        if (m_attachedFrameOfReference && delta > 1s)
-        {
-            SpatialCoordinateSystem attachedCoordinateSystem =
-                m_attachedFrameOfReference.GetStationaryCoordinateSystemAtTimestamp(timestamp);
-            SpatialBoundingVolume volume = SpatialBoundingVolume::FromBox(attachedCoordinateSystem, axisAlignedBoundingBox);
-            m_surfaceObserver.SetBoundingVolume(volume);
+    // the head pose drives the order of mesh computations and the level of detail selection. if the head can't be located, measure
+    // from the origin of the rendering coordinate system.
+    float3 viewPosition = float3::zero();
+    float3 viewForward = {0.0f, 0.0f, -1.0f};
+    bool headLocated = false;
+    if (auto pointerPose = winrt::Windows::UI::Input::Spatial::SpatialPointerPose::TryGetAtTimestamp(renderingCoordinateSystem, timestamp))
+    {
+        viewPosition = pointerPose.Head().Position();
+        viewForward = pointerPose.Head().ForwardDirection();
+        headLocated = true;
+    }
 
-            m_boundingVolumeUpdateTime = now;
-        }
+    const double now = GetTimeInSeconds();
+
+    // move the observed volume along with the head. it is only replaced when the head moved enough, since every change makes the
+    // observer report changed surfaces
+    if (headLocated &&
+        m_boundingVolumePolicy.Update(
+            now, {viewPosition.x, viewPosition.y, viewPosition.z}, {viewForward.x, viewForward.y, viewForward.z}))
+    {
+        const BoundingVolumePolicy::Box& box = m_boundingVolumePolicy.GetBox();
+        SpatialBoundingBox axisAlignedBoundingBox = {
+            {box.center.x - box.halfExtents.x, box.center.y - box.halfExtents.y, box.center.z - box.halfExtents.z},
+            {box.halfExtents.x * 2.0f, box.halfExtents.y * 2.0f, box.halfExtents.z * 2.0f},
+        };
+
+        // the rendering coordinate system is stationary, so the box stays in place until it is replaced
+        m_surfaceObserver.SetBoundingVolume(SpatialBoundingVolume::FromBox(renderingCoordinateSystem, axisAlignedBoundingBox));
     }
 
     if (m_sufaceChanged)
     {
         // first mark all as not used
-        for (auto& pair : m_meshParts)
+        for (SpatialSurfaceMeshPart& part : m_meshParts)
         {
-            pair.second->m_inUse = false;
+            part.m_inUse = false;
         }
 
         auto mapContainingSurfaceCollection = m_surfaceObserver.GetObservedSurfaces();
@@ -181,45 +300,253 @@ void SpatialSurfaceMeshRenderer::Update(
         {
             if (SpatialSurfaceMeshPart* meshPart = GetOrCreateMeshPart(pair.Key()))
             {
-                meshPart->Update(pair.Value());
+                // surfaces which did not change keep their mesh, unchanged surfaces of a previous session come from the mesh cache
+                if (meshPart->Update(pair.Value()) && !meshPart->RestoreFromCache())
+                {
+                    m_computeScheduler.Request(meshPart->m_id, now);
+                }
                 g_freeze = g_freezeOnFrame;
             }
         }
 
         // purge the ones not used
-        for (MeshPartMap::const_iterator itr = m_meshParts.cbegin(); itr != m_meshParts.cend();)
+        m_meshParts.EraseIf([this](SpatialSurfaceMeshPart& part) {
+            if (part.IsInUse())
+            {
+                return false;
+            }
+
+            RetireComputation(part);
+            m_computeScheduler.Remove(part.m_id);
+            ReleaseArenaAllocations(part);
+            FreePartSlot(part.m_slot);
+            return true;
+        });
+
+        m_sufaceChanged = false;
+    }
+
+    // computations of removed parts free their scheduler slot once they finished
+    std::erase_if(m_retiringComputations, [&](const RetiringComputation& computation) {
+        if (computation.meshData->updateInProgress)
         {
-            itr = itr->second->IsInUse() ? std::next(itr) : m_meshParts.erase(itr);
+            return false;
         }
 
-        m_sufaceChanged = false;
+        m_computeScheduler.Complete(computation.id, now);
+        return true;
+    });
+
+    // every frame, pick up finished meshes and bring the model matrix to rendering space
+    for (SpatialSurfaceMeshPart& part : m_meshParts)
+    {
+        if (!part.m_meshData->updateInProgress && m_computeScheduler.IsInFlight(part.m_id))
+        {
+            m_computeScheduler.Complete(part.m_id, now);
+        }
+
+        part.TakePendingMesh();
+        part.UpdateModelMatrix(renderingCoordinateSystem);
     }
 
-    // every frame, bring the model matrix to rendering space
-    for (auto& pair : m_meshParts)
+    // start the most important mesh computations, without flooding the system with all of them at once
+    m_computeScheduler.Dispatch(
+        now,
+        [&](const GUID& id) {
+            return GetComputePriorityInputs(*m_meshParts.Get(id), renderingCoordinateSystem, viewPosition, viewForward);
+        },
+        [&](const GUID& id) { m_meshParts.Get(id)->ComputeMesh(); });
+
+    SelectLevelsOfDetail(viewPosition);
+}
+
+SpatialSurfaceMeshRenderer::ComputeScheduler::PriorityInputs SpatialSurfaceMeshRenderer::GetComputePriorityInputs(
+    const SpatialSurfaceMeshPart& part,
+    SpatialCoordinateSystem renderingCoordinateSystem,
+    const float3& viewPosition,
+    const float3& viewForward) const
+{
+    // without bounds the surface is treated as far away and invisible
+    ComputeScheduler::PriorityInputs inputs;
+    inputs.distance = m_computeScheduler.GetPolicy().maxDistance;
+    inputs.visible = false;
+
+    auto bounds = part.m_surfaceInfo ? part.m_surfaceInfo.TryGetBounds(renderingCoordinateSystem) : nullptr;
+    if (!bounds)
     {
-        pair.second->UpdateModelMatrix(renderingCoordinateSystem);
+        return inputs;
     }
+
+    const SpatialBoundingOrientedBox box = bounds.Value();
+    const float3 toCenter = box.Center - viewPosition;
+    const float centerDistance = length(toCenter);
+    const float radius = length(box.Extents);
+
+    // approximate the view frustum with a cone around the head direction, widened by the size of the surface
+    inputs.distance = std::max(centerDistance - radius, 0.0f);
+    inputs.visible = inputs.distance == 0.0f || dot(toCenter, viewForward) + radius >= centerDistance * ViewConeCosine;
+    return inputs;
 }
 
-void SpatialSurfaceMeshRenderer::Render(bool isStereo)
+void SpatialSurfaceMeshRenderer::SelectLevelsOfDetail(const float3& viewPosition)
 {
-    if (!m_loadingComplete || m_meshParts.empty())
+    uint32_t triangleCount = 0;
+    m_partsByDistance.clear();
+    for (SpatialSurfaceMeshPart& part : m_meshParts)
+    {
+        if (part.m_lodCount == 0)
+        {
+            continue;
+        }
+
+        part.SelectLod(distance(part.m_renderingCenter, viewPosition));
+        triangleCount += part.m_lodIndexCounts[part.m_lod] / 3;
+        m_partsByDistance.push_back(&part);
+    }
+
+    if (triangleCount > m_triangleBudget)
+    {
+        // over budget, coarsen the farthest parts first
+        std::sort(m_partsByDistance.begin(), m_partsByDistance.end(), [](const auto* a, const auto* b) {
+            return a->m_viewDistance > b->m_viewDistance;
+        });
+
+        for (bool reduced = true; reduced && triangleCount > m_triangleBudget;)
+        {
+            reduced = false;
+            for (SpatialSurfaceMeshPart* part : m_partsByDistance)
+            {
+                if (triangleCount <= m_triangleBudget)
+                {
+                    break;
+                }
+
+                if (part->m_lod + 1 < part->m_lodCount)
+                {
+                    triangleCount -= (part->m_lodIndexCounts[part->m_lod] - part->m_lodIndexCounts[part->m_lod + 1]) / 3;
+                    part->m_lod++;
+                    reduced = true;
+                }
+            }
+        }
+    }
+
+    m_selectedTriangleCount = triangleCount;
+}
+
+void SpatialSurfaceMeshRenderer::RenderOccluders(
+    OcclusionCuller& occlusionCuller, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum)
+{
+    for (const SpatialSurfaceMeshPart& part : m_meshParts)
+    {
+        if (part.m_occluderIndices.empty())
+        {
+            continue;
+        }
+
+        if (!FrustumCulling::OrientedBoxInFrustum(
+                part.m_renderingCenter,
+                part.m_renderingHalfAxes[0],
+                part.m_renderingHalfAxes[1],
+                part.m_renderingHalfAxes[2],
+                cullingFrustum))
+        {
+            continue;
+        }
+
+        occlusionCuller.RenderOccluder(
+            part.m_occluderPositions.data(),
+            static_cast<uint32_t>(part.m_occluderPositions.size() / 3),
+            3,
+            part.m_occluderIndices.data(),
+            static_cast<uint32_t>(part.m_occluderIndices.size()),
+            &part.m_model.m11);
+    }
+}
+
+void SpatialSurfaceMeshRenderer::Render(bool isStereo, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum)
+{
+    m_drawnPartCount = 0;
+    m_culledPartCount = 0;
+
+    if (!m_loadingComplete || m_meshParts.Empty())
+    {
+        return;
+    }
+
+    // upload new meshes before binding the arenas, since an upload might grow or compact them
+    for (SpatialSurfaceMeshPart& part : m_meshParts)
+    {
+        if (part.m_needsUpload)
+        {
+            part.UploadData(m_frameIndex);
+        }
+    }
+
+    // collect the visible parts into one batch
+    m_batch.Begin();
+    for (SpatialSurfaceMeshPart& part : m_meshParts)
+    {
+        if (part.m_indexCount == 0)
+        {
+            continue;
+        }
+
+        if (!FrustumCulling::OrientedBoxInFrustum(
+                part.m_renderingCenter,
+                part.m_renderingHalfAxes[0],
+                part.m_renderingHalfAxes[1],
+                part.m_renderingHalfAxes[2],
+                cullingFrustum))
+        {
+            m_culledPartCount++;
+            continue;
+        }
+        m_drawnPartCount++;
+
+        m_batch.AddPart(
+            part.m_slot,
+            &part.m_constantBufferData.modelMatrix.m[0][0],
+            m_vertexArena.allocator.GetOffset(part.m_vertexAllocation),
+            m_indexArena.allocator.GetOffset(part.m_indexAllocation) + part.m_lodIndexOffsets[part.m_lod],
+            part.m_lodIndexCounts[part.m_lod]);
+    }
+
+    bool indicesChanged = m_batch.End();
+    if (m_batch.GetIndexCount() == 0)
+    {
         return;
+    }
+
+    indicesChanged |= ReserveBatchBuffers(m_batch.GetIndexCount(), m_batch.GetPartDataCount());
 
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
-        // Each vertex is one instance of the VertexPositionColorTexture struct.
-        const uint32_t stride = sizeof(SpatialSurfaceMeshPart::Vertex_t);
-        const uint32_t offset = 0;
-        ID3D11Buffer* pBufferToSet;
+        // gather the index ranges of the visible parts, this is only necessary if they changed since the last frame
+        if (indicesChanged)
+        {
+            const uint32_t indexSize = m_indexArena.elementSize;
+            for (const MeshBatchBuilder::CopyRange& range : m_batch.GetCopyRanges())
+            {
+                const D3D11_BOX box = {range.sourceOffset * indexSize, 0, 0, (range.sourceOffset + range.count) * indexSize, 1, 1};
+                context->CopySubresourceRegion(
+                    m_batchIndexBuffer.get(), 0, range.destinationOffset * indexSize, 0, 0, m_indexArena.buffer.get(), 0, &box);
+            }
+        }
+
+        const uint32_t partDataSize = m_batch.GetPartDataCount() * static_cast<uint32_t>(sizeof(MeshBatchBuilder::PartData));
+        const D3D11_BOX partDataBox = {0, 0, 0, partDataSize, 1, 1};
+
+        context->UpdateSubresource(m_partDataBuffer.get(), 0, &partDataBox, m_batch.GetPartData(), 0, 0);
+
+        // the vertex shader fetches the vertices itself, no vertex buffers are bound
         context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        context->IASetInputLayout(m_inputLayout.get());
+        context->IASetInputLayout(nullptr);
+        context->IASetIndexBuffer(m_batchIndexBuffer.get(), DXGI_FORMAT_R32_UINT, 0);
 
         // Attach the vertex shader.
         context->VSSetShader(m_vertexShader.get(), nullptr, 0);
-        // Apply the model constant buffer to the vertex shader.
-        pBufferToSet = m_modelConstantBuffer.get();
-        context->VSSetConstantBuffers(0, 1, &pBufferToSet);
+        ID3D11ShaderResourceView* shaderResources[] = {m_partDataView.get(), m_vertexArena.view.get()};
+        context->VSSetShaderResources(0, ARRAYSIZE(shaderResources), shaderResources);
 
         // geometry shader
         context->GSSetShader(m_geometryShader.get(), nullptr, 0);
@@ -227,81 +554,341 @@ void SpatialSurfaceMeshRenderer::Render(bool isStereo)
         // pixel shader
         context->PSSetShader(m_zfillOnly ? nullptr : m_pixelShader.get(), nullptr, 0);
 
-        // Apply the model constant buffer to the pixel shader.
-        pBufferToSet = m_modelConstantBuffer.get();
-        context->PSSetConstantBuffers(0, 1, &pBufferToSet);
+        // all visible parts at once
+        context->DrawIndexedInstanced(m_batch.GetIndexCount(), isStereo ? 2 : 1, 0, 0, 0);
+
+        // set geometry shader and shader resources back
+        context->GSSetShader(nullptr, nullptr, 0);
+        ID3D11ShaderResourceView* nullResources[ARRAYSIZE(shaderResources)] = {};
+        context->VSSetShaderResources(0, ARRAYSIZE(nullResources), nullResources);
+    });
+}
+
+bool SpatialSurfaceMeshRenderer::ReserveBatchBuffers(uint32_t indexCount, uint32_t partDataCount)
+{
+    bool indexBufferChanged = false;
+    if (indexCount > m_batchIndexCapacity)
+    {
+        m_batchIndexCapacity = std::max(indexCount, m_batchIndexCapacity * 2);
+        m_batchIndexBuffer = nullptr;
+
+        const CD3D11_BUFFER_DESC bufferDesc(m_batchIndexCapacity * m_indexArena.elementSize, D3D11_BIND_INDEX_BUFFER);
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&bufferDesc, nullptr, m_batchIndexBuffer.put()));
+        indexBufferChanged = true;
+    }
+
+    if (partDataCount > m_partDataCapacity)
+    {
+        m_partDataCapacity = std::max(partDataCount, m_partDataCapacity * 2);
+        m_partDataBuffer = nullptr;
+        m_partDataView = nullptr;
+
+        const CD3D11_BUFFER_DESC bufferDesc(
+            m_partDataCapacity * sizeof(MeshBatchBuilder::PartData),
+            D3D11_BIND_SHADER_RESOURCE,
+            D3D11_USAGE_DEFAULT,
+            0,
+            D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+            sizeof(MeshBatchBuilder::PartData));
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&bufferDesc, nullptr, m_partDataBuffer.put()));
+
+        const CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(
+            m_partDataBuffer.get(), DXGI_FORMAT_UNKNOWN, 0, m_partDataCapacity);
+        winrt::check_hresult(
+            m_deviceResources->GetD3DDevice()->CreateShaderResourceView(m_partDataBuffer.get(), &viewDesc, m_partDataView.put()));
+    }
+
+    return indexBufferChanged;
+}
+
+SpatialSurfaceMeshRenderer::MeshArena::MeshArena(
+    uint32_t elementSize, UINT bindFlags, UINT miscFlags, uint32_t capacity, uint32_t minBlockSize)
+    : elementSize(elementSize)
+    , bindFlags(bindFlags)
+    , miscFlags(miscFlags)
+    , allocator(capacity, minBlockSize)
+{
+}
+
+TlsfAllocator::Allocation SpatialSurfaceMeshRenderer::AllocateFromArena(MeshArena& arena, uint32_t count)
+{
+    if (!arena.buffer)
+    {
+        RebuildArena(arena, arena.allocator.GetCapacity());
+    }
 
-        // render each mesh part
-        for (auto& pair : m_meshParts)
+    TlsfAllocator::Allocation allocation = arena.allocator.Allocate(count);
+    if (!allocation)
+    {
+        // if there is plenty of free space it is just too scattered, compact it in place. otherwise grow the arena.
+        const TlsfAllocator::Statistics statistics = arena.allocator.GetStatistics();
+        uint32_t capacity = statistics.capacity;
+        if (statistics.freeSize / 2 < count)
+        {
+            capacity = std::max(capacity * 2, statistics.usedSize + count * 2);
+        }
+
+        RebuildArena(arena, capacity);
+        allocation = arena.allocator.Allocate(count);
+        assert(allocation);
+    }
+
+    return allocation;
+}
+
+void SpatialSurfaceMeshRenderer::RebuildArena(MeshArena& arena, uint32_t capacity)
+{
+    // pack all live ranges to the front of a new buffer, which also takes care of any fragmentation
+    winrt::com_ptr<ID3D11Buffer> oldBuffer = std::move(arena.buffer);
+    const std::vector<TlsfAllocator::Relocation> relocations = arena.allocator.Defragment();
+    arena.allocator.Grow(capacity);
+
+    const CD3D11_BUFFER_DESC bufferDesc(capacity * arena.elementSize, arena.bindFlags, D3D11_USAGE_DEFAULT, 0, arena.miscFlags);
+    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&bufferDesc, nullptr, arena.buffer.put()));
+
+    arena.view = nullptr;
+    if (arena.bindFlags & D3D11_BIND_SHADER_RESOURCE)
+    {
+        // raw views address 32 bit words
+        const CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(
+            arena.buffer.get(), DXGI_FORMAT_R32_TYPELESS, 0, capacity * arena.elementSize / 4, D3D11_BUFFEREX_SRV_FLAG_RAW);
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(arena.buffer.get(), &viewDesc, arena.view.put()));
+    }
+
+    if (!oldBuffer)
+    {
+        return;
+    }
+
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        // ranges which are adjacent before and after the move are copied at once
+        for (size_t i = 0; i < relocations.size();)
         {
-            SpatialSurfaceMeshPart* part = pair.second.get();
-            if (part->m_indexCount == 0)
-                continue;
+            const uint32_t sourceOffset = relocations[i].sourceOffset;
+            const uint32_t destinationOffset = relocations[i].destinationOffset;
+            uint32_t size = relocations[i].size;
 
-            if (part->m_needsUpload)
+            for (i++; i < relocations.size() && relocations[i].sourceOffset == sourceOffset + size &&
+                      relocations[i].destinationOffset == destinationOffset + size;
+                 i++)
             {
-                part->UploadData();
+                size += relocations[i].size;
             }
 
-            // update part specific model matrix
-            context->UpdateSubresource(m_modelConstantBuffer.get(), 0, nullptr, &part->m_constantBufferData, 0, 0);
-
-            ID3D11Buffer* pBufferToSet2 = part->m_vertexBuffer.get();
-            context->IASetVertexBuffers(0, 1, &pBufferToSet2, &stride, &offset);
-            context->IASetIndexBuffer(part->m_indexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
-            // draw the mesh
-            context->DrawIndexedInstanced(part->m_indexCount, isStereo ? 2 : 1, 0, 0, 0);
+            const D3D11_BOX box = {sourceOffset * arena.elementSize, 0, 0, (sourceOffset + size) * arena.elementSize, 1, 1};
+            context->CopySubresourceRegion(
+                arena.buffer.get(), 0, destinationOffset * arena.elementSize, 0, 0, oldBuffer.get(), 0, &box);
         }
-
-        // set geometry shader back
-        context->GSSetShader(nullptr, nullptr, 0);
     });
 }
 
+void SpatialSurfaceMeshRenderer::ReleaseArenaAllocations(SpatialSurfaceMeshPart& part)
+{
+    m_vertexArena.allocator.Free(part.m_vertexAllocation);
+    m_indexArena.allocator.Free(part.m_indexAllocation);
+    part.m_vertexAllocation = {};
+    part.m_indexAllocation = {};
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 // SRMeshPart
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-SpatialSurfaceMeshPart::SpatialSurfaceMeshPart(SpatialSurfaceMeshRenderer* owner)
+SpatialSurfaceMeshPart::SpatialSurfaceMeshPart(SpatialSurfaceMeshRenderer* owner, const GUID& id, uint32_t slot)
     : m_owner(owner)
+    , m_id(id)
+    , m_slot(slot)
+    , m_meshData(std::make_shared<MeshData>(
+          owner->m_stagingRing, owner->m_contentCounters, owner->m_vertexCacheCounters, owner->m_meshCache, slot))
 {
     auto identity = DirectX::XMMatrixIdentity();
     m_constantBufferData.modelMatrix = reinterpret_cast<DirectX::XMFLOAT4X4&>(identity);
     m_vertexScale.x = m_vertexScale.y = m_vertexScale.z = 1.0f;
 }
 
-void SpatialSurfaceMeshPart::Update(Surfaces::SpatialSurfaceInfo surfaceInfo)
+bool SpatialSurfaceMeshPart::Update(Surfaces::SpatialSurfaceInfo surfaceInfo)
 {
     m_inUse = true;
-    m_updateInProgress = true;
+    m_surfaceInfo = surfaceInfo;
+
+    const int64_t updateTime = surfaceInfo.UpdateTime().time_since_epoch().count();
+    if (m_hasUpdateTime && updateTime == m_updateTime)
+    {
+        return false;
+    }
+
+    m_updateTime = updateTime;
+    m_hasUpdateTime = true;
+    return true;
+}
+
+bool SpatialSurfaceMeshPart::RestoreFromCache()
+{
+    // the render thread may only stage a mesh while no computation does
+    if (!m_meshData->meshCache || m_meshData->updateInProgress)
+    {
+        return false;
+    }
+
+    MeshCache::Id id;
+    static_assert(sizeof(id.bytes) == sizeof(GUID));
+    memcpy(id.bytes, &m_id, sizeof(id.bytes));
+
+    return m_meshData->meshCache->Read(id, m_updateTime, [this](const MeshCache::Mesh& mesh) { m_meshData->RestoreMesh(mesh); });
+}
+
+void SpatialSurfaceMeshPart::ComputeMesh()
+{
+    m_meshData->updateInProgress = true;
     double TriangleDensity = 750.0; // from Hydrogen
-    auto asyncOpertation = surfaceInfo.TryComputeLatestMeshAsync(TriangleDensity);
-    asyncOpertation.Completed([this](winrt::Windows::Foundation::IAsyncOperation<Surfaces::SpatialSurfaceMesh> result, auto asyncStatus) {
-        Surfaces::SpatialSurfaceMesh mesh = result.GetResults();
-        UpdateMesh(mesh);
-        m_updateInProgress = false;
+    auto asyncOpertation = m_surfaceInfo.TryComputeLatestMeshAsync(TriangleDensity);
+    asyncOpertation.Completed([meshData = m_meshData](
+                                  winrt::Windows::Foundation::IAsyncOperation<Surfaces::SpatialSurfaceMesh> result,
+                                  winrt::Windows::Foundation::AsyncStatus asyncStatus) {
+        try
+        {
+            if (asyncStatus == winrt::Windows::Foundation::AsyncStatus::Completed)
+            {
+                if (Surfaces::SpatialSurfaceMesh mesh = result.GetResults())
+                {
+                    meshData->UpdateMesh(mesh);
+                }
+            }
+        }
+        catch (const winrt::hresult_error&)
+        {
+            // keep the previous mesh, the surface is computed again on its next change
+        }
+
+        // always free the computation, otherwise the part would hold its scheduler slot forever
+        meshData->updateInProgress = false;
     });
 }
 
 void SpatialSurfaceMeshPart::UpdateModelMatrix(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem)
 {
-    if (m_coordinateSystem == nullptr)
+    float4x4 model;
+    if (m_coordinateSystem)
+    {
+        auto modelTransform = m_coordinateSystem.TryGetTransformTo(renderingCoordinateSystem);
+        if (!modelTransform)
+        {
+            return;
+        }
+
+        model = modelTransform.Value();
+    }
+    else if (m_placeByBounds && m_surfaceInfo)
+    {
+        // a restored mesh keeps its position relative to the bounds of the surface, which can still be located
+        auto bounds = m_surfaceInfo.TryGetBounds(renderingCoordinateSystem);
+        if (!bounds)
+        {
+            return;
+        }
+
+        const SpatialBoundingOrientedBox box = bounds.Value();
+        model = make_float4x4_translation(-m_boundsCenter) * make_float4x4_from_quaternion(inverse(m_boundsOrientation)) *
+                make_float4x4_from_quaternion(box.Orientation) * make_float4x4_translation(box.Center);
+    }
+    else
+    {
+        return;
+    }
+
+    float4x4 matrixWinRt = transpose(model);
+    DirectX::XMMATRIX transformMatrix = DirectX::XMLoadFloat4x4(&matrixWinRt);
+    DirectX::XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(m_vertexScale.x, m_vertexScale.y, m_vertexScale.z);
+    DirectX::XMMATRIX result = DirectX::XMMatrixMultiply(transformMatrix, scaleMatrix);
+    DirectX::XMStoreFloat4x4(&m_constantBufferData.modelMatrix, result);
+    m_model = model;
+
+    m_renderingCenter = transform(float3(m_center.x, m_center.y, m_center.z), model);
+    m_renderingHalfAxes[0] = float3(model.m11, model.m12, model.m13) * m_extents.x;
+    m_renderingHalfAxes[1] = float3(model.m21, model.m22, model.m23) * m_extents.y;
+    m_renderingHalfAxes[2] = float3(model.m31, model.m32, model.m33) * m_extents.z;
+}
+
+void SpatialSurfaceMeshPart::SelectLod(float viewDistance)
+{
+    m_viewDistance = viewDistance;
+
+    // a threshold has to be passed by the hysteresis margin before switching to the other side of it
+    uint32_t lod = 0;
+    while (lod + 1 < m_lodCount)
+    {
+        const float threshold = LodDistances[lod] + (lod < m_lod ? -LodHysteresis : LodHysteresis);
+        if (viewDistance < threshold)
+        {
+            break;
+        }
+
+        lod++;
+    }
+
+    m_lod = lod;
+}
+
+void SpatialSurfaceMeshPart::TakePendingMesh()
+{
+    TripleBuffer<StagedMesh>& meshes = m_meshData->meshes;
+    if (!meshes.HasPublished())
+    {
         return;
+    }
 
-    auto modelTransform = m_coordinateSystem.TryGetTransformTo(renderingCoordinateSystem);
-    if (modelTransform)
+    // a mesh which was never submitted is superseded by the newer one
+    meshes.GetReadSlot().Release(*m_meshData->stagingRing, 0);
+    meshes.Acquire();
+
+    const StagedMesh& mesh = meshes.GetReadSlot();
+    m_coordinateSystem = mesh.coordinateSystem;
+    m_placeByBounds = mesh.restored;
+    m_boundsCenter = mesh.boundsCenter;
+    m_boundsOrientation = mesh.boundsOrientation;
+    m_vertexScale = mesh.vertexScale;
+    m_center = mesh.center;
+    m_extents = mesh.extents;
+
+    m_lodCount = mesh.lodCount;
+    uint32_t lodIndexOffset = 0;
+    for (uint32_t lod = 0; lod < mesh.lodCount; lod++)
     {
-        float4x4 matrixWinRt = transpose(modelTransform.Value());
-        DirectX::XMMATRIX transformMatrix = DirectX::XMLoadFloat4x4(&matrixWinRt);
-        DirectX::XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(m_vertexScale.x, m_vertexScale.y, m_vertexScale.z);
-        DirectX::XMMATRIX result = DirectX::XMMatrixMultiply(transformMatrix, scaleMatrix);
-        DirectX::XMStoreFloat4x4(&m_constantBufferData.modelMatrix, result);
+        m_lodIndexOffsets[lod] = lodIndexOffset;
+        m_lodIndexCounts[lod] = mesh.lodIndexCounts[lod];
+        lodIndexOffset += mesh.lodIndexCounts[lod];
     }
+    m_lod = std::min(m_lod, m_lodCount > 0 ? m_lodCount - 1 : 0);
+
+    m_needsUpload = true;
+}
+
+SpatialSurfaceMeshPart::MeshData::MeshData(
+    std::shared_ptr<StagingRing> stagingRing,
+    std::shared_ptr<SRMeshContentCounters> contentCounters,
+    std::shared_ptr<SRMeshVertexCacheCounters> vertexCacheCounters,
+    std::shared_ptr<MeshCache> meshCache,
+    uint32_t slot)
+    : stagingRing(std::move(stagingRing))
+    , contentCounters(std::move(contentCounters))
+    , vertexCacheCounters(std::move(vertexCacheCounters))
+    , meshCache(std::move(meshCache))
+    , slot(slot)
+{
 }
 
-void SpatialSurfaceMeshPart::UpdateMesh(Surfaces::SpatialSurfaceMesh mesh)
+SpatialSurfaceMeshPart::MeshData::~MeshData()
 {
-    m_coordinateSystem = mesh.CoordinateSystem();
+    meshes.ForEachSlot([this](StagedMesh& mesh) { mesh.Release(*stagingRing, 0); });
+}
+
+void SpatialSurfaceMeshPart::MeshData::UpdateMesh(Surfaces::SpatialSurfaceMesh mesh)
+{
+    // the write slot may still hold a mesh the render thread skipped, build the new mesh in place of it
+    StagedMesh& stagedMesh = meshes.GetWriteSlot();
+    stagedMesh.Release(*stagingRing, 0);
+    stagedMesh = {};
+    stagedMesh.coordinateSystem = mesh.CoordinateSystem();
 
     Surfaces::SpatialSurfaceMeshBuffer vertexBuffer = mesh.VertexPositions();
     Surfaces::SpatialSurfaceMeshBuffer indexBuffer = mesh.TriangleIndices();
@@ -316,105 +903,302 @@ void SpatialSurfaceMeshPart::UpdateMesh(Surfaces::SpatialSurfaceMesh mesh)
     uint32_t indexCount = indexBuffer.ElementCount();
     assert((indexCount % 3) == 0);
 
-    if (vertexCount == 0 || indexCount == 0)
+    if (vertexCount != 0 && indexCount != 0)
     {
-        m_indexCount = 0;
-        return;
-    }
-
-    // convert vertices:
-    {
-        Vertex_t* dest = MapVertices(vertexCount);
         winrt::Windows::Storage::Streams::IBuffer vertexData = vertexBuffer.Data();
-        uint8_t* vertexRaw = vertexData.data();
+        winrt::Windows::Storage::Streams::IBuffer indexData = indexBuffer.Data();
         int vertexStride = vertexData.Length() / vertexCount;
         assert(vertexStride == 8); // DirectXPixelFormat::R16G16B16A16IntNormalized
+
         winrt::Windows::Foundation::Numerics::float3 positionScale = mesh.VertexPositionScale();
-        m_vertexScale.x = positionScale.x;
-        m_vertexScale.y = positionScale.y;
-        m_vertexScale.z = positionScale.z;
-        memcpy(dest, vertexRaw, vertexCount * sizeof(Vertex_t));
-        UnmapVertices();
-    }
+        stagedMesh.vertexScale.x = positionScale.x;
+        stagedMesh.vertexScale.y = positionScale.y;
+        stagedMesh.vertexScale.z = positionScale.z;
+        stagedMesh.vertexCount = vertexCount;
+
+        const Vertex_t* vertices = reinterpret_cast<const Vertex_t*>(vertexData.data());
+        const uint16_t* indices = reinterpret_cast<const uint16_t*>(indexData.data());
+
+        // most surfaces are recomputed without any change, skip those before doing any work
+        ContentHash hash;
+        hash.Update(vertices, vertexCount * sizeof(Vertex_t));
+        hash.Update(indices, indexCount * sizeof(uint16_t));
+        hash.UpdateValue(positionScale);
+        const uint64_t contentHash = hash.Finish();
+        if (!HasContentChanged(contentHash))
+        {
+            return;
+        }
 
-    // convert indices
-    {
-        uint16_t* dest = MapIndices(indexCount);
-        winrt::Windows::Storage::Streams::IBuffer indexData = indexBuffer.Data();
-        uint16_t* source = (uint16_t*)indexData.data();
-        for (uint32_t i = 0; i < indexCount; i++)
+        // bounding box for level of detail selection and culling, in meters
+        const SnormBounds bounds = ComputeSnormBounds(&vertices->pos[0], vertexCount);
+        const float scale[3] = {positionScale.x / 32767.0f, positionScale.y / 32767.0f, positionScale.z / 32767.0f};
+        stagedMesh.center = {
+            (bounds.min[0] + bounds.max[0]) * 0.5f * scale[0],
+            (bounds.min[1] + bounds.max[1]) * 0.5f * scale[1],
+            (bounds.min[2] + bounds.max[2]) * 0.5f * scale[2]};
+        stagedMesh.extents = {
+            (bounds.max[0] - bounds.min[0]) * 0.5f * scale[0],
+            (bounds.max[1] - bounds.min[1]) * 0.5f * scale[1],
+            (bounds.max[2] - bounds.min[2]) * 0.5f * scale[2]};
+
+        // reorder the triangles for the post transform vertex cache, which saves vertex shader invocations in both eyes. all levels of
+        // detail are collected in scratch memory since their final size is only known afterwards
+        thread_local VertexCacheOptimizer optimizer;
+        thread_local std::vector<uint16_t> lodIndices;
+        thread_local std::vector<uint16_t> simplifiedIndices;
+        lodIndices.resize(indexCount * 3);
+        simplifiedIndices.resize(indexCount);
+        optimizer.OptimizeTriangleOrder(lodIndices.data(), indices, indexCount, vertexCount);
+
+        const VertexCacheOptimizer::Statistics received = optimizer.Analyze(indices, indexCount, vertexCount);
+        const VertexCacheOptimizer::Statistics optimized = optimizer.Analyze(lodIndices.data(), indexCount, vertexCount);
+        vertexCacheCounters->triangles += received.triangleCount;
+        vertexCacheCounters->vertices += received.vertexCount;
+        vertexCacheCounters->receivedTransforms += received.transformedCount;
+        vertexCacheCounters->optimizedTransforms += optimized.transformedCount;
+
+        // simplify each level from the previous one, and reorder it as well
+        thread_local MeshSimplifier simplifier;
+
+        MeshSimplifier::Positions positions;
+        positions.data = &vertices->pos[0];
+        positions.stride = 4;
+        positions.count = vertexCount;
+        positions.scale[0] = positionScale.x;
+        positions.scale[1] = positionScale.y;
+        positions.scale[2] = positionScale.z;
+
+        stagedMesh.lodCount = 1;
+        stagedMesh.lodIndexCounts[0] = indexCount;
+        stagedMesh.indexCount = indexCount;
+
+        uint16_t* lodLists[MaxLodCount] = {lodIndices.data()};
+        for (uint32_t lod = 1; lod < MaxLodCount; lod++)
+        {
+            const uint32_t sourceCount = stagedMesh.lodIndexCounts[lod - 1];
+            const uint32_t targetCount = static_cast<uint32_t>(indexCount * LodTriangleRatios[lod - 1]) / 3 * 3;
+            const uint32_t count = simplifier.Simplify(
+                simplifiedIndices.data(), lodLists[lod - 1], sourceCount, positions, targetCount, LodMaxErrors[lod - 1]);
+            if (count == 0 || count > sourceCount * (1.0f - MinLodReduction))
+            {
+                break;
+            }
+
+            lodLists[lod] = lodIndices.data() + stagedMesh.indexCount;
+            optimizer.OptimizeTriangleOrder(lodLists[lod], simplifiedIndices.data(), count, vertexCount);
+
+            stagedMesh.lodIndexCounts[lod] = count;
+            stagedMesh.lodCount++;
+            stagedMesh.indexCount += count;
+        }
+
+        // copy the vertices directly into the staging memory, in the order the levels of detail first use them so the vertex fetches
+        // walk through memory. vertices which are not used at all are dropped. the indices follow, rebased into batch indices, and the
+        // render thread only needs to submit them
+        uint8_t* dest = stagedMesh.Allocate(*stagingRing, vertexCount * sizeof(Vertex_t) + stagedMesh.indexCount * sizeof(uint32_t));
+        stagedMesh.vertexCount = optimizer.OptimizeVertexFetch(
+            dest, vertices, vertexCount, sizeof(Vertex_t), lodLists, stagedMesh.lodIndexCounts, stagedMesh.lodCount);
+
+        uint32_t* destIndices = reinterpret_cast<uint32_t*>(dest + stagedMesh.vertexCount * sizeof(Vertex_t));
+        MeshBatchBuilder::RebaseIndices(destIndices, lodIndices.data(), stagedMesh.indexCount, slot);
+
+#ifdef _DEBUG
+        const uint32_t* stagedIndices = stagedMesh.Indices();
+        for (uint32_t i = 0; i < stagedMesh.indexCount; i++)
         {
-            assert(source[i] < vertexCount);
-            dest[i] = source[i];
+            assert((stagedIndices[i] & 0xFFFF) < stagedMesh.vertexCount && (stagedIndices[i] >> 16) == slot);
+        }
+#endif
+
+        // the cached mesh is placed by the bounds of the surface when it is restored, without the coordinate system of the mesh
+        if (meshCache)
+        {
+            Surfaces::SpatialSurfaceInfo surfaceInfo = mesh.SurfaceInfo();
+            if (auto surfaceBounds = surfaceInfo.TryGetBounds(stagedMesh.coordinateSystem))
+            {
+                const SpatialBoundingOrientedBox box = surfaceBounds.Value();
+
+                MeshCache::Id id;
+                const GUID surfaceId = surfaceInfo.Id();
+                memcpy(id.bytes, &surfaceId, sizeof(id.bytes));
+
+                MeshCache::Mesh cachedMesh;
+                cachedMesh.updateTime = surfaceInfo.UpdateTime().time_since_epoch().count();
+                cachedMesh.contentHash = contentHash;
+                memcpy(cachedMesh.vertexScale, &stagedMesh.vertexScale, sizeof(cachedMesh.vertexScale));
+                memcpy(cachedMesh.center, &stagedMesh.center, sizeof(cachedMesh.center));
+                memcpy(cachedMesh.extents, &stagedMesh.extents, sizeof(cachedMesh.extents));
+                memcpy(cachedMesh.boundsCenter, &box.Center, sizeof(cachedMesh.boundsCenter));
+                memcpy(cachedMesh.boundsOrientation, &box.Orientation, sizeof(cachedMesh.boundsOrientation));
+                cachedMesh.vertexCount = stagedMesh.vertexCount;
+                cachedMesh.lodCount = stagedMesh.lodCount;
+                cachedMesh.positions = &stagedMesh.Vertices()->pos[0];
+                for (uint32_t lod = 0; lod < stagedMesh.lodCount; lod++)
+                {
+                    cachedMesh.lodIndexCounts[lod] = stagedMesh.lodIndexCounts[lod];
+                    cachedMesh.indices[lod] = lodLists[lod];
+                }
+
+                meshCache->Store(id, cachedMesh);
+            }
         }
-        UnmapIndices();
     }
-    m_needsUpload = true;
+    else if (!HasContentChanged(0))
+    {
+        return;
+    }
+
+    meshes.Publish();
 }
 
-SpatialSurfaceMeshPart::Vertex_t* SpatialSurfaceMeshPart::MapVertices(uint32_t vertexCount)
+void SpatialSurfaceMeshPart::MeshData::RestoreMesh(const MeshCache::Mesh& mesh)
 {
-    m_vertexCount = vertexCount;
-    if (vertexCount > m_vertexData.size())
-        m_vertexData.resize(vertexCount);
-    return &m_vertexData[0];
+    StagedMesh& stagedMesh = meshes.GetWriteSlot();
+    stagedMesh.Release(*stagingRing, 0);
+    stagedMesh = {};
+    stagedMesh.restored = true;
+    stagedMesh.boundsCenter = {mesh.boundsCenter[0], mesh.boundsCenter[1], mesh.boundsCenter[2]};
+    stagedMesh.boundsOrientation = {
+        mesh.boundsOrientation[0], mesh.boundsOrientation[1], mesh.boundsOrientation[2], mesh.boundsOrientation[3]};
+
+    stagedMesh.vertexScale = {mesh.vertexScale[0], mesh.vertexScale[1], mesh.vertexScale[2]};
+    stagedMesh.center = {mesh.center[0], mesh.center[1], mesh.center[2]};
+    stagedMesh.extents = {mesh.extents[0], mesh.extents[1], mesh.extents[2]};
+    stagedMesh.vertexCount = mesh.vertexCount;
+    stagedMesh.lodCount = std::min(mesh.lodCount, MaxLodCount);
+    for (uint32_t lod = 0; lod < stagedMesh.lodCount; lod++)
+    {
+        stagedMesh.lodIndexCounts[lod] = mesh.lodIndexCounts[lod];
+        stagedMesh.indexCount += mesh.lodIndexCounts[lod];
+    }
+
+    const size_t vertexBytes = mesh.vertexCount * sizeof(Vertex_t);
+    uint8_t* dest = stagedMesh.Allocate(*stagingRing, vertexBytes + stagedMesh.indexCount * sizeof(uint32_t));
+    memcpy(dest, mesh.positions, vertexBytes);
+    uint32_t* destIndices = reinterpret_cast<uint32_t*>(dest + vertexBytes);
+    for (uint32_t lod = 0; lod < stagedMesh.lodCount; lod++)
+    {
+        MeshBatchBuilder::RebaseIndices(destIndices, mesh.indices[lod], stagedMesh.lodIndexCounts[lod], slot);
+        destIndices += stagedMesh.lodIndexCounts[lod];
+    }
+
+    // a later computation of the same mesh is recognized as unchanged
+    {
+        std::scoped_lock lock(contentMutex);
+        contentHash = mesh.contentHash;
+        hasContentHash = true;
+    }
+
+    meshes.Publish();
 }
 
-void SpatialSurfaceMeshPart::UnmapVertices()
+bool SpatialSurfaceMeshPart::MeshData::HasContentChanged(uint64_t hash)
 {
+    std::scoped_lock lock(contentMutex);
+    if (hasContentHash && hash == contentHash)
+    {
+        contentCounters->hits++;
+        return false;
+    }
+
+    contentHash = hash;
+    hasContentHash = true;
+    contentCounters->misses++;
+    return true;
 }
 
-uint16_t* SpatialSurfaceMeshPart::MapIndices(uint32_t indexCount)
+uint8_t* SpatialSurfaceMeshPart::StagedMesh::Allocate(StagingRing& stagingRing, size_t size)
 {
-    m_indexCount = indexCount;
-    if (indexCount > m_indexData.size())
-        m_indexData.resize(indexCount);
-    return &m_indexData[0];
+    allocation = stagingRing.Allocate(size);
+    if (allocation)
+    {
+        return allocation.data;
+    }
+
+    // the staging ring is exhausted, fall back to a heap allocation
+    overflow.resize(size);
+    return overflow.data();
 }
 
-void SpatialSurfaceMeshPart::UnmapIndices()
+void SpatialSurfaceMeshPart::StagedMesh::Release(StagingRing& stagingRing, uint64_t fence)
 {
+    stagingRing.Release(allocation, fence);
+    allocation = {};
+    overflow = {};
 }
 
-void SpatialSurfaceMeshPart::UploadData()
+void SpatialSurfaceMeshPart::UploadData(uint64_t frameIndex)
 {
-    if (m_vertexCount > m_allocatedVertexCount)
+    m_needsUpload = false;
+    m_owner->ReleaseArenaAllocations(*this);
+
+    StagedMesh& submitMesh = m_meshData->meshes.GetReadSlot();
+
+    m_vertexCount = submitMesh.vertexCount;
+    m_indexCount = submitMesh.indexCount;
+    ExtractOccluder(submitMesh);
+    if (m_indexCount == 0)
     {
-        m_vertexBuffer = nullptr;
+        submitMesh.Release(*m_meshData->stagingRing, frameIndex);
+        return;
+    }
 
-        const int alignment = 1024;
-        m_allocatedVertexCount = ((m_vertexCount + alignment - 1) / alignment) * alignment; // align to reasonable size
+    m_vertexAllocation = m_owner->AllocateFromArena(m_owner->m_vertexArena, m_vertexCount);
+    m_indexAllocation = m_owner->AllocateFromArena(m_owner->m_indexArena, m_indexCount);
 
-        const int elementSize = sizeof(Vertex_t);
-        const CD3D11_BUFFER_DESC vertexBufferDesc(
-            m_allocatedVertexCount * elementSize, D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+    // upload data into the part's ranges of the arenas
+    const uint32_t vertexOffset = m_owner->m_vertexArena.allocator.GetOffset(m_vertexAllocation);
+    const uint32_t indexOffset = m_owner->m_indexArena.allocator.GetOffset(m_indexAllocation);
+    const uint32_t vertexSize = m_owner->m_vertexArena.elementSize;
+    const uint32_t indexSize = m_owner->m_indexArena.elementSize;
+    const D3D11_BOX vertexBox = {vertexOffset * vertexSize, 0, 0, (vertexOffset + m_vertexCount) * vertexSize, 1, 1};
+    const D3D11_BOX indexBox = {indexOffset * indexSize, 0, 0, (indexOffset + m_indexCount) * indexSize, 1, 1};
 
-        winrt::check_hresult(m_owner->m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, nullptr, m_vertexBuffer.put()));
-    }
+    m_owner->m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        context->UpdateSubresource(m_owner->m_vertexArena.buffer.get(), 0, &vertexBox, submitMesh.Vertices(), 0, 0);
+        context->UpdateSubresource(m_owner->m_indexArena.buffer.get(), 0, &indexBox, submitMesh.Indices(), 0, 0);
+    });
 
-    if (m_indexCount > m_allocatedIndexCount)
-    {
-        m_indexBuffer = nullptr;
-        const int alignment = 3 * 1024;
-        m_allocatedIndexCount = ((m_indexCount + alignment - 1) / alignment) * alignment; // align to reasonable size
+    // the indices might have landed where those of another part have been before, the batch has to gather them again
+    m_owner->m_batch.Invalidate();
 
-        const int elementSize = sizeof(uint16_t);
-        const CD3D11_BUFFER_DESC indexBufferDesc(
-            m_allocatedIndexCount * elementSize, D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+    // the staging memory can be reused once this frame is done
+    submitMesh.Release(*m_meshData->stagingRing, frameIndex);
+}
 
-        winrt::check_hresult(m_owner->m_deviceResources->GetD3DDevice()->CreateBuffer(&indexBufferDesc, nullptr, m_indexBuffer.put()));
+void SpatialSurfaceMeshPart::ExtractOccluder(const StagedMesh& mesh)
+{
+    m_occluderPositions.clear();
+    m_occluderIndices.clear();
+    if (mesh.lodCount == 0)
+    {
+        return;
     }
 
-    // upload data
-    D3D11_MAPPED_SUBRESOURCE resource;
+    // the coarsest level of detail is the last one. its batch indices carry the vertex index in the low half
+    const uint32_t lodIndexCount = mesh.lodIndexCounts[mesh.lodCount - 1];
+    const uint32_t* indices = mesh.Indices() + (mesh.indexCount - lodIndexCount);
+    const Vertex_t* vertices = mesh.Vertices();
+    const float scale[3] = {mesh.vertexScale.x / 32767.0f, mesh.vertexScale.y / 32767.0f, mesh.vertexScale.z / 32767.0f};
 
-    m_owner->m_deviceResources->UseD3DDeviceContext([&](auto context) {
-        context->Map(m_vertexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
-        memcpy(resource.pData, &m_vertexData[0], sizeof(Vertex_t) * m_vertexCount);
-        context->Unmap(m_vertexBuffer.get(), 0);
+    constexpr uint32_t Unused = ~0u;
+    std::vector<uint32_t>& remap = m_owner->m_occluderRemap;
+    remap.assign(mesh.vertexCount, Unused);
 
-        context->Map(m_indexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
-        memcpy(resource.pData, &m_indexData[0], sizeof(uint16_t) * m_indexCount);
-        context->Unmap(m_indexBuffer.get(), 0);
-    });
+    m_occluderIndices.resize(lodIndexCount);
+    for (uint32_t i = 0; i < lodIndexCount; i++)
+    {
+        const uint32_t v = indices[i] & 0xFFFF;
+        if (remap[v] == Unused)
+        {
+            remap[v] = static_cast<uint32_t>(m_occluderPositions.size() / 3);
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                // same decoding as in the vertex shader, -32768 is -1 as well
+                m_occluderPositions.push_back(std::max<int16_t>(vertices[v].pos[k], -32767) * scale[k]);
+            }
+        }
+        m_occluderIndices[i] = static_cast<uint16_t>(remap[v]);
+    }
 }
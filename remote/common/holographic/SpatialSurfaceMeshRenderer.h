@@ -11,12 +11,24 @@
 
 #pragma once
 
+#include <BoundingVolumePolicy.h>
 #include <DeviceResourcesD3D11.h>
+#include <FlatHashMap.h>
+#include <MeshBatchBuilder.h>
+#include <MeshCache.h>
+#include <MeshComputeScheduler.h>
+#include <OcclusionCuller.h>
+#include <StagingRing.h>
+#include <TlsfAllocator.h>
+#include <TripleBuffer.h>
 #include <Utils.h>
+#include <VertexCacheOptimizer.h>
 
 #include <winrt/windows.perception.spatial.surfaces.h>
 
+#include <filesystem>
 #include <future>
+#include <mutex>
 #include <string>
 
 // forward
@@ -32,6 +44,24 @@ static_assert(
     (sizeof(SRMeshConstantBuffer) % (sizeof(float) * 4)) == 0,
     "SR mesh constant buffer size must be 16-byte aligned (16 bytes is the length of four floats).");
 
+// Counts how often a recomputed surface mesh had the same content as the previous one (hit), so that copying and uploading it was
+// skipped, and how often it changed (miss).
+struct SRMeshContentCounters
+{
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+};
+
+// Vertex shader invocations of the full resolution meshes on a simulated vertex cache, as received from the runtime and after the
+// triangles were reordered.
+struct SRMeshVertexCacheCounters
+{
+    std::atomic<uint64_t> triangles = 0;
+    std::atomic<uint64_t> vertices = 0;
+    std::atomic<uint64_t> receivedTransforms = 0;
+    std::atomic<uint64_t> optimizedTransforms = 0;
+};
+
 // represents a single piece of mesh (SpatialSurfaceMesh)
 class SpatialSurfaceMeshPart
 {
@@ -41,43 +71,154 @@ public:
         // float pos[4];
         int16_t pos[4];
     };
-    SpatialSurfaceMeshPart(SpatialSurfaceMeshRenderer* owner);
-    void Update(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo surfaceInfo);
 
-    void UpdateMesh(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh mesh);
+    // full resolution mesh plus up to two simplified versions of it
+    static constexpr uint32_t MaxLodCount = 3;
+
+    SpatialSurfaceMeshPart(SpatialSurfaceMeshRenderer* owner, const GUID& id, uint32_t slot);
+
+    // records the latest surface info, the mesh is computed once the owner schedules it. returns false if the surface did not change
+    // since the last call
+    bool Update(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo surfaceInfo);
 
     bool IsInUse() const
     {
-        return m_inUse || m_updateInProgress;
+        return m_inUse || m_meshData->updateInProgress;
     }
 
 private:
-    Vertex_t* MapVertices(uint32_t vertexCount);
-    void UnmapVertices();
-    uint16_t* MapIndices(uint32_t indexCount);
-    void UnmapIndices();
-    void UploadData();
+    // Vertices and indices of one mesh, copied straight out of the SpatialSurfaceMesh buffers into staging memory.
+    struct StagedMesh
+    {
+        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem coordinateSystem = nullptr;
+        DirectX::XMFLOAT3 vertexScale = {1.0f, 1.0f, 1.0f};
+        // center of the bounding box in the mesh coordinate system
+        DirectX::XMFLOAT3 center = {0.0f, 0.0f, 0.0f};
+        DirectX::XMFLOAT3 extents = {0.0f, 0.0f, 0.0f};
+        uint32_t vertexCount = 0;
+        // total over all levels of detail
+        uint32_t indexCount = 0;
+        uint32_t lodCount = 0;
+        uint32_t lodIndexCounts[MaxLodCount] = {};
+
+        // a mesh restored from the mesh cache has no coordinate system, it is placed relative to the bounds of its surface instead
+        bool restored = false;
+        winrt::Windows::Foundation::Numerics::float3 boundsCenter = {0.0f, 0.0f, 0.0f};
+        winrt::Windows::Foundation::Numerics::quaternion boundsOrientation = {0.0f, 0.0f, 0.0f, 1.0f};
+
+        // Vertices followed by the batch indices (see MeshBatchBuilder) of each level of detail. Lives in the staging ring, or in
+        // overflow if the ring was full.
+        StagingRing::Allocation allocation;
+        std::vector<uint8_t> overflow;
+
+        uint8_t* Allocate(StagingRing& stagingRing, size_t size);
+        void Release(StagingRing& stagingRing, uint64_t fence);
+
+        const Vertex_t* Vertices() const
+        {
+            return reinterpret_cast<const Vertex_t*>(allocation ? allocation.data : overflow.data());
+        }
+
+        const uint32_t* Indices() const
+        {
+            return reinterpret_cast<const uint32_t*>(Vertices() + vertexCount);
+        }
+    };
+
+    // Mesh data written by the asynchronous mesh computation. It is shared with the completion handler, so that the part itself can be
+    // moved around inside the mesh part table while a computation is in flight.
+    struct MeshData
+    {
+        MeshData(
+            std::shared_ptr<StagingRing> stagingRing,
+            std::shared_ptr<SRMeshContentCounters> contentCounters,
+            std::shared_ptr<SRMeshVertexCacheCounters> vertexCacheCounters,
+            std::shared_ptr<MeshCache> meshCache,
+            uint32_t slot);
+        ~MeshData();
+
+        void UpdateMesh(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh mesh);
+
+        // Stages a mesh read from the mesh cache, like UpdateMesh does for a computed one. Must not be called while a computation is in
+        // progress.
+        void RestoreMesh(const MeshCache::Mesh& mesh);
+
+        // Records the content hash of a new mesh. Returns false if it is the same as the one of the previous mesh, in which case the
+        // previous mesh (and its coordinate system, which belongs to the same surface) stays in use.
+        bool HasContentChanged(uint64_t hash);
+
+        std::atomic<bool> updateInProgress = false;
+        std::shared_ptr<StagingRing> stagingRing;
+        std::shared_ptr<SRMeshContentCounters> contentCounters;
+        std::shared_ptr<SRMeshVertexCacheCounters> vertexCacheCounters;
+        // optional, computed meshes are stored in it
+        std::shared_ptr<MeshCache> meshCache;
+        // slot of the part, baked into the staged indices
+        const uint32_t slot;
+
+        // hash of the last mesh which was staged, to detect recomputations without any changes
+        std::mutex contentMutex;
+        bool hasContentHash = false;
+        uint64_t contentHash = 0;
+
+        // Meshes handed from the completion handler to the render thread. The scheduler of the owner never runs two computations of
+        // the same part at once, so there is a single producer. The read slot holds the mesh taken over by the render thread until it
+        // is submitted.
+        TripleBuffer<StagedMesh> meshes;
+    };
+
+    void ComputeMesh();
+    bool RestoreFromCache();
+    void TakePendingMesh();
+    void UploadData(uint64_t frameIndex);
+    void ExtractOccluder(const StagedMesh& mesh);
     void UpdateModelMatrix(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
+    void SelectLod(float viewDistance);
 
     friend class SpatialSurfaceMeshRenderer;
     SpatialSurfaceMeshRenderer* m_owner;
+    GUID m_id;
+    uint32_t m_slot;
+    winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo m_surfaceInfo = nullptr;
+    // update time of the surface info, in ticks
+    int64_t m_updateTime = 0;
+    bool m_hasUpdateTime = false;
     bool m_inUse = true;
     bool m_needsUpload = false;
-    bool m_updateInProgress = false;
 
-    GUID m_ID;
-    uint32_t m_allocatedVertexCount = 0;
-    uint32_t m_allocatedIndexCount = 0;
     uint32_t m_vertexCount = 0;
     uint32_t m_indexCount = 0;
-    winrt::com_ptr<ID3D11Buffer> m_vertexBuffer;
-    winrt::com_ptr<ID3D11Buffer> m_indexBuffer;
+
+    // ranges in the vertex and index arenas of the owner
+    TlsfAllocator::Allocation m_vertexAllocation;
+    TlsfAllocator::Allocation m_indexAllocation;
+
+    // the levels of detail are stored back to back in the index allocation
+    uint32_t m_lodCount = 0;
+    uint32_t m_lodIndexOffsets[MaxLodCount] = {};
+    uint32_t m_lodIndexCounts[MaxLodCount] = {};
+    uint32_t m_lod = 0;
+    float m_viewDistance = 0.0f;
+    DirectX::XMFLOAT3 m_center = {0.0f, 0.0f, 0.0f};
+    winrt::Windows::Foundation::Numerics::float3 m_renderingCenter = {0.0f, 0.0f, 0.0f};
+
+    // half size of the bounding box in the mesh coordinate system, and its axes scaled by it in rendering space
+    DirectX::XMFLOAT3 m_extents = {0.0f, 0.0f, 0.0f};
+    winrt::Windows::Foundation::Numerics::float3 m_renderingHalfAxes[3] = {};
 
     winrt::Windows::Perception::Spatial::SpatialCoordinateSystem m_coordinateSystem = nullptr;
 
-    // double buffered data:
-    std::vector<Vertex_t> m_vertexData;
-    std::vector<uint16_t> m_indexData;
+    // placement of a restored mesh, the bounds of the surface in the mesh coordinate system
+    bool m_placeByBounds = false;
+    winrt::Windows::Foundation::Numerics::float3 m_boundsCenter = {0.0f, 0.0f, 0.0f};
+    winrt::Windows::Foundation::Numerics::quaternion m_boundsOrientation = {0.0f, 0.0f, 0.0f, 1.0f};
+
+    // coarsest level of detail in meters in the mesh coordinate system, with only the vertices it uses, for occlusion culling
+    std::vector<float> m_occluderPositions;
+    std::vector<uint16_t> m_occluderIndices;
+    winrt::Windows::Foundation::Numerics::float4x4 m_model = winrt::Windows::Foundation::Numerics::float4x4::identity();
+
+    std::shared_ptr<MeshData> m_meshData;
     SRMeshConstantBuffer m_constantBufferData;
     DirectX::XMFLOAT3 m_vertexScale;
 };
@@ -86,23 +227,128 @@ private:
 class SpatialSurfaceMeshRenderer
 {
 public:
-    SpatialSurfaceMeshRenderer(const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources);
+    // If meshCacheFile is set, computed meshes are kept in that file. Surfaces which did not change since their mesh was stored are
+    // restored from it instead of being computed again, also across sessions.
+    SpatialSurfaceMeshRenderer(
+        const std::shared_ptr<DXHelper::DeviceResourcesD3D11>& deviceResources, const std::filesystem::path& meshCacheFile = {});
     virtual ~SpatialSurfaceMeshRenderer();
 
     void Update(
         winrt::Windows::Perception::PerceptionTimestamp timestamp,
         winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
 
-    void Render(bool isStereo);
+    void Render(
+        bool isStereo, winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum> cullingFrustum);
+
+    // Rasterizes the coarsest level of detail of the parts within the frustum into occlusionCuller, so that holograms behind the
+    // surfaces can be culled. Call it after OcclusionCuller::BeginFrame with the view projections of the rendering coordinate system.
+    void RenderOccluders(
+        OcclusionCuller& occlusionCuller,
+        winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum> cullingFrustum);
 
     void CreateDeviceDependentResources();
     void ReleaseDeviceDependentResources();
 
+    // Parts far away from the viewer use simplified meshes. If the selected levels of detail still exceed the triangle budget, the
+    // farthest parts are reduced further.
+    void SetTriangleBudget(uint32_t triangleBudget)
+    {
+        m_triangleBudget = triangleBudget;
+    }
+
+    uint32_t GetSelectedTriangleCount() const
+    {
+        return m_selectedTriangleCount;
+    }
+
+    // number of parts drawn and skipped by frustum culling during the last call to Render
+    uint32_t GetDrawnPartCount() const
+    {
+        return m_drawnPartCount;
+    }
+
+    uint32_t GetCulledPartCount() const
+    {
+        return m_culledPartCount;
+    }
+
+    using ComputeScheduler = MeshComputeScheduler<GUID, Utils::GUIDHasher>;
+
+    const ComputeScheduler::Statistics& GetMeshComputeStatistics() const
+    {
+        return m_computeScheduler.GetStatistics();
+    }
+
+    uint64_t GetContentHashHitCount() const
+    {
+        return m_contentCounters->hits;
+    }
+
+    uint64_t GetContentHashMissCount() const
+    {
+        return m_contentCounters->misses;
+    }
+
+    // ACMR (vertex shader invocations per triangle) and ATVR (per vertex) of the full resolution meshes before and after reordering
+    VertexCacheOptimizer::Statistics GetReceivedVertexCacheStatistics() const
+    {
+        return {m_vertexCacheCounters->triangles, m_vertexCacheCounters->vertices, m_vertexCacheCounters->receivedTransforms};
+    }
+
+    VertexCacheOptimizer::Statistics GetOptimizedVertexCacheStatistics() const
+    {
+        return {m_vertexCacheCounters->triangles, m_vertexCacheCounters->vertices, m_vertexCacheCounters->optimizedTransforms};
+    }
+
+    MeshCache::Statistics GetMeshCacheStatistics() const
+    {
+        return m_meshCache ? m_meshCache->GetStatistics() : MeshCache::Statistics();
+    }
+
+    TlsfAllocator::Statistics GetVertexArenaStatistics() const
+    {
+        return m_vertexArena.allocator.GetStatistics();
+    }
+
+    TlsfAllocator::Statistics GetIndexArenaStatistics() const
+    {
+        return m_indexArena.allocator.GetStatistics();
+    }
+
 private:
+    // one large vertex or index buffer which all mesh parts suballocate from, sizes are in elements
+    struct MeshArena
+    {
+        MeshArena(uint32_t elementSize, UINT bindFlags, UINT miscFlags, uint32_t capacity, uint32_t minBlockSize);
+
+        const uint32_t elementSize;
+        const UINT bindFlags;
+        const UINT miscFlags;
+        TlsfAllocator allocator;
+        winrt::com_ptr<ID3D11Buffer> buffer;
+        // raw view for fetching from the buffer in shaders, if it is bound as a shader resource
+        winrt::com_ptr<ID3D11ShaderResourceView> view;
+    };
+
     void OnObservedSurfaceChanged();
     void OnLocatibilityChanged(
         const winrt::Windows::Perception::Spatial::SpatialLocator& spatialLocator, const winrt::Windows::Foundation::IInspectable&);
     SpatialSurfaceMeshPart* GetOrCreateMeshPart(winrt::guid id);
+    void ClearMeshParts();
+    void RetireComputation(const SpatialSurfaceMeshPart& part);
+    uint32_t AllocatePartSlot();
+    void FreePartSlot(uint32_t slot);
+    void SelectLevelsOfDetail(const winrt::Windows::Foundation::Numerics::float3& viewPosition);
+    ComputeScheduler::PriorityInputs GetComputePriorityInputs(
+        const SpatialSurfaceMeshPart& part,
+        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem,
+        const winrt::Windows::Foundation::Numerics::float3& viewPosition,
+        const winrt::Windows::Foundation::Numerics::float3& viewForward) const;
+
+    TlsfAllocator::Allocation AllocateFromArena(MeshArena& arena, uint32_t count);
+    void RebuildArena(MeshArena& arena, uint32_t capacity);
+    void ReleaseArenaAllocations(SpatialSurfaceMeshPart& part);
+    bool ReserveBatchBuffers(uint32_t indexCount, uint32_t partDataCount);
 
 private:
     friend class SpatialSurfaceMeshPart;
@@ -116,26 +362,68 @@ private:
     winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceObserver m_surfaceObserver = nullptr;
     winrt::event_token m_observedSurfaceChangedToken;
 
-    // mesh parts
-    using MeshPartMap = std::map<GUID, std::unique_ptr<SpatialSurfaceMeshPart>, Utils::GUIDComparer>;
+    // mesh parts, stored by value in a flat hash map to keep the per frame iteration cache friendly
+    using MeshPartMap = Utils::FlatHashMap<GUID, SpatialSurfaceMeshPart, Utils::GUIDHasher>;
     MeshPartMap m_meshParts;
+    // set when tracking is lost, the parts are dropped on the next update
+    std::atomic<bool> m_clearMeshParts = false;
+
+    // limits and orders the asynchronous mesh computations
+    ComputeScheduler m_computeScheduler;
+
+    // computations of removed parts, they keep their scheduler slot until they finished
+    struct RetiringComputation
+    {
+        GUID id;
+        std::shared_ptr<SpatialSurfaceMeshPart::MeshData> meshData;
+    };
+    std::vector<RetiringComputation> m_retiringComputations;
+
+    // staging memory the asynchronous mesh computations copy the mesh data into, retired once per frame
+    std::shared_ptr<StagingRing> m_stagingRing;
+    std::shared_ptr<SRMeshContentCounters> m_contentCounters;
+    std::shared_ptr<SRMeshVertexCacheCounters> m_vertexCacheCounters;
+    std::shared_ptr<MeshCache> m_meshCache;
+    uint64_t m_frameIndex = 0;
+
+    // shared vertex and index buffers. the vertex shader fetches the vertices itself, the index ranges of the drawn parts are copied
+    // into the batch index buffer
+    MeshArena m_vertexArena;
+    MeshArena m_indexArena;
+
+    // every part has a slot in the per part data, which is referenced by its batch indices
+    std::vector<uint32_t> m_freePartSlots;
+    uint32_t m_partSlotCount = 0;
+
+    // all visible parts are drawn with a single draw call
+    MeshBatchBuilder m_batch;
+    winrt::com_ptr<ID3D11Buffer> m_batchIndexBuffer;
+    uint32_t m_batchIndexCapacity = 0;
+    winrt::com_ptr<ID3D11Buffer> m_partDataBuffer;
+    winrt::com_ptr<ID3D11ShaderResourceView> m_partDataView;
+    uint32_t m_partDataCapacity = 0;
+
+    // level of detail selection
+    uint32_t m_triangleBudget;
+    uint32_t m_selectedTriangleCount = 0;
+    std::vector<SpatialSurfaceMeshPart*> m_partsByDistance;
+
+    // scratch memory for extracting occluders
+    std::vector<uint32_t> m_occluderRemap;
 
     // rendering
     bool m_zfillOnly = false;
+    uint32_t m_drawnPartCount = 0;
+    uint32_t m_culledPartCount = 0;
     std::atomic<bool> m_loadingComplete = false;
-    winrt::com_ptr<ID3D11InputLayout> m_inputLayout;
 
     winrt::com_ptr<ID3D11VertexShader> m_vertexShader;
     winrt::com_ptr<ID3D11GeometryShader> m_geometryShader;
     winrt::com_ptr<ID3D11PixelShader> m_pixelShader;
 
-    winrt::com_ptr<ID3D11Buffer> m_modelConstantBuffer;
-
     winrt::Windows::Perception::Spatial::SpatialLocator m_spatialLocator = nullptr;
     winrt::Windows::Perception::Spatial::SpatialLocator::LocatabilityChanged_revoker m_spatialLocatorLocabilityChangedEventRevoker;
 
-    // A attached frame of reference based on m_spatialLocator.
-    winrt::Windows::Perception::Spatial::SpatialLocatorAttachedFrameOfReference m_attachedFrameOfReference = nullptr;
-
-    std::chrono::time_point<std::chrono::steady_clock> m_boundingVolumeUpdateTime;
+    // decides when and where to move the bounding volume of the observer
+    BoundingVolumePolicy m_boundingVolumePolicy;
 };
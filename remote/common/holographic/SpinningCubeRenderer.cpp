@@ -159,6 +159,12 @@ void SpinningCubeRenderer::Render(bool isStereo, winrt::Windows::Foundation::IRe
         return;
     }
 
+    // Occlusion culling
+    if (m_occlusionCuller && !m_occlusionCuller->IsSphereVisible(&GetPosition().x, m_boundingSphereRadius))
+    {
+        return;
+    }
+
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
         ID3D11Buffer* pBufferToSet = nullptr;
 
@@ -12,6 +12,7 @@
 #pragma once
 
 #include <DeviceResourcesD3D11.h>
+#include <OcclusionCuller.h>
 #include <SimpleColor_ShaderStructures.h>
 
 #include <winrt/Windows.UI.Input.Spatial.h>
@@ -61,6 +62,12 @@ public:
     }
     void TogglePauseState();
 
+    // Optional, the cube is not drawn if it is hidden behind the occluders rendered into the culler for the current camera.
+    void SetOcclusionCuller(std::shared_ptr<OcclusionCuller> occlusionCuller)
+    {
+        m_occlusionCuller = std::move(occlusionCuller);
+    }
+
 private:
     enum class PauseState
     {
@@ -72,6 +79,7 @@ private:
 
     // Cached pointer to device resources.
     std::shared_ptr<DXHelper::DeviceResourcesD3D11> m_deviceResources;
+    std::shared_ptr<OcclusionCuller> m_occlusionCuller;
 
     // Direct3D resources for cube geometry.
     winrt::com_ptr<ID3D11InputLayout> m_inputLayout;
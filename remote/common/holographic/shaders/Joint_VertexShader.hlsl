@@ -0,0 +1,88 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// A constant buffer that stores the model transform.
+cbuffer ModelConstantBuffer : register(b0)
+{
+    float4x4 model;
+};
+
+// A constant buffer that stores each set of view and projection matrices in column-major format.
+cbuffer ViewProjectionConstantBuffer : register(b1)
+{
+    float4x4 viewProjection[2];
+};
+
+// A constant buffer that stores the number of views each joint is drawn to, the instance step rate of the joints.
+cbuffer JointConstantBuffer : register(b2)
+{
+    uint viewCount;
+};
+
+// Per-vertex data used as input to the vertex shader.
+// The vertex is one of the prototype joint mesh: x and y are in units of radius / sqrt(2), z and w are the weights of the height of
+// its center and of its length along -z. The joint is per instance (see VertexPacking::PackedJoint).
+struct VertexShaderInput
+{
+    float4      pos         : POSITION;
+    min16float3 color       : COLOR0;
+    float3      jointPos    : JOINTPOSITION;
+    float4      orientation : JOINTORIENTATION;
+    float2      size        : JOINTSIZE;        // length, radius
+    uint        instId      : SV_InstanceID;
+};
+
+// Per-vertex data passed to the geometry shader.
+// Note that the render target array index will be set by the geometry shader
+// using the value of viewId.
+struct VertexShaderOutput
+{
+    float4      pos     : SV_POSITION;
+    min16float3 color   : COLOR0;
+    uint        viewId  : TEXCOORD0;  // SV_InstanceID % viewCount
+};
+
+// Simple shader to do vertex processing on the GPU.
+VertexShaderOutput main(VertexShaderInput input)
+{
+    VertexShaderOutput output;
+
+    // Scale the prototype to the size of the joint.
+    float jointLength = input.size.x;
+    float jointRadius = input.size.y;
+    float centerHeight = min(jointRadius, 0.5f * jointLength);
+    float3 offset = float3(input.pos.xy * jointRadius * 0.70710678f, -(input.pos.z * centerHeight + input.pos.w * jointLength));
+
+    // Rotate by the orientation, q * v * conjugate(q), and move to the position of the joint.
+    float4 q = normalize(input.orientation);
+    offset += 2.0f * cross(q.xyz, cross(q.xyz, offset) + q.w * offset);
+    float4 pos = float4(input.jointPos + offset, 1.0f);
+
+    // Note which view this vertex has been sent to. Used for matrix lookup.
+    // Each joint is viewCount instances, one for each view.
+    int idx = input.instId % viewCount;
+
+    // Transform the vertex position into world space.
+    pos = mul(pos, model);
+
+    // Correct for perspective and project the vertex position onto the screen.
+    pos = mul(pos, viewProjection[idx]);
+    output.pos = pos;
+
+    // Pass the color through without modification.
+    output.color = input.color;
+
+    // Set the instance ID. The pass-through geometry shader will set the
+    // render target array index to whatever value is set here.
+    output.viewId = idx;
+
+    return output;
+}
@@ -9,12 +9,19 @@
 //
 //*********************************************************
 
-// A constant buffer that stores the model transform.
-cbuffer SRMeshConstantBuffer : register(b0)
+// Per part data, indexed by the slot of the part (see MeshBatchBuilder).
+struct PartData
 {
     float4x4 model;
+    uint     baseVertex;
+    uint3    padding;
 };
 
+StructuredBuffer<PartData> parts : register(t0);
+
+// Vertices of all parts, four SNORM int16 components each.
+ByteAddressBuffer vertices : register(t1);
+
 // A constant buffer that stores each set of view and projection matrices in column-major format.
 cbuffer ViewProjectionConstantBuffer : register(b1)
 {
@@ -22,9 +29,10 @@ cbuffer ViewProjectionConstantBuffer : register(b1)
 };
 
 // Per-vertex data used as input to the vertex shader.
+// The vertex id is a batch index: slot of the part in the high 16 bits, vertex within the part in the low 16 bits.
 struct VertexShaderInput
 {
-    float4  pos      : POSITION;
+    uint    vertexId : SV_VertexID;
     uint    instId   : SV_InstanceID;
 };
 
@@ -41,7 +49,13 @@ struct VertexShaderOutput
 VertexShaderOutput main(VertexShaderInput input)
 {
     VertexShaderOutput output;
-    float4 pos = float4(input.pos.xyz, 1.0f);
+
+    PartData part = parts[input.vertexId >> 16];
+    uint2 packed = vertices.Load2((part.baseVertex + (input.vertexId & 0xFFFF)) * 8);
+
+    // Sign extend the int16 components and convert them like the R16G16B16A16_SNORM format does.
+    int3 snorm = int3(int(packed.x << 16) >> 16, int(packed.x) >> 16, int(packed.y << 16) >> 16);
+    float4 pos = float4(max(float3(snorm) / 32767.0f, -1.0f), 1.0f);
 
     // Note which view this vertex has been sent to. Used for matrix lookup.
     // Taking the modulo of the instance ID allows geometry instancing to be used
@@ -50,7 +64,7 @@ VertexShaderOutput main(VertexShaderInput input)
     int idx = input.instId % 2;
 
     // Transform the vertex position into world space.
-    pos = mul(pos, model);
+    pos = mul(pos, part.model);
 
     // Correct for perspective and project the vertex position onto the screen.
     pos = mul(pos, viewProjection[idx]);
@@ -22,7 +22,15 @@ cbuffer ViewProjectionConstantBuffer : register(b1)
     float4x4 viewProjection[2];
 };
 
+// A constant buffer that stores the bounds the positions are quantized to (see VertexPacking).
+cbuffer SUQuantizationConstantBuffer : register(b2)
+{
+    float3 positionOrigin;
+    float3 positionExtent;
+};
+
 // Per-vertex data used as input to the vertex shader.
+// The position is SNORM int16, the uv half float and the color UNORM int8.
 struct VertexShaderInput
 {
     float3      pos     : POSITION;
@@ -46,7 +54,7 @@ struct VertexShaderOutput
 VertexShaderOutput main(VertexShaderInput input)
 {
     VertexShaderOutput output;
-    float4 pos = float4(input.pos, 1.0f);
+    float4 pos = float4(input.pos * positionExtent + positionOrigin, 1.0f);
 
     // Note which view this vertex has been sent to. Used for matrix lookup.
     // Taking the modulo of the instance ID allows geometry instancing to be used
@@ -0,0 +1,319 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <AsyncUpdatePublisher.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+    struct Scene
+    {
+        uint32_t version;
+        size_t vertexCount;
+    };
+
+    // Built from a scene and never changed afterwards, the checksum tells whether the render thread sees all of it.
+    struct Geometry
+    {
+        uint32_t version = 0;
+        std::vector<float> vertices;
+        double checksum = 0.0;
+    };
+
+    using Publisher = AsyncUpdatePublisher<Scene, Geometry>;
+
+    std::shared_ptr<const Geometry> BuildGeometry(const Scene& scene)
+    {
+        auto geometry = std::make_shared<Geometry>();
+        geometry->version = scene.version;
+        geometry->vertices.resize(scene.vertexCount * 3);
+        Tests::Random random(scene.version + 1);
+        for (float& coordinate : geometry->vertices)
+        {
+            coordinate = random.NextFloat(-5.0f, 5.0f);
+            geometry->checksum += coordinate;
+        }
+        return geometry;
+    }
+
+    bool IsComplete(const Geometry& geometry)
+    {
+        double checksum = 0.0;
+        for (float coordinate : geometry.vertices)
+        {
+            checksum += coordinate;
+        }
+        return checksum == geometry.checksum;
+    }
+
+    // The previous design of the scene understanding renderer: the update holds the lock of the renderer while it builds the geometry,
+    // and the render thread takes the lock every frame.
+    class LockedPublisher
+    {
+    public:
+        void SetSource(std::shared_ptr<const Scene> source)
+        {
+            std::lock_guard lock(m_mutex);
+            m_source = std::move(source);
+        }
+
+        bool BeginUpdate(Publisher::Update& update)
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_source == m_updatedSource || m_updating)
+            {
+                return false;
+            }
+            m_updatedSource = m_source;
+            m_updating = true;
+            update = {0, m_source};
+            return true;
+        }
+
+        std::shared_ptr<const Geometry> GetResult()
+        {
+            std::lock_guard lock(m_mutex);
+            return m_result;
+        }
+
+        void Update(const Publisher::Update& update)
+        {
+            std::lock_guard lock(m_mutex);
+            m_result = BuildGeometry(*update.source);
+            m_updating = false;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::shared_ptr<const Scene> m_source;
+        std::shared_ptr<const Scene> m_updatedSource;
+        bool m_updating = false;
+        std::shared_ptr<const Geometry> m_result;
+    };
+
+    void Run(Publisher& publisher, const Publisher::Update& update)
+    {
+        publisher.Publish(update.id, BuildGeometry(*update.source));
+    }
+
+    void Run(LockedPublisher& publisher, const Publisher::Update& update)
+    {
+        publisher.Update(update);
+    }
+
+    struct WaitStatistics
+    {
+        double rebuildMilliseconds = 0.0;
+        double maxWaitMilliseconds = 0.0;
+        double p99WaitMilliseconds = 0.0;
+        size_t frameCount = 0;
+        bool complete = true;
+    };
+
+    // Plays the render thread: every frame it starts an update on a background thread if the scene changed, and takes the latest
+    // geometry, which is timed. The rest of the frame is spent sleeping, which leaves the processors to the updates. A new scene is set
+    // as soon as the geometry of the previous one is rendered, until rebuildCount scenes are.
+    template <typename PublisherType>
+    WaitStatistics RunRenderThread(size_t vertexCount, uint32_t rebuildCount)
+    {
+        PublisherType publisher;
+        std::vector<std::thread> updates;
+        std::vector<double> waits;
+        WaitStatistics statistics;
+
+        uint32_t version = 1;
+        publisher.SetSource(std::make_shared<const Scene>(Scene{version, vertexCount}));
+        Tests::Stopwatch total;
+        while (true)
+        {
+            Tests::Stopwatch wait;
+            Publisher::Update update;
+            const bool begin = publisher.BeginUpdate(update);
+            const std::shared_ptr<const Geometry> geometry = publisher.GetResult();
+            waits.push_back(wait.ElapsedMilliseconds());
+
+            if (begin)
+            {
+                updates.emplace_back([&publisher, update]() { Run(publisher, update); });
+            }
+            if (geometry && geometry->version == version)
+            {
+                statistics.complete &= IsComplete(*geometry);
+                if (version == rebuildCount)
+                {
+                    break;
+                }
+                publisher.SetSource(std::make_shared<const Scene>(Scene{++version, vertexCount}));
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+        statistics.rebuildMilliseconds = total.ElapsedMilliseconds() / rebuildCount;
+
+        for (std::thread& thread : updates)
+        {
+            thread.join();
+        }
+
+        std::sort(waits.begin(), waits.end());
+        statistics.frameCount = waits.size();
+        statistics.maxWaitMilliseconds = waits.back();
+        statistics.p99WaitMilliseconds = waits[waits.size() * 99 / 100];
+        return statistics;
+    }
+} // namespace
+
+TEST_CASE(AsyncUpdatePublisher_Sequence)
+{
+    Publisher publisher;
+    Publisher::Update update;
+    CHECK(!publisher.BeginUpdate(update));
+    CHECK(publisher.GetResult() == nullptr);
+
+    // One update at a time, for the latest scene.
+    const auto first = std::make_shared<const Scene>(Scene{1, 10});
+    publisher.SetSource(first);
+    CHECK(publisher.BeginUpdate(update) && update.source == first);
+    CHECK(publisher.IsUpdating());
+    const auto second = std::make_shared<const Scene>(Scene{2, 10});
+    publisher.SetSource(second);
+    Publisher::Update next;
+    CHECK(!publisher.BeginUpdate(next));
+
+    bool published = false;
+    CHECK(publisher.Publish(update.id, BuildGeometry(*update.source), [&] { published = true; }));
+    CHECK(published && !publisher.IsUpdating());
+    CHECK(publisher.GetResult()->version == 1);
+
+    // The render thread keeps the geometry it took while the next one is published.
+    const std::shared_ptr<const Geometry> rendered = publisher.GetResult();
+    CHECK(publisher.BeginUpdate(update) && update.source == second);
+    CHECK(publisher.Publish(update.id, BuildGeometry(*update.source)));
+    CHECK(rendered->version == 1 && rendered.use_count() == 1);
+    CHECK(publisher.GetResult()->version == 2);
+
+    // Nothing to do until the scene changes, and a failed update keeps the geometry.
+    CHECK(!publisher.BeginUpdate(update));
+    publisher.SetSource(std::make_shared<const Scene>(Scene{3, 10}));
+    CHECK(publisher.BeginUpdate(update));
+    CHECK(publisher.Publish(update.id, nullptr));
+    CHECK(publisher.GetResult()->version == 2 && !publisher.IsUpdating());
+}
+
+TEST_CASE(AsyncUpdatePublisher_ResetLeavesUpdatesStale)
+{
+    Publisher publisher;
+    Publisher::Update update;
+    publisher.SetSource(std::make_shared<const Scene>(Scene{1, 10}));
+    CHECK(publisher.BeginUpdate(update));
+    CHECK(publisher.Publish(update.id, BuildGeometry(*update.source)));
+
+    publisher.SetSource(std::make_shared<const Scene>(Scene{2, 10}));
+    CHECK(publisher.BeginUpdate(update));
+    bool reset = false;
+    publisher.Reset([&] { reset = true; });
+    CHECK(reset && publisher.GetResult() == nullptr && !publisher.IsUpdating());
+
+    // The update which was running during the reset doesn't publish, and there is no scene to update from anymore.
+    bool published = false;
+    CHECK(!publisher.Publish(update.id, BuildGeometry(*update.source), [&] { published = true; }));
+    CHECK(!published && publisher.GetResult() == nullptr);
+    CHECK(!publisher.BeginUpdate(update));
+
+    // A new scene starts over.
+    publisher.SetSource(std::make_shared<const Scene>(Scene{3, 10}));
+    CHECK(publisher.BeginUpdate(update) && update.source->version == 3);
+    CHECK(publisher.Publish(update.id, BuildGeometry(*update.source)));
+    CHECK(publisher.GetResult()->version == 3);
+}
+
+TEST_CASE(AsyncUpdatePublisher_Concurrent)
+{
+    // Scenes are set and the renderer is reset from other threads while the render thread starts updates and renders their geometry.
+    // It only ever sees complete geometry, of increasing versions, as an update running during a reset never publishes, and the geometry
+    // of the last scene in the end.
+    Publisher publisher;
+    std::atomic<bool> stop = false;
+    constexpr uint32_t LastVersion = 2000;
+
+    std::thread setter([&]() {
+        for (uint32_t version = 1; version <= LastVersion; version++)
+        {
+            publisher.SetSource(std::make_shared<const Scene>(Scene{version, 200}));
+            if (version % 97 == 0)
+            {
+                publisher.Reset();
+                publisher.SetSource(std::make_shared<const Scene>(Scene{version, 200}));
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> updates;
+    bool complete = true;
+    bool increasing = true;
+    uint32_t lastVersion = 0;
+    while (!stop)
+    {
+        Publisher::Update update;
+        if (publisher.BeginUpdate(update))
+        {
+            updates.emplace_back([&publisher, update]() { Run(publisher, update); });
+        }
+
+        if (const std::shared_ptr<const Geometry> geometry = publisher.GetResult())
+        {
+            complete &= IsComplete(*geometry);
+            increasing &= geometry->version >= lastVersion;
+            lastVersion = geometry->version;
+            stop = geometry->version == LastVersion;
+        }
+        std::this_thread::yield();
+    }
+
+    setter.join();
+    for (std::thread& thread : updates)
+    {
+        thread.join();
+    }
+    CHECK(complete);
+    CHECK(increasing);
+    CHECK(!publisher.IsUpdating());
+}
+
+BENCHMARK(AsyncUpdatePublisher_RenderThreadWait)
+{
+    // The time the render thread spends starting updates and taking the geometry per frame, while scenes of up to a few million
+    // vertices are rebuilt one after the other, with the lock held during the whole rebuild and with the geometry published atomically.
+    std::printf("%10s %10s %10s %12s %14s %14s\n", "vertices", "design", "frames", "rebuild ms", "max wait ms", "p99 wait ms");
+
+    for (size_t vertexCount : Tests::BenchmarkSizes({100000, 1000000, 4000000}))
+    {
+        const uint32_t rebuildCount = Tests::IsSmokeRun() ? 3 : 10;
+        for (bool locked : {true, false})
+        {
+            const WaitStatistics statistics = locked ? RunRenderThread<LockedPublisher>(vertexCount, rebuildCount)
+                                                     : RunRenderThread<Publisher>(vertexCount, rebuildCount);
+            CHECK(statistics.complete);
+            std::printf(
+                "%10zu %10s %10zu %12.2f %14.3f %14.3f\n",
+                vertexCount,
+                locked ? "locked" : "published",
+                statistics.frameCount,
+                statistics.rebuildMilliseconds,
+                statistics.maxWaitMilliseconds,
+                statistics.p99WaitMilliseconds);
+        }
+    }
+}
@@ -0,0 +1,451 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <BoundingVolumeHierarchy.h>
+
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    using Bounds = BoundingVolumeHierarchy::Bounds;
+
+    // A room of 8 x 3 x 6 m like the ones scene understanding delivers: floor, ceiling and walls, and boxes standing on the floor for
+    // furniture, each one an object whose surfaces are tessellated into slightly noisy triangles. The triangles are stored as three
+    // vertices of x, y, z each, the objects as ranges of triangles.
+    struct Room
+    {
+        std::vector<float> triangles;
+        std::vector<uint32_t> objectBegins;
+
+        uint32_t GetTriangleCount() const
+        {
+            return static_cast<uint32_t>(triangles.size() / 9);
+        }
+
+        const float* GetVertex(uint32_t triangle, uint32_t corner) const
+        {
+            return &triangles[triangle * 9 + corner * 3];
+        }
+    };
+
+    // Adds a rectangle from corner along the edges u and v, split into cells x cells quads of two triangles.
+    void AddRectangle(Room& room, const float* corner, const float* u, const float* v, uint32_t cells, Tests::Random& random)
+    {
+        // The borders stay exact, so that there are no gaps between the rectangles for rays to slip through.
+        std::vector<float> points;
+        for (uint32_t j = 0; j <= cells; j++)
+        {
+            for (uint32_t i = 0; i <= cells; i++)
+            {
+                const float s = static_cast<float>(i) / cells;
+                const float t = static_cast<float>(j) / cells;
+                const bool border = i == 0 || j == 0 || i == cells || j == cells;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    points.push_back(corner[axis] + s * u[axis] + t * v[axis] + (border ? 0.0f : random.NextFloat(-0.002f, 0.002f)));
+                }
+            }
+        }
+
+        for (uint32_t j = 0; j < cells; j++)
+        {
+            for (uint32_t i = 0; i < cells; i++)
+            {
+                const uint32_t first = j * (cells + 1) + i;
+                const uint32_t quad[4] = {first, first + 1, first + cells + 1, first + cells + 2};
+                for (int quadCorner : {0, 1, 2, 2, 1, 3})
+                {
+                    const float* point = &points[quad[quadCorner] * 3];
+                    room.triangles.insert(room.triangles.end(), point, point + 3);
+                }
+            }
+        }
+    }
+
+    Room MakeRoom(uint32_t triangleCount, uint64_t seed)
+    {
+        Tests::Random random(seed);
+        Room room;
+
+        // Half of the triangles for the six sides of the room, the other half for 20 boxes.
+        const uint32_t roomCells = std::max(1u, static_cast<uint32_t>(std::sqrt(triangleCount / 2 / 12.0f)));
+        const float sides[6][3][3] = {
+            {{-4, 0, -3}, {8, 0, 0}, {0, 0, 6}},
+            {{-4, 3, -3}, {0, 0, 6}, {8, 0, 0}},
+            {{-4, 0, -3}, {0, 3, 0}, {8, 0, 0}},
+            {{-4, 0, 3}, {8, 0, 0}, {0, 3, 0}},
+            {{-4, 0, -3}, {0, 0, 6}, {0, 3, 0}},
+            {{4, 0, -3}, {0, 3, 0}, {0, 0, 6}}};
+        for (const auto& side : sides)
+        {
+            room.objectBegins.push_back(room.GetTriangleCount());
+            AddRectangle(room, side[0], side[1], side[2], roomCells, random);
+        }
+
+        const uint32_t boxCells = std::max(1u, static_cast<uint32_t>(std::sqrt(triangleCount / 2 / 20 / 12.0f)));
+        for (int box = 0; box < 20; box++)
+        {
+            const float size[3] = {random.NextFloat(0.3f, 1.5f), random.NextFloat(0.4f, 1.2f), random.NextFloat(0.3f, 1.5f)};
+            const float x = random.NextFloat(-3.5f, 3.5f - size[0]);
+            const float z = random.NextFloat(-2.5f, 2.5f - size[2]);
+            const float faces[6][3][3] = {
+                {{x, size[1], z}, {0, 0, size[2]}, {size[0], 0, 0}},
+                {{x, 0, z}, {0, size[1], 0}, {size[0], 0, 0}},
+                {{x, 0, z + size[2]}, {size[0], 0, 0}, {0, size[1], 0}},
+                {{x, 0, z}, {0, 0, size[2]}, {0, size[1], 0}},
+                {{x + size[0], 0, z}, {0, size[1], 0}, {0, 0, size[2]}},
+                {{x, 0, z}, {size[0], 0, 0}, {0, 0, size[2]}}};
+            room.objectBegins.push_back(room.GetTriangleCount());
+            for (const auto& face : faces)
+            {
+                AddRectangle(room, face[0], face[1], face[2], boxCells, random);
+            }
+        }
+        room.objectBegins.push_back(room.GetTriangleCount());
+        return room;
+    }
+
+    Bounds GetTriangleBounds(const Room& room, uint32_t triangle)
+    {
+        Bounds bounds = {{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            const float* vertex = room.GetVertex(triangle, corner);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                bounds.min[axis] = std::min(bounds.min[axis], vertex[axis]);
+                bounds.max[axis] = std::max(bounds.max[axis], vertex[axis]);
+            }
+        }
+        return bounds;
+    }
+
+    BoundingVolumeHierarchy BuildTriangleHierarchy(const Room& room, uint32_t begin, uint32_t end)
+    {
+        std::vector<Bounds> bounds(end - begin);
+        for (uint32_t i = begin; i < end; i++)
+        {
+            bounds[i - begin] = GetTriangleBounds(room, i);
+        }
+        BoundingVolumeHierarchy hierarchy;
+        hierarchy.Build(bounds.data(), end - begin);
+        return hierarchy;
+    }
+
+    bool IntersectTriangle(const Room& room, uint32_t triangle, const float* origin, const float* direction, float& distance)
+    {
+        return BoundingVolumeHierarchy::IntersectTriangle(
+            origin, direction, room.GetVertex(triangle, 0), room.GetVertex(triangle, 1), room.GetVertex(triangle, 2), distance);
+    }
+
+    bool CloserTriangle(const Room& room, uint32_t triangle, const float* point, float& distance)
+    {
+        float closest[3];
+        BoundingVolumeHierarchy::ClosestPointOnTriangle(
+            point, room.GetVertex(triangle, 0), room.GetVertex(triangle, 1), room.GetVertex(triangle, 2), closest);
+        const float d = std::sqrt(
+            (closest[0] - point[0]) * (closest[0] - point[0]) + (closest[1] - point[1]) * (closest[1] - point[1]) +
+            (closest[2] - point[2]) * (closest[2] - point[2]));
+        if (d < distance)
+        {
+            distance = d;
+            return true;
+        }
+        return false;
+    }
+
+    // Gaze rays from head height in random directions.
+    void RandomRay(Tests::Random& random, float* origin, float* direction)
+    {
+        origin[0] = random.NextFloat(-3.0f, 3.0f);
+        origin[1] = random.NextFloat(1.2f, 1.9f);
+        origin[2] = random.NextFloat(-2.0f, 2.0f);
+        direction[0] = random.NextFloat(-1.0f, 1.0f);
+        direction[1] = random.NextFloat(-1.0f, 1.0f);
+        direction[2] = random.NextFloat(-1.0f, 1.0f);
+    }
+} // namespace
+
+TEST_CASE(BoundingVolumeHierarchy_Triangles)
+{
+    const float v0[3] = {0, 0, 0};
+    const float v1[3] = {1, 0, 0};
+    const float v2[3] = {0, 1, 0};
+
+    // Hits from both sides, within the distance only.
+    float origin[3] = {0.25f, 0.25f, 1.0f};
+    float direction[3] = {0.0f, 0.0f, -2.0f};
+    float distance = FLT_MAX;
+    CHECK(BoundingVolumeHierarchy::IntersectTriangle(origin, direction, v0, v1, v2, distance) && distance == 0.5f);
+    origin[2] = -1.0f;
+    direction[2] = 1.0f;
+    distance = FLT_MAX;
+    CHECK(BoundingVolumeHierarchy::IntersectTriangle(origin, direction, v0, v1, v2, distance) && distance == 1.0f);
+    distance = 0.9f;
+    CHECK(!BoundingVolumeHierarchy::IntersectTriangle(origin, direction, v0, v1, v2, distance) && distance == 0.9f);
+    origin[0] = 0.8f;
+    distance = FLT_MAX;
+    CHECK(!BoundingVolumeHierarchy::IntersectTriangle(origin, direction, v0, v1, v2, distance));
+
+    // The closest point in each of the Voronoi regions.
+    const float points[][3] = {{-1, -1, 1}, {2, -1, 0}, {-1, 2, 0}, {0.5f, -1, 0}, {-1, 0.5f, 0}, {1, 1, 0}, {0.2f, 0.3f, 5}};
+    const float expected[][3] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0.5f, 0, 0}, {0, 0.5f, 0}, {0.5f, 0.5f, 0}, {0.2f, 0.3f, 0}};
+    bool closest = true;
+    for (int i = 0; i < 7; i++)
+    {
+        float point[3];
+        BoundingVolumeHierarchy::ClosestPointOnTriangle(points[i], v0, v1, v2, point);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            closest &= std::abs(point[axis] - expected[i][axis]) < 1e-6f;
+        }
+    }
+    CHECK(closest);
+}
+
+TEST_CASE(BoundingVolumeHierarchy_Structure)
+{
+    const Room room = MakeRoom(20000, 3);
+    BoundingVolumeHierarchy hierarchy = BuildTriangleHierarchy(room, 0, room.GetTriangleCount());
+
+    // Every triangle is in exactly one leaf, and the nodes contain their children.
+    std::vector<uint32_t> seen(room.GetTriangleCount(), 0);
+    for (uint32_t index : hierarchy.GetPrimitiveIndices())
+    {
+        seen[index]++;
+    }
+    CHECK(std::all_of(seen.begin(), seen.end(), [](uint32_t count) { return count == 1; }));
+
+    bool contained = true;
+    const std::vector<BoundingVolumeHierarchy::Node>& nodes = hierarchy.GetNodes();
+    for (const BoundingVolumeHierarchy::Node& node : nodes)
+    {
+        for (uint32_t child = node.index; node.count == 0 && child < node.index + 2; child++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                contained &= nodes[child].min[axis] >= node.min[axis] && nodes[child].max[axis] <= node.max[axis];
+            }
+        }
+    }
+    CHECK(contained);
+
+    const BoundingVolumeHierarchy::Statistics statistics = hierarchy.GetStatistics();
+    std::printf("    %u nodes, depth %u, relative cost %.4f\n", statistics.nodeCount, statistics.maxDepth, statistics.cost);
+    CHECK(statistics.nodeCount == nodes.size() && statistics.maxDepth < BoundingVolumeHierarchy::MaxDepth);
+    CHECK(statistics.cost < 0.01f);
+
+    // Primitives which all have the same bounds end up in deep leaves, but the depth stays limited.
+    const std::vector<Bounds> same(1000, Bounds{{0, 0, 0}, {1, 1, 1}});
+    hierarchy.Build(same.data(), 1000);
+    CHECK(hierarchy.GetStatistics().maxDepth < BoundingVolumeHierarchy::MaxDepth);
+    CHECK(hierarchy.GetPrimitiveIndices().size() == 1000);
+
+    hierarchy.Clear();
+    float distance = FLT_MAX;
+    const float origin[3] = {0, 0, 0};
+    CHECK(hierarchy.IsEmpty() && !hierarchy.Raycast(origin, origin, distance, [](uint32_t, float&) { return true; }));
+}
+
+TEST_CASE(BoundingVolumeHierarchy_QueriesMatchBruteForce)
+{
+    const Room room = MakeRoom(20000, 5);
+    const uint32_t triangleCount = room.GetTriangleCount();
+    const BoundingVolumeHierarchy hierarchy = BuildTriangleHierarchy(room, 0, triangleCount);
+    Tests::Random random(7);
+
+    // Ray casts find the nearest hit.
+    bool raysMatch = true;
+    uint32_t hitCount = 0;
+    for (int i = 0; i < 500; i++)
+    {
+        float origin[3], direction[3];
+        RandomRay(random, origin, direction);
+        float expected = FLT_MAX;
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            IntersectTriangle(room, triangle, origin, direction, expected);
+        }
+        float distance = FLT_MAX;
+        const bool hit = hierarchy.Raycast(origin, direction, distance, [&](uint32_t triangle, float& hitDistance) {
+            return IntersectTriangle(room, triangle, origin, direction, hitDistance);
+        });
+        raysMatch &= hit == (expected < FLT_MAX) && distance == expected;
+        hitCount += hit ? 1 : 0;
+    }
+    CHECK(raysMatch);
+    CHECK(hitCount == 500);
+
+    // Nearest surfaces, e.g. to snap a hologram to.
+    bool nearestMatch = true;
+    for (int i = 0; i < 200; i++)
+    {
+        const float point[3] = {random.NextFloat(-4.0f, 4.0f), random.NextFloat(0.0f, 3.0f), random.NextFloat(-3.0f, 3.0f)};
+        float expected = FLT_MAX;
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            CloserTriangle(room, triangle, point, expected);
+        }
+        float distance = FLT_MAX;
+        hierarchy.FindNearest(point, distance, [&](uint32_t triangle, float& hitDistance) {
+            return CloserTriangle(room, triangle, point, hitDistance);
+        });
+        nearestMatch &= distance == expected;
+    }
+    CHECK(nearestMatch);
+
+    // A frustum looking down -z from the center of the room, as planes with positive distances outside. Every triangle whose bounds are
+    // not outside of one of the planes is visited, and few others, which share a leaf with them.
+    const float s = std::sqrt(0.5f);
+    const float planes[5][4] = {{s, 0, s, 0}, {-s, 0, s, 0}, {0, s, s, -1.5f * s}, {0, -s, s, 1.5f * s}, {0, 0, 1, 0.5f}};
+    std::vector<bool> visited(triangleCount, false);
+    hierarchy.QueryPlanes(planes, 5, [&](uint32_t triangle) { visited[triangle] = true; });
+    bool frustumMatches = true;
+    uint32_t visitedCount = 0;
+    uint32_t expectedCount = 0;
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        const Bounds bounds = GetTriangleBounds(room, triangle);
+        bool outside = false;
+        for (const float* plane : planes)
+        {
+            float nearest = plane[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                nearest += std::min(plane[axis] * bounds.min[axis], plane[axis] * bounds.max[axis]);
+            }
+            outside |= nearest > 0.0f;
+        }
+        frustumMatches &= outside || visited[triangle];
+        visitedCount += visited[triangle] ? 1 : 0;
+        expectedCount += outside ? 0 : 1;
+    }
+    CHECK(frustumMatches);
+    CHECK(expectedCount > 0 && visitedCount < expectedCount * 11 / 10);
+}
+
+TEST_CASE(BoundingVolumeHierarchy_TwoLevels)
+{
+    // Like the scene understanding renderer: a hierarchy per object, which is kept as long as the object doesn't change, and one over
+    // the objects, which is rebuilt with each scene. Casting through both levels hits the same as casting against all triangles.
+    const Room room = MakeRoom(20000, 9);
+    const uint32_t objectCount = static_cast<uint32_t>(room.objectBegins.size() - 1);
+    std::vector<BoundingVolumeHierarchy> objectHierarchies;
+    std::vector<Bounds> objectBounds;
+    for (uint32_t object = 0; object < objectCount; object++)
+    {
+        objectHierarchies.push_back(BuildTriangleHierarchy(room, room.objectBegins[object], room.objectBegins[object + 1]));
+        objectBounds.push_back(objectHierarchies.back().GetBounds());
+    }
+    BoundingVolumeHierarchy sceneHierarchy;
+    sceneHierarchy.Build(objectBounds.data(), objectCount);
+    const BoundingVolumeHierarchy flat = BuildTriangleHierarchy(room, 0, room.GetTriangleCount());
+
+    Tests::Random random(11);
+    bool match = true;
+    for (int i = 0; i < 1000; i++)
+    {
+        float origin[3], direction[3];
+        RandomRay(random, origin, direction);
+        float expected = FLT_MAX;
+        flat.Raycast(origin, direction, expected, [&](uint32_t triangle, float& hitDistance) {
+            return IntersectTriangle(room, triangle, origin, direction, hitDistance);
+        });
+        float distance = FLT_MAX;
+        sceneHierarchy.Raycast(origin, direction, distance, [&](uint32_t object, float& hitDistance) {
+            return objectHierarchies[object].Raycast(origin, direction, hitDistance, [&](uint32_t triangle, float& triangleDistance) {
+                return IntersectTriangle(room, room.objectBegins[object] + triangle, origin, direction, triangleDistance);
+            });
+        });
+        match &= distance == expected;
+    }
+    CHECK(match);
+}
+
+BENCHMARK(BoundingVolumeHierarchy_Rooms)
+{
+    // Build time, and ray casts and nearest surface queries per second, for rooms of up to a million triangles, with brute force ray
+    // casts against all triangles for comparison.
+    std::printf(
+        "%10s %8s %10s %10s %14s %14s %14s\n", "triangles", "nodes", "cost", "build ms", "rays/s", "nearest/s", "brute rays/s");
+
+    for (size_t triangleCount : Tests::BenchmarkSizes({10000, 100000, 1000000}))
+    {
+        const Room room = MakeRoom(static_cast<uint32_t>(triangleCount), 13);
+        const uint32_t count = room.GetTriangleCount();
+        std::vector<Bounds> bounds(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            bounds[i] = GetTriangleBounds(room, i);
+        }
+
+        BoundingVolumeHierarchy hierarchy;
+        Tests::Stopwatch build;
+        hierarchy.Build(bounds.data(), count);
+        const double buildMilliseconds = build.ElapsedMilliseconds();
+
+        Tests::Random random(17);
+        const int rayCount = Tests::IsSmokeRun() ? 1000 : 200000;
+        uint32_t hitCount = 0;
+        Tests::Stopwatch rays;
+        for (int i = 0; i < rayCount; i++)
+        {
+            float origin[3], direction[3];
+            RandomRay(random, origin, direction);
+            float distance = FLT_MAX;
+            hitCount += hierarchy.Raycast(origin, direction, distance, [&](uint32_t triangle, float& hitDistance) {
+                return IntersectTriangle(room, triangle, origin, direction, hitDistance);
+            });
+        }
+        const double rayMilliseconds = rays.ElapsedMilliseconds();
+        // The rays start inside the closed room, only a few slip through between the edges of adjacent triangles.
+        CHECK(hitCount >= static_cast<uint32_t>(rayCount) * 999 / 1000);
+
+        const int nearestCount = rayCount / 4;
+        Tests::Stopwatch nearest;
+        for (int i = 0; i < nearestCount; i++)
+        {
+            const float point[3] = {random.NextFloat(-4.0f, 4.0f), random.NextFloat(0.0f, 3.0f), random.NextFloat(-3.0f, 3.0f)};
+            float distance = FLT_MAX;
+            hierarchy.FindNearest(point, distance, [&](uint32_t triangle, float& hitDistance) {
+                return CloserTriangle(room, triangle, point, hitDistance);
+            });
+        }
+        const double nearestMilliseconds = nearest.ElapsedMilliseconds();
+
+        const int bruteCount = Tests::IsSmokeRun() ? 10 : static_cast<int>(std::max<size_t>(10, 10000000 / count));
+        Tests::Stopwatch brute;
+        for (int i = 0; i < bruteCount; i++)
+        {
+            float origin[3], direction[3];
+            RandomRay(random, origin, direction);
+            float distance = FLT_MAX;
+            for (uint32_t triangle = 0; triangle < count; triangle++)
+            {
+                IntersectTriangle(room, triangle, origin, direction, distance);
+            }
+        }
+        const double bruteMilliseconds = brute.ElapsedMilliseconds();
+
+        std::printf(
+            "%10u %8zu %10.4f %10.2f %14.0f %14.0f %14.0f\n",
+            count,
+            hierarchy.GetNodes().size(),
+            hierarchy.GetStatistics().cost,
+            buildMilliseconds,
+            rayCount / (rayMilliseconds / 1000.0),
+            nearestCount / (nearestMilliseconds / 1000.0),
+            bruteCount / (bruteMilliseconds / 1000.0));
+    }
+}
@@ -0,0 +1,271 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <BoundingVolumePolicy.h>
+
+#include <cmath>
+
+namespace
+{
+    using Vector3 = BoundingVolumePolicy::Vector3;
+    using Box = BoundingVolumePolicy::Box;
+
+    constexpr double FrameTime = 1.0 / 60.0;
+
+    bool Contains(const Box& box, const Vector3& point)
+    {
+        return std::abs(point.x - box.center.x) <= box.halfExtents.x && std::abs(point.y - box.center.y) <= box.halfExtents.y &&
+               std::abs(point.z - box.center.z) <= box.halfExtents.z;
+    }
+
+    Vector3 Forward(float yaw)
+    {
+        return {std::sin(yaw), 0.0f, -std::cos(yaw)};
+    }
+
+    // Walks from position with velocity for the given time and returns the number of box updates.
+    uint32_t Walk(BoundingVolumePolicy& policy, double& time, Vector3& position, const Vector3& velocity, double duration, float yaw = 0.0f)
+    {
+        uint32_t updateCount = 0;
+        for (double end = time + duration; time < end; time += FrameTime)
+        {
+            const float step = float(FrameTime);
+            position = {position.x + velocity.x * step, position.y + velocity.y * step, position.z + velocity.z * step};
+            updateCount += policy.Update(time, position, Forward(yaw)) ? 1 : 0;
+        }
+        return updateCount;
+    }
+} // namespace
+
+TEST_CASE(BoundingVolumePolicy_StationaryBoxStaysPut)
+{
+    BoundingVolumePolicy policy;
+    const BoundingVolumePolicy::Settings settings;
+
+    CHECK(policy.Update(0.0, {1.0f, 1.6f, 2.0f}, Forward(0.0f)));
+    CHECK(!policy.IsMoving());
+    CHECK(policy.GetBox().center.x == 1.0f && policy.GetBox().center.z == 2.0f);
+    CHECK(policy.GetBox().halfExtents.x == settings.stationaryHalfExtents.x);
+
+    // Head jitter and looking around slowly never move the box.
+    Tests::Random random(3);
+    uint32_t updateCount = 0;
+    for (double time = FrameTime; time < 60.0; time += FrameTime)
+    {
+        const Vector3 position = {1.0f + random.NextFloat(-0.005f, 0.005f), 1.6f, 2.0f + random.NextFloat(-0.005f, 0.005f)};
+        updateCount += policy.Update(time, position, Forward(0.2f * std::sin(float(time)))) ? 1 : 0;
+    }
+    CHECK(updateCount == 0);
+    CHECK(!policy.IsMoving());
+}
+
+TEST_CASE(BoundingVolumePolicy_GrowsInDirectionOfTravel)
+{
+    BoundingVolumePolicy policy;
+    const BoundingVolumePolicy::Settings settings;
+
+    double time = 0.0;
+    Vector3 position = {0.0f, 1.6f, 0.0f};
+    Walk(policy, time, position, {0.0f, 0.0f, 0.0f}, 1.0);
+    CHECK(Walk(policy, time, position, {1.2f, 0.0f, 0.0f}, 2.0) > 0);
+    CHECK(policy.IsMoving());
+
+    // The box is ahead of the head along +x and extends further along x than along z.
+    const Box& box = policy.GetBox();
+    CHECK(box.center.x > position.x - 0.5f);
+    CHECK(box.halfExtents.x > settings.movingHalfExtents.x);
+    CHECK(box.halfExtents.z < box.halfExtents.x);
+    CHECK(Contains(box, position));
+    CHECK(Contains(box, {position.x + 1.2f * settings.lookAheadTime, position.y, position.z}));
+}
+
+TEST_CASE(BoundingVolumePolicy_FastTurnEntersMovingState)
+{
+    BoundingVolumePolicy policy;
+    double time = 0.0;
+    for (; time < 1.0; time += FrameTime)
+    {
+        policy.Update(time, {0.0f, 1.6f, 0.0f}, Forward(0.0f));
+    }
+    CHECK(!policy.IsMoving());
+
+    // Turning on the spot at 2 rad/s.
+    bool updated = false;
+    for (float yaw = 0.0f; time < 2.0; time += FrameTime, yaw += 2.0f * float(FrameTime))
+    {
+        updated |= policy.Update(time, {0.0f, 1.6f, 0.0f}, Forward(yaw));
+    }
+    CHECK(policy.IsMoving());
+    CHECK(updated);
+}
+
+TEST_CASE(BoundingVolumePolicy_Hysteresis)
+{
+    BoundingVolumePolicy policy;
+    const BoundingVolumePolicy::Settings settings;
+
+    double time = 0.0;
+    Vector3 position = {0.0f, 1.6f, 0.0f};
+
+    // Between the two thresholds the stationary state sticks...
+    const float between = (settings.movingSpeed + settings.stationarySpeed) * 0.5f;
+    Walk(policy, time, position, {between, 0.0f, 0.0f}, 3.0);
+    CHECK(!policy.IsMoving());
+
+    // ...and so does the moving state.
+    Walk(policy, time, position, {1.0f, 0.0f, 0.0f}, 1.0);
+    CHECK(policy.IsMoving());
+    Walk(policy, time, position, {between, 0.0f, 0.0f}, 3.0);
+    CHECK(policy.IsMoving());
+
+    // Stopping only leaves the moving state after the delay.
+    Walk(policy, time, position, {0.0f, 0.0f, 0.0f}, settings.stationaryDelay * 0.5);
+    CHECK(policy.IsMoving());
+    Walk(policy, time, position, {0.0f, 0.0f, 0.0f}, settings.stationaryDelay * 2.0);
+    CHECK(!policy.IsMoving());
+    CHECK(policy.GetBox().halfExtents.x == settings.stationaryHalfExtents.x);
+}
+
+TEST_CASE(BoundingVolumePolicy_RateLimitAndReset)
+{
+    BoundingVolumePolicy::Settings settings;
+    settings.minUpdateInterval = 0.5f;
+    BoundingVolumePolicy policy(settings);
+
+    double time = 0.0;
+    Vector3 position = {0.0f, 1.6f, 0.0f};
+    Walk(policy, time, position, {3.0f, 0.0f, 0.0f}, 10.0);
+    CHECK(policy.GetStatistics().updateCount <= 1 + static_cast<uint64_t>(10.0 / settings.minUpdateInterval));
+    CHECK(policy.GetStatistics().movingSampleCount > 0);
+
+    CHECK(!policy.Update(time, position, Forward(0.0f)));
+    policy.Reset();
+    CHECK(policy.Update(time + FrameTime, position, Forward(0.0f)));
+}
+
+BENCHMARK(BoundingVolumePolicy_TraceSimulation)
+{
+    // Replays synthetic head traces at 60 Hz made of standing, looking around, walking, jogging and fast turns, and compares the policy
+    // with the fixed one second timer which reset the box to 10 x 5 x 10 m at the head. Surfaces are laid out on a 2 m grid, every box
+    // update recomputes all surfaces within the new box. A frame counts as a coverage gap if the point 2.5 m ahead of the gaze or the
+    // point the head reaches within one second is outside the box.
+    std::printf("%10s %10s %10s %14s %12s\n", "trace s", "policy", "updates", "recomputations", "gaps %");
+
+    for (size_t seconds : Tests::BenchmarkSizes({60, 420}))
+    {
+        Tests::Random random(31);
+
+        struct Sample
+        {
+            Vector3 position;
+            Vector3 forward;
+        };
+        std::vector<Sample> trace;
+        Vector3 position = {0.0f, 1.6f, 0.0f};
+        float yaw = 0.0f;
+        const size_t frameCount = static_cast<size_t>(seconds / FrameTime);
+        while (trace.size() < frameCount)
+        {
+            // Pick the next activity and hold it for a few seconds.
+            const uint32_t activity = random.Next(5);
+            const size_t length = static_cast<size_t>(random.NextFloat(2.0f, 10.0f) / FrameTime);
+            const float heading = random.NextFloat(0.0f, 6.283f);
+            const float turnRate = random.NextFloat(-3.0f, 3.0f);
+            for (size_t i = 0; i < length && trace.size() < frameCount; i++)
+            {
+                const float t = float(i * FrameTime);
+                switch (activity)
+                {
+                    case 0: // standing
+                        break;
+                    case 1: // looking around
+                        yaw += 0.6f * std::cos(t) * float(FrameTime);
+                        break;
+                    case 2: // walking, looking where we go
+                    case 3: // jogging
+                    {
+                        const float speed = activity == 2 ? 1.3f : 3.0f;
+                        yaw = heading;
+                        position.x += speed * std::sin(heading) * float(FrameTime);
+                        position.z -= speed * std::cos(heading) * float(FrameTime);
+                        break;
+                    }
+                    case 4: // fast turn
+                        yaw += turnRate * float(FrameTime);
+                        break;
+                }
+
+                const float jitterX = random.NextFloat(-0.002f, 0.002f);
+                const float jitterY = random.NextFloat(-0.002f, 0.002f);
+                const float jitterZ = random.NextFloat(-0.002f, 0.002f);
+                trace.push_back({{position.x + jitterX, position.y + jitterY, position.z + jitterZ}, Forward(yaw)});
+            }
+        }
+
+        const auto countSurfaces = [](const Box& box) {
+            const auto cells = [](float center, float halfExtent) {
+                return static_cast<uint32_t>(std::floor((center + halfExtent) / 2.0f) - std::ceil((center - halfExtent) / 2.0f) + 1.0f);
+            };
+            return cells(box.center.x, box.halfExtents.x) * cells(box.center.z, box.halfExtents.z);
+        };
+
+        for (bool adaptive : {false, true})
+        {
+            BoundingVolumePolicy policy;
+            Box box = {};
+            double lastReset = -1.0;
+            uint64_t updateCount = 0;
+            uint64_t recomputations = 0;
+            uint64_t gapCount = 0;
+            const size_t lookAheadFrames = static_cast<size_t>(1.0 / FrameTime);
+
+            for (size_t frame = 0; frame < trace.size(); frame++)
+            {
+                const double time = frame * FrameTime;
+                const Sample& sample = trace[frame];
+
+                bool updated = false;
+                if (adaptive)
+                {
+                    updated = policy.Update(time, sample.position, sample.forward);
+                    box = policy.GetBox();
+                }
+                else if (time - lastReset >= 1.0)
+                {
+                    box = {sample.position, {5.0f, 2.5f, 5.0f}};
+                    lastReset = time;
+                    updated = true;
+                }
+
+                if (updated)
+                {
+                    updateCount++;
+                    recomputations += countSurfaces(box);
+                }
+
+                const Vector3 gaze = {
+                    sample.position.x + sample.forward.x * 2.5f, sample.position.y, sample.position.z + sample.forward.z * 2.5f};
+                const Vector3& ahead = trace[std::min(frame + lookAheadFrames, trace.size() - 1)].position;
+                gapCount += (!Contains(box, gaze) || !Contains(box, ahead)) ? 1 : 0;
+            }
+
+            std::printf(
+                "%10zu %10s %10llu %14llu %12.2f\n",
+                seconds,
+                adaptive ? "adaptive" : "timer",
+                static_cast<unsigned long long>(updateCount),
+                static_cast<unsigned long long>(recomputations),
+                100.0 * gapCount / trace.size());
+        }
+    }
+}
@@ -0,0 +1,240 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <BufferPool.h>
+
+#include <thread>
+
+namespace
+{
+    // Buffers are numbered in the order they are created, 0 is none.
+    using Pool = BufferPool<uint32_t>;
+
+    constexpr uint32_t VertexUsage = 1;
+    constexpr uint32_t IndexUsage = 2;
+
+    struct Counter
+    {
+        uint32_t createdCount = 0;
+
+        uint32_t operator()(uint64_t)
+        {
+            return ++createdCount;
+        }
+    };
+} // namespace
+
+TEST_CASE(BufferPool_SizeClasses)
+{
+    using namespace BufferSizeClasses;
+    CHECK(GetClass(0) == 0 && GetClass(MinCapacity) == 0 && GetCapacity(0) == MinCapacity);
+    CHECK(GetClass(MinCapacity + 1) == 1 && GetCapacity(1) == MinCapacity * 5 / 4);
+    CHECK(GetCapacity(4) == 2 * MinCapacity && GetCapacity(8) == 4 * MinCapacity);
+
+    // Every size fits into its class, which is less than 25% larger, and not into the class below.
+    Tests::Random random(3);
+    bool fits = true;
+    for (int i = 0; i < 100000; i++)
+    {
+        const uint64_t size = MinCapacity + 1 + (static_cast<uint64_t>(random.Next()) << random.Next(12));
+        const uint32_t sizeClass = GetClass(size);
+        fits &= GetCapacity(sizeClass) >= size && GetCapacity(sizeClass) < size + size / 4 && GetCapacity(sizeClass - 1) < size;
+    }
+    CHECK(fits);
+
+    bool increasing = true;
+    for (uint32_t sizeClass = 1; sizeClass < 160; sizeClass++)
+    {
+        increasing &= GetCapacity(sizeClass) > GetCapacity(sizeClass - 1) && GetClass(GetCapacity(sizeClass)) == sizeClass;
+    }
+    CHECK(increasing);
+}
+
+TEST_CASE(BufferPool_Reuse)
+{
+    auto pool = std::make_shared<Pool>(1 << 20);
+    Counter create;
+
+    Pool::Lease vertices = pool->Acquire(VertexUsage, 10000, create);
+    CHECK(vertices && vertices.Get() == 1 && vertices.GetCapacity() >= 10000);
+    vertices.Release();
+    CHECK(!vertices && pool->GetStatistics().pooledCount == 1);
+
+    // The released buffer is reused for the same usage and size class, or for sizes of the class below, but not for other usages,
+    // smaller classes or larger ones.
+    Pool::Lease indices = pool->Acquire(IndexUsage, 10000, create);
+    CHECK(indices.Get() == 2);
+    vertices = pool->Acquire(VertexUsage, 8000, create);
+    CHECK(vertices.Get() == 1 && vertices.GetCapacity() == BufferSizeClasses::GetCapacity(BufferSizeClasses::GetClass(10000)));
+    Pool::Lease smaller = pool->Acquire(VertexUsage, 5000, create);
+    CHECK(smaller.Get() == 3);
+    Pool::Lease larger = pool->Acquire(VertexUsage, 12000, create);
+    CHECK(larger.Get() == 4);
+
+    // Of the buffers which fit, the one of the smaller class is taken.
+    vertices = {};
+    larger = {};
+    smaller = {};
+    CHECK(pool->GetStatistics().pooledCount == 3);
+    CHECK(pool->Acquire(VertexUsage, 10000, create).Get() == 1);
+
+    const Pool::Statistics statistics = pool->GetStatistics();
+    CHECK(statistics.allocationCount == 4 && statistics.reuseCount == 2 && statistics.churnCount == 0);
+    CHECK(statistics.pooledCount == 3 && statistics.pooledBytes > 0);
+
+    // A moved lease returns its buffer once, and keeps the pool alive.
+    Pool::Lease moved = pool->Acquire(VertexUsage, 100, create);
+    Pool::Lease target(std::move(moved));
+    CHECK(!moved && target);
+    const std::weak_ptr<Pool> weakPool = pool;
+    indices = {};
+    pool = nullptr;
+    CHECK(!weakPool.expired());
+    target = {};
+    CHECK(weakPool.expired());
+}
+
+TEST_CASE(BufferPool_Limit)
+{
+    using BufferSizeClasses::GetCapacity;
+    const auto pool = std::make_shared<Pool>(3 * GetCapacity(0));
+    Counter create;
+
+    // Buffers beyond the limit are destroyed, those released the longest time ago first, and the ones larger than the limit always.
+    std::vector<Pool::Lease> leases;
+    for (int i = 0; i < 5; i++)
+    {
+        leases.push_back(pool->Acquire(VertexUsage, 100, create));
+    }
+    leases.push_back(pool->Acquire(VertexUsage, 4 * GetCapacity(0), create));
+    leases.clear();
+
+    Pool::Statistics statistics = pool->GetStatistics();
+    CHECK(statistics.pooledCount == 3 && statistics.pooledBytes == 3 * GetCapacity(0));
+    CHECK(statistics.churnCount == 3 && statistics.churnedBytes == 2 * GetCapacity(0) + GetCapacity(BufferSizeClasses::GetClass(4 * 4096)));
+    CHECK(pool->Acquire(VertexUsage, 100, create).Get() == 5);
+
+    // Clearing destroys the pooled buffers, and the leased ones once they are released, e.g. after a lost device.
+    Pool::Lease leased = pool->Acquire(VertexUsage, 100, create);
+    pool->Clear();
+    statistics = pool->GetStatistics();
+    CHECK(statistics.pooledCount == 0 && statistics.churnCount == 5);
+    leased = {};
+    statistics = pool->GetStatistics();
+    CHECK(statistics.pooledCount == 0 && statistics.churnCount == 6);
+    CHECK(pool->Acquire(VertexUsage, 100, create).Get() == 7);
+}
+
+TEST_CASE(BufferPool_Concurrent)
+{
+    // Updates on several threads acquire and release buffers of a few sizes. Every buffer is leased by one thread at a time, and the
+    // counters add up.
+    const auto pool = std::make_shared<Pool>(64 * BufferSizeClasses::MinCapacity);
+    std::atomic<uint32_t> createdCount = 0;
+    constexpr int ThreadCount = 4;
+    constexpr int AcquireCount = 20000;
+    std::vector<std::atomic<uint32_t>> leased(ThreadCount * AcquireCount + 1);
+    std::atomic<bool> exclusive = true;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; t++)
+    {
+        threads.emplace_back([&, t]() {
+            Tests::Random random(t + 1);
+            std::vector<Pool::Lease> leases(4);
+            for (int i = 0; i < AcquireCount; i++)
+            {
+                Pool::Lease& lease = leases[random.Next(4)];
+                if (lease)
+                {
+                    leased[lease.Get()]--;
+                }
+                lease = pool->Acquire(random.Next(2), 1000 + random.Next(20000), [&](uint64_t) { return ++createdCount; });
+                exclusive = exclusive && leased[lease.Get()]++ == 0;
+            }
+            for (Pool::Lease& lease : leases)
+            {
+                if (lease)
+                {
+                    leased[lease.Get()]--;
+                    lease.Release();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    const Pool::Statistics statistics = pool->GetStatistics();
+    CHECK(exclusive);
+    CHECK(statistics.allocationCount == createdCount && statistics.allocationCount + statistics.reuseCount == ThreadCount * AcquireCount);
+    CHECK(statistics.allocationCount - statistics.churnCount == statistics.pooledCount);
+    std::printf("    %llu of %d buffers reused\n", static_cast<unsigned long long>(statistics.reuseCount), ThreadCount * AcquireCount);
+}
+
+BENCHMARK(BufferPool_AllocationChurn)
+{
+    // Scene updates which replace the vertex and index buffers of a scene: every update acquires the buffers of all objects, of sizes
+    // which change by up to 10% from one update to the next, and releases the ones of the previous update. Buffers are simulated by
+    // memory which is allocated and cleared, the way a graphics API initializes them, and are created for every update without the pool.
+    std::printf(
+        "%8s %8s %14s %14s %12s %12s %12s\n", "buffers", "pool", "allocs/update", "MB/update", "reused %", "churned MB", "update ms");
+
+    using MemoryPool = BufferPool<std::vector<uint8_t>>;
+    const auto createMemory = [](uint64_t capacity) { return std::vector<uint8_t>(capacity); };
+
+    for (size_t bufferCount : Tests::BenchmarkSizes({16, 64, 256}))
+    {
+        for (bool pooled : {false, true})
+        {
+            Tests::Random random(11);
+            std::vector<uint64_t> sizes(bufferCount);
+            for (uint64_t& size : sizes)
+            {
+                size = 4096 + random.Next(1 << 20);
+            }
+
+            const auto pool = std::make_shared<MemoryPool>(pooled ? 512ull << 20 : 0);
+            std::vector<MemoryPool::Lease> leases;
+            const int updateCount = Tests::IsSmokeRun() ? 3 : 50;
+            Tests::Stopwatch stopwatch;
+            for (int update = 0; update < updateCount; update++)
+            {
+                std::vector<MemoryPool::Lease> next;
+                for (size_t i = 0; i < bufferCount; i++)
+                {
+                    const uint32_t usage = i % 2 == 0 ? VertexUsage : IndexUsage;
+                    sizes[i] = std::max<uint64_t>(1024, sizes[i] * (90 + random.Next(21)) / 100);
+                    next.push_back(pool->Acquire(usage, sizes[i], createMemory));
+                }
+                leases = std::move(next);
+            }
+            leases.clear();
+            const double milliseconds = stopwatch.ElapsedMilliseconds() / updateCount;
+
+            const MemoryPool::Statistics statistics = pool->GetStatistics();
+            const uint64_t acquiredCount = statistics.allocationCount + statistics.reuseCount;
+            std::printf(
+                "%8zu %8s %14.1f %14.1f %12.1f %12.1f %12.3f\n",
+                bufferCount,
+                pooled ? "yes" : "no",
+                static_cast<double>(statistics.allocationCount) / updateCount,
+                statistics.allocatedBytes / 1048576.0 / updateCount,
+                100.0 * statistics.reuseCount / acquiredCount,
+                statistics.churnedBytes / 1048576.0,
+                milliseconds);
+        }
+    }
+}
@@ -0,0 +1,122 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <ContentHash.h>
+
+#include <unordered_set>
+
+namespace
+{
+    std::vector<uint8_t> MakeData(size_t size, uint64_t seed = 1)
+    {
+        Tests::Random random(seed);
+        std::vector<uint8_t> data(size);
+        for (uint8_t& value : data)
+        {
+            value = static_cast<uint8_t>(random.Next());
+        }
+        return data;
+    }
+} // namespace
+
+TEST_CASE(ContentHash_PiecewiseMatchesOneShot)
+{
+    // Cover the tail, stripe, block and multi block paths.
+    for (size_t size : {0, 1, 15, 63, 64, 65, 1023, 1024, 1025, 5000, 70000})
+    {
+        const std::vector<uint8_t> data = MakeData(size, size + 1);
+        const uint64_t expected = ContentHash::Compute(data.data(), data.size(), 7);
+
+        Tests::Random random(size);
+        ContentHash hash(7);
+        for (size_t offset = 0; offset < size;)
+        {
+            const size_t piece = std::min<size_t>(size - offset, random.Next(200));
+            hash.Update(data.data() + offset, piece);
+            offset += piece;
+        }
+        CHECK(hash.Finish() == expected);
+
+        // Finish does not consume the state.
+        CHECK(hash.Finish() == expected);
+    }
+}
+
+TEST_CASE(ContentHash_StableAcrossPlatforms)
+{
+    // The SSE2, NEON and scalar stripe loops must agree, and cached hashes (e.g. in the mesh cache file) must stay valid between
+    // builds. These values must not change.
+    const std::vector<uint8_t> data = MakeData(3000, 42);
+    CHECK(ContentHash::Compute(nullptr, 0) == ContentHash::Compute(data.data(), 0));
+    CHECK(ContentHash::Compute(data.data(), 3) == 0xC6C41B2E83A168C9ull);
+    CHECK(ContentHash::Compute(data.data(), 64) == 0x369290129C38AD4Dull);
+    CHECK(ContentHash::Compute(data.data(), 3000) == 0xF246E32FC766E4C9ull);
+    CHECK(ContentHash::Compute(data.data(), 3000, 1) == 0x6E845F63DFBA71F5ull);
+}
+
+TEST_CASE(ContentHash_DetectsSingleBitChanges)
+{
+    std::vector<uint8_t> data = MakeData(4096);
+    const uint64_t original = ContentHash::Compute(data.data(), data.size());
+
+    std::unordered_set<uint64_t> hashes = {original};
+    for (size_t byte : {0, 1, 63, 64, 1000, 1024, 2047, 4095})
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            data[byte] ^= static_cast<uint8_t>(1u << bit);
+            hashes.insert(ContentHash::Compute(data.data(), data.size()));
+            data[byte] ^= static_cast<uint8_t>(1u << bit);
+        }
+    }
+    CHECK(hashes.size() == 1 + 8 * 8);
+    CHECK(ContentHash::Compute(data.data(), data.size()) == original);
+
+    // Appending zeros changes the hash as well, since the length is part of it.
+    data.push_back(0);
+    CHECK(ContentHash::Compute(data.data(), data.size()) != original);
+
+    // So does the seed.
+    CHECK(ContentHash::Compute(data.data(), 4096, 1) != original);
+}
+
+TEST_CASE(ContentHash_NoCollisionsOnSmallInputs)
+{
+    std::unordered_set<uint64_t> hashes;
+    for (uint32_t value = 0; value < 100000; value++)
+    {
+        hashes.insert(ContentHash::Compute(&value, sizeof(value)));
+    }
+    CHECK(hashes.size() == 100000);
+}
+
+BENCHMARK(ContentHash_Throughput)
+{
+    std::printf("%12s %12s %12s\n", "bytes", "GB/s", "hash");
+
+    for (size_t size : Tests::BenchmarkSizes({64, 4096, 256 * 1024, 16 * 1024 * 1024}))
+    {
+        const std::vector<uint8_t> data = MakeData(size);
+        const size_t repetitions = std::max<size_t>(1, (Tests::IsSmokeRun() ? 1 : 512) * 1024 * 1024 / size);
+
+        uint64_t hash = 0;
+        Tests::Stopwatch stopwatch;
+        for (size_t i = 0; i < repetitions; i++)
+        {
+            hash ^= ContentHash::Compute(data.data(), data.size(), i);
+        }
+        const double milliseconds = stopwatch.ElapsedMilliseconds();
+
+        std::printf("%12zu %12.2f %12llx\n", size, size * repetitions / (milliseconds * 1.0e6), static_cast<unsigned long long>(hash));
+    }
+}
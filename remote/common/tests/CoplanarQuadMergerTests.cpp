@@ -0,0 +1,468 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <CoplanarQuadMerger.h>
+
+#include <cmath>
+
+namespace
+{
+    using Quad = CoplanarQuadMerger::Quad;
+    using Rect = CoplanarQuadMerger::Rect;
+    using Cluster = CoplanarQuadMerger::Cluster;
+
+    constexpr uint32_t WallGroup = 1;
+    constexpr uint32_t FloorGroup = 2;
+    constexpr uint32_t CeilingGroup = 3;
+
+    float Dot(const float* a, const float* b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    Quad MakeQuad(uint32_t group, float x, float y, float z, float width, float height)
+    {
+        Quad quad;
+        quad.group = group;
+        quad.center[0] = x;
+        quad.center[1] = y;
+        quad.center[2] = z;
+        quad.xAxis[0] = 1.0f;
+        quad.xAxis[1] = 0.0f;
+        quad.xAxis[2] = 0.0f;
+        quad.yAxis[0] = 0.0f;
+        quad.yAxis[1] = 1.0f;
+        quad.yAxis[2] = 0.0f;
+        quad.width = width;
+        quad.height = height;
+        return quad;
+    }
+
+    // A quad in the z = 0 plane from x0, y0 to x1, y1.
+    Quad MakeQuad(float x0, float y0, float x1, float y1)
+    {
+        return MakeQuad(WallGroup, (x0 + x1) / 2, (y0 + y1) / 2, 0.0f, x1 - x0, y1 - y0);
+    }
+
+    double GetArea(const Rect& rect)
+    {
+        return static_cast<double>(rect.max[0] - rect.min[0]) * (rect.max[1] - rect.min[1]);
+    }
+
+    // True if no two rectangles of the cluster overlap by more than the tolerance.
+    bool AreDisjoint(const std::vector<Rect>& rects, const Cluster& cluster, float tolerance)
+    {
+        for (uint32_t i = cluster.firstRect; i < cluster.firstRect + cluster.rectCount; i++)
+        {
+            for (uint32_t j = i + 1; j < cluster.firstRect + cluster.rectCount; j++)
+            {
+                const float overlapX = std::min(rects[i].max[0], rects[j].max[0]) - std::max(rects[i].min[0], rects[j].min[0]);
+                const float overlapY = std::min(rects[i].max[1], rects[j].max[1]) - std::max(rects[i].min[1], rects[j].min[1]);
+                if (overlapX > tolerance && overlapY > tolerance)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // A surface of a room, e.g. a wall, on a grid of cells of which some are left out, e.g. for a door.
+    struct Surface
+    {
+        uint32_t group;
+        float origin[3];
+        float xAxis[3];
+        float yAxis[3];
+        uint32_t columnCount;
+        uint32_t rowCount;
+        float cellSize;
+        std::vector<uint8_t> cells;
+
+        bool HasCell(uint32_t column, uint32_t row) const
+        {
+            return column < columnCount && row < rowCount && cells[row * columnCount + column] != 0;
+        }
+
+        void GetPosition(float x, float y, float* position) const
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                position[axis] = origin[axis] + xAxis[axis] * x + yAxis[axis] * y;
+            }
+        }
+    };
+
+    // A room of 6 x 4 m and 3 m height, turned by yaw around the vertical axis and moved by offset, with a door and a window in two of
+    // the walls and a pillar in the middle of the floor. The holes are aligned to 1 m, so cellSize must divide 1 m.
+    std::vector<Surface> MakeRoom(float yaw, const float* offset, float cellSize)
+    {
+        const float c = std::cos(yaw);
+        const float s = std::sin(yaw);
+        auto rotate = [&](float x, float y, float z, float* result) {
+            result[0] = c * x + s * z;
+            result[1] = y;
+            result[2] = -s * x + c * z;
+        };
+        // origin, x axis, y axis, size and hole, in the frame of the room.
+        struct Layout
+        {
+            uint32_t group;
+            float origin[3];
+            float xAxis[3];
+            float yAxis[3];
+            float size[2];
+            float hole[4];
+        };
+        const Layout layouts[] = {
+            {FloorGroup, {0, 0, 0}, {1, 0, 0}, {0, 0, 1}, {6, 4}, {2, 1, 3, 2}},
+            {CeilingGroup, {0, 3, 0}, {1, 0, 0}, {0, 0, 1}, {6, 4}, {0, 0, 0, 0}},
+            {WallGroup, {0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {6, 3}, {1, 0, 2, 2}},
+            {WallGroup, {0, 0, 4}, {1, 0, 0}, {0, 1, 0}, {6, 3}, {0, 0, 0, 0}},
+            {WallGroup, {0, 0, 0}, {0, 0, 1}, {0, 1, 0}, {4, 3}, {2, 1, 3, 2}},
+            {WallGroup, {6, 0, 0}, {0, 0, 1}, {0, 1, 0}, {4, 3}, {0, 0, 0, 0}},
+        };
+
+        std::vector<Surface> surfaces;
+        for (const Layout& layout : layouts)
+        {
+            Surface& surface = surfaces.emplace_back();
+            surface.group = layout.group;
+            rotate(layout.origin[0], layout.origin[1], layout.origin[2], surface.origin);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                surface.origin[axis] += offset[axis];
+            }
+            rotate(layout.xAxis[0], layout.xAxis[1], layout.xAxis[2], surface.xAxis);
+            rotate(layout.yAxis[0], layout.yAxis[1], layout.yAxis[2], surface.yAxis);
+            surface.columnCount = static_cast<uint32_t>(std::lround(layout.size[0] / cellSize));
+            surface.rowCount = static_cast<uint32_t>(std::lround(layout.size[1] / cellSize));
+            surface.cellSize = cellSize;
+            surface.cells.resize(surface.columnCount * surface.rowCount);
+            for (uint32_t row = 0; row < surface.rowCount; row++)
+            {
+                for (uint32_t column = 0; column < surface.columnCount; column++)
+                {
+                    const float x = (column + 0.5f) * cellSize;
+                    const float y = (row + 0.5f) * cellSize;
+                    const bool hole = x > layout.hole[0] && x < layout.hole[2] && y > layout.hole[1] && y < layout.hole[3];
+                    surface.cells[row * surface.columnCount + column] = hole ? 0 : 1;
+                }
+            }
+        }
+        return surfaces;
+    }
+
+    // Appends a quad for each cell of the surface, the way scene understanding returns them in pieces: quads reach into the neighboring
+    // cells by up to a fifth of a cell, their edges are off by up to 2 mm, and half of them are turned by 90 degrees.
+    void AppendQuads(const Surface& surface, Tests::Random& random, std::vector<Quad>& quads)
+    {
+        const float cellSize = surface.cellSize;
+        for (uint32_t row = 0; row < surface.rowCount; row++)
+        {
+            for (uint32_t column = 0; column < surface.columnCount; column++)
+            {
+                if (!surface.HasCell(column, row))
+                {
+                    continue;
+                }
+                const bool extendX = surface.HasCell(column + 1, row) && random.Next(2) == 0;
+                const bool extendY = surface.HasCell(column, row + 1) && random.Next(2) == 0 &&
+                                     (!extendX || surface.HasCell(column + 1, row + 1));
+                float min[2] = {column * cellSize, row * cellSize};
+                float max[2] = {(column + 1) * cellSize, (row + 1) * cellSize};
+                max[0] += extendX ? random.NextFloat(0.05f, 0.2f) * cellSize : 0.0f;
+                max[1] += extendY ? random.NextFloat(0.05f, 0.2f) * cellSize : 0.0f;
+                for (int axis = 0; axis < 2; axis++)
+                {
+                    min[axis] += random.NextFloat(-0.002f, 0.002f);
+                    max[axis] += random.NextFloat(-0.002f, 0.002f);
+                }
+
+                Quad& quad = quads.emplace_back();
+                quad.group = surface.group;
+                surface.GetPosition((min[0] + max[0]) / 2, (min[1] + max[1]) / 2, quad.center);
+                const bool turned = random.Next(2) == 0;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    quad.xAxis[axis] = turned ? surface.yAxis[axis] : surface.xAxis[axis];
+                    quad.yAxis[axis] = turned ? -surface.xAxis[axis] : surface.yAxis[axis];
+                }
+                quad.width = turned ? max[1] - min[1] : max[0] - min[0];
+                quad.height = turned ? max[0] - min[0] : max[1] - min[1];
+            }
+        }
+    }
+
+    std::vector<Surface> MakeRooms(size_t roomCount, float cellSize)
+    {
+        std::vector<Surface> surfaces;
+        for (size_t i = 0; i < roomCount; i++)
+        {
+            const float offset[3] = {10.0f * (i % 8), 0.1f * i, 10.0f * (i / 8)};
+            const std::vector<Surface> room = MakeRoom(0.3f + 0.7f * i, offset, cellSize);
+            surfaces.insert(surfaces.end(), room.begin(), room.end());
+        }
+        return surfaces;
+    }
+
+    // Returns the cluster in the plane of the surface, or nullptr.
+    const Cluster* FindCluster(const CoplanarQuadMerger& merger, const Surface& surface)
+    {
+        for (const Cluster& cluster : merger.GetClusters())
+        {
+            float normal[3];
+            float clusterNormal[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const int a = (axis + 1) % 3;
+                const int b = (axis + 2) % 3;
+                normal[axis] = surface.xAxis[a] * surface.yAxis[b] - surface.xAxis[b] * surface.yAxis[a];
+                clusterNormal[axis] = cluster.xAxis[a] * cluster.yAxis[b] - cluster.xAxis[b] * cluster.yAxis[a];
+            }
+            const float offset[3] = {
+                cluster.origin[0] - surface.origin[0], cluster.origin[1] - surface.origin[1], cluster.origin[2] - surface.origin[2]};
+            if (cluster.group == surface.group && Dot(normal, clusterNormal) > 0.999f && std::abs(Dot(offset, normal)) < 0.01f)
+            {
+                return &cluster;
+            }
+        }
+        return nullptr;
+    }
+} // namespace
+
+TEST_CASE(CoplanarQuadMerger_SingleQuad)
+{
+    // A quad on its own keeps its size, with the frame at its corner, so its texture coordinates are the same as without merging.
+    Quad quad = MakeQuad(WallGroup, 1.0f, 2.0f, 3.0f, 0.5f, 0.25f);
+    quad.xAxis[0] = 0.0f;
+    quad.xAxis[2] = 1.0f;
+    CoplanarQuadMerger merger;
+    merger.Merge(&quad, 1, CoplanarQuadMerger::Settings());
+    REQUIRE(merger.GetClusters().size() == 1 && merger.GetRects().size() == 1);
+
+    const Cluster& cluster = merger.GetClusters()[0];
+    const Rect& rect = merger.GetRects()[0];
+    CHECK(cluster.group == WallGroup && cluster.quadCount == 1 && cluster.rectCount == 1);
+    CHECK(rect.min[0] == 0.0f && rect.min[1] == 0.0f && rect.max[0] == 0.5f && rect.max[1] == 0.25f);
+    float corner[3];
+    CoplanarQuadMerger::GetPosition(cluster, 0.5f, 0.25f, corner);
+    CHECK(corner[0] == 1.0f && corner[1] == 2.125f && corner[2] == 3.25f);
+
+    // Empty quads are skipped.
+    quad.width = 0.0f;
+    merger.Merge(&quad, 1, CoplanarQuadMerger::Settings());
+    CHECK(merger.GetClusters().empty() && merger.GetStatistics().quadCount == 0);
+}
+
+TEST_CASE(CoplanarQuadMerger_Clusters)
+{
+    // Quads are merged only with quads of the same group, in the same plane, and turned by multiples of 90 degrees.
+    std::vector<Quad> quads = {
+        MakeQuad(0, 0, 1, 1),
+        MakeQuad(1, 0, 2, 1),
+        MakeQuad(FloorGroup, 2.5f, 0.5f, 0.0f, 1.0f, 1.0f),
+        MakeQuad(WallGroup, 2.5f, 0.5f, 0.05f, 1.0f, 1.0f),
+        MakeQuad(WallGroup, 2.5f, 0.5f, 0.01f, 1.0f, 1.0f),
+    };
+    Quad turned = MakeQuad(WallGroup, 0.5f, 1.5f, 0.0f, 1.0f, 1.0f);
+    turned.xAxis[0] = 0.0f;
+    turned.xAxis[1] = 1.0f;
+    turned.yAxis[0] = -1.0f;
+    turned.yAxis[1] = 0.0f;
+    quads.push_back(turned);
+    Quad diagonal = MakeQuad(WallGroup, 1.5f, 1.5f, 0.0f, 1.0f, 1.0f);
+    const float half = std::sqrt(0.5f);
+    diagonal.xAxis[0] = half;
+    diagonal.xAxis[1] = half;
+    diagonal.yAxis[0] = -half;
+    diagonal.yAxis[1] = half;
+    quads.push_back(diagonal);
+
+    CoplanarQuadMerger merger;
+    merger.Merge(quads.data(), static_cast<uint32_t>(quads.size()), CoplanarQuadMerger::Settings());
+    const std::vector<Cluster>& clusters = merger.GetClusters();
+    REQUIRE(clusters.size() == 4);
+    CHECK(clusters[0].quadCount == 4 && clusters[1].group == FloorGroup && clusters[2].quadCount == 1 && clusters[3].quadCount == 1);
+
+    // The quads at z = 0 and z = 0.01 form an L shape, which is split into two rectangles.
+    CHECK(clusters[0].rectCount == 2);
+    CHECK(std::abs(merger.GetStatistics().rectArea - 7.0) < 1e-4 && merger.GetStatistics().quadArea == 7.0);
+}
+
+TEST_CASE(CoplanarQuadMerger_Union)
+{
+    const CoplanarQuadMerger::Settings settings;
+    CoplanarQuadMerger merger;
+
+    // Overlapping quads and gaps narrower than the snap distance become one rectangle.
+    const std::vector<Quad> strip = {MakeQuad(0, 0, 1.2f, 1), MakeQuad(1, 0, 2, 1), MakeQuad(2.003f, 0, 3, 1.002f)};
+    merger.Merge(strip.data(), static_cast<uint32_t>(strip.size()), settings);
+    REQUIRE(merger.GetRects().size() == 1);
+    CHECK(std::abs(GetArea(merger.GetRects()[0]) - 3.0) < 1e-4);
+
+    // A floor around a pillar, made of eight quads, is four rectangles.
+    const std::vector<Quad> ring = {
+        MakeQuad(0, 0, 1.5f, 4),
+        MakeQuad(2.5f, 0, 4, 4),
+        MakeQuad(1, 0, 3, 1.5f),
+        MakeQuad(1.2f, 2.5f, 2.8f, 4),
+        MakeQuad(0, 0, 2, 1),
+        MakeQuad(3, 3, 4, 4),
+        MakeQuad(0, 3.5f, 4, 4),
+        MakeQuad(0.5f, 3, 3.5f, 3.8f)};
+    merger.Merge(ring.data(), static_cast<uint32_t>(ring.size()), settings);
+    REQUIRE(merger.GetClusters().size() == 1);
+    CHECK(merger.GetRects().size() == 4 && AreDisjoint(merger.GetRects(), merger.GetClusters()[0], 1e-4f));
+    CHECK(std::abs(merger.GetStatistics().rectArea - 15.0) < 1e-3);
+
+    // The union is split along columns if that gives fewer rectangles than rows, e.g. for a T on its side.
+    const std::vector<Quad> tee = {MakeQuad(0, 0, 1, 3), MakeQuad(1, 1, 3, 2)};
+    merger.Merge(tee.data(), static_cast<uint32_t>(tee.size()), settings);
+    CHECK(merger.GetRects().size() == 2);
+    const std::vector<Quad> upright = {MakeQuad(0, 0, 3, 1), MakeQuad(1, 1, 2, 3)};
+    merger.Merge(upright.data(), static_cast<uint32_t>(upright.size()), settings);
+    CHECK(merger.GetRects().size() == 2);
+}
+
+TEST_CASE(CoplanarQuadMerger_FragmentedRooms)
+{
+    // Rooms whose surfaces are returned in pieces are merged into one cluster per surface, with a floor around a pillar of four
+    // rectangles, a wall with a door of three, one with a window of four and one rectangle for each of the others.
+    for (float cellSize : {1.0f, 0.5f, 0.25f})
+    {
+        const std::vector<Surface> surfaces = MakeRooms(3, cellSize);
+        Tests::Random random(static_cast<uint64_t>(cellSize * 100));
+        std::vector<Quad> quads;
+        for (const Surface& surface : surfaces)
+        {
+            AppendQuads(surface, random, quads);
+        }
+
+        CoplanarQuadMerger merger;
+        merger.Merge(quads.data(), static_cast<uint32_t>(quads.size()), CoplanarQuadMerger::Settings());
+        CHECK(merger.GetClusters().size() == surfaces.size());
+        CHECK(merger.GetRects().size() == 3 * 14);
+
+        // The rectangles don't overlap, and cover the cells of the surface and nothing else. The texture coordinates are the position in
+        // the frame of the cluster, so they continue from one rectangle to the next.
+        bool found = true;
+        bool disjoint = true;
+        bool covered = true;
+        bool inPlane = true;
+        for (const Surface& surface : surfaces)
+        {
+            const Cluster* cluster = FindCluster(merger, surface);
+            if (!cluster)
+            {
+                found = false;
+                continue;
+            }
+            disjoint &= AreDisjoint(merger.GetRects(), *cluster, 1e-4f);
+
+            const Rect* rects = merger.GetRects().data() + cluster->firstRect;
+            for (uint32_t i = 0; i < cluster->rectCount; i++)
+            {
+                float corner[3];
+                CoplanarQuadMerger::GetPosition(*cluster, rects[i].max[0], rects[i].max[1], corner);
+                const float offset[3] = {corner[0] - surface.origin[0], corner[1] - surface.origin[1], corner[2] - surface.origin[2]};
+                const float x = Dot(offset, surface.xAxis);
+                const float y = Dot(offset, surface.yAxis);
+                const float distance = Dot(offset, offset) - x * x - y * y;
+                inPlane &= distance < 1e-4f && x > -0.01f && y > -0.01f;
+            }
+
+            // Sample points which are not too close to the edges of the cells.
+            for (int sample = 0; sample < 1000; sample++)
+            {
+                const uint32_t column = random.Next(surface.columnCount);
+                const uint32_t row = random.Next(surface.rowCount);
+                const float x = (column + random.NextFloat(0.05f, 0.95f)) * cellSize;
+                const float y = (row + random.NextFloat(0.05f, 0.95f)) * cellSize;
+                float position[3];
+                surface.GetPosition(x, y, position);
+                const float offset[3] = {
+                    position[0] - cluster->origin[0], position[1] - cluster->origin[1], position[2] - cluster->origin[2]};
+                const float clusterX = Dot(offset, cluster->xAxis);
+                const float clusterY = Dot(offset, cluster->yAxis);
+                bool inside = false;
+                for (uint32_t i = 0; i < cluster->rectCount; i++)
+                {
+                    inside |= clusterX > rects[i].min[0] && clusterX < rects[i].max[0] && clusterY > rects[i].min[1] &&
+                              clusterY < rects[i].max[1];
+                }
+                covered &= inside == surface.HasCell(column, row);
+            }
+        }
+        CHECK(found && disjoint && covered && inPlane);
+
+        const CoplanarQuadMerger::Statistics& statistics = merger.GetStatistics();
+        CHECK(std::abs(statistics.rectArea - 3 * (23.0 + 24.0 + 16.0 + 18.0 + 11.0 + 12.0)) < 0.1);
+        std::printf(
+            "    %.2f m cells: %u quads, %u rectangles, %.2fx overdraw before\n",
+            cellSize,
+            statistics.quadCount,
+            statistics.rectCount,
+            statistics.quadArea / statistics.rectArea);
+    }
+}
+
+BENCHMARK(CoplanarQuadMerger_Rooms)
+{
+    // Rooms returned in pieces of different sizes. Each quad or rectangle is drawn as two triangles of six vertices.
+    std::printf(
+        "%8s %8s %10s %10s %14s %14s %12s %12s\n",
+        "rooms",
+        "cell m",
+        "quads",
+        "rects",
+        "vertices",
+        "merged",
+        "overdraw",
+        "merge ms");
+
+    for (size_t roomCount : Tests::BenchmarkSizes({1, 4, 16}))
+    {
+        for (float cellSize : {1.0f, 0.5f, 0.25f})
+        {
+            const std::vector<Surface> surfaces = MakeRooms(roomCount, cellSize);
+            Tests::Random random(5);
+            std::vector<Quad> quads;
+            for (const Surface& surface : surfaces)
+            {
+                AppendQuads(surface, random, quads);
+            }
+
+            CoplanarQuadMerger merger;
+            const int repetitions = Tests::IsSmokeRun() ? 1 : 10;
+            Tests::Stopwatch stopwatch;
+            for (int r = 0; r < repetitions; r++)
+            {
+                merger.Merge(quads.data(), static_cast<uint32_t>(quads.size()), CoplanarQuadMerger::Settings());
+            }
+            const double milliseconds = stopwatch.ElapsedMilliseconds() / repetitions;
+
+            const CoplanarQuadMerger::Statistics& statistics = merger.GetStatistics();
+            std::printf(
+                "%8zu %8.2f %10u %10u %14u %14u %11.2fx %12.3f\n",
+                roomCount,
+                cellSize,
+                statistics.quadCount,
+                statistics.rectCount,
+                statistics.quadCount * 6,
+                statistics.rectCount * 6,
+                statistics.quadArea / statistics.rectArea,
+                milliseconds);
+        }
+    }
+}
@@ -0,0 +1,299 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#if defined(_WIN32)
+#    include <guiddef.h>
+#else
+struct GUID
+{
+    uint32_t Data1;
+    uint16_t Data2;
+    uint16_t Data3;
+    uint8_t Data4[8];
+};
+#endif
+
+#include <FlatHashMap.h>
+#include <Utils.h>
+
+#include <map>
+#include <memory>
+
+namespace
+{
+    struct GUIDEqual
+    {
+        bool operator()(const GUID& left, const GUID& right) const
+        {
+            return Utils::GUIDComparer::equals(left, right);
+        }
+    };
+
+    struct Part
+    {
+        uint32_t id = 0;
+        bool seen = false;
+    };
+
+    using PartMap = Utils::FlatHashMap<GUID, Part, Utils::GUIDHasher, GUIDEqual>;
+
+    GUID MakeGuid(Tests::Random& random)
+    {
+        GUID guid;
+        uint32_t words[4] = {random.Next(), random.Next(), random.Next(), random.Next()};
+        std::memcpy(&guid, words, sizeof(guid));
+        return guid;
+    }
+
+    std::vector<GUID> MakeGuids(size_t count, uint64_t seed = 1)
+    {
+        Tests::Random random(seed);
+        std::vector<GUID> guids(count);
+        for (GUID& guid : guids)
+        {
+            guid = MakeGuid(random);
+        }
+        return guids;
+    }
+} // namespace
+
+TEST_CASE(FlatHashMap_InsertFindErase)
+{
+    PartMap map;
+    const std::vector<GUID> guids = MakeGuids(1000);
+
+    for (uint32_t i = 0; i < guids.size(); i++)
+    {
+        auto [handle, inserted] = map.TryEmplace(guids[i], Part{i});
+        CHECK(inserted);
+        CHECK(handle.IsValid());
+    }
+    CHECK(map.Size() == guids.size());
+
+    // Inserting again returns the existing entry.
+    auto [handle, inserted] = map.TryEmplace(guids[17], Part{12345});
+    CHECK(!inserted);
+    CHECK(map.Get(handle)->id == 17);
+
+    for (uint32_t i = 0; i < guids.size(); i++)
+    {
+        const Part* part = map.Get(guids[i]);
+        REQUIRE(part);
+        CHECK(part->id == i);
+    }
+
+    for (uint32_t i = 0; i < guids.size(); i += 2)
+    {
+        CHECK(map.Erase(guids[i]));
+    }
+    CHECK(!map.Erase(guids[0]));
+    CHECK(map.Size() == guids.size() / 2);
+
+    for (uint32_t i = 0; i < guids.size(); i++)
+    {
+        const Part* part = map.Get(guids[i]);
+        CHECK((part != nullptr) == (i % 2 == 1));
+        CHECK(!part || part->id == i);
+    }
+}
+
+TEST_CASE(FlatHashMap_HandlesSurviveOtherErasesAndRehash)
+{
+    PartMap map;
+    const std::vector<GUID> guids = MakeGuids(64);
+
+    std::vector<PartMap::Handle> handles;
+    for (uint32_t i = 0; i < guids.size(); i++)
+    {
+        handles.push_back(map.TryEmplace(guids[i], Part{i}).first);
+    }
+
+    // Erasing moves values around in the dense array, handles must still resolve to their own value.
+    map.Erase(guids[0]);
+    map.Erase(guids[10]);
+
+    // Growing rehashes the buckets.
+    for (const GUID& guid : MakeGuids(1000, 2))
+    {
+        map.TryEmplace(guid);
+    }
+
+    CHECK(map.Get(handles[0]) == nullptr);
+    CHECK(map.Get(handles[10]) == nullptr);
+    for (uint32_t i = 1; i < guids.size(); i++)
+    {
+        if (i != 10)
+        {
+            const Part* part = map.Get(handles[i]);
+            REQUIRE(part);
+            CHECK(part->id == i);
+        }
+    }
+
+    // A handle to an erased entry must not resolve to a new entry which reuses its slot.
+    map.TryEmplace(guids[0], Part{999});
+    CHECK(map.Get(handles[0]) == nullptr);
+
+    map.Clear();
+    CHECK(map.Empty());
+    CHECK(map.Get(handles[5]) == nullptr);
+    CHECK(map.Get(guids[5]) == nullptr);
+}
+
+TEST_CASE(FlatHashMap_MarkAndSweep)
+{
+    PartMap map;
+    const std::vector<GUID> guids = MakeGuids(500);
+    for (uint32_t i = 0; i < guids.size(); i++)
+    {
+        map.TryEmplace(guids[i], Part{i});
+    }
+
+    for (uint32_t i = 0; i < guids.size(); i += 3)
+    {
+        map.Get(guids[i])->seen = true;
+    }
+
+    const size_t erased = map.EraseIf([](const Part& part) { return !part.seen; });
+    CHECK(erased == guids.size() - (guids.size() + 2) / 3);
+    CHECK(map.Size() == (guids.size() + 2) / 3);
+
+    for (size_t i = 0; i < map.Size(); i++)
+    {
+        const Part* part = map.Get(map.HandleAt(i));
+        REQUIRE(part);
+        CHECK(part->seen);
+        CHECK(Utils::GUIDComparer::equals(map.KeyAt(i), guids[part->id]));
+    }
+}
+
+TEST_CASE(FlatHashMap_MatchesReferenceMap)
+{
+    PartMap map;
+    std::map<GUID, uint32_t, Utils::GUIDComparer> reference;
+
+    // Few distinct keys, so that inserts and erases hit existing entries and probe chains wrap around.
+    const std::vector<GUID> guids = MakeGuids(200, 3);
+    Tests::Random random(4);
+    for (uint32_t step = 0; step < 20000; step++)
+    {
+        const GUID& guid = guids[random.Next(static_cast<uint32_t>(guids.size()))];
+        if (random.Next(3) == 0)
+        {
+            CHECK(map.Erase(guid) == (reference.erase(guid) == 1));
+        }
+        else
+        {
+            const bool inserted = map.TryEmplace(guid, Part{step}).second;
+            CHECK(inserted == reference.emplace(guid, step).second);
+        }
+    }
+
+    CHECK(map.Size() == reference.size());
+    for (const auto& [guid, id] : reference)
+    {
+        const Part* part = map.Get(guid);
+        REQUIRE(part);
+        CHECK(part->id == id);
+    }
+}
+
+BENCHMARK(FlatHashMap_Benchmark)
+{
+    std::printf("%8s %12s %12s %12s %12s %12s\n", "parts", "container", "insert us", "lookup us", "sweep us", "iterate us");
+
+    for (size_t count : Tests::BenchmarkSizes({100, 1000, 10000}))
+    {
+        const std::vector<GUID> guids = MakeGuids(count);
+        const int repetitions = static_cast<int>(std::max<size_t>(1, 100000 / count));
+
+        double flat[4] = {};
+        double tree[4] = {};
+        uint64_t checksum = 0;
+        for (int repetition = 0; repetition < repetitions; repetition++)
+        {
+            {
+                PartMap map;
+                Tests::Stopwatch insert;
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    map.TryEmplace(guids[i], Part{i});
+                }
+                flat[0] += insert.ElapsedMilliseconds();
+
+                Tests::Stopwatch lookup;
+                for (const GUID& guid : guids)
+                {
+                    Part* part = map.Get(guid);
+                    part->seen = (part->id & 1) == 0;
+                }
+                flat[1] += lookup.ElapsedMilliseconds();
+
+                Tests::Stopwatch sweep;
+                map.EraseIf([](const Part& part) { return !part.seen; });
+                flat[2] += sweep.ElapsedMilliseconds();
+
+                Tests::Stopwatch iterate;
+                for (const Part& part : map)
+                {
+                    checksum += part.id;
+                }
+                flat[3] += iterate.ElapsedMilliseconds();
+            }
+
+            {
+                // What the renderer used before: a tree of individually allocated parts.
+                std::map<GUID, std::unique_ptr<Part>, Utils::GUIDComparer> map;
+                Tests::Stopwatch insert;
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    map.emplace(guids[i], std::make_unique<Part>(Part{i}));
+                }
+                tree[0] += insert.ElapsedMilliseconds();
+
+                Tests::Stopwatch lookup;
+                for (const GUID& guid : guids)
+                {
+                    Part* part = map.find(guid)->second.get();
+                    part->seen = (part->id & 1) == 0;
+                }
+                tree[1] += lookup.ElapsedMilliseconds();
+
+                Tests::Stopwatch sweep;
+                std::erase_if(map, [](const auto& entry) { return !entry.second->seen; });
+                tree[2] += sweep.ElapsedMilliseconds();
+
+                Tests::Stopwatch iterate;
+                for (const auto& entry : map)
+                {
+                    checksum += entry.second->id;
+                }
+                tree[3] += iterate.ElapsedMilliseconds();
+            }
+        }
+
+        const auto print = [&](const char* name, const double* timings) {
+            std::printf(
+                "%8zu %12s %12.2f %12.2f %12.2f %12.2f\n",
+                count,
+                name,
+                timings[0] * 1000.0 / repetitions,
+                timings[1] * 1000.0 / repetitions,
+                timings[2] * 1000.0 / repetitions,
+                timings[3] * 1000.0 / repetitions);
+        };
+        print("FlatHashMap", flat);
+        print("std::map", tree);
+        CHECK(checksum > 0);
+    }
+}
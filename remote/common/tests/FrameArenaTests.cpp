@@ -0,0 +1,285 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+#include "TestHands.h"
+
+#include <FrameArena.h>
+
+#include <cstring>
+
+namespace
+{
+    using TestHands::HandJointCount;
+    using TestHands::Joint;
+    using TestHands::JointVertexCount;
+    using TestHands::Vertex;
+
+    bool IsAligned(const void* memory, size_t alignment)
+    {
+        return reinterpret_cast<uintptr_t>(memory) % alignment == 0;
+    }
+
+    // Counts the allocations of the containers of the per frame geometry without the arena.
+    uint64_t g_heapAllocationCount = 0;
+
+    template <typename T>
+    struct CountingAllocator
+    {
+        using value_type = T;
+
+        CountingAllocator() = default;
+
+        template <typename U>
+        CountingAllocator(const CountingAllocator<U>&)
+        {
+        }
+
+        T* allocate(size_t count)
+        {
+            g_heapAllocationCount++;
+            return std::allocator<T>().allocate(count);
+        }
+
+        void deallocate(T* memory, size_t count)
+        {
+            std::allocator<T>().deallocate(memory, count);
+        }
+
+        bool operator==(const CountingAllocator&) const
+        {
+            return true;
+        }
+    };
+
+    template <typename T>
+    using CountedVector = std::vector<T, CountingAllocator<T>>;
+
+    // The geometry of a frame with containers from the heap: the joints are kept in a member which is cleared and refilled, the vertices
+    // of each joint are returned in a vector of their own, and appended to the vertices of the frame.
+    class HeapFrameBuilder
+    {
+    public:
+        size_t Build(size_t handCount, int frame)
+        {
+            m_joints.clear();
+            m_joints.resize(handCount * HandJointCount);
+            TestHands::GetHandJoints(handCount, frame, m_joints.data());
+
+            CountedVector<Vertex> vertices;
+            for (const Joint& joint : m_joints)
+            {
+                const CountedVector<Vertex> jointVertices = GetJointVertices(joint);
+                vertices.insert(vertices.end(), jointVertices.begin(), jointVertices.end());
+            }
+            return vertices.size();
+        }
+
+    private:
+        static CountedVector<Vertex> GetJointVertices(const Joint& joint)
+        {
+            CountedVector<Vertex> vertices(JointVertexCount);
+            TestHands::SetJointVertices(joint, vertices.data());
+            return vertices;
+        }
+
+        CountedVector<Joint> m_joints;
+    };
+
+    // The same geometry in the arena, reset at the start of each frame.
+    class ArenaFrameBuilder
+    {
+    public:
+        explicit ArenaFrameBuilder(size_t capacity)
+            : m_arena(capacity)
+        {
+        }
+
+        size_t Build(size_t handCount, int frame)
+        {
+            m_arena.Reset();
+            m_joints = FrameArena::Array<Joint>(m_arena, handCount * HandJointCount);
+            TestHands::GetHandJoints(handCount, frame, m_joints.grow(handCount * HandJointCount));
+
+            FrameArena::Array<Vertex> vertices(m_arena, m_joints.size() * JointVertexCount);
+            for (const Joint& joint : m_joints)
+            {
+                TestHands::SetJointVertices(joint, vertices.grow(JointVertexCount));
+            }
+            return vertices.size();
+        }
+
+        const FrameArena& GetArena() const
+        {
+            return m_arena;
+        }
+
+    private:
+        FrameArena m_arena;
+        FrameArena::Array<Joint> m_joints;
+    };
+} // namespace
+
+TEST_CASE(FrameArena_Allocate)
+{
+    FrameArena arena(1024);
+    uint8_t* bytes = static_cast<uint8_t*>(arena.Allocate(3, 1));
+    double* doubles = arena.Allocate<double>(4);
+    void* aligned = arena.Allocate(16, 64);
+    CHECK(IsAligned(doubles, alignof(double)) && IsAligned(aligned, 64));
+    CHECK(reinterpret_cast<uint8_t*>(doubles) >= bytes + 3 && static_cast<uint8_t*>(aligned) >= reinterpret_cast<uint8_t*>(doubles + 4));
+
+    // The used bytes include the alignment padding.
+    FrameArena::Statistics statistics = arena.GetStatistics();
+    CHECK(statistics.allocationCount == 3 && statistics.allocatedBytes == 3 + 32 + 16);
+    CHECK(statistics.usedBytes == static_cast<size_t>(static_cast<uint8_t*>(aligned) + 16 - bytes));
+    CHECK(statistics.overflowCount == 0 && statistics.heapAllocationCount == 1 && statistics.capacity == 1024);
+
+    // Reset takes back all allocations, the next frame starts at the beginning of the block.
+    arena.Reset();
+    CHECK(arena.Allocate(3, 1) == bytes);
+    statistics = arena.GetStatistics();
+    CHECK(statistics.frameCount == 1 && statistics.usedBytes == 3 && statistics.peakUsedBytes > 51);
+}
+
+TEST_CASE(FrameArena_Overflow)
+{
+    FrameArena arena(256);
+    uint8_t* first = arena.Allocate<uint8_t>(200);
+    uint8_t* second = arena.Allocate<uint8_t>(100);
+    uint8_t* third = arena.Allocate<uint8_t>(100);
+    uint8_t* large = arena.Allocate<uint8_t>(1000);
+    std::memset(first, 1, 200);
+    std::memset(second, 2, 100);
+    std::memset(third, 3, 100);
+    std::memset(large, 4, 1000);
+    CHECK(first[199] == 1 && second[0] == 2 && second[99] == 2 && third[99] == 3 && large[0] == 4);
+
+    // The second and the third allocation share an overflow block of the size of the block, the large one gets its own.
+    FrameArena::Statistics statistics = arena.GetStatistics();
+    CHECK(statistics.overflowCount == 3 && statistics.heapAllocationCount == 3);
+    CHECK(statistics.usedBytes >= 1400 && statistics.capacity == 256);
+
+    // The next frame has a block of twice what the frame used, and the same allocations fit into it.
+    arena.Reset();
+    statistics = arena.GetStatistics();
+    CHECK(statistics.capacity == 4096 && statistics.heapAllocationCount == 4 && statistics.usedBytes == 0);
+    for (size_t size : {200, 100, 100, 1000})
+    {
+        arena.Allocate<uint8_t>(size);
+    }
+    arena.Reset();
+    statistics = arena.GetStatistics();
+    CHECK(statistics.overflowCount == 3 && statistics.heapAllocationCount == 4 && statistics.capacity == 4096);
+}
+
+TEST_CASE(FrameArena_Array)
+{
+    FrameArena arena(64);
+    FrameArena::Array<uint32_t> values(arena);
+    CHECK(values.empty() && values.data() == nullptr);
+
+    // Growing keeps the elements, also when the array moves to an overflow block.
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        values.push_back(i);
+    }
+    uint32_t* more = values.grow(3);
+    more[0] = 100;
+    more[1] = 101;
+    more[2] = 102;
+    bool kept = values.size() == 103;
+    for (uint32_t i = 0; i < values.size(); i++)
+    {
+        kept &= values[i] == i;
+    }
+    CHECK(kept);
+    CHECK(arena.GetStatistics().overflowCount > 0);
+
+    // A reserved array doesn't allocate again until it is full.
+    arena.Reset();
+    FrameArena::Array<uint32_t> reserved(arena, 16);
+    const uint32_t* data = reserved.data();
+    const uint64_t allocationCount = arena.GetStatistics().allocationCount;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        reserved.emplace_back(i);
+    }
+    CHECK(reserved.data() == data && arena.GetStatistics().allocationCount == allocationCount);
+    reserved.clear();
+    CHECK(reserved.empty() && reserved.begin() == reserved.end());
+}
+
+TEST_CASE(FrameArena_HandGeometryMatchesHeap)
+{
+    // The arena builds the same vertices as the containers from the heap. Only the first frame overflows the small block, the ones
+    // after it don't allocate from the heap anymore.
+    HeapFrameBuilder heapBuilder;
+    ArenaFrameBuilder arenaBuilder(1024);
+    CHECK(heapBuilder.Build(2, 0) == arenaBuilder.Build(2, 0));
+    const FrameArena::Statistics first = arenaBuilder.GetArena().GetStatistics();
+    CHECK(first.overflowCount > 0);
+    for (int frame = 1; frame < 20; frame++)
+    {
+        CHECK(heapBuilder.Build(2, frame) == arenaBuilder.Build(2, frame));
+    }
+    const FrameArena::Statistics statistics = arenaBuilder.GetArena().GetStatistics();
+    CHECK(statistics.overflowCount == first.overflowCount && statistics.heapAllocationCount == first.heapAllocationCount + 1);
+}
+
+BENCHMARK(FrameArena_HandGeometry)
+{
+    // The joints of 2 hands and of 100 for a stress test. The arena starts at the 64 KB of SpatialInputRenderer, which is enough for two
+    // hands.
+    std::printf("%8s %10s %16s %14s %14s %12s\n", "hands", "arena", "heap allocs/f", "arena KB", "overflows", "frame us");
+
+    for (size_t handCount : {size_t(2), size_t(100)})
+    {
+        const int warmupFrameCount = 10;
+        const int frameCount = Tests::IsSmokeRun() ? 20 : 2000;
+        for (bool useArena : {false, true})
+        {
+            HeapFrameBuilder heapBuilder;
+            ArenaFrameBuilder arenaBuilder(64 * 1024);
+            size_t vertexCount = 0;
+            for (int frame = 0; frame < warmupFrameCount; frame++)
+            {
+                vertexCount += useArena ? arenaBuilder.Build(handCount, frame) : heapBuilder.Build(handCount, frame);
+            }
+
+            const uint64_t heapAllocationCount =
+                useArena ? arenaBuilder.GetArena().GetStatistics().heapAllocationCount : g_heapAllocationCount;
+            Tests::Stopwatch stopwatch;
+            for (int frame = warmupFrameCount; frame < frameCount; frame++)
+            {
+                vertexCount += useArena ? arenaBuilder.Build(handCount, frame) : heapBuilder.Build(handCount, frame);
+            }
+            const double microseconds = stopwatch.ElapsedMilliseconds() * 1000.0 / (frameCount - warmupFrameCount);
+
+            const FrameArena::Statistics statistics = arenaBuilder.GetArena().GetStatistics();
+            const uint64_t steadyAllocationCount =
+                (useArena ? statistics.heapAllocationCount : g_heapAllocationCount) - heapAllocationCount;
+            if (useArena)
+            {
+                CHECK(steadyAllocationCount == 0);
+            }
+            std::printf(
+                "%8zu %10s %16.1f %14.1f %14llu %12.2f\n",
+                handCount,
+                useArena ? "yes" : "no",
+                static_cast<double>(steadyAllocationCount) / (frameCount - warmupFrameCount),
+                useArena ? statistics.capacity / 1024.0 : 0.0,
+                static_cast<unsigned long long>(statistics.overflowCount),
+                microseconds);
+            CHECK(vertexCount == frameCount * handCount * HandJointCount * JointVertexCount);
+        }
+    }
+}
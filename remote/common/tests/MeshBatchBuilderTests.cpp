@@ -0,0 +1,189 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <MeshBatchBuilder.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+    struct TestPart
+    {
+        uint32_t slot;
+        uint32_t indexOffset;
+        uint32_t indexCount;
+    };
+
+    void AddParts(MeshBatchBuilder& builder, const std::vector<TestPart>& parts)
+    {
+        builder.Begin();
+        for (const TestPart& part : parts)
+        {
+            float model[16] = {};
+            model[0] = model[5] = model[10] = model[15] = 1.0f;
+            model[12] = static_cast<float>(part.slot);
+            builder.AddPart(part.slot, model, part.slot * 100, part.indexOffset, part.indexCount);
+        }
+    }
+
+    // Executes the copy ranges of the builder on a fake shared index buffer in which every index is its own offset.
+    std::vector<uint32_t> ExecuteCopies(const MeshBatchBuilder& builder)
+    {
+        std::vector<uint32_t> batch(builder.GetIndexCount());
+        for (const MeshBatchBuilder::CopyRange& range : builder.GetCopyRanges())
+        {
+            std::iota(batch.begin() + range.destinationOffset, batch.begin() + range.destinationOffset + range.count, range.sourceOffset);
+        }
+        return batch;
+    }
+} // namespace
+
+TEST_CASE(MeshBatchBuilder_RebaseIndices)
+{
+    const uint16_t indices[] = {0, 1, 2, 65535};
+    uint32_t rebased[4];
+    MeshBatchBuilder::RebaseIndices(rebased, indices, 4, 3);
+    CHECK(rebased[0] == 0x30000 && rebased[1] == 0x30001 && rebased[2] == 0x30002 && rebased[3] == 0x3FFFF);
+
+    MeshBatchBuilder::RebaseIndices(rebased, indices, 4, MeshBatchBuilder::MaxSlotCount - 1);
+    CHECK(rebased[3] == 0xFFFFFFFFu);
+}
+
+TEST_CASE(MeshBatchBuilder_MergesAdjacentRanges)
+{
+    MeshBatchBuilder builder;
+
+    // Parts 1 and 2 as well as 3 and 4 are neighbors in the shared index buffer, regardless of the order they are added in.
+    AddParts(builder, {{4, 300, 30}, {1, 0, 60}, {3, 150, 150}, {2, 60, 30}, {5, 1000, 0}});
+    CHECK(builder.End());
+
+    const std::vector<MeshBatchBuilder::CopyRange>& ranges = builder.GetCopyRanges();
+    REQUIRE(ranges.size() == 2);
+    CHECK(ranges[0].sourceOffset == 0 && ranges[0].count == 90 && ranges[0].destinationOffset == 0);
+    CHECK(ranges[1].sourceOffset == 150 && ranges[1].count == 180 && ranges[1].destinationOffset == 90);
+    CHECK(builder.GetIndexCount() == 270);
+
+    // Every part's indices end up in the batch exactly once.
+    std::vector<uint32_t> batch = ExecuteCopies(builder);
+    std::vector<uint32_t> expected;
+    for (const TestPart& part : std::vector<TestPart>{{1, 0, 60}, {2, 60, 30}, {3, 150, 150}, {4, 300, 30}})
+    {
+        for (uint32_t i = 0; i < part.indexCount; i++)
+        {
+            expected.push_back(part.indexOffset + i);
+        }
+    }
+    std::sort(batch.begin(), batch.end());
+    CHECK(batch == expected);
+}
+
+TEST_CASE(MeshBatchBuilder_PartDataBySlot)
+{
+    MeshBatchBuilder builder;
+    AddParts(builder, {{7, 0, 3}, {2, 3, 3}});
+    builder.End();
+
+    CHECK(builder.GetPartDataCount() == 8);
+    const MeshBatchBuilder::PartData* partData = builder.GetPartData();
+    CHECK(partData[7].baseVertex == 700 && partData[7].model[12] == 7.0f);
+    CHECK(partData[2].baseVertex == 200 && partData[2].model[12] == 2.0f);
+    CHECK(sizeof(MeshBatchBuilder::PartData) % 16 == 0);
+}
+
+TEST_CASE(MeshBatchBuilder_ReportsChangedRanges)
+{
+    MeshBatchBuilder builder;
+    const std::vector<TestPart> parts = {{0, 0, 30}, {1, 30, 30}, {2, 90, 60}};
+
+    AddParts(builder, parts);
+    CHECK(builder.End());
+
+    // Same ranges, only the transforms would have changed.
+    AddParts(builder, parts);
+    CHECK(!builder.End());
+
+    // A part switched to a different level of detail.
+    AddParts(builder, {{0, 0, 30}, {1, 30, 30}, {2, 90, 30}});
+    CHECK(builder.End());
+
+    // A part was culled.
+    AddParts(builder, {{0, 0, 30}, {2, 90, 30}});
+    CHECK(builder.End());
+    CHECK(builder.GetIndexCount() == 60);
+
+    AddParts(builder, {{0, 0, 30}, {2, 90, 30}});
+    CHECK(!builder.End());
+
+    builder.Invalidate();
+    AddParts(builder, {{0, 0, 30}, {2, 90, 30}});
+    CHECK(builder.End());
+}
+
+BENCHMARK(MeshBatchBuilder_PackingCost)
+{
+    // A frame of the renderer: all parts are added with their transform, about a third are culled, and half of the visible ones are
+    // neighbors in the shared index buffer.
+    std::printf("%10s %12s %12s %12s %12s\n", "parts", "ns/part", "copies", "indices", "rebase ns/i");
+
+    for (size_t partCount : Tests::BenchmarkSizes({100, 1000, 10000}))
+    {
+        Tests::Random random(27);
+        std::vector<TestPart> parts;
+        uint32_t offset = 0;
+        for (uint32_t slot = 0; slot < partCount; slot++)
+        {
+            const uint32_t count = 3 * (100 + random.Next(2000));
+            parts.push_back({slot, offset, count});
+            offset += count + (random.Next(2) == 0 ? 0 : 3 * random.Next(500));
+        }
+
+        MeshBatchBuilder builder;
+        const size_t frameCount = Tests::IsSmokeRun() ? 10 : 2000;
+        std::vector<TestPart> visible;
+        Tests::Stopwatch stopwatch;
+        for (size_t frame = 0; frame < frameCount; frame++)
+        {
+            visible.clear();
+            for (const TestPart& part : parts)
+            {
+                if ((part.slot + frame / 60) % 3 != 0)
+                {
+                    visible.push_back(part);
+                }
+            }
+            AddParts(builder, visible);
+            builder.End();
+        }
+        const double milliseconds = stopwatch.ElapsedMilliseconds();
+
+        std::vector<uint16_t> indices(65535);
+        std::iota(indices.begin(), indices.end(), uint16_t(0));
+        std::vector<uint32_t> rebased(indices.size());
+        Tests::Stopwatch rebaseStopwatch;
+        const uint32_t indexCount = static_cast<uint32_t>(indices.size());
+        for (size_t i = 0; i < frameCount; i++)
+        {
+            MeshBatchBuilder::RebaseIndices(rebased.data(), indices.data(), indexCount, static_cast<uint32_t>(i));
+        }
+        const double rebaseMilliseconds = rebaseStopwatch.ElapsedMilliseconds();
+
+        std::printf(
+            "%10zu %12.1f %12zu %12u %12.3f\n",
+            partCount,
+            milliseconds * 1.0e6 / (frameCount * partCount),
+            builder.GetCopyRanges().size(),
+            builder.GetIndexCount(),
+            rebaseMilliseconds * 1.0e6 / (frameCount * indices.size()));
+    }
+}
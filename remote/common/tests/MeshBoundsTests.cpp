@@ -0,0 +1,129 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <MeshBounds.h>
+
+#include <algorithm>
+
+namespace
+{
+    SnormBounds ReferenceBounds(const int16_t* positions, uint32_t count)
+    {
+        SnormBounds bounds;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                bounds.min[k] = std::min(bounds.min[k], positions[i * 4 + k]);
+                bounds.max[k] = std::max(bounds.max[k], positions[i * 4 + k]);
+            }
+        }
+        return bounds;
+    }
+
+    bool Equal(const SnormBounds& a, const SnormBounds& b)
+    {
+        return std::equal(a.min, a.min + 3, b.min) && std::equal(a.max, a.max + 3, b.max);
+    }
+
+    std::vector<int16_t> MakePositions(uint32_t count, Tests::Random& random)
+    {
+        std::vector<int16_t> positions(size_t(count) * 4);
+        for (int16_t& value : positions)
+        {
+            value = static_cast<int16_t>(random.Next(65536) - 32768);
+        }
+        return positions;
+    }
+} // namespace
+
+TEST_CASE(MeshBounds_MatchesScalarReference)
+{
+    Tests::Random random(21);
+
+    // All tail lengths around the eight vertex SIMD loop, and larger meshes.
+    for (uint32_t count = 0; count < 70; count++)
+    {
+        const std::vector<int16_t> positions = MakePositions(count, random);
+        CHECK(Equal(ComputeSnormBounds(positions.data(), count), ReferenceBounds(positions.data(), count)));
+    }
+
+    for (uint32_t count : {1000u, 4097u, 65535u})
+    {
+        const std::vector<int16_t> positions = MakePositions(count, random);
+        CHECK(Equal(ComputeSnormBounds(positions.data(), count), ReferenceBounds(positions.data(), count)));
+    }
+}
+
+TEST_CASE(MeshBounds_IgnoresW)
+{
+    // w is always 32767 in spatial mapping meshes, it must not leak into the bounds of x, y or z.
+    std::vector<int16_t> positions;
+    for (int i = 0; i < 20; i++)
+    {
+        positions.insert(positions.end(), {static_cast<int16_t>(i), static_cast<int16_t>(-i), 0, INT16_MAX});
+    }
+
+    const SnormBounds bounds = ComputeSnormBounds(positions.data(), 20);
+    CHECK(bounds.min[0] == 0 && bounds.max[0] == 19);
+    CHECK(bounds.min[1] == -19 && bounds.max[1] == 0);
+    CHECK(bounds.min[2] == 0 && bounds.max[2] == 0);
+}
+
+TEST_CASE(MeshBounds_Extremes)
+{
+    std::vector<int16_t> positions(16 * 4, 0);
+    positions[5 * 4 + 0] = INT16_MIN;
+    positions[9 * 4 + 1] = INT16_MAX;
+    positions[15 * 4 + 2] = INT16_MIN;
+
+    const SnormBounds bounds = ComputeSnormBounds(positions.data(), 16);
+    CHECK(bounds.min[0] == INT16_MIN && bounds.max[1] == INT16_MAX && bounds.min[2] == INT16_MIN);
+    CHECK(!bounds.IsEmpty());
+    CHECK(ComputeSnormBounds(positions.data(), 0).IsEmpty());
+}
+
+BENCHMARK(MeshBounds_Kernel)
+{
+    std::printf("%12s %14s %14s %10s\n", "vertices", "simd Mvert/s", "scalar Mvert/s", "speedup");
+
+    Tests::Random random(23);
+    for (size_t count : Tests::BenchmarkSizes({1000, 16000, 65535}))
+    {
+        const std::vector<int16_t> positions = MakePositions(static_cast<uint32_t>(count), random);
+        const size_t repetitions = std::max<size_t>(1, (Tests::IsSmokeRun() ? 1000000 : 200000000) / count);
+
+        int32_t checksum = 0;
+        Tests::Stopwatch simd;
+        for (size_t i = 0; i < repetitions; i++)
+        {
+            checksum += ComputeSnormBounds(positions.data(), static_cast<uint32_t>(count)).max[0];
+        }
+        const double simdMilliseconds = simd.ElapsedMilliseconds();
+
+        Tests::Stopwatch scalar;
+        for (size_t i = 0; i < repetitions; i++)
+        {
+            checksum -= ReferenceBounds(positions.data(), static_cast<uint32_t>(count)).max[0];
+        }
+        const double scalarMilliseconds = scalar.ElapsedMilliseconds();
+
+        std::printf(
+            "%12zu %14.1f %14.1f %10.2f\n",
+            count,
+            count * repetitions / (simdMilliseconds * 1000.0),
+            count * repetitions / (scalarMilliseconds * 1000.0),
+            scalarMilliseconds / simdMilliseconds);
+        CHECK(checksum == 0);
+    }
+}
@@ -0,0 +1,360 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <MeshCache.h>
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    // A cache file in the temp directory, which is deleted again at the end of the test.
+    class TempPath
+    {
+    public:
+        explicit TempPath(const char* name)
+            : m_path(std::filesystem::temp_directory_path() / name)
+        {
+            Remove();
+        }
+
+        ~TempPath()
+        {
+            Remove();
+        }
+
+        const std::filesystem::path& Get() const
+        {
+            return m_path;
+        }
+
+        uint64_t GetFileSize() const
+        {
+            return std::filesystem::file_size(m_path);
+        }
+
+    private:
+        void Remove()
+        {
+            std::error_code error;
+            std::filesystem::remove(m_path, error);
+            std::filesystem::remove(std::filesystem::path(m_path) += ".tmp", error);
+        }
+
+        std::filesystem::path m_path;
+    };
+
+    struct TestMesh
+    {
+        std::vector<int16_t> positions;
+        std::vector<uint16_t> indices[MeshCache::MaxLodCount];
+        MeshCache::Mesh mesh;
+    };
+
+    MeshCache::Id MakeId(uint32_t value)
+    {
+        MeshCache::Id id;
+        std::memcpy(id.bytes, &value, sizeof(value));
+        id.bytes[15] = 0xAB;
+        return id;
+    }
+
+    TestMesh MakeMesh(uint32_t vertexCount, uint32_t lodCount, int64_t updateTime, Tests::Random& random)
+    {
+        TestMesh result;
+        result.positions.resize(size_t(vertexCount) * 4);
+        for (int16_t& value : result.positions)
+        {
+            value = static_cast<int16_t>(random.Next(65536) - 32768);
+        }
+
+        MeshCache::Mesh& mesh = result.mesh;
+        mesh.updateTime = updateTime;
+        mesh.contentHash = random.Next() * 0x100000001ull;
+        mesh.vertexScale[0] = random.NextFloat(0.5f, 4.0f);
+        mesh.center[1] = random.NextFloat(-1.0f, 1.0f);
+        mesh.extents[2] = random.NextFloat(0.1f, 2.0f);
+        mesh.boundsOrientation[0] = 0.5f;
+        mesh.vertexCount = vertexCount;
+        mesh.lodCount = lodCount;
+        mesh.positions = result.positions.data();
+
+        // Odd index counts, so the payload needs padding.
+        for (uint32_t lod = 0; lod < lodCount; lod++)
+        {
+            result.indices[lod].resize(((vertexCount * 3) >> lod) | 1);
+            for (uint16_t& index : result.indices[lod])
+            {
+                index = static_cast<uint16_t>(random.Next(vertexCount));
+            }
+            mesh.lodIndexCounts[lod] = static_cast<uint32_t>(result.indices[lod].size());
+            mesh.indices[lod] = result.indices[lod].data();
+        }
+        return result;
+    }
+
+    bool Matches(const MeshCache::Mesh& cached, const TestMesh& expected)
+    {
+        const MeshCache::Mesh& mesh = expected.mesh;
+        bool equal = cached.updateTime == mesh.updateTime && cached.contentHash == mesh.contentHash &&
+                     std::memcmp(cached.vertexScale, mesh.vertexScale, sizeof(mesh.vertexScale)) == 0 &&
+                     std::memcmp(cached.center, mesh.center, sizeof(mesh.center)) == 0 &&
+                     std::memcmp(cached.extents, mesh.extents, sizeof(mesh.extents)) == 0 &&
+                     std::memcmp(cached.boundsOrientation, mesh.boundsOrientation, sizeof(mesh.boundsOrientation)) == 0 &&
+                     cached.vertexCount == mesh.vertexCount && cached.lodCount == mesh.lodCount &&
+                     std::memcmp(cached.positions, expected.positions.data(), expected.positions.size() * sizeof(int16_t)) == 0;
+        for (uint32_t lod = 0; lod < mesh.lodCount && equal; lod++)
+        {
+            equal = cached.lodIndexCounts[lod] == mesh.lodIndexCounts[lod] &&
+                    std::memcmp(cached.indices[lod], expected.indices[lod].data(), expected.indices[lod].size() * sizeof(uint16_t)) == 0;
+        }
+        return equal;
+    }
+
+    bool ReadMatches(MeshCache& cache, uint32_t id, const TestMesh& expected)
+    {
+        bool matches = false;
+        const bool found =
+            cache.Read(MakeId(id), expected.mesh.updateTime, [&](const MeshCache::Mesh& mesh) { matches = Matches(mesh, expected); });
+        return found && matches;
+    }
+
+    void PatchFile(const std::filesystem::path& path, uint64_t offset, const void* data, size_t size)
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+} // namespace
+
+TEST_CASE(MeshCache_StoresAndReloads)
+{
+    TempPath path("MeshCacheTests_StoresAndReloads.bin");
+    Tests::Random random(41);
+    const TestMesh a = MakeMesh(100, 3, 1000, random);
+    const TestMesh b = MakeMesh(7, 1, 2000, random);
+
+    {
+        MeshCache cache(path.Get());
+        REQUIRE(cache.IsOpen());
+        CHECK(cache.GetStatistics().fileSize == 16);
+        CHECK(cache.Store(MakeId(1), a.mesh));
+        CHECK(cache.Store(MakeId(2), b.mesh));
+
+        // Readable right away, before the file is mapped again.
+        CHECK(ReadMatches(cache, 1, a));
+        CHECK(ReadMatches(cache, 2, b));
+    }
+
+    MeshCache cache(path.Get());
+    CHECK(cache.GetStatistics().meshCount == 2);
+    CHECK(cache.GetStatistics().fileSize == path.GetFileSize());
+    CHECK(cache.GetStatistics().fileSize % 8 == 0);
+    CHECK(ReadMatches(cache, 1, a));
+    CHECK(ReadMatches(cache, 2, b));
+
+    // The surface changed since the mesh was stored, or was never stored.
+    CHECK(!cache.Read(MakeId(1), 1001, [](const MeshCache::Mesh&) {}));
+    CHECK(!cache.Read(MakeId(3), 1000, [](const MeshCache::Mesh&) {}));
+    CHECK(cache.GetStatistics().hitCount == 2);
+    CHECK(cache.GetStatistics().missCount == 2);
+}
+
+TEST_CASE(MeshCache_LatestRecordWins)
+{
+    TempPath path("MeshCacheTests_LatestRecordWins.bin");
+    Tests::Random random(43);
+    const TestMesh first = MakeMesh(50, 2, 10, random);
+    const TestMesh second = MakeMesh(60, 2, 20, random);
+
+    {
+        MeshCache cache(path.Get());
+        cache.Store(MakeId(5), first.mesh);
+        cache.Store(MakeId(5), second.mesh);
+        CHECK(!cache.Read(MakeId(5), 10, [](const MeshCache::Mesh&) {}));
+        CHECK(ReadMatches(cache, 5, second));
+    }
+
+    MeshCache cache(path.Get());
+    const MeshCache::Statistics statistics = cache.GetStatistics();
+    CHECK(statistics.meshCount == 1);
+    CHECK(statistics.liveSize < statistics.fileSize - 16);
+    CHECK(ReadMatches(cache, 5, second));
+}
+
+TEST_CASE(MeshCache_DiscardsOtherVersions)
+{
+    TempPath path("MeshCacheTests_DiscardsOtherVersions.bin");
+    Tests::Random random(47);
+    {
+        MeshCache cache(path.Get());
+        cache.Store(MakeId(1), MakeMesh(10, 1, 1, random).mesh);
+    }
+
+    const uint32_t version = MeshCache::Version + 1;
+    PatchFile(path.Get(), 4, &version, sizeof(version));
+
+    MeshCache cache(path.Get());
+    CHECK(cache.IsOpen());
+    CHECK(cache.GetStatistics().meshCount == 0);
+    CHECK(path.GetFileSize() == 16);
+}
+
+TEST_CASE(MeshCache_TruncatesPartialRecord)
+{
+    TempPath path("MeshCacheTests_TruncatesPartialRecord.bin");
+    Tests::Random random(53);
+    const TestMesh a = MakeMesh(40, 2, 1, random);
+    uint64_t sizeAfterFirst = 0;
+    {
+        MeshCache cache(path.Get());
+        cache.Store(MakeId(1), a.mesh);
+        sizeAfterFirst = cache.GetStatistics().fileSize;
+        cache.Store(MakeId(2), MakeMesh(40, 2, 1, random).mesh);
+    }
+
+    // The application went away in the middle of writing the second record.
+    std::filesystem::resize_file(path.Get(), sizeAfterFirst + 100);
+
+    MeshCache cache(path.Get());
+    CHECK(cache.GetStatistics().meshCount == 1);
+    CHECK(path.GetFileSize() == sizeAfterFirst);
+    CHECK(ReadMatches(cache, 1, a));
+
+    // New records go after the last valid one.
+    const TestMesh c = MakeMesh(20, 1, 3, random);
+    CHECK(cache.Store(MakeId(3), c.mesh));
+    CHECK(ReadMatches(cache, 3, c));
+}
+
+TEST_CASE(MeshCache_IgnoresCorruptPayload)
+{
+    TempPath path("MeshCacheTests_IgnoresCorruptPayload.bin");
+    Tests::Random random(59);
+    const TestMesh a = MakeMesh(30, 1, 1, random);
+    const TestMesh b = MakeMesh(30, 1, 2, random);
+    {
+        MeshCache cache(path.Get());
+        cache.Store(MakeId(1), a.mesh);
+        cache.Store(MakeId(2), b.mesh);
+    }
+
+    // Flip a byte in the positions of the first record, right after the file and record headers.
+    const uint8_t garbage = 0x5A;
+    PatchFile(path.Get(), 16 + 136 + 3, &garbage, 1);
+
+    MeshCache cache(path.Get());
+    CHECK(cache.GetStatistics().meshCount == 2);
+    CHECK(!cache.Read(MakeId(1), 1, [](const MeshCache::Mesh&) {}));
+    CHECK(cache.GetStatistics().corruptCount == 1);
+    CHECK(cache.GetStatistics().meshCount == 1);
+    CHECK(ReadMatches(cache, 2, b));
+}
+
+TEST_CASE(MeshCache_CompactsSupersededRecords)
+{
+    TempPath path("MeshCacheTests_CompactsSupersededRecords.bin");
+    Tests::Random random(61);
+
+    // Each record is about 100 KB, storing the same two ids over and over leaves megabytes of superseded records.
+    TestMesh latest[2];
+    {
+        MeshCache cache(path.Get());
+        for (int64_t updateTime = 0; updateTime < 20; updateTime++)
+        {
+            for (uint32_t id = 0; id < 2; id++)
+            {
+                latest[id] = MakeMesh(8000, 2, updateTime, random);
+                CHECK(cache.Store(MakeId(id), latest[id].mesh));
+            }
+        }
+    }
+    const uint64_t sizeBefore = path.GetFileSize();
+
+    MeshCache cache(path.Get());
+    const MeshCache::Statistics statistics = cache.GetStatistics();
+    CHECK(statistics.meshCount == 2);
+    CHECK(statistics.fileSize == 16 + statistics.liveSize);
+    CHECK(path.GetFileSize() == statistics.fileSize);
+    CHECK(statistics.fileSize < sizeBefore / 10);
+    CHECK(ReadMatches(cache, 0, latest[0]));
+    CHECK(ReadMatches(cache, 1, latest[1]));
+}
+
+BENCHMARK(MeshCache_LoadTime)
+{
+    // Loads a cache of surface meshes of typical size, and reads every mesh once, as the renderer does when it restores all parts
+    // after reconnecting. Compares the memory mapped cache with reading the whole file into memory and parsing it there.
+    std::printf("%10s %12s %12s %12s %12s\n", "parts", "file MB", "mmap ms", "buffered ms", "speedup");
+
+    for (size_t partCount : Tests::BenchmarkSizes({100, 1000}))
+    {
+        TempPath path("MeshCacheTests_LoadTime.bin");
+        Tests::Random random(67);
+        {
+            MeshCache cache(path.Get());
+            for (uint32_t id = 0; id < partCount; id++)
+            {
+                cache.Store(MakeId(id), MakeMesh(1000 + random.Next(3000), 3, id, random).mesh);
+            }
+        }
+
+        const int repetitions = Tests::IsSmokeRun() ? 1 : 10;
+        uint64_t checksum = 0;
+
+        Tests::Stopwatch mapped;
+        for (int repetition = 0; repetition < repetitions; repetition++)
+        {
+            MeshCache cache(path.Get());
+            for (uint32_t id = 0; id < partCount; id++)
+            {
+                cache.Read(MakeId(id), id, [&](const MeshCache::Mesh& mesh) { checksum += mesh.positions[0] + mesh.indices[0][0]; });
+            }
+        }
+        const double mappedMilliseconds = mapped.ElapsedMilliseconds() / repetitions;
+
+        // The buffered reader skips the payload hash check the cache does, so it is a lower bound for buffered reads.
+        Tests::Stopwatch buffered;
+        for (int repetition = 0; repetition < repetitions; repetition++)
+        {
+            std::ifstream file(path.Get(), std::ios::binary);
+            std::vector<uint8_t> data(path.GetFileSize());
+            file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+            for (size_t offset = 16; offset + 136 <= data.size();)
+            {
+                uint32_t size;
+                uint32_t vertexCount;
+                std::memcpy(&size, data.data() + offset + 4, sizeof(size));
+                std::memcpy(&vertexCount, data.data() + offset + 112, sizeof(vertexCount));
+
+                int16_t position;
+                uint16_t index;
+                std::memcpy(&position, data.data() + offset + 136, sizeof(position));
+                std::memcpy(&index, data.data() + offset + 136 + vertexCount * 8ull, sizeof(index));
+                checksum -= position + index;
+                offset += size;
+            }
+        }
+        const double bufferedMilliseconds = buffered.ElapsedMilliseconds() / repetitions;
+
+        std::printf(
+            "%10zu %12.1f %12.2f %12.2f %12.2f\n",
+            partCount,
+            path.GetFileSize() / (1024.0 * 1024.0),
+            mappedMilliseconds,
+            bufferedMilliseconds,
+            bufferedMilliseconds / mappedMilliseconds);
+        CHECK(checksum == 0);
+    }
+}
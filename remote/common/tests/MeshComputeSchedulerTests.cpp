@@ -0,0 +1,318 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <MeshComputeScheduler.h>
+
+#include <algorithm>
+#include <map>
+
+namespace
+{
+    using Scheduler = MeshComputeScheduler<uint32_t, std::hash<uint32_t>>;
+
+    struct Surface
+    {
+        float distance = 1.0f;
+        bool visible = true;
+    };
+
+    // Dispatches with the given surfaces and returns the keys which were started.
+    std::vector<uint32_t> Dispatch(Scheduler& scheduler, double now, const std::map<uint32_t, Surface>& surfaces = {})
+    {
+        std::vector<uint32_t> started;
+        scheduler.Dispatch(
+            now,
+            [&](uint32_t key) {
+                auto it = surfaces.find(key);
+                const Surface surface = it != surfaces.end() ? it->second : Surface{};
+                return Scheduler::PriorityInputs{surface.distance, surface.visible};
+            },
+            [&](uint32_t key) { started.push_back(key); });
+        return started;
+    }
+} // namespace
+
+TEST_CASE(MeshComputeScheduler_LimitsComputationsInFlight)
+{
+    Scheduler scheduler;
+    for (uint32_t key = 0; key < 10; key++)
+    {
+        scheduler.Request(key, 0.0);
+    }
+
+    CHECK(Dispatch(scheduler, 0.0).size() == 4);
+    CHECK(Dispatch(scheduler, 0.0).empty());
+    CHECK(scheduler.GetStatistics().inFlightCount == 4);
+    CHECK(scheduler.GetStatistics().queuedCount == 6);
+
+    uint32_t key = 0;
+    while (!scheduler.IsInFlight(key))
+    {
+        key++;
+    }
+    scheduler.Complete(key, 1.0);
+    CHECK(Dispatch(scheduler, 1.0).size() == 1);
+    CHECK(scheduler.GetStatistics().peakInFlightCount == 4);
+}
+
+TEST_CASE(MeshComputeScheduler_CoalescesRequests)
+{
+    Scheduler scheduler;
+    scheduler.Request(1, 0.0);
+    scheduler.Request(1, 0.1);
+    scheduler.Request(1, 0.2);
+    CHECK(scheduler.GetStatistics().coalescedCount == 2);
+    CHECK(Dispatch(scheduler, 0.3) == std::vector<uint32_t>{1});
+
+    // Requests while in flight are deferred into a single computation after the running one.
+    scheduler.Request(1, 0.4);
+    scheduler.Request(1, 0.5);
+    CHECK(Dispatch(scheduler, 0.5).empty());
+
+    scheduler.Complete(1, 1.0);
+    CHECK(scheduler.GetStatistics().completedCount == 1);
+    CHECK(scheduler.GetStatistics().maxLatency == 1.0);
+    CHECK(Dispatch(scheduler, 1.0) == std::vector<uint32_t>{1});
+
+    scheduler.Complete(1, 2.0);
+    CHECK(Dispatch(scheduler, 2.0).empty());
+    CHECK(scheduler.GetStatistics().startedCount == 2);
+}
+
+TEST_CASE(MeshComputeScheduler_PrefersNearAndVisible)
+{
+    Scheduler::Policy policy;
+    policy.maxInFlight = 1;
+    Scheduler scheduler(policy);
+
+    const std::map<uint32_t, Surface> surfaces = {
+        {1, {10.0f, true}},
+        {2, {1.0f, false}},
+        {3, {1.0f, true}},
+        {4, {3.0f, true}},
+    };
+    for (const auto& [key, surface] : surfaces)
+    {
+        scheduler.Request(key, 0.0);
+    }
+
+    std::vector<uint32_t> order;
+    for (double now = 0.0; order.size() < surfaces.size(); now += 0.01)
+    {
+        for (uint32_t key : Dispatch(scheduler, now, surfaces))
+        {
+            order.push_back(key);
+            scheduler.Complete(key, now);
+        }
+    }
+    CHECK((order == std::vector<uint32_t>{3, 4, 2, 1}));
+}
+
+TEST_CASE(MeshComputeScheduler_RemovedComputationsKeepTheirSlot)
+{
+    Scheduler scheduler;
+    for (uint32_t key = 0; key < 4; key++)
+    {
+        scheduler.Request(key, 0.0);
+    }
+    CHECK(Dispatch(scheduler, 0.0).size() == 4);
+
+    // The surfaces are gone, but their computations are still running.
+    scheduler.Remove(0);
+    scheduler.Remove(1);
+    CHECK(!scheduler.IsInFlight(0));
+    CHECK(scheduler.GetStatistics().retiringCount == 2);
+    CHECK(scheduler.GetStatistics().inFlightCount == 4);
+
+    for (uint32_t key = 10; key < 20; key++)
+    {
+        scheduler.Request(key, 0.0);
+    }
+    CHECK(Dispatch(scheduler, 0.0).empty());
+
+    scheduler.Complete(0, 1.0);
+    CHECK(scheduler.GetStatistics().retiredCount == 1);
+    CHECK(scheduler.GetStatistics().completedCount == 0);
+    CHECK(Dispatch(scheduler, 1.0).size() == 1);
+
+    // Clear retires the computations in flight as well.
+    scheduler.Clear();
+    CHECK(scheduler.GetStatistics().queuedCount == 0);
+    CHECK(scheduler.GetStatistics().inFlightCount == 4);
+    CHECK(scheduler.GetStatistics().retiringCount == 4);
+
+    scheduler.Request(30, 2.0);
+    CHECK(Dispatch(scheduler, 2.0).empty());
+    scheduler.Complete(1, 2.0);
+    CHECK(Dispatch(scheduler, 2.0) == std::vector<uint32_t>{30});
+}
+
+TEST_CASE(MeshComputeScheduler_ReaddedKeyWaitsForRetiringComputation)
+{
+    Scheduler scheduler;
+    scheduler.Request(7, 0.0);
+    CHECK(Dispatch(scheduler, 0.0).size() == 1);
+
+    // The surface disappears and comes back while its old computation is still running, there must never be two computations of the
+    // same key at once.
+    scheduler.Remove(7);
+    scheduler.Request(7, 0.5);
+    CHECK(Dispatch(scheduler, 0.5).empty());
+
+    scheduler.Complete(7, 1.0);
+    CHECK(scheduler.GetStatistics().retiredCount == 1);
+    CHECK(Dispatch(scheduler, 1.0) == std::vector<uint32_t>{7});
+    CHECK(scheduler.IsInFlight(7));
+
+    scheduler.Complete(7, 2.0);
+    CHECK(scheduler.GetStatistics().completedCount == 1);
+    CHECK(scheduler.GetStatistics().inFlightCount == 0);
+}
+
+TEST_CASE(MeshComputeScheduler_RandomChurnNeverExceedsLimit)
+{
+    Scheduler::Policy policy;
+    policy.maxInFlight = 3;
+    Scheduler scheduler(policy);
+    Tests::Random random(13);
+
+    // What is actually running, independent of what the scheduler thinks. Every key may be in here only once.
+    std::vector<uint32_t> running;
+    size_t peakRunning = 0;
+    for (uint32_t frame = 0; frame < 20000; frame++)
+    {
+        const double now = frame * 0.016;
+        const uint32_t action = random.Next(10);
+        const uint32_t key = random.Next(16);
+        if (action < 4)
+        {
+            scheduler.Request(key, now);
+        }
+        else if (action < 6)
+        {
+            scheduler.Remove(key);
+        }
+        else if (action == 6 && random.Next(20) == 0)
+        {
+            scheduler.Clear();
+        }
+
+        // Computations finish in random order, and the caller reports every one of them, whether its key still exists or not.
+        if (!running.empty() && random.Next(3) == 0)
+        {
+            const size_t index = random.Next(static_cast<uint32_t>(running.size()));
+            scheduler.Complete(running[index], now);
+            running.erase(running.begin() + index);
+        }
+
+        for (uint32_t started : Dispatch(scheduler, now))
+        {
+            CHECK(std::find(running.begin(), running.end(), started) == running.end());
+            running.push_back(started);
+        }
+        peakRunning = std::max(peakRunning, running.size());
+        CHECK(scheduler.GetStatistics().inFlightCount == running.size());
+    }
+
+    CHECK(peakRunning == policy.maxInFlight);
+}
+
+BENCHMARK(MeshComputeScheduler_SurfaceChangeTraces)
+{
+    // Replays synthetic surface change traces: a room with surfaces at random distances, a quarter of them visible, which change in bursts
+    // (e.g. when the observed volume moves). Each computation takes 50 to 300 ms. Reports how long visible surfaces take from the
+    // change to their new mesh, and how many computations ran at once.
+    std::printf(
+        "%10s %12s %14s %14s %14s %12s\n", "surfaces", "max flight", "visible avg ms", "visible max ms", "all avg ms", "peak flight");
+
+    for (size_t surfaceCount : Tests::BenchmarkSizes({50, 200, 800}))
+    {
+        for (uint32_t maxInFlight : {4u, 8u, 1000u})
+        {
+            Scheduler::Policy policy;
+            policy.maxInFlight = maxInFlight;
+            Scheduler scheduler(policy);
+            Tests::Random random(17);
+
+            std::map<uint32_t, Surface> surfaces;
+            for (uint32_t key = 0; key < surfaceCount; key++)
+            {
+                surfaces[key] = {random.NextFloat(0.5f, 10.0f), random.Next(4) == 0};
+            }
+
+            struct Computation
+            {
+                uint32_t key;
+                double end;
+            };
+            std::vector<Computation> running;
+            std::map<uint32_t, double> pendingVisible;
+            double visibleLatency = 0.0;
+            double visibleMaxLatency = 0.0;
+            uint32_t visibleCount = 0;
+
+            constexpr double FrameTime = 1.0 / 60.0;
+            const uint32_t frameCount = Tests::IsSmokeRun() ? 600 : 60 * 120;
+            for (uint32_t frame = 0; frame < frameCount; frame++)
+            {
+                const double now = frame * FrameTime;
+
+                // A burst every ~2 seconds touches a third of the surfaces, and a few surfaces change every frame.
+                const bool burst = random.Next(120) == 0;
+                const uint32_t changeCount = burst ? static_cast<uint32_t>(surfaceCount / 3) : random.Next(2);
+                for (uint32_t i = 0; i < changeCount; i++)
+                {
+                    const uint32_t key = random.Next(static_cast<uint32_t>(surfaceCount));
+                    scheduler.Request(key, now);
+                    if (surfaces[key].visible)
+                    {
+                        pendingVisible.emplace(key, now);
+                    }
+                }
+
+                std::erase_if(running, [&](const Computation& computation) {
+                    if (computation.end > now)
+                    {
+                        return false;
+                    }
+
+                    scheduler.Complete(computation.key, now);
+                    if (auto it = pendingVisible.find(computation.key); it != pendingVisible.end())
+                    {
+                        const double latency = now - it->second;
+                        visibleLatency += latency;
+                        visibleMaxLatency = std::max(visibleMaxLatency, latency);
+                        visibleCount++;
+                        pendingVisible.erase(it);
+                    }
+                    return true;
+                });
+
+                for (uint32_t key : Dispatch(scheduler, now, surfaces))
+                {
+                    running.push_back({key, now + 0.05 + random.Next(250) * 0.001});
+                }
+            }
+
+            const Scheduler::Statistics& statistics = scheduler.GetStatistics();
+            std::printf(
+                "%10zu %12u %14.1f %14.1f %14.1f %12u\n",
+                surfaceCount,
+                maxInFlight,
+                visibleCount > 0 ? visibleLatency / visibleCount * 1000.0 : 0.0,
+                visibleMaxLatency * 1000.0,
+                statistics.AverageLatency() * 1000.0,
+                statistics.peakInFlightCount);
+        }
+    }
+}
@@ -0,0 +1,153 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+#include "TestMeshes.h"
+
+#include <MeshSimplifier.h>
+
+#include <cmath>
+
+namespace
+{
+    float TriangleArea(const TestMeshes::Mesh& mesh, const uint16_t* triangle)
+    {
+        float p[3][3];
+        for (int k = 0; k < 3; k++)
+        {
+            mesh.GetPosition(triangle[k], p[k]);
+        }
+        const float u[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+        const float v[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+        const float n[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+        return 0.5f * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    }
+
+    float TotalArea(const TestMeshes::Mesh& mesh, const uint16_t* indices, uint32_t indexCount)
+    {
+        float area = 0.0f;
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            area += TriangleArea(mesh, indices + i);
+        }
+        return area;
+    }
+
+    MeshSimplifier::Positions GetPositions(const TestMeshes::Mesh& mesh)
+    {
+        MeshSimplifier::Positions positions;
+        positions.data = mesh.positions.data();
+        positions.stride = 4;
+        positions.count = mesh.GetVertexCount();
+        for (int k = 0; k < 3; k++)
+        {
+            positions.scale[k] = mesh.scale[k];
+        }
+        return positions;
+    }
+} // namespace
+
+TEST_CASE(MeshSimplifier_FlatGridCollapsesWithoutHoles)
+{
+    const TestMeshes::Mesh mesh = TestMeshes::MakeGrid(40, 40, 2.0f, 0.0f);
+    const uint32_t indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+    MeshSimplifier simplifier;
+    std::vector<uint16_t> result(indexCount);
+    float error = -1.0f;
+    const uint32_t count =
+        simplifier.Simplify(result.data(), mesh.indices.data(), indexCount, GetPositions(mesh), indexCount / 10, 0.01f, &error);
+
+    CHECK(count % 3 == 0);
+    CHECK(count <= indexCount / 4);
+    CHECK(error >= 0.0f && error <= 0.01f);
+
+    for (uint32_t i = 0; i < count; i += 3)
+    {
+        CHECK(result[i] < mesh.GetVertexCount() && result[i + 1] < mesh.GetVertexCount() && result[i + 2] < mesh.GetVertexCount());
+        CHECK(result[i] != result[i + 1] && result[i + 1] != result[i + 2] && result[i + 2] != result[i]);
+    }
+
+    // Borders are locked and collapses never flip triangles, so a flat surface keeps its area.
+    const float area = TotalArea(mesh, mesh.indices.data(), indexCount);
+    CHECK(std::abs(TotalArea(mesh, result.data(), count) - area) < area * 1.0e-3f);
+}
+
+TEST_CASE(MeshSimplifier_RespectsMaxError)
+{
+    const TestMeshes::Mesh mesh = TestMeshes::MakeGrid(40, 40, 2.0f, 0.05f);
+    const uint32_t indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+    MeshSimplifier simplifier;
+    std::vector<uint16_t> strict(indexCount);
+    std::vector<uint16_t> loose(indexCount);
+    float strictError = 0.0f;
+    float looseError = 0.0f;
+    const uint32_t strictCount =
+        simplifier.Simplify(strict.data(), mesh.indices.data(), indexCount, GetPositions(mesh), 0, 0.002f, &strictError);
+    const uint32_t looseCount =
+        simplifier.Simplify(loose.data(), mesh.indices.data(), indexCount, GetPositions(mesh), 0, 0.05f, &looseError);
+
+    CHECK(strictError <= 0.002f);
+    CHECK(looseError <= 0.05f);
+    CHECK(strictCount > looseCount);
+    CHECK(strictCount < indexCount);
+}
+
+TEST_CASE(MeshSimplifier_InPlace)
+{
+    const TestMeshes::Mesh mesh = TestMeshes::MakeGrid(20, 20, 1.0f, 0.01f);
+    const uint32_t indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+    MeshSimplifier simplifier;
+    std::vector<uint16_t> separate(indexCount);
+    const uint32_t separateCount =
+        simplifier.Simplify(separate.data(), mesh.indices.data(), indexCount, GetPositions(mesh), indexCount / 2, 1.0f);
+
+    std::vector<uint16_t> inPlace = mesh.indices;
+    const uint32_t inPlaceCount = simplifier.Simplify(inPlace.data(), inPlace.data(), indexCount, GetPositions(mesh), indexCount / 2, 1.0f);
+
+    CHECK(separateCount == inPlaceCount);
+    CHECK(std::equal(separate.begin(), separate.begin() + separateCount, inPlace.begin()));
+}
+
+BENCHMARK(MeshSimplifier_RoomScale)
+{
+    // Noisy walls like the ones spatial mapping produces, decimated to the renderer's two coarser levels of detail.
+    std::printf("%10s %10s %12s %12s %12s %12s\n", "triangles", "ratio", "result", "ms", "tris/ms", "error mm");
+
+    MeshSimplifier simplifier;
+    for (size_t side : Tests::BenchmarkSizes({32, 96, 180}))
+    {
+        const TestMeshes::Mesh mesh = TestMeshes::MakeGrid(static_cast<uint32_t>(side), static_cast<uint32_t>(side), 5.0f, 0.02f);
+        const uint32_t indexCount = static_cast<uint32_t>(mesh.indices.size());
+        std::vector<uint16_t> result(indexCount);
+
+        for (float ratio : {0.5f, 0.15f})
+        {
+            float error = 0.0f;
+            Tests::Stopwatch stopwatch;
+            const uint32_t targetCount = static_cast<uint32_t>(indexCount * ratio);
+            const uint32_t count =
+                simplifier.Simplify(result.data(), mesh.indices.data(), indexCount, GetPositions(mesh), targetCount, 0.05f, &error);
+            const double milliseconds = stopwatch.ElapsedMilliseconds();
+
+            std::printf(
+                "%10u %10.2f %12u %12.2f %12.1f %12.2f\n",
+                indexCount / 3,
+                ratio,
+                count / 3,
+                milliseconds,
+                indexCount / 3 / milliseconds,
+                error * 1000.0f);
+        }
+    }
+}
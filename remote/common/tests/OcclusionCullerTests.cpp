@@ -0,0 +1,579 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+#include "TestMeshes.h"
+
+#include <OcclusionCuller.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+namespace
+{
+    using InstructionSet = OcclusionCuller::InstructionSet;
+
+    constexpr uint32_t Width = 320;
+    constexpr uint32_t Height = 176;
+    constexpr float DepthBias = 0.1f;
+
+    // The culler clips occluders at this view distance.
+    constexpr float NearDistance = 0.05f;
+
+    // 60 degrees vertical field of view.
+    const float FocalLength = 1.0f / std::tan(0.5236f);
+    constexpr float Aspect = static_cast<float>(Width) / Height;
+
+    struct Vector3
+    {
+        float x, y, z;
+    };
+
+    Vector3 operator+(const Vector3& a, const Vector3& b)
+    {
+        return {a.x + b.x, a.y + b.y, a.z + b.z};
+    }
+
+    Vector3 operator-(const Vector3& a, const Vector3& b)
+    {
+        return {a.x - b.x, a.y - b.y, a.z - b.z};
+    }
+
+    Vector3 operator*(const Vector3& a, float s)
+    {
+        return {a.x * s, a.y * s, a.z * s};
+    }
+
+    float Dot(const Vector3& a, const Vector3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    Vector3 Cross(const Vector3& a, const Vector3& b)
+    {
+        return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+
+    Vector3 Normalize(const Vector3& a)
+    {
+        return a * (1.0f / std::sqrt(Dot(a, a)));
+    }
+
+    // Right handed perspective projection looking down -z, for row vectors, of a view whose eye is at (eyeX, 0, 0). The culler only
+    // uses x, y and w of the clip coordinates.
+    void MakeViewProjection(float* matrix, float eyeX = 0.0f)
+    {
+        const float near = 0.05f;
+        const float far = 50.0f;
+        std::fill(matrix, matrix + 16, 0.0f);
+        matrix[0] = FocalLength / Aspect;
+        matrix[5] = FocalLength;
+        matrix[10] = far / (near - far);
+        matrix[11] = -1.0f;
+        matrix[14] = near * far / (near - far);
+
+        // translation by -eyeX, then the projection
+        matrix[12] = -eyeX * matrix[0];
+    }
+
+    constexpr float IdentityModel[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+    struct Scene
+    {
+        std::vector<Vector3> positions;
+        std::vector<uint16_t> indices;
+
+        void AddQuad(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d)
+        {
+            const uint16_t base = static_cast<uint16_t>(positions.size());
+            positions.insert(positions.end(), {a, b, c, d});
+            indices.insert(indices.end(), {base, uint16_t(base + 1), uint16_t(base + 2), base, uint16_t(base + 2), uint16_t(base + 3)});
+        }
+
+        // Quad at center spanned by the two half axes.
+        void AddWall(const Vector3& center, const Vector3& halfAxisU, const Vector3& halfAxisV)
+        {
+            AddQuad(
+                center - halfAxisU - halfAxisV,
+                center + halfAxisU - halfAxisV,
+                center + halfAxisU + halfAxisV,
+                center - halfAxisU + halfAxisV);
+        }
+
+        void Render(OcclusionCuller& culler) const
+        {
+            culler.RenderOccluder(
+                &positions[0].x,
+                static_cast<uint32_t>(positions.size()),
+                3,
+                indices.data(),
+                static_cast<uint32_t>(indices.size()),
+                IdentityModel);
+        }
+    };
+
+    struct Box
+    {
+        Vector3 center;
+        Vector3 halfAxes[3];
+    };
+
+    bool IsVisible(OcclusionCuller& culler, const Box& box)
+    {
+        return culler.IsBoxVisible(&box.center.x, &box.halfAxes[0].x, &box.halfAxes[1].x, &box.halfAxes[2].x);
+    }
+
+    Box MakeCube(const Vector3& center, float halfSize)
+    {
+        return {center, {{halfSize, 0.0f, 0.0f}, {0.0f, halfSize, 0.0f}, {0.0f, 0.0f, halfSize}}};
+    }
+
+    std::vector<InstructionSet> GetSupportedInstructionSets()
+    {
+        std::vector<InstructionSet> supported;
+        OcclusionCuller culler;
+        for (InstructionSet instructionSet : {InstructionSet::Scalar, InstructionSet::Sse2, InstructionSet::Avx2, InstructionSet::Neon})
+        {
+            if (culler.SetInstructionSet(instructionSet) == instructionSet)
+            {
+                supported.push_back(instructionSet);
+            }
+        }
+        return supported;
+    }
+
+    const char* GetName(InstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+            case InstructionSet::Sse2:
+                return "sse2";
+            case InstructionSet::Avx2:
+                return "avx2";
+            case InstructionSet::Neon:
+                return "neon";
+            default:
+                return "scalar";
+        }
+    }
+
+    // Per pixel reference: casts a ray through the center of every pixel of the view with the eye at the origin, and finds the closest
+    // occluder along it, exactly and without tiles, layers or conservative depths.
+    class ReferenceRasterizer
+    {
+    public:
+        explicit ReferenceRasterizer(const Scene& scene)
+            : m_distances(Width * Height, Infinity)
+        {
+            for (uint32_t y = 0; y < Height; y++)
+            {
+                for (uint32_t x = 0; x < Width; x++)
+                {
+                    const Vector3 direction = GetRay(x, y);
+                    float& distance = m_distances[y * Width + x];
+                    for (size_t i = 0; i + 2 < scene.indices.size(); i += 3)
+                    {
+                        const Vector3& a = scene.positions[scene.indices[i]];
+                        const Vector3& b = scene.positions[scene.indices[i + 1]];
+                        const Vector3& c = scene.positions[scene.indices[i + 2]];
+                        distance = std::min(distance, IntersectTriangle(direction, a, b, c));
+                    }
+                }
+            }
+        }
+
+        // A box is hidden if, for every pixel whose ray hits it, an occluder is hit first. Boxes reaching in front of the near plane
+        // count as visible, as they do for the culler.
+        bool IsBoxHidden(const Box& box) const
+        {
+            for (uint32_t y = 0; y < Height; y++)
+            {
+                for (uint32_t x = 0; x < Width; x++)
+                {
+                    float entry;
+                    if (!IntersectBox(GetRay(x, y), box, entry))
+                    {
+                        continue;
+                    }
+
+                    // the ray is scaled to unit view distance, so the distance along it is the view distance; allow for rounding
+                    if (entry < NearDistance || m_distances[y * Width + x] > entry * 1.0001f + 1.0e-5f)
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+    private:
+        static constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+        static Vector3 GetRay(uint32_t x, uint32_t y)
+        {
+            const float ndcX = (x + 0.5f) / Width * 2.0f - 1.0f;
+            const float ndcY = 1.0f - (y + 0.5f) / Height * 2.0f;
+            return {ndcX * Aspect / FocalLength, ndcY / FocalLength, -1.0f};
+        }
+
+        // View distance of the hit, or infinity. Triangles are grown by a tiny fraction, so that pixel centers right on the edge shared
+        // by two triangles count as covered, whatever the rounding.
+        static float IntersectTriangle(const Vector3& direction, const Vector3& a, const Vector3& b, const Vector3& c)
+        {
+            const Vector3 ab = b - a;
+            const Vector3 ac = c - a;
+            const Vector3 p = Cross(direction, ac);
+            const float determinant = Dot(ab, p);
+            if (std::abs(determinant) < 1.0e-12f)
+            {
+                return Infinity;
+            }
+
+            const float inverse = 1.0f / determinant;
+            const Vector3 s = a * -1.0f;
+            const float u = Dot(s, p) * inverse;
+            const Vector3 q = Cross(s, ab);
+            const float v = Dot(direction, q) * inverse;
+            constexpr float Epsilon = 1.0e-4f;
+            if (u < -Epsilon || v < -Epsilon || u + v > 1.0f + Epsilon)
+            {
+                return Infinity;
+            }
+
+            const float distance = Dot(ac, q) * inverse;
+            return distance >= NearDistance ? distance : Infinity;
+        }
+
+        static bool IntersectBox(const Vector3& direction, const Box& box, float& entry)
+        {
+            float near = 0.0f;
+            float far = Infinity;
+            for (const Vector3& halfAxis : box.halfAxes)
+            {
+                const float extent = std::sqrt(Dot(halfAxis, halfAxis));
+                const Vector3 axis = halfAxis * (1.0f / extent);
+                const float origin = -Dot(box.center, axis);
+                const float speed = Dot(direction, axis);
+                if (std::abs(speed) < 1.0e-12f)
+                {
+                    if (std::abs(origin) > extent)
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+
+                const float t0 = (-extent - origin) / speed;
+                const float t1 = (extent - origin) / speed;
+                near = std::max(near, std::min(t0, t1));
+                far = std::min(far, std::max(t0, t1));
+            }
+
+            entry = near;
+            return near <= far;
+        }
+
+        std::vector<float> m_distances;
+    };
+
+    Vector3 RandomDirection(Tests::Random& random)
+    {
+        const Vector3 direction = {random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f)};
+        return Dot(direction, direction) > 1.0e-4f ? Normalize(direction) : Vector3{1.0f, 0.0f, 0.0f};
+    }
+
+    // Point in the view frustum, or a bit beyond its sides.
+    Vector3 RandomPointInView(Tests::Random& random, float minDistance, float maxDistance)
+    {
+        const float distance = random.NextFloat(minDistance, maxDistance);
+        const float x = random.NextFloat(-1.2f, 1.2f) * Aspect / FocalLength * distance;
+        const float y = random.NextFloat(-1.2f, 1.2f) / FocalLength * distance;
+        return {x, y, -distance};
+    }
+
+    // Walls at random distances and orientations, and a floor which reaches behind the eye, so occluders are clipped at the near plane.
+    Scene MakeRandomScene(Tests::Random& random)
+    {
+        Scene scene;
+        const uint32_t wallCount = 2 + random.Next(12);
+        for (uint32_t i = 0; i < wallCount; i++)
+        {
+            const Vector3 normal = RandomDirection(random);
+            const Vector3 u = Normalize(Cross(normal, std::abs(normal.y) < 0.9f ? Vector3{0.0f, 1.0f, 0.0f} : Vector3{1.0f, 0.0f, 0.0f}));
+            const Vector3 v = Cross(normal, u);
+            scene.AddWall(RandomPointInView(random, 1.0f, 8.0f), u * random.NextFloat(0.3f, 3.0f), v * random.NextFloat(0.3f, 3.0f));
+        }
+
+        const float floorY = random.NextFloat(-2.0f, -1.0f);
+        scene.AddQuad({-20.0f, floorY, 5.0f}, {20.0f, floorY, 5.0f}, {20.0f, floorY, -30.0f}, {-20.0f, floorY, -30.0f});
+        return scene;
+    }
+
+    Box MakeRandomBox(Tests::Random& random)
+    {
+        const Vector3 x = RandomDirection(random);
+        const Vector3 y = Normalize(Cross(x, std::abs(x.y) < 0.9f ? Vector3{0.0f, 1.0f, 0.0f} : Vector3{1.0f, 0.0f, 0.0f}));
+        const Vector3 z = Cross(x, y);
+        return {
+            RandomPointInView(random, 0.3f, 12.0f),
+            {x * random.NextFloat(0.02f, 0.8f), y * random.NextFloat(0.02f, 0.8f), z * random.NextFloat(0.02f, 0.8f)}};
+    }
+} // namespace
+
+TEST_CASE(OcclusionCuller_WallHidesBoxesBehindIt)
+{
+    float viewProjection[16];
+    MakeViewProjection(viewProjection);
+
+    // A wall at 3 m which fills the whole view.
+    Scene scene;
+    scene.AddWall({0.0f, 0.0f, -3.0f}, {20.0f, 0.0f, 0.0f}, {0.0f, 20.0f, 0.0f});
+
+    for (InstructionSet instructionSet : GetSupportedInstructionSets())
+    {
+        OcclusionCuller culler(Width, Height, DepthBias);
+        culler.SetInstructionSet(instructionSet);
+        culler.BeginFrame(1, viewProjection);
+        scene.Render(culler);
+        CHECK(culler.GetStatistics().rasterizedTriangleCount == 2);
+
+        CHECK(!IsVisible(culler, MakeCube({0.0f, 0.0f, -6.0f}, 0.5f)));
+        CHECK(!IsVisible(culler, MakeCube({1.0f, -0.5f, -3.5f}, 0.2f)));
+        CHECK(IsVisible(culler, MakeCube({0.0f, 0.0f, -2.0f}, 0.5f)));
+
+        // Within the depth bias of the wall, e.g. a hologram placed on it.
+        CHECK(IsVisible(culler, MakeCube({0.0f, 0.0f, -3.15f}, 0.1f)));
+
+        // Through the near plane.
+        CHECK(IsVisible(culler, MakeCube({0.0f, 0.0f, -6.0f}, 6.0f)));
+
+        // Entirely off screen, and partly off screen.
+        CHECK(IsVisible(culler, MakeCube({30.0f, 0.0f, -6.0f}, 1.0f)));
+        CHECK(!IsVisible(culler, MakeCube({6.4f, 0.0f, -6.0f}, 1.0f)));
+
+        const float sphereCenter[3] = {0.0f, 1.0f, -5.0f};
+        CHECK(!culler.IsSphereVisible(sphereCenter, 0.5f));
+        CHECK(culler.GetStatistics().testedCount == 8);
+        CHECK(culler.GetStatistics().occludedCount == 4);
+    }
+}
+
+TEST_CASE(OcclusionCuller_HoleInWall)
+{
+    float viewProjection[16];
+    MakeViewProjection(viewProjection);
+
+    // A wall at 2 m made of 0.5 m tiles, with one tile missing in the middle.
+    Scene scene;
+    for (int y = -8; y < 8; y++)
+    {
+        for (int x = -8; x < 8; x++)
+        {
+            if (x != 0 || y != 0)
+            {
+                scene.AddWall({x * 0.5f + 0.25f, y * 0.5f + 0.25f, -2.0f}, {0.25f, 0.0f, 0.0f}, {0.0f, 0.25f, 0.0f});
+            }
+        }
+    }
+
+    for (InstructionSet instructionSet : GetSupportedInstructionSets())
+    {
+        OcclusionCuller culler(Width, Height, DepthBias);
+        culler.SetInstructionSet(instructionSet);
+        culler.BeginFrame(1, viewProjection);
+        scene.Render(culler);
+
+        CHECK(IsVisible(culler, MakeCube({0.5f, 0.5f, -6.0f}, 0.2f)));
+        CHECK(!IsVisible(culler, MakeCube({-1.5f, -1.5f, -6.0f}, 0.2f)));
+    }
+}
+
+TEST_CASE(OcclusionCuller_VisibleInAnyView)
+{
+    // A narrow pillar right in front of the right eye hides a distant box from it, but not from the left eye.
+    float viewProjections[2][16];
+    MakeViewProjection(viewProjections[0], -0.032f);
+    MakeViewProjection(viewProjections[1], 0.032f);
+
+    Scene scene;
+    scene.AddWall({0.032f, 0.0f, -0.1f}, {0.03f, 0.0f, 0.0f}, {0.0f, 0.5f, 0.0f});
+    const Box box = MakeCube({0.032f, 0.0f, -10.0f}, 0.005f);
+
+    OcclusionCuller culler(Width, Height, DepthBias);
+    culler.BeginFrame(1, viewProjections[1]);
+    scene.Render(culler);
+    CHECK(!IsVisible(culler, box));
+
+    culler.BeginFrame(2, viewProjections[0]);
+    scene.Render(culler);
+    CHECK(IsVisible(culler, box));
+
+    // Without any view nothing can be culled.
+    culler.BeginFrame(0, nullptr);
+    CHECK(IsVisible(culler, box));
+}
+
+TEST_CASE(OcclusionCuller_ConservativeAgainstReference)
+{
+    // Random scenes: the culler must never hide a box which the per pixel reference sees, and all kernels must agree.
+    float viewProjection[16];
+    MakeViewProjection(viewProjection);
+
+    const std::vector<InstructionSet> instructionSets = GetSupportedInstructionSets();
+    std::vector<OcclusionCuller> cullers(instructionSets.size(), OcclusionCuller(Width, Height, DepthBias));
+    for (size_t i = 0; i < instructionSets.size(); i++)
+    {
+        cullers[i].SetInstructionSet(instructionSets[i]);
+    }
+
+    Tests::Random random(71);
+    uint32_t hiddenCount = 0;
+    uint32_t culledCount = 0;
+    bool conservative = true;
+    bool kernelsAgree = true;
+    for (uint32_t sceneIndex = 0; sceneIndex < 12; sceneIndex++)
+    {
+        const Scene scene = MakeRandomScene(random);
+        const ReferenceRasterizer reference(scene);
+        for (OcclusionCuller& culler : cullers)
+        {
+            culler.BeginFrame(1, viewProjection);
+            scene.Render(culler);
+            kernelsAgree &= culler.GetStatistics().rasterizedTriangleCount == cullers[0].GetStatistics().rasterizedTriangleCount;
+        }
+
+        for (uint32_t boxIndex = 0; boxIndex < 60; boxIndex++)
+        {
+            const Box box = MakeRandomBox(random);
+            const bool visible = IsVisible(cullers[0], box);
+            for (OcclusionCuller& culler : cullers)
+            {
+                kernelsAgree &= IsVisible(culler, box) == visible;
+            }
+
+            const bool hidden = reference.IsBoxHidden(box);
+            conservative &= visible || hidden;
+            hiddenCount += hidden ? 1 : 0;
+            culledCount += visible ? 0 : 1;
+        }
+    }
+
+    CHECK(conservative);
+    CHECK(kernelsAgree);
+
+    // The culler is conservative, but it must still find a fair share of the hidden boxes.
+    std::printf("    %u of %u hidden boxes culled\n", culledCount, hiddenCount);
+    CHECK(hiddenCount > 50);
+    CHECK(culledCount * 2 > hiddenCount);
+}
+
+BENCHMARK(OcclusionCuller_FrameTime)
+{
+    // A frame of the remoting sample: the spatial mesh of a room as occluders, rendered into both views, then a thousand boxes tested.
+    // The room is made of four walls and a floor, tessellated like spatial surface meshes.
+    std::printf(
+        "%10s %8s %10s %12s %10s %12s %12s\n", "triangles", "kernels", "clear ms", "rasterize ms", "test ms", "ns/triangle", "occluded %");
+
+    float viewProjections[2][16];
+    MakeViewProjection(viewProjections[0], -0.032f);
+    MakeViewProjection(viewProjections[1], 0.032f);
+
+    for (size_t side : Tests::BenchmarkSizes({20, 45, 100}))
+    {
+        Scene scene;
+        const TestMeshes::Mesh grid = TestMeshes::MakeGrid(static_cast<uint32_t>(side), static_cast<uint32_t>(side), 2.0f, 0.02f);
+        struct Surface
+        {
+            Vector3 center, u, v, n;
+        };
+        const Surface surfaces[] = {
+            {{0.0f, 0.0f, -4.0f}, {3.0f, 0.0f, 0.0f}, {0.0f, 1.5f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+            {{-3.0f, 0.0f, -2.0f}, {0.0f, 0.0f, 2.0f}, {0.0f, 1.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+            {{3.0f, 0.0f, -2.0f}, {0.0f, 0.0f, 2.0f}, {0.0f, 1.5f, 0.0f}, {-1.0f, 0.0f, 0.0f}},
+            {{0.0f, 0.0f, 0.5f}, {3.0f, 0.0f, 0.0f}, {0.0f, 1.5f, 0.0f}, {0.0f, 0.0f, -1.0f}},
+            {{0.0f, -1.5f, -2.0f}, {3.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 2.5f}, {0.0f, 1.0f, 0.0f}},
+        };
+
+        std::vector<std::vector<float>> meshes;
+        for (const Surface& surface : surfaces)
+        {
+            std::vector<float>& positions = meshes.emplace_back();
+            for (uint32_t vertex = 0; vertex < grid.GetVertexCount(); vertex++)
+            {
+                float p[3];
+                grid.GetPosition(vertex, p);
+                const Vector3 position = surface.center + surface.u * p[0] + surface.v * p[1] + surface.n * p[2];
+                positions.insert(positions.end(), {position.x, position.y, position.z});
+            }
+        }
+
+        Tests::Random random(73);
+        std::vector<Box> boxes;
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            Box box = MakeRandomBox(random);
+            for (Vector3& halfAxis : box.halfAxes)
+            {
+                halfAxis = halfAxis * 0.3f;
+            }
+            boxes.push_back(box);
+        }
+
+        const uint32_t triangleCount = static_cast<uint32_t>(std::size(surfaces) * grid.indices.size() / 3);
+        const int frameCount = Tests::IsSmokeRun() ? 2 : 100;
+        for (InstructionSet instructionSet : GetSupportedInstructionSets())
+        {
+            OcclusionCuller culler(Width, Height, DepthBias);
+            culler.SetInstructionSet(instructionSet);
+
+            double clearTime = 0.0;
+            double rasterizeTime = 0.0;
+            double testTime = 0.0;
+            uint32_t occludedCount = 0;
+            for (int frame = 0; frame < frameCount; frame++)
+            {
+                culler.BeginFrame(2, viewProjections[0]);
+                for (const std::vector<float>& positions : meshes)
+                {
+                    culler.RenderOccluder(
+                        positions.data(),
+                        grid.GetVertexCount(),
+                        3,
+                        grid.indices.data(),
+                        static_cast<uint32_t>(grid.indices.size()),
+                        IdentityModel);
+                }
+                for (const Box& box : boxes)
+                {
+                    IsVisible(culler, box);
+                }
+
+                const OcclusionCuller::Statistics& statistics = culler.GetStatistics();
+                clearTime += statistics.clearTime;
+                rasterizeTime += statistics.rasterizeTime;
+                testTime += statistics.testTime;
+                occludedCount = statistics.occludedCount;
+            }
+
+            std::printf(
+                "%10u %8s %10.3f %12.3f %10.3f %12.1f %12.1f\n",
+                triangleCount,
+                GetName(instructionSet),
+                clearTime / frameCount,
+                rasterizeTime / frameCount,
+                testTime / frameCount,
+                rasterizeTime * 1.0e6 / (frameCount * triangleCount * 2.0),
+                100.0 * occludedCount / boxes.size());
+        }
+    }
+}
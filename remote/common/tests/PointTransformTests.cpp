@@ -0,0 +1,254 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <PointTransform.h>
+
+#include <cmath>
+
+namespace
+{
+    using InstructionSet = PointTransform::InstructionSet;
+
+    // A rotation, a scale and a translation, for row vectors.
+    constexpr float Matrix[16] = {0.0f, 2.0f, 0.0f, 0.0f, -1.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.5f, 0.0f, 10.0f, -3.0f, 7.0f, 1.0f};
+
+    // Transforms one point at a time, like transform(float3, float4x4) of Windows.Foundation.Numerics.
+    void TransformPoint(const float* m, const float* p, float* result)
+    {
+        const float x = p[0], y = p[1], z = p[2];
+        result[0] = x * m[0] + y * m[4] + z * m[8] + m[12];
+        result[1] = x * m[1] + y * m[5] + z * m[9] + m[13];
+        result[2] = x * m[2] + y * m[6] + z * m[10] + m[14];
+    }
+
+    std::vector<InstructionSet> GetSupportedInstructionSets()
+    {
+        const InstructionSet selected = PointTransform::GetInstructionSet();
+        std::vector<InstructionSet> supported;
+        for (InstructionSet instructionSet : {InstructionSet::Scalar, InstructionSet::Sse2, InstructionSet::Avx2, InstructionSet::Neon})
+        {
+            if (PointTransform::SetInstructionSet(instructionSet) == instructionSet)
+            {
+                supported.push_back(instructionSet);
+            }
+        }
+        PointTransform::SetInstructionSet(selected);
+        return supported;
+    }
+
+    const char* GetName(InstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+            case InstructionSet::Sse2:
+                return "sse2";
+            case InstructionSet::Avx2:
+                return "avx2";
+            case InstructionSet::Neon:
+                return "neon";
+            default:
+                return "scalar";
+        }
+    }
+
+    std::vector<float> RandomPoints(size_t count, uint64_t seed)
+    {
+        Tests::Random random(seed);
+        std::vector<float> points(count * 3);
+        for (float& coordinate : points)
+        {
+            coordinate = random.NextFloat(-100.0f, 100.0f);
+        }
+        return points;
+    }
+
+    // The kernels may use fused multiply adds, so allow for a few ulps of the largest term.
+    bool IsClose(float a, float b)
+    {
+        return std::abs(a - b) <= 1.0e-5f * (std::abs(b) + 300.0f);
+    }
+} // namespace
+
+TEST_CASE(PointTransform_AosMatchesScalar)
+{
+    // Counts which exercise the vector loops and all remainders, strides of packed points and of the positions of 32 byte vertices.
+    for (InstructionSet instructionSet : GetSupportedInstructionSets())
+    {
+        PointTransform::SetInstructionSet(instructionSet);
+        for (size_t count : {0, 1, 3, 7, 8, 9, 17, 1000})
+        {
+            for (size_t stride : {3, 8})
+            {
+                const std::vector<float> source = RandomPoints(count * stride / 3 + 1, count);
+                std::vector<float> destination(count * stride + 1, -1.0f);
+                PointTransform::TransformPoints(
+                    Matrix, source.data(), stride * sizeof(float), destination.data(), stride * sizeof(float), count);
+
+                bool same = destination.back() == -1.0f;
+                for (size_t i = 0; i < count; i++)
+                {
+                    float expected[3];
+                    TransformPoint(Matrix, &source[i * stride], expected);
+                    for (int k = 0; k < 3; k++)
+                    {
+                        same &= IsClose(destination[i * stride + k], expected[k]);
+                    }
+
+                    // The rest of the vertex is not touched.
+                    for (size_t k = 3; k < stride; k++)
+                    {
+                        same &= destination[i * stride + k] == -1.0f;
+                    }
+                }
+                CHECK(same);
+            }
+        }
+    }
+    PointTransform::SetInstructionSet(GetSupportedInstructionSets().back());
+}
+
+TEST_CASE(PointTransform_InPlace)
+{
+    for (InstructionSet instructionSet : GetSupportedInstructionSets())
+    {
+        PointTransform::SetInstructionSet(instructionSet);
+        const std::vector<float> source = RandomPoints(101, 5);
+        std::vector<float> points = source;
+        PointTransform::TransformPoints(Matrix, points.data(), 12, points.data(), 12, 101);
+
+        bool same = true;
+        for (size_t i = 0; i < 101; i++)
+        {
+            float expected[3];
+            TransformPoint(Matrix, &source[i * 3], expected);
+            for (int k = 0; k < 3; k++)
+            {
+                same &= IsClose(points[i * 3 + k], expected[k]);
+            }
+        }
+        CHECK(same);
+    }
+    PointTransform::SetInstructionSet(GetSupportedInstructionSets().back());
+}
+
+TEST_CASE(PointTransform_SoaMatchesAos)
+{
+    for (InstructionSet instructionSet : GetSupportedInstructionSets())
+    {
+        PointTransform::SetInstructionSet(instructionSet);
+        for (size_t count : {1, 5, 16, 333})
+        {
+            const std::vector<float> source = RandomPoints(count, 9);
+            std::vector<float> x(count), y(count), z(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                x[i] = source[i * 3];
+                y[i] = source[i * 3 + 1];
+                z[i] = source[i * 3 + 2];
+            }
+
+            std::vector<float> aos(count * 3);
+            PointTransform::TransformPoints(Matrix, source.data(), 12, aos.data(), 12, count);
+
+            // In place, the source arrays are the destination arrays.
+            PointTransform::TransformPoints(Matrix, x.data(), y.data(), z.data(), x.data(), y.data(), z.data(), count);
+
+            bool same = true;
+            for (size_t i = 0; i < count; i++)
+            {
+                same &= x[i] == aos[i * 3] && y[i] == aos[i * 3 + 1] && z[i] == aos[i * 3 + 2];
+            }
+            CHECK(same);
+        }
+    }
+    PointTransform::SetInstructionSet(GetSupportedInstructionSets().back());
+}
+
+TEST_CASE(PointTransform_SelectsSupportedKernels)
+{
+    const std::vector<InstructionSet> supported = GetSupportedInstructionSets();
+    CHECK(supported.front() == InstructionSet::Scalar);
+
+    // By default the best supported kernels are in use.
+    CHECK(PointTransform::GetInstructionSet() == supported.back());
+}
+
+BENCHMARK(PointTransform_Throughput)
+{
+    // Points transformed one at a time through the scalar per point function, and in batches by each kernel, as packed points (AoS)
+    // and as the positions of 32 byte vertices, and as separate coordinate arrays (SoA).
+    std::printf("%10s %8s %14s %14s %14s %14s\n", "points", "kernels", "per point ms", "aos ms", "vertices ms", "soa ms");
+
+    const InstructionSet selected = PointTransform::GetInstructionSet();
+    for (size_t count : Tests::BenchmarkSizes({1000, 100000, 1000000, 10000000}))
+    {
+        const std::vector<float> source = RandomPoints(count, 1);
+        std::vector<float> destination(count * 3);
+        std::vector<float> vertices(count * 8);
+        std::vector<float> x(count), y(count), z(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            x[i] = source[i * 3];
+            y[i] = source[i * 3 + 1];
+            z[i] = source[i * 3 + 2];
+        }
+        const int repetitions = Tests::IsSmokeRun() ? 1 : static_cast<int>(std::max<size_t>(1, 20000000 / count));
+
+        Tests::Stopwatch perPoint;
+        for (int r = 0; r < repetitions; r++)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                TransformPoint(Matrix, &source[i * 3], &destination[i * 3]);
+            }
+        }
+        const double perPointMilliseconds = perPoint.ElapsedMilliseconds() / repetitions;
+
+        for (InstructionSet instructionSet : GetSupportedInstructionSets())
+        {
+            PointTransform::SetInstructionSet(instructionSet);
+
+            Tests::Stopwatch aos;
+            for (int r = 0; r < repetitions; r++)
+            {
+                PointTransform::TransformPoints(Matrix, source.data(), 12, destination.data(), 12, count);
+            }
+            const double aosMilliseconds = aos.ElapsedMilliseconds() / repetitions;
+
+            Tests::Stopwatch strided;
+            for (int r = 0; r < repetitions; r++)
+            {
+                PointTransform::TransformPoints(Matrix, source.data(), 12, vertices.data(), 32, count);
+            }
+            const double stridedMilliseconds = strided.ElapsedMilliseconds() / repetitions;
+
+            std::vector<float> dx(count), dy(count), dz(count);
+            Tests::Stopwatch soa;
+            for (int r = 0; r < repetitions; r++)
+            {
+                PointTransform::TransformPoints(Matrix, x.data(), y.data(), z.data(), dx.data(), dy.data(), dz.data(), count);
+            }
+            const double soaMilliseconds = soa.ElapsedMilliseconds() / repetitions;
+
+            std::printf(
+                "%10zu %8s %14.3f %14.3f %14.3f %14.3f\n",
+                count,
+                GetName(instructionSet),
+                perPointMilliseconds,
+                aosMilliseconds,
+                stridedMilliseconds,
+                soaMilliseconds);
+        }
+    }
+    PointTransform::SetInstructionSet(selected);
+}
@@ -0,0 +1,394 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+#include "TestMeshes.h"
+
+#include <SceneGeometryBuilder.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <thread>
+
+namespace
+{
+    // The layout of the scene understanding vertices before packing.
+    struct Vertex
+    {
+        float position[3];
+        float uv[2];
+        float color[3];
+    };
+
+    // Rotation about y by 30 degrees and a translation, for row vectors.
+    constexpr float ObjectToScene[16] = {
+        0.8660254f, 0.0f, -0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.0f, 0.8660254f, 0.0f, 1.5f, -0.5f, 2.0f, 1.0f};
+
+    void Transform(const float* m, const float* p, float* result)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            result[k] = p[0] * m[k] + p[1] * m[4 + k] + p[2] * m[8 + k] + m[12 + k];
+        }
+    }
+
+    // A world mesh as the scene understanding runtime delivers it: float3 positions and 32 bit triangle indices.
+    struct WorldMesh
+    {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    WorldMesh MakeWorldMesh(uint32_t side)
+    {
+        const TestMeshes::Mesh grid = TestMeshes::MakeGrid(side, side, 10.0f, 0.05f);
+        WorldMesh mesh;
+        mesh.positions.resize(grid.GetVertexCount() * 3);
+        for (uint32_t i = 0; i < grid.GetVertexCount(); i++)
+        {
+            grid.GetPosition(i, &mesh.positions[i * 3]);
+        }
+        mesh.indices.assign(grid.indices.begin(), grid.indices.end());
+        return mesh;
+    }
+
+    // What the renderer did before the mesh was kept indexed: three vertices for every triangle, transformed one by one.
+    void ExpandMesh(const float* matrix, const WorldMesh& mesh, std::vector<Vertex>& vertices)
+    {
+        for (uint32_t index : mesh.indices)
+        {
+            Vertex vertex = {{}, {0.0f, 0.0f}, {0.4f, 1.0f, 1.0f}};
+            Transform(matrix, &mesh.positions[index * 3], vertex.position);
+            vertices.push_back(vertex);
+        }
+    }
+
+    void AppendIndexedMesh(const float* matrix, const WorldMesh& mesh, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        const uint32_t vertexCount = static_cast<uint32_t>(mesh.positions.size() / 3);
+        const uint32_t indexCount = static_cast<uint32_t>(mesh.indices.size());
+        const uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+        const size_t baseIndex = indices.size();
+        vertices.resize(baseVertex + vertexCount, {{}, {0.0f, 0.0f}, {0.4f, 1.0f, 1.0f}});
+        indices.resize(baseIndex + indexCount);
+        SceneGeometryBuilder::AppendMesh(
+            matrix,
+            mesh.positions.data(),
+            vertexCount,
+            mesh.indices.data(),
+            indexCount,
+            baseVertex,
+            vertices[baseVertex].position,
+            sizeof(Vertex),
+            indices.data() + baseIndex);
+    }
+
+    // A synthetic scene object: a quad, and for some objects a world mesh of a few thousand triangles.
+    struct SceneObject
+    {
+        float transform[16];
+        float width;
+        float height;
+        const WorldMesh* mesh;
+    };
+
+    struct ObjectGeometry
+    {
+        std::vector<Vertex> quadVertices;
+        std::vector<Vertex> meshVertices;
+        std::vector<uint32_t> meshIndices;
+    };
+
+    std::vector<SceneObject> MakeSceneObjects(size_t count, const std::vector<WorldMesh>& meshes)
+    {
+        Tests::Random random(17);
+        std::vector<SceneObject> objects(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            SceneObject& object = objects[i];
+            std::copy(std::begin(ObjectToScene), std::end(ObjectToScene), object.transform);
+            object.transform[12] = random.NextFloat(-20.0f, 20.0f);
+            object.transform[14] = random.NextFloat(-20.0f, 20.0f);
+            object.width = random.NextFloat(0.2f, 3.0f);
+            object.height = random.NextFloat(0.2f, 3.0f);
+            object.mesh = random.Next(8) == 0 ? &meshes[random.Next(static_cast<uint32_t>(meshes.size()))] : nullptr;
+        }
+        return objects;
+    }
+
+    void BuildObjectGeometry(const SceneObject& object, ObjectGeometry& geometry)
+    {
+        const float w = object.width * 0.5f;
+        const float h = object.height * 0.5f;
+        const float corners[6][3] = {{-w, -h, 0.0f}, {w, -h, 0.0f}, {-w, h, 0.0f}, {-w, h, 0.0f}, {w, -h, 0.0f}, {w, h, 0.0f}};
+        for (const float* corner : corners)
+        {
+            Vertex vertex = {{}, {corner[0], corner[1]}, {1.0f, 0.6f, 0.5f}};
+            Transform(object.transform, corner, vertex.position);
+            geometry.quadVertices.push_back(vertex);
+        }
+
+        if (object.mesh)
+        {
+            AppendIndexedMesh(object.transform, *object.mesh, geometry.meshVertices, geometry.meshIndices);
+        }
+    }
+
+    // Runs work(item) for count items on threadCount threads, which take the next item whenever they are done with one, like the thread
+    // pool of the renderer.
+    void ParallelFor(size_t threadCount, size_t count, const std::function<void(size_t)>& work)
+    {
+        std::atomic<size_t> next = 0;
+        const auto run = [&]() {
+            for (size_t item = next++; item < count; item = next++)
+            {
+                work(item);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < threadCount; i++)
+        {
+            threads.emplace_back(run);
+        }
+        run();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Builds the geometry of the objects in chunks on threadCount threads, then concatenates it in the order of the objects.
+    void BuildSceneGeometry(
+        const std::vector<SceneObject>& objects, size_t threadCount, ObjectGeometry& scene, double* buildMilliseconds = nullptr)
+    {
+        Tests::Stopwatch stopwatch;
+        const size_t objectCount = objects.size();
+        const size_t chunkCount = SceneGeometryBuilder::GetChunkCount(objectCount, threadCount);
+        std::vector<ObjectGeometry> parts(objectCount);
+        ParallelFor(threadCount, chunkCount, [&](size_t chunk) {
+            const size_t end = SceneGeometryBuilder::GetChunkBegin(objectCount, chunkCount, chunk + 1);
+            for (size_t i = SceneGeometryBuilder::GetChunkBegin(objectCount, chunkCount, chunk); i < end; i++)
+            {
+                BuildObjectGeometry(objects[i], parts[i]);
+            }
+        });
+        if (buildMilliseconds)
+        {
+            *buildMilliseconds = stopwatch.ElapsedMilliseconds();
+        }
+
+        const std::vector<size_t> quadOffsets =
+            SceneGeometryBuilder::GetPartOffsets(parts, [](const ObjectGeometry& part) { return part.quadVertices.size(); });
+        const std::vector<size_t> vertexOffsets =
+            SceneGeometryBuilder::GetPartOffsets(parts, [](const ObjectGeometry& part) { return part.meshVertices.size(); });
+        const std::vector<size_t> indexOffsets =
+            SceneGeometryBuilder::GetPartOffsets(parts, [](const ObjectGeometry& part) { return part.meshIndices.size(); });
+        scene.quadVertices.resize(quadOffsets.back());
+        scene.meshVertices.resize(vertexOffsets.back());
+        scene.meshIndices.resize(indexOffsets.back());
+        ParallelFor(threadCount, objectCount, [&](size_t i) {
+            const ObjectGeometry& part = parts[i];
+            std::copy(part.quadVertices.begin(), part.quadVertices.end(), scene.quadVertices.begin() + quadOffsets[i]);
+            std::copy(part.meshVertices.begin(), part.meshVertices.end(), scene.meshVertices.begin() + vertexOffsets[i]);
+            SceneGeometryBuilder::OffsetIndices(
+                part.meshIndices.data(),
+                part.meshIndices.size(),
+                static_cast<uint32_t>(vertexOffsets[i]),
+                scene.meshIndices.data() + indexOffsets[i]);
+        });
+    }
+
+    std::vector<WorldMesh> MakeWorldMeshes()
+    {
+        std::vector<WorldMesh> meshes;
+        for (uint32_t side : {10, 25, 40})
+        {
+            meshes.push_back(MakeWorldMesh(side));
+        }
+        return meshes;
+    }
+} // namespace
+
+TEST_CASE(SceneGeometryBuilder_AppendMeshMatchesExpansion)
+{
+    // Two meshes in one buffer, the triangles of the second one index its own vertices.
+    const WorldMesh first = MakeWorldMesh(5);
+    const WorldMesh second = MakeWorldMesh(3);
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    AppendIndexedMesh(ObjectToScene, first, vertices, indices);
+    AppendIndexedMesh(ObjectToScene, second, vertices, indices);
+    CHECK(vertices.size() == (first.positions.size() + second.positions.size()) / 3);
+    CHECK(indices.size() == first.indices.size() + second.indices.size());
+    CHECK(indices[first.indices.size()] == second.indices[0] + first.positions.size() / 3);
+
+    std::vector<Vertex> expanded;
+    ExpandMesh(ObjectToScene, first, expanded);
+    ExpandMesh(ObjectToScene, second, expanded);
+
+    bool same = true;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        const Vertex& vertex = vertices[indices[i]];
+        for (int k = 0; k < 3; k++)
+        {
+            same &= std::abs(vertex.position[k] - expanded[i].position[k]) <= 1.0e-5f;
+            same &= vertex.color[k] == expanded[i].color[k];
+        }
+    }
+    CHECK(same);
+}
+
+TEST_CASE(SceneGeometryBuilder_OffsetIndices)
+{
+    const uint32_t indices[] = {0, 1, 2, 2, 1, 3};
+    uint32_t offset[6] = {};
+    SceneGeometryBuilder::OffsetIndices(indices, 6, 100, offset);
+    CHECK(offset[0] == 100 && offset[3] == 102 && offset[5] == 103);
+
+    // In place.
+    SceneGeometryBuilder::OffsetIndices(offset, 6, 1, offset);
+    CHECK(offset[0] == 101 && offset[5] == 104);
+}
+
+TEST_CASE(SceneGeometryBuilder_Chunks)
+{
+    CHECK(SceneGeometryBuilder::GetChunkCount(0, 8) == 0);
+    CHECK(SceneGeometryBuilder::GetChunkCount(3, 8) == 3);
+    CHECK(SceneGeometryBuilder::GetChunkCount(10000, 0) == SceneGeometryBuilder::ChunksPerThread);
+    CHECK(SceneGeometryBuilder::GetChunkCount(10000, 8) == 8 * SceneGeometryBuilder::ChunksPerThread);
+
+    // The chunks cover all objects once, in order, and differ in size by at most one object.
+    const size_t chunkCount = SceneGeometryBuilder::GetChunkCount(1001, 3);
+    bool contiguous = SceneGeometryBuilder::GetChunkBegin(1001, chunkCount, 0) == 0;
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        const size_t size =
+            SceneGeometryBuilder::GetChunkBegin(1001, chunkCount, chunk + 1) - SceneGeometryBuilder::GetChunkBegin(1001, chunkCount, chunk);
+        contiguous &= size == 1001 / chunkCount || size == 1001 / chunkCount + 1;
+    }
+    CHECK(contiguous);
+    CHECK(SceneGeometryBuilder::GetChunkBegin(1001, chunkCount, chunkCount) == 1001);
+
+    const std::vector<int> sizes = {3, 0, 5, 1};
+    const std::vector<size_t> offsets = SceneGeometryBuilder::GetPartOffsets(sizes, [](int size) { return static_cast<size_t>(size); });
+    CHECK(offsets == std::vector<size_t>({0, 3, 3, 8, 9}));
+}
+
+TEST_CASE(SceneGeometryBuilder_ParallelBuildMatchesSerial)
+{
+    const std::vector<WorldMesh> meshes = MakeWorldMeshes();
+    const std::vector<SceneObject> objects = MakeSceneObjects(2000, meshes);
+
+    ObjectGeometry serial;
+    BuildSceneGeometry(objects, 1, serial);
+    CHECK(serial.quadVertices.size() == 6 * objects.size());
+
+    for (size_t threadCount : {2, 4, 7})
+    {
+        ObjectGeometry parallel;
+        BuildSceneGeometry(objects, threadCount, parallel);
+        CHECK(parallel.meshIndices == serial.meshIndices);
+        CHECK(parallel.quadVertices.size() == serial.quadVertices.size() && parallel.meshVertices.size() == serial.meshVertices.size());
+        CHECK(std::memcmp(parallel.quadVertices.data(), serial.quadVertices.data(), serial.quadVertices.size() * sizeof(Vertex)) == 0);
+        CHECK(std::memcmp(parallel.meshVertices.data(), serial.meshVertices.data(), serial.meshVertices.size() * sizeof(Vertex)) == 0);
+    }
+}
+
+BENCHMARK(SceneGeometryBuilder_ParallelScene)
+{
+    // 10k scene objects, one in eight with a world mesh, built from scratch on 1 to N threads. The time to the first render is the
+    // time from setting the scene until the geometry is ready to upload.
+    const size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("%10s %10s %10s %10s %14s %10s\n", "objects", "threads", "build ms", "merge ms", "first render ms", "speedup");
+
+    const std::vector<WorldMesh> meshes = MakeWorldMeshes();
+    for (size_t objectCount : Tests::BenchmarkSizes({1000, 10000}))
+    {
+        const std::vector<SceneObject> objects = MakeSceneObjects(objectCount, meshes);
+        double singleThreaded = 0.0;
+        for (size_t threadCount = 1; threadCount <= std::max<size_t>(hardwareThreads, 4); threadCount *= 2)
+        {
+            double buildMilliseconds = 0.0;
+            Tests::Stopwatch stopwatch;
+            ObjectGeometry scene;
+            BuildSceneGeometry(objects, threadCount, scene, &buildMilliseconds);
+            const double totalMilliseconds = stopwatch.ElapsedMilliseconds();
+            if (threadCount == 1)
+            {
+                singleThreaded = totalMilliseconds;
+            }
+
+            std::printf(
+                "%10zu %10zu %10.2f %10.2f %14.2f %10.2f\n",
+                objectCount,
+                threadCount,
+                buildMilliseconds,
+                totalMilliseconds - buildMilliseconds,
+                totalMilliseconds,
+                singleThreaded / totalMilliseconds);
+        }
+    }
+    std::printf("    %zu hardware threads\n", hardwareThreads);
+}
+
+BENCHMARK(SceneGeometryBuilder_IndexedWorldMesh)
+{
+    // World meshes of up to a million triangles, built as three vertices per triangle like before, and indexed.
+    std::printf(
+        "%10s %10s %14s %14s %14s %14s\n", "triangles", "vertices", "expanded ms", "indexed ms", "expanded MB", "indexed MB");
+
+    for (size_t side : Tests::BenchmarkSizes({100, 300, 708}))
+    {
+        const WorldMesh mesh = MakeWorldMesh(static_cast<uint32_t>(side));
+        const size_t triangleCount = mesh.indices.size() / 3;
+        const size_t vertexCount = mesh.positions.size() / 3;
+        const int repetitions = Tests::IsSmokeRun() ? 1 : 5;
+
+        double expandedMilliseconds = 0.0;
+        double indexedMilliseconds = 0.0;
+        size_t expandedBytes = 0;
+        size_t indexedBytes = 0;
+        for (int i = 0; i < repetitions; i++)
+        {
+            {
+                Tests::Stopwatch stopwatch;
+                std::vector<Vertex> vertices;
+                ExpandMesh(ObjectToScene, mesh, vertices);
+                expandedMilliseconds += stopwatch.ElapsedMilliseconds();
+                expandedBytes = vertices.size() * sizeof(Vertex);
+            }
+            {
+                Tests::Stopwatch stopwatch;
+                std::vector<Vertex> vertices;
+                std::vector<uint32_t> indices;
+                AppendIndexedMesh(ObjectToScene, mesh, vertices, indices);
+                indexedMilliseconds += stopwatch.ElapsedMilliseconds();
+                indexedBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t);
+            }
+        }
+
+        std::printf(
+            "%10zu %10zu %14.2f %14.2f %14.2f %14.2f\n",
+            triangleCount,
+            vertexCount,
+            expandedMilliseconds / repetitions,
+            indexedMilliseconds / repetitions,
+            expandedBytes / 1048576.0,
+            indexedBytes / 1048576.0);
+    }
+}
@@ -0,0 +1,271 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <SceneObjectCache.h>
+
+#include <algorithm>
+
+namespace
+{
+    enum class Kind : uint32_t
+    {
+        Wall,
+        Floor,
+        World
+    };
+
+    // The geometry of an object, a number of vertices which depends on the object.
+    struct Geometry
+    {
+        uint64_t id;
+        std::vector<float> vertices;
+    };
+
+    using Cache = SceneObjectCache<uint64_t, Kind, Geometry, std::hash<uint64_t>>;
+
+    // An object of a synthetic scene snapshot. The geometry hash stands for the hash of its location, extents and meshes.
+    struct SceneObject
+    {
+        uint64_t id;
+        Kind kind;
+        uint64_t geometryHash;
+        uint32_t vertexCount;
+    };
+
+    std::shared_ptr<const Geometry> BuildGeometry(const SceneObject& object)
+    {
+        auto geometry = std::make_shared<Geometry>();
+        geometry->id = object.id;
+        geometry->vertices.resize(object.vertexCount * 8);
+        for (size_t i = 0; i < geometry->vertices.size(); i++)
+        {
+            geometry->vertices[i] = static_cast<float>((object.geometryHash + i) % 1000) * 0.001f;
+        }
+        return geometry;
+    }
+
+    // The update of the renderer: each object is looked up in the cache of the previous snapshot, and goes into the cache of this one.
+    struct Update
+    {
+        std::shared_ptr<const Cache> cache;
+        std::vector<std::shared_ptr<const Geometry>> geometries;
+        uint64_t reusedCount = 0;
+        uint64_t rebuiltCount = 0;
+    };
+
+    Update UpdateScene(const std::vector<SceneObject>& objects, const Cache* previousCache)
+    {
+        Update update;
+        Cache cache;
+        cache.Reserve(objects.size());
+        for (const SceneObject& object : objects)
+        {
+            std::shared_ptr<const Geometry> geometry =
+                previousCache ? previousCache->Find(object.id, object.kind, object.geometryHash) : nullptr;
+            if (geometry)
+            {
+                update.reusedCount++;
+            }
+            else
+            {
+                geometry = BuildGeometry(object);
+                update.rebuiltCount++;
+            }
+            cache.Insert(object.id, object.kind, object.geometryHash, geometry);
+            update.geometries.push_back(std::move(geometry));
+        }
+        update.cache = std::make_shared<const Cache>(std::move(cache));
+        return update;
+    }
+
+    // Snapshots of a scene in which, from one snapshot to the next, some objects disappear, some appear and some change their geometry
+    // or kind, in the proportions given in percent.
+    class SnapshotSequence
+    {
+    public:
+        SnapshotSequence(size_t objectCount, uint32_t removedPercent, uint32_t addedPercent, uint32_t changedPercent, uint64_t seed)
+            : m_random(seed)
+            , m_removedPercent(removedPercent)
+            , m_addedPercent(addedPercent)
+            , m_changedPercent(changedPercent)
+        {
+            for (size_t i = 0; i < objectCount; i++)
+            {
+                m_objects.push_back(MakeObject());
+            }
+        }
+
+        const std::vector<SceneObject>& GetObjects() const
+        {
+            return m_objects;
+        }
+
+        // Moves to the next snapshot, returns the number of objects which were added or changed.
+        uint64_t Next()
+        {
+            const size_t count = m_objects.size();
+            const auto removed = [this](const SceneObject&) { return m_random.Next(100) < m_removedPercent; };
+            m_objects.erase(std::remove_if(m_objects.begin(), m_objects.end(), removed), m_objects.end());
+
+            uint64_t changedCount = 0;
+            for (SceneObject& object : m_objects)
+            {
+                if (m_random.Next(100) < m_changedPercent)
+                {
+                    // Mostly the geometry changes, sometimes an object is reclassified.
+                    if (m_random.Next(4) == 0)
+                    {
+                        object.kind = object.kind == Kind::Wall ? Kind::Floor : Kind::Wall;
+                    }
+                    else
+                    {
+                        object.geometryHash = m_nextHash++;
+                    }
+                    changedCount++;
+                }
+            }
+
+            const size_t addedCount = count * m_addedPercent / 100;
+            for (size_t i = 0; i < addedCount; i++)
+            {
+                m_objects.insert(m_objects.begin() + m_random.Next(static_cast<uint32_t>(m_objects.size() + 1)), MakeObject());
+            }
+            return changedCount + addedCount;
+        }
+
+    private:
+        SceneObject MakeObject()
+        {
+            const Kind kind = static_cast<Kind>(m_random.Next(3));
+            const uint32_t vertexCount = kind == Kind::World ? 200 + m_random.Next(2000) : 12;
+            return {m_nextId++, kind, m_nextHash++, vertexCount};
+        }
+
+        Tests::Random m_random;
+        uint32_t m_removedPercent;
+        uint32_t m_addedPercent;
+        uint32_t m_changedPercent;
+        std::vector<SceneObject> m_objects;
+        uint64_t m_nextId = 1;
+        uint64_t m_nextHash = 1;
+    };
+} // namespace
+
+TEST_CASE(SceneObjectCache_FindAndInsert)
+{
+    Cache cache;
+    CHECK(!cache.Find(1, Kind::Wall, 7));
+
+    const SceneObject wall = {1, Kind::Wall, 7, 4};
+    const std::shared_ptr<const Geometry> geometry = BuildGeometry(wall);
+    CHECK(cache.Insert(1, Kind::Wall, 7, geometry));
+    CHECK(!cache.Insert(1, Kind::Floor, 8, geometry));
+    CHECK(cache.Size() == 1);
+
+    CHECK(cache.Find(1, Kind::Wall, 7) == geometry);
+    CHECK(!cache.Find(1, Kind::Floor, 7));
+    CHECK(!cache.Find(1, Kind::Wall, 8));
+    CHECK(!cache.Find(2, Kind::Wall, 7));
+}
+
+TEST_CASE(SceneObjectCache_SnapshotSequence)
+{
+    SnapshotSequence sequence(500, 2, 2, 5, 3);
+    Update previous = UpdateScene(sequence.GetObjects(), nullptr);
+    CHECK(previous.rebuiltCount == 500 && previous.reusedCount == 0);
+
+    bool countsMatch = true;
+    bool unchangedShared = true;
+    for (int snapshot = 0; snapshot < 30; snapshot++)
+    {
+        const uint64_t expectedRebuilt = sequence.Next();
+        Update update = UpdateScene(sequence.GetObjects(), previous.cache.get());
+        countsMatch &= update.rebuiltCount == expectedRebuilt;
+        countsMatch &= update.reusedCount + update.rebuiltCount == sequence.GetObjects().size();
+        countsMatch &= update.cache->Size() == sequence.GetObjects().size();
+
+        // The geometry of every object is the one built from its current state, and unchanged objects share it with the last snapshot.
+        for (size_t i = 0; i < sequence.GetObjects().size(); i++)
+        {
+            const SceneObject& object = sequence.GetObjects()[i];
+            const std::shared_ptr<const Geometry>& geometry = update.geometries[i];
+            unchangedShared &= geometry->id == object.id && geometry->vertices == BuildGeometry(object)->vertices;
+            const std::shared_ptr<const Geometry> cached = previous.cache->Find(object.id, object.kind, object.geometryHash);
+            unchangedShared &= !cached || cached == geometry;
+        }
+        previous = std::move(update);
+    }
+    CHECK(countsMatch);
+    CHECK(unchangedShared);
+}
+
+TEST_CASE(SceneObjectCache_RemovedObjectsDropOut)
+{
+    const std::vector<SceneObject> objects = {{1, Kind::Wall, 10, 4}, {2, Kind::World, 11, 100}, {3, Kind::Floor, 12, 4}};
+    const Update first = UpdateScene(objects, nullptr);
+
+    // Object 2 is missing from a snapshot, when it comes back unchanged it is rebuilt, as the cache only holds the last snapshot.
+    const Update second = UpdateScene({objects[0], objects[2]}, first.cache.get());
+    CHECK(second.reusedCount == 2 && second.rebuiltCount == 0);
+    CHECK(!second.cache->Find(2, Kind::World, 11));
+
+    const Update third = UpdateScene(objects, second.cache.get());
+    CHECK(third.reusedCount == 2 && third.rebuiltCount == 1);
+    CHECK(third.geometries[0] == first.geometries[0] && third.geometries[1] != first.geometries[1]);
+}
+
+BENCHMARK(SceneObjectCache_IncrementalUpdates)
+{
+    // Sequences of snapshots of 10k objects, in which a few percent of the objects appear, disappear or change from one snapshot to the
+    // next, updated from scratch and with the cache.
+    std::printf("%10s %10s %12s %12s %14s %14s\n", "objects", "churn %", "reused", "rebuilt", "scratch ms", "cached ms");
+
+    for (size_t objectCount : Tests::BenchmarkSizes({1000, 10000}))
+    {
+        for (uint32_t churn : {1, 5, 20})
+        {
+            SnapshotSequence sequence(objectCount, churn, churn, churn, 5);
+            Update previous = UpdateScene(sequence.GetObjects(), nullptr);
+            const int snapshotCount = Tests::IsSmokeRun() ? 2 : 10;
+            uint64_t reusedCount = 0;
+            uint64_t rebuiltCount = 0;
+            double scratchMilliseconds = 0.0;
+            double cachedMilliseconds = 0.0;
+            for (int snapshot = 0; snapshot < snapshotCount; snapshot++)
+            {
+                sequence.Next();
+                {
+                    Tests::Stopwatch stopwatch;
+                    UpdateScene(sequence.GetObjects(), nullptr);
+                    scratchMilliseconds += stopwatch.ElapsedMilliseconds();
+                }
+
+                Tests::Stopwatch stopwatch;
+                Update update = UpdateScene(sequence.GetObjects(), previous.cache.get());
+                cachedMilliseconds += stopwatch.ElapsedMilliseconds();
+                reusedCount += update.reusedCount;
+                rebuiltCount += update.rebuiltCount;
+                previous = std::move(update);
+            }
+
+            std::printf(
+                "%10zu %10u %12llu %12llu %14.3f %14.3f\n",
+                objectCount,
+                churn,
+                static_cast<unsigned long long>(reusedCount / snapshotCount),
+                static_cast<unsigned long long>(rebuiltCount / snapshotCount),
+                scratchMilliseconds / snapshotCount,
+                cachedMilliseconds / snapshotCount);
+        }
+    }
+}
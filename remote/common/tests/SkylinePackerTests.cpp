@@ -0,0 +1,202 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <SkylinePacker.h>
+
+#include <cstring>
+
+namespace
+{
+    using Rect = SkylinePacker::Rect;
+    using Size = SkylinePacker::Size;
+
+    std::vector<Size> RandomSizes(size_t count, uint32_t minSize, uint32_t maxSize, uint64_t seed)
+    {
+        Tests::Random random(seed);
+        std::vector<Size> sizes(count);
+        for (Size& size : sizes)
+        {
+            size = {minSize + random.Next(maxSize - minSize + 1), minSize + random.Next(maxSize - minSize + 1)};
+        }
+        return sizes;
+    }
+
+    // True if the rectangles are inside the atlas and at least padding apart from each other.
+    bool IsValidPacking(const std::vector<Rect>& rects, uint32_t width, uint32_t height, uint32_t padding)
+    {
+        for (size_t i = 0; i < rects.size(); i++)
+        {
+            const Rect& a = rects[i];
+            if (a.x + a.width > width || a.y + a.height > height)
+            {
+                return false;
+            }
+            for (size_t j = i + 1; j < rects.size(); j++)
+            {
+                const Rect& b = rects[j];
+                const bool apart = a.x + a.width + padding <= b.x || b.x + b.width + padding <= a.x ||
+                                   a.y + a.height + padding <= b.y || b.y + b.height + padding <= a.y;
+                if (!apart)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+} // namespace
+
+TEST_CASE(SkylinePacker_Insert)
+{
+    SkylinePacker packer(100, 50);
+    Rect rect;
+    CHECK(packer.Insert(60, 20, rect) && rect.x == 0 && rect.y == 0);
+    CHECK(packer.Insert(40, 10, rect) && rect.x == 60 && rect.y == 0);
+
+    // The next one goes onto the lower part of the skyline, then the row above is full width.
+    CHECK(packer.Insert(40, 10, rect) && rect.x == 60 && rect.y == 10);
+    CHECK(packer.Insert(100, 30, rect) && rect.x == 0 && rect.y == 20);
+    CHECK(packer.GetUsedHeight() == 50 && packer.GetOccupancy() == 1.0f);
+
+    // Nothing fits anymore, except an empty rectangle.
+    CHECK(!packer.Insert(1, 1, rect));
+    CHECK(packer.Insert(0, 5, rect) && rect.width == 0);
+    CHECK(!SkylinePacker(100, 50).Insert(101, 1, rect));
+    CHECK(!SkylinePacker(100, 50).Insert(1, 51, rect));
+
+    packer.Reset();
+    CHECK(packer.GetUsedHeight() == 0 && packer.GetOccupancy() == 0.0f);
+    CHECK(packer.Insert(100, 50, rect) && rect.x == 0 && rect.y == 0);
+}
+
+TEST_CASE(SkylinePacker_Padding)
+{
+    // Padding separates the rectangles, but is cut off at the edges of the atlas.
+    SkylinePacker packer(20, 20, 2);
+    Rect rect;
+    CHECK(packer.Insert(9, 9, rect) && rect.x == 0 && rect.y == 0);
+    CHECK(packer.Insert(9, 9, rect) && rect.x == 11 && rect.y == 0);
+    CHECK(packer.Insert(20, 9, rect) && rect.x == 0 && rect.y == 11);
+    CHECK(!packer.Insert(1, 1, rect));
+
+    for (uint32_t padding : {0u, 1u, 3u})
+    {
+        const std::vector<Size> sizes = RandomSizes(300, 1, 40, 3 + padding);
+        std::vector<Rect> rects(sizes.size());
+        SkylinePacker randomPacker(512, 4096, padding);
+        CHECK(randomPacker.InsertAll(sizes.data(), static_cast<uint32_t>(sizes.size()), rects.data()));
+        CHECK(IsValidPacking(rects, 512, randomPacker.GetUsedHeight(), padding));
+        bool sizesKept = true;
+        for (size_t i = 0; i < sizes.size(); i++)
+        {
+            sizesKept &= rects[i].width == sizes[i].width && rects[i].height == sizes[i].height;
+        }
+        CHECK(sizesKept);
+    }
+}
+
+TEST_CASE(SkylinePacker_InsertAllPacksTighter)
+{
+    const std::vector<Size> sizes = RandomSizes(1000, 4, 64, 5);
+    std::vector<Rect> rects(sizes.size());
+
+    SkylinePacker sorted(1024, 8192);
+    CHECK(sorted.InsertAll(sizes.data(), static_cast<uint32_t>(sizes.size()), rects.data()));
+
+    SkylinePacker unsorted(1024, 8192);
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        CHECK(unsorted.Insert(sizes[i].width, sizes[i].height, rects[i]));
+    }
+
+    std::printf("    occupancy %.3f sorted, %.3f in any order\n", sorted.GetOccupancy(), unsorted.GetOccupancy());
+    CHECK(sorted.GetUsedHeight() < unsorted.GetUsedHeight());
+    CHECK(sorted.GetOccupancy() > 0.85f);
+
+    // Some don't fit into a small atlas, the others are placed anyway.
+    SkylinePacker small(256, 256);
+    CHECK(!small.InsertAll(sizes.data(), static_cast<uint32_t>(sizes.size()), rects.data()));
+    CHECK(small.GetUsedHeight() <= 256 && small.GetOccupancy() > 0.85f);
+}
+
+TEST_CASE(SkylinePacker_LabelAtlas)
+{
+    // The labels of the scene object kinds, as the renderer lays them out: text of 36 pixels, a few pixels per character, in an atlas
+    // of 512 texels width, 2 texels apart. Before, each label had a texture of its own of 256 x 128 texels.
+    const char* names[] = {"Background", "Wall", "Floor", "Ceiling", "Platform", "Unknown", "World", "Inferred", "CompletelyInferred"};
+    std::vector<Size> sizes;
+    for (const char* name : names)
+    {
+        sizes.push_back({static_cast<uint32_t>(std::strlen(name) * 19), 43});
+    }
+    std::vector<Rect> rects(sizes.size());
+    SkylinePacker packer(512, 512, 2);
+    CHECK(packer.InsertAll(sizes.data(), static_cast<uint32_t>(sizes.size()), rects.data()));
+    CHECK(IsValidPacking(rects, 512, packer.GetUsedHeight(), 2));
+    std::printf(
+        "    %zu labels in 512 x %u texels, %.1f%% of one texture per label\n",
+        sizes.size(),
+        packer.GetUsedHeight(),
+        100.0 * 512 * packer.GetUsedHeight() / (sizes.size() * 256 * 128));
+    CHECK(packer.GetUsedHeight() <= 256);
+
+    // The texture coordinates of the corners.
+    float uvRect[4];
+    SkylinePacker::GetUVRect({128, 64, 64, 32}, 512, 256, uvRect);
+    CHECK(uvRect[0] == 0.25f && uvRect[1] == 0.25f && uvRect[2] == 0.375f && uvRect[3] == 0.375f);
+}
+
+BENCHMARK(SkylinePacker_Throughput)
+{
+    // Rectangles the sizes of labels and of glyphs, packed into atlases which are large enough to hold them all.
+    std::printf("%10s %10s %10s %12s %14s %12s\n", "rects", "sizes", "order", "height", "Mrects/s", "occupancy");
+
+    for (size_t count : Tests::BenchmarkSizes({100, 1000, 10000, 100000}))
+    {
+        for (uint32_t maxSize : {16u, 128u})
+        {
+            const std::vector<Size> sizes = RandomSizes(count, maxSize / 4, maxSize, 7);
+            std::vector<Rect> rects(count);
+            const int repetitions = Tests::IsSmokeRun() ? 1 : static_cast<int>(std::max<size_t>(1, 200000 / count));
+            for (bool sorted : {false, true})
+            {
+                SkylinePacker packer(4096, 1u << 30, 1);
+                Tests::Stopwatch stopwatch;
+                for (int r = 0; r < repetitions; r++)
+                {
+                    packer.Reset();
+                    if (sorted)
+                    {
+                        packer.InsertAll(sizes.data(), static_cast<uint32_t>(count), rects.data());
+                    }
+                    else
+                    {
+                        for (size_t i = 0; i < count; i++)
+                        {
+                            packer.Insert(sizes[i].width, sizes[i].height, rects[i]);
+                        }
+                    }
+                }
+                const double milliseconds = stopwatch.ElapsedMilliseconds() / repetitions;
+                std::printf(
+                    "%10zu %10u %10s %12u %14.3f %12.3f\n",
+                    count,
+                    maxSize,
+                    sorted ? "tallest" : "any",
+                    packer.GetUsedHeight(),
+                    count / (milliseconds * 1000.0),
+                    packer.GetOccupancy());
+            }
+        }
+    }
+}
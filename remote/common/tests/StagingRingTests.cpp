@@ -0,0 +1,215 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <StagingRing.h>
+
+#include <cstring>
+#include <deque>
+
+TEST_CASE(StagingRing_AllocatesAlignedBlocks)
+{
+    StagingRing ring(1024);
+
+    StagingRing::Allocation a = ring.Allocate(10);
+    StagingRing::Allocation b = ring.Allocate(10, 64);
+    REQUIRE(a && b);
+    CHECK(reinterpret_cast<uintptr_t>(b.data) % 64 == reinterpret_cast<uintptr_t>(a.data) % 64);
+    CHECK(b.data - a.data == 64);
+    CHECK(b.size == 10);
+
+    // Zero sized allocations fail.
+    CHECK(!ring.Allocate(0));
+}
+
+TEST_CASE(StagingRing_FailsWhenFullAndRetiresByFence)
+{
+    StagingRing ring(256);
+
+    StagingRing::Allocation a = ring.Allocate(128);
+    StagingRing::Allocation b = ring.Allocate(128);
+    REQUIRE(a && b);
+    CHECK(!ring.Allocate(16));
+    CHECK(ring.GetStatistics().failedAllocationCount == 1);
+
+    ring.Release(a, 5);
+    ring.Retire(4);
+    CHECK(!ring.Allocate(16));
+
+    ring.Retire(5);
+    CHECK(ring.GetStatistics().usedBytes == 128);
+    StagingRing::Allocation c = ring.Allocate(128);
+    REQUIRE(c);
+    CHECK(c.data == a.data);
+}
+
+TEST_CASE(StagingRing_OutOfOrderReleaseWaitsForOlderBlocks)
+{
+    StagingRing ring(256);
+
+    StagingRing::Allocation a = ring.Allocate(64);
+    StagingRing::Allocation b = ring.Allocate(64);
+    REQUIRE(a && b);
+
+    // b is done, but a is still in use, so nothing can be reclaimed yet.
+    ring.Release(b, 1);
+    ring.Retire(1);
+    CHECK(ring.GetStatistics().usedBytes == 128);
+
+    ring.Release(a, 2);
+    ring.Retire(2);
+    CHECK(ring.GetStatistics().usedBytes == 0);
+}
+
+TEST_CASE(StagingRing_NeverSplitsBlocksAtTheEnd)
+{
+    StagingRing ring(256);
+
+    StagingRing::Allocation a = ring.Allocate(160);
+    REQUIRE(a);
+    ring.Release(a, 1);
+
+    StagingRing::Allocation keep = ring.Allocate(16);
+    REQUIRE(keep);
+
+    ring.Retire(1);
+
+    // Only 80 bytes are left at the end of the ring, the block has to start at the beginning.
+    StagingRing::Allocation b = ring.Allocate(120);
+    REQUIRE(b);
+    CHECK(b.data == a.data);
+
+    // The skipped bytes at the end of the ring count as used until b is retired, so there is no room for another large block.
+    CHECK(!ring.Allocate(128));
+}
+
+TEST_CASE(StagingRing_LiveBlocksNeverOverlap)
+{
+    constexpr size_t Capacity = 4096;
+    StagingRing ring(Capacity);
+    Tests::Random random(7);
+
+    struct Live
+    {
+        StagingRing::Allocation allocation;
+        uint8_t pattern;
+        uint64_t fence;
+    };
+    std::deque<Live> live;
+
+    uint8_t* base = nullptr;
+    uint64_t frame = 0;
+    size_t allocated = 0;
+    for (uint32_t step = 0; step < 20000; step++)
+    {
+        const uint32_t size = 1 + random.Next(600);
+        StagingRing::Allocation allocation = ring.Allocate(size, size_t(1) << random.Next(5));
+        if (allocation)
+        {
+            // The ring starts empty, so the first block is at the start of the ring memory.
+            base = base ? base : allocation.data;
+            CHECK(allocation.data >= base && allocation.data + size <= base + Capacity);
+
+            const uint8_t pattern = static_cast<uint8_t>(step);
+            std::memset(allocation.data, pattern, size);
+            live.push_back({allocation, pattern, frame});
+            allocated++;
+        }
+
+        // Submit a frame every few allocations, and let the "GPU" lag two frames behind.
+        if (random.Next(4) == 0)
+        {
+            for (Live& block : live)
+            {
+                if (block.fence == frame)
+                {
+                    bool intact = true;
+                    for (uint32_t i = 0; i < block.allocation.size; i++)
+                    {
+                        intact &= block.allocation.data[i] == block.pattern;
+                    }
+                    CHECK(intact);
+                    ring.Release(block.allocation, frame);
+                }
+            }
+            while (!live.empty() && live.front().fence == frame)
+            {
+                live.pop_front();
+            }
+
+            frame++;
+            if (frame >= 2)
+            {
+                ring.Retire(frame - 2);
+            }
+        }
+    }
+
+    CHECK(allocated > 1000);
+    CHECK(ring.GetStatistics().peakUsedBytes <= Capacity);
+}
+
+BENCHMARK(StagingRing_Throughput)
+{
+    // Mesh sized blocks: a few KB to a few hundred KB, released at the end of each frame and retired two frames later.
+    std::printf("%12s %12s %12s %14s %12s %12s\n", "ring KB", "blocks", "ms", "allocs/ms", "GB/s", "full");
+
+    for (size_t capacity : Tests::BenchmarkSizes({4u << 20, 16u << 20, 64u << 20}))
+    {
+        StagingRing ring(capacity);
+        Tests::Random random(11);
+
+        const size_t blockCount = Tests::IsSmokeRun() ? 1000 : 200000;
+        std::vector<StagingRing::Allocation> frameBlocks;
+        uint64_t frame = 0;
+        uint64_t bytes = 0;
+        size_t done = 0;
+
+        Tests::Stopwatch stopwatch;
+        while (done < blockCount)
+        {
+            if (frameBlocks.size() < 32)
+            {
+                const size_t size = 4096 + random.Next(128 * 1024);
+                StagingRing::Allocation allocation = ring.Allocate(size);
+                if (allocation)
+                {
+                    std::memset(allocation.data, 0x5A, size);
+                    frameBlocks.push_back(allocation);
+                    bytes += size;
+                    done++;
+                    continue;
+                }
+            }
+
+            // End the frame when it is full or the ring ran out of space.
+            for (const StagingRing::Allocation& block : frameBlocks)
+            {
+                ring.Release(block, frame);
+            }
+            frameBlocks.clear();
+
+            frame++;
+            ring.Retire(frame >= 2 ? frame - 2 : 0);
+        }
+        const double milliseconds = stopwatch.ElapsedMilliseconds();
+
+        std::printf(
+            "%12zu %12zu %12.2f %14.1f %12.2f %12llu\n",
+            capacity / 1024,
+            blockCount,
+            milliseconds,
+            blockCount / milliseconds,
+            bytes / (milliseconds * 1.0e6),
+            static_cast<unsigned long long>(ring.GetStatistics().failedAllocationCount));
+    }
+}
@@ -0,0 +1,123 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+// Minimal test and benchmark harness for the platform independent modules in remote/common.
+//
+// TEST_CASE functions run by default and report failed CHECKs. BENCHMARK functions only run when the executable is started with
+// --benchmark, they print their own results. With --smoke, benchmarks only run their smallest problem size, which is what ctest does
+// to keep them compiling and working.
+namespace Tests
+{
+    using TestFunction = void (*)();
+
+    struct Registration
+    {
+        Registration(const char* name, TestFunction function, bool benchmark);
+    };
+
+    void ReportFailure(const char* file, int line, const char* expression);
+
+    // True if benchmarks should only run a quick sanity pass.
+    bool IsSmokeRun();
+
+    // Problem sizes a benchmark should iterate, only the first one in a smoke run.
+    std::vector<size_t> BenchmarkSizes(std::initializer_list<size_t> sizes);
+
+    class Stopwatch
+    {
+    public:
+        Stopwatch()
+            : m_start(std::chrono::steady_clock::now())
+        {
+        }
+
+        double ElapsedMilliseconds() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Small deterministic generator so that tests and benchmarks produce the same data on every run and platform.
+    class Random
+    {
+    public:
+        explicit Random(uint64_t seed = 0x853C49E6748FEA9Bull)
+            : m_state(seed)
+        {
+        }
+
+        uint32_t Next()
+        {
+            m_state = m_state * 6364136223846793005ull + 1442695040888963407ull;
+            return static_cast<uint32_t>(m_state >> 33);
+        }
+
+        // Uniform in [0, bound).
+        uint32_t Next(uint32_t bound)
+        {
+            return static_cast<uint32_t>((static_cast<uint64_t>(Next()) * bound) >> 31);
+        }
+
+        // Uniform in [min, max).
+        float NextFloat(float min, float max)
+        {
+            return min + (max - min) * (static_cast<float>(Next() >> 7) / static_cast<float>(1u << 24));
+        }
+
+    private:
+        uint64_t m_state;
+    };
+} // namespace Tests
+
+#define TEST_CONCAT_IMPL(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_IMPL(a, b)
+
+#define TEST_CASE(name)                                                                                                                    \
+    static void name();                                                                                                                    \
+    static const Tests::Registration TEST_CONCAT(name, Registration)(#name, &name, false);                                                 \
+    static void name()
+
+#define BENCHMARK(name)                                                                                                                    \
+    static void name();                                                                                                                    \
+    static const Tests::Registration TEST_CONCAT(name, Registration)(#name, &name, true);                                                  \
+    static void name()
+
+#define CHECK(expression)                                                                                                                  \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        if (!(expression))                                                                                                                 \
+        {                                                                                                                                  \
+            Tests::ReportFailure(__FILE__, __LINE__, #expression);                                                                         \
+        }                                                                                                                                  \
+    } while (false)
+
+// Like CHECK, but leaves the current test on failure.
+#define REQUIRE(expression)                                                                                                                \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        if (!(expression))                                                                                                                 \
+        {                                                                                                                                  \
+            Tests::ReportFailure(__FILE__, __LINE__, #expression);                                                                         \
+            return;                                                                                                                        \
+        }                                                                                                                                  \
+    } while (false)
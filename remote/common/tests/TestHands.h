@@ -0,0 +1,128 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Synthetic hand poses and the geometry SpatialInputRenderer builds for them: a vertex has a position, a normal and a color, and a joint
+// is drawn as a double pyramid of eight triangles.
+namespace TestHands
+{
+    struct Vertex
+    {
+        float position[3];
+        float normal[3];
+        float color[3];
+    };
+
+    // The 9 floats of a joint as VertexPacking::PackJoints reads them.
+    struct Joint
+    {
+        float position[3];
+        float orientation[4];
+        float length;
+        float radius;
+    };
+
+    constexpr size_t JointVertexCount = 2 * 4 * 3;
+
+    // The source pointer pose and the 26 joints of a hand.
+    constexpr size_t HandJointCount = 1 + 26;
+
+    // Rotates v by the unit quaternion x, y, z, w and adds the translation.
+    inline void Transform(const float* translation, const float* q, const float* v, float* result)
+    {
+        const float t[3] = {
+            2.0f * (q[1] * v[2] - q[2] * v[1]), 2.0f * (q[2] * v[0] - q[0] * v[2]), 2.0f * (q[0] * v[1] - q[1] * v[0])};
+        result[0] = translation[0] + v[0] + q[3] * t[0] + q[1] * t[2] - q[2] * t[1];
+        result[1] = translation[1] + v[1] + q[3] * t[1] + q[2] * t[0] - q[0] * t[2];
+        result[2] = translation[2] + v[2] + q[3] * t[2] + q[0] * t[1] - q[1] * t[0];
+    }
+
+    inline void SetColoredTriangle(const float* p0, const float* p1, const float* p2, const float* color, Vertex* vertices)
+    {
+        const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        float normal[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (float& n : normal)
+        {
+            n /= length;
+        }
+        const float* positions[3] = {p0, p1, p2};
+        for (int i = 0; i < 3; i++)
+        {
+            std::memcpy(vertices[i].position, positions[i], sizeof(vertices[i].position));
+            std::memcpy(vertices[i].normal, normal, sizeof(normal));
+            std::memcpy(vertices[i].color, color, sizeof(vertices[i].color));
+        }
+    }
+
+    // Writes the JointVertexCount vertices of the joint.
+    inline void SetJointVertices(const Joint& joint, Vertex* vertices)
+    {
+        const float centerHeight = std::min(joint.radius, 0.5f * joint.length);
+        const float centerXandY = joint.radius / std::sqrt(2.0f);
+        const float local[6][3] = {
+            {0.0f, 0.0f, 0.0f},
+            {-centerXandY, -centerXandY, -centerHeight},
+            {-centerXandY, +centerXandY, -centerHeight},
+            {+centerXandY, +centerXandY, -centerHeight},
+            {+centerXandY, -centerXandY, -centerHeight},
+            {0.0f, 0.0f, -joint.length}};
+        float p[6][3];
+        for (int i = 0; i < 6; i++)
+        {
+            Transform(joint.position, joint.orientation, local[i], p[i]);
+        }
+        const float colors[8][3] = {
+            {0.0f, 0.0f, 0.4f},
+            {0.0f, 0.4f, 0.0f},
+            {0.4f, 0.0f, 0.0f},
+            {0.4f, 0.4f, 0.0f},
+            {0.0f, 0.0f, 0.6f},
+            {0.0f, 0.6f, 0.0f},
+            {0.6f, 0.0f, 0.0f},
+            {0.6f, 0.6f, 0.0f}};
+        for (int i = 0; i < 4; i++)
+        {
+            SetColoredTriangle(p[0], p[1 + i], p[1 + (i + 1) % 4], colors[i], vertices + 3 * i);
+            SetColoredTriangle(p[5], p[1 + (i + 1) % 4], p[1 + i], colors[4 + i], vertices + 3 * (4 + i));
+        }
+    }
+
+    // Synthetic poses of the joints of the hands, which move a little from frame to frame.
+    inline void GetHandJoints(size_t handCount, int frame, Joint* joints)
+    {
+        for (size_t hand = 0; hand < handCount; hand++)
+        {
+            for (size_t i = 0; i < HandJointCount; i++)
+            {
+                Joint& joint = joints[hand * HandJointCount + i];
+                const float angle = 0.01f * frame + 0.2f * i;
+                joint.position[0] = 0.3f * hand + 0.02f * (i % 5);
+                joint.position[1] = 0.01f * std::sin(angle);
+                joint.position[2] = -0.5f - 0.02f * (i / 5);
+                joint.orientation[0] = 0.0f;
+                joint.orientation[1] = std::sin(angle / 2);
+                joint.orientation[2] = 0.0f;
+                joint.orientation[3] = std::cos(angle / 2);
+                joint.radius = i == 0 ? 0.01f : 0.008f;
+                joint.length = i == 0 ? 1.0f : 2 * joint.radius;
+            }
+        }
+    }
+} // namespace TestHands
@@ -0,0 +1,108 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <cstring>
+#include <string>
+
+namespace
+{
+    struct RegisteredFunction
+    {
+        const char* name;
+        Tests::TestFunction function;
+        bool benchmark;
+    };
+
+    std::vector<RegisteredFunction>& Registry()
+    {
+        static std::vector<RegisteredFunction> registry;
+        return registry;
+    }
+
+    size_t g_failureCount = 0;
+    bool g_smokeRun = false;
+} // namespace
+
+namespace Tests
+{
+    Registration::Registration(const char* name, TestFunction function, bool benchmark)
+    {
+        Registry().push_back({name, function, benchmark});
+    }
+
+    void ReportFailure(const char* file, int line, const char* expression)
+    {
+        std::printf("%s(%d): CHECK failed: %s\n", file, line, expression);
+        g_failureCount++;
+    }
+
+    bool IsSmokeRun()
+    {
+        return g_smokeRun;
+    }
+
+    std::vector<size_t> BenchmarkSizes(std::initializer_list<size_t> sizes)
+    {
+        std::vector<size_t> result(sizes);
+        if (g_smokeRun && !result.empty())
+        {
+            result.resize(1);
+        }
+        return result;
+    }
+} // namespace Tests
+
+// Usage: HolographicCommonTests [--benchmark] [--smoke] [name filter]
+int main(int argc, char** argv)
+{
+    bool runBenchmarks = false;
+    std::string filter;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--benchmark") == 0)
+        {
+            runBenchmarks = true;
+        }
+        else if (std::strcmp(argv[i], "--smoke") == 0)
+        {
+            g_smokeRun = true;
+        }
+        else
+        {
+            filter = argv[i];
+        }
+    }
+
+    size_t runCount = 0;
+    size_t failedCount = 0;
+    for (const RegisteredFunction& entry : Registry())
+    {
+        if (entry.benchmark != runBenchmarks || (!filter.empty() && std::string(entry.name).find(filter) == std::string::npos))
+        {
+            continue;
+        }
+
+        std::printf("[ RUN  ] %s\n", entry.name);
+        const size_t failuresBefore = g_failureCount;
+        entry.function();
+        const bool passed = g_failureCount == failuresBefore;
+        std::printf("[ %s ] %s\n", passed ? " OK " : "FAIL", entry.name);
+        std::fflush(stdout);
+
+        runCount++;
+        failedCount += passed ? 0 : 1;
+    }
+
+    std::printf("%zu of %zu %s passed\n", runCount - failedCount, runCount, runBenchmarks ? "benchmarks" : "tests");
+    return failedCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "TestFramework.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Synthetic meshes in the format spatial mapping produces: int16 SNORM positions (x, y, z, w) with a per mesh scale and 16 bit indices.
+namespace TestMeshes
+{
+    struct Mesh
+    {
+        std::vector<int16_t> positions;
+        std::vector<uint16_t> indices;
+        float scale[3] = {1.0f, 1.0f, 1.0f};
+
+        uint32_t GetVertexCount() const
+        {
+            return static_cast<uint32_t>(positions.size() / 4);
+        }
+
+        void GetPosition(uint32_t vertex, float* position) const
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                position[k] = positions[vertex * 4 + k] / 32767.0f * scale[k];
+            }
+        }
+    };
+
+    // Wall of size x size meters made of columns x rows quads, with random bumps of up to noise meters along z.
+    inline Mesh MakeGrid(uint32_t columns, uint32_t rows, float size, float noise, uint64_t seed = 1)
+    {
+        Mesh mesh;
+        Tests::Random random(seed);
+
+        // Leave room for the noise, so it never clips.
+        const float halfSize = size * 0.5f;
+        mesh.scale[0] = mesh.scale[1] = halfSize;
+        mesh.scale[2] = std::max(noise, 0.001f);
+
+        for (uint32_t y = 0; y <= rows; y++)
+        {
+            for (uint32_t x = 0; x <= columns; x++)
+            {
+                const float px = (static_cast<float>(x) / columns) * 2.0f - 1.0f;
+                const float py = (static_cast<float>(y) / rows) * 2.0f - 1.0f;
+                const float pz = noise > 0.0f ? random.NextFloat(-1.0f, 1.0f) : 0.0f;
+                mesh.positions.push_back(static_cast<int16_t>(std::lround(px * 32767.0f)));
+                mesh.positions.push_back(static_cast<int16_t>(std::lround(py * 32767.0f)));
+                mesh.positions.push_back(static_cast<int16_t>(std::lround(pz * 32767.0f)));
+                mesh.positions.push_back(32767);
+            }
+        }
+
+        for (uint32_t y = 0; y < rows; y++)
+        {
+            for (uint32_t x = 0; x < columns; x++)
+            {
+                const uint16_t v0 = static_cast<uint16_t>(y * (columns + 1) + x);
+                const uint16_t v1 = static_cast<uint16_t>(v0 + 1);
+                const uint16_t v2 = static_cast<uint16_t>(v0 + columns + 1);
+                const uint16_t v3 = static_cast<uint16_t>(v2 + 1);
+                mesh.indices.insert(mesh.indices.end(), {v0, v1, v2, v2, v1, v3});
+            }
+        }
+
+        return mesh;
+    }
+
+    // Randomizes the order of the triangles, keeping the winding of each.
+    inline void ShuffleTriangles(std::vector<uint16_t>& indices, uint64_t seed = 1)
+    {
+        Tests::Random random(seed);
+        const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        for (uint32_t i = triangleCount; i > 1; i--)
+        {
+            const uint32_t j = random.Next(i);
+            if (j != i - 1)
+            {
+                std::swap_ranges(indices.begin() + (i - 1) * 3, indices.begin() + i * 3, indices.begin() + j * 3);
+            }
+        }
+    }
+} // namespace TestMeshes
@@ -0,0 +1,292 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <TlsfAllocator.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    struct LiveAllocation
+    {
+        TlsfAllocator::Allocation allocation;
+        uint32_t size;
+        uint32_t alignment;
+        uint8_t pattern;
+    };
+
+    // Checks that all live allocations are inside the capacity, aligned and disjoint.
+    bool AllocationsAreDisjoint(const TlsfAllocator& allocator, const std::vector<LiveAllocation>& live)
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        for (const LiveAllocation& entry : live)
+        {
+            const uint32_t offset = allocator.GetOffset(entry.allocation);
+            if (offset % entry.alignment != 0 || offset + entry.size > allocator.GetCapacity() ||
+                allocator.GetSize(entry.allocation) != entry.size)
+            {
+                return false;
+            }
+            ranges.push_back({offset, offset + entry.size});
+        }
+
+        std::sort(ranges.begin(), ranges.end());
+        for (size_t i = 1; i < ranges.size(); i++)
+        {
+            if (ranges[i].first < ranges[i - 1].second)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace
+
+TEST_CASE(TlsfAllocator_AllocateFreeCoalesce)
+{
+    TlsfAllocator allocator(1024);
+
+    TlsfAllocator::Allocation a = allocator.Allocate(100);
+    TlsfAllocator::Allocation b = allocator.Allocate(200);
+    TlsfAllocator::Allocation c = allocator.Allocate(300);
+    REQUIRE(a && b && c);
+    CHECK(allocator.GetStatistics().usedSize == 600);
+    CHECK(allocator.GetStatistics().allocationCount == 3);
+
+    // Freeing the middle block leaves two free blocks, freeing its neighbors merges everything back into one.
+    allocator.Free(b);
+    CHECK(allocator.GetStatistics().freeBlockCount == 2);
+    allocator.Free(a);
+    allocator.Free(c);
+
+    const TlsfAllocator::Statistics statistics = allocator.GetStatistics();
+    CHECK(statistics.usedSize == 0);
+    CHECK(statistics.freeBlockCount == 1);
+    CHECK(statistics.largestFreeBlock == 1024);
+    CHECK(statistics.FragmentationRatio() == 0.0f);
+}
+
+TEST_CASE(TlsfAllocator_FailsWhenNoBlockFits)
+{
+    TlsfAllocator allocator(1000);
+
+    CHECK(!allocator.Allocate(1001));
+
+    TlsfAllocator::Allocation a = allocator.Allocate(400);
+    TlsfAllocator::Allocation b = allocator.Allocate(200);
+    TlsfAllocator::Allocation c = allocator.Allocate(400);
+    REQUIRE(a && b && c);
+    allocator.Free(a);
+    allocator.Free(c);
+
+    // 800 units are free, but the largest free block only has 400.
+    CHECK(!allocator.Allocate(500));
+    CHECK(allocator.GetStatistics().FragmentationRatio() > 0.4f);
+
+    allocator.Grow(1500);
+    CHECK(allocator.Allocate(500));
+}
+
+TEST_CASE(TlsfAllocator_Alignment)
+{
+    TlsfAllocator allocator(4096, 16);
+
+    TlsfAllocator::Allocation a = allocator.Allocate(3);
+    TlsfAllocator::Allocation b = allocator.Allocate(100, 256);
+    REQUIRE(a && b);
+    CHECK(allocator.GetOffset(b) % 256 == 0);
+    CHECK(allocator.GetSize(b) == 100);
+
+    CHECK(allocator.GetStatistics().alignmentWaste == 0);
+
+    // The padding in front of b became a free block of its own and can be used.
+    TlsfAllocator::Allocation c = allocator.Allocate(200);
+    REQUIRE(c);
+    CHECK(allocator.GetOffset(c) < allocator.GetOffset(b));
+}
+
+TEST_CASE(TlsfAllocator_SlackBelowMinBlockSizeIsWaste)
+{
+    TlsfAllocator allocator(4096, 16);
+
+    // Only 6 units would be left, which is less than the min block size, so they stay attached to the allocation.
+    TlsfAllocator::Allocation a = allocator.Allocate(4090);
+    REQUIRE(a);
+    CHECK(allocator.GetSize(a) == 4090);
+    CHECK(allocator.GetStatistics().alignmentWaste == 6);
+    CHECK(allocator.GetStatistics().usedSize == 4096);
+
+    allocator.Free(a);
+    CHECK(allocator.GetStatistics().alignmentWaste == 0);
+}
+
+TEST_CASE(TlsfAllocator_RandomChurn)
+{
+    constexpr uint32_t Capacity = 1u << 20;
+    TlsfAllocator allocator(Capacity, 4);
+    Tests::Random random(3);
+
+    std::vector<LiveAllocation> live;
+    uint32_t failed = 0;
+    for (uint32_t step = 0; step < 20000; step++)
+    {
+        if (live.empty() || random.Next(5) < 3)
+        {
+            const uint32_t size = 1 + random.Next(8192);
+            const uint32_t alignment = 1u << random.Next(7);
+            TlsfAllocator::Allocation allocation = allocator.Allocate(size, alignment);
+            if (allocation)
+            {
+                live.push_back({allocation, size, alignment, 0});
+            }
+            else
+            {
+                failed++;
+            }
+        }
+        else
+        {
+            const size_t index = random.Next(static_cast<uint32_t>(live.size()));
+            allocator.Free(live[index].allocation);
+            live[index] = live.back();
+            live.pop_back();
+        }
+
+        if (step % 1000 == 0)
+        {
+            CHECK(AllocationsAreDisjoint(allocator, live));
+        }
+    }
+
+    CHECK(AllocationsAreDisjoint(allocator, live));
+    CHECK(allocator.GetStatistics().allocationCount == live.size());
+    CHECK(failed > 0);
+
+    for (const LiveAllocation& entry : live)
+    {
+        allocator.Free(entry.allocation);
+    }
+    CHECK(allocator.GetStatistics().freeBlockCount == 1);
+    CHECK(allocator.GetStatistics().largestFreeBlock == Capacity);
+}
+
+TEST_CASE(TlsfAllocator_DefragmentKeepsData)
+{
+    constexpr uint32_t Capacity = 64 * 1024;
+    TlsfAllocator allocator(Capacity);
+    std::vector<uint8_t> memory(Capacity);
+    Tests::Random random(5);
+
+    std::vector<LiveAllocation> live;
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        const uint32_t size = 1 + random.Next(300);
+        const uint32_t alignment = 1u << random.Next(5);
+        TlsfAllocator::Allocation allocation = allocator.Allocate(size, alignment);
+        REQUIRE(allocation);
+        const uint8_t pattern = static_cast<uint8_t>(i + 1);
+        std::memset(memory.data() + allocator.GetOffset(allocation), pattern, size);
+        live.push_back({allocation, size, alignment, pattern});
+    }
+
+    // Free every other allocation to leave holes.
+    std::vector<LiveAllocation> kept;
+    for (size_t i = 0; i < live.size(); i++)
+    {
+        if (i % 2 == 0)
+        {
+            allocator.Free(live[i].allocation);
+        }
+        else
+        {
+            kept.push_back(live[i]);
+        }
+    }
+    CHECK(allocator.GetStatistics().FragmentationRatio() > 0.0f);
+
+    // Relocations are in address order and only move data to the front, so copying them in order is safe.
+    const std::vector<TlsfAllocator::Relocation> relocations = allocator.Defragment();
+    CHECK(relocations.size() == kept.size());
+    for (const TlsfAllocator::Relocation& relocation : relocations)
+    {
+        CHECK(relocation.destinationOffset <= relocation.sourceOffset);
+        std::memmove(memory.data() + relocation.destinationOffset, memory.data() + relocation.sourceOffset, relocation.size);
+    }
+
+    CHECK(AllocationsAreDisjoint(allocator, kept));
+    for (const LiveAllocation& entry : kept)
+    {
+        const uint8_t* data = memory.data() + allocator.GetOffset(entry.allocation);
+        CHECK(std::all_of(data, data + entry.size, [&](uint8_t value) { return value == entry.pattern; }));
+    }
+
+    const TlsfAllocator::Statistics statistics = allocator.GetStatistics();
+    CHECK(statistics.freeBlockCount >= 1);
+    CHECK(statistics.largestFreeBlock + statistics.usedSize >= Capacity - statistics.freeBlockCount * 32);
+}
+
+BENCHMARK(TlsfAllocator_Churn)
+{
+    // Vertex arena sized like the renderer's: parts between a few hundred and a few thousand vertices, constantly replaced.
+    std::printf("%10s %12s %12s %12s %14s %12s\n", "live parts", "operations", "ms", "ops/ms", "fragmentation", "waste");
+
+    for (size_t partCount : Tests::BenchmarkSizes({1000, 4000, 16000}))
+    {
+        const uint32_t capacity = static_cast<uint32_t>(partCount * 4096);
+        TlsfAllocator allocator(capacity, 64);
+        Tests::Random random(9);
+
+        std::vector<TlsfAllocator::Allocation> live;
+        live.reserve(partCount);
+        for (size_t i = 0; i < partCount; i++)
+        {
+            live.push_back(allocator.Allocate(64 + random.Next(4000), 16));
+        }
+
+        const size_t operationCount = Tests::IsSmokeRun() ? 10000 : 2000000;
+        uint32_t failed = 0;
+        Tests::Stopwatch stopwatch;
+        for (size_t i = 0; i < operationCount; i++)
+        {
+            // Replace a random part with a new one of a different size.
+            TlsfAllocator::Allocation& entry = live[random.Next(static_cast<uint32_t>(live.size()))];
+            if (entry)
+            {
+                allocator.Free(entry);
+            }
+            entry = allocator.Allocate(64 + random.Next(4000), 16);
+            failed += entry ? 0 : 1;
+        }
+        const double milliseconds = stopwatch.ElapsedMilliseconds();
+
+        const TlsfAllocator::Statistics statistics = allocator.GetStatistics();
+        std::printf(
+            "%10zu %12zu %12.2f %12.1f %14.3f %12u\n",
+            partCount,
+            operationCount,
+            milliseconds,
+            2.0 * operationCount / milliseconds,
+            statistics.FragmentationRatio(),
+            statistics.alignmentWaste);
+
+        Tests::Stopwatch defragmentStopwatch;
+        const size_t relocationCount = allocator.Defragment().size();
+        std::printf(
+            "%10s defragment of %zu allocations: %.2f ms, %u failed allocations\n",
+            "",
+            relocationCount,
+            defragmentStopwatch.ElapsedMilliseconds(),
+            failed);
+    }
+}
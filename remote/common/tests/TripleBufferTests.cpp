@@ -0,0 +1,192 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+
+#include <TripleBuffer.h>
+
+#include <algorithm>
+#include <thread>
+
+// The stress tests are meant to be run with ThreadSanitizer as well, see HOLOGRAPHIC_COMMON_TSAN in CMakeLists.txt.
+
+namespace
+{
+    // Large enough that a torn read would be very likely to show up as a mix of two sequence numbers.
+    struct Mesh
+    {
+        uint64_t sequence = 0;
+        std::vector<uint64_t> payload;
+    };
+
+    void WriteMesh(Mesh& mesh, uint64_t sequence)
+    {
+        mesh.sequence = sequence;
+        mesh.payload.assign(256 + sequence % 64, sequence);
+    }
+
+    bool IsConsistent(const Mesh& mesh)
+    {
+        return mesh.payload.size() == 256 + mesh.sequence % 64 &&
+               std::all_of(mesh.payload.begin(), mesh.payload.end(), [&](uint64_t value) { return value == mesh.sequence; });
+    }
+} // namespace
+
+TEST_CASE(TripleBuffer_HandsOverLatestValue)
+{
+    TripleBuffer<int> buffer;
+    CHECK(!buffer.HasPublished());
+    CHECK(!buffer.Acquire());
+
+    buffer.GetWriteSlot() = 1;
+    buffer.Publish();
+    CHECK(buffer.HasPublished());
+    CHECK(buffer.Acquire());
+    CHECK(buffer.GetReadSlot() == 1);
+    CHECK(!buffer.HasPublished());
+
+    // Nothing new, the read slot stays.
+    CHECK(!buffer.Acquire());
+    CHECK(buffer.GetReadSlot() == 1);
+
+    // Older values are skipped.
+    buffer.GetWriteSlot() = 2;
+    buffer.Publish();
+    buffer.GetWriteSlot() = 3;
+    buffer.Publish();
+    CHECK(buffer.Acquire());
+    CHECK(buffer.GetReadSlot() == 3);
+
+    // The producer never gets the slot the consumer is reading.
+    buffer.GetWriteSlot() = 4;
+    CHECK(buffer.GetReadSlot() == 3);
+}
+
+TEST_CASE(TripleBuffer_SlotsAreDistinct)
+{
+    TripleBuffer<int> buffer;
+    for (int i = 0; i < 100; i++)
+    {
+        buffer.GetWriteSlot() = i;
+        buffer.Publish();
+        if (i % 3 == 0)
+        {
+            CHECK(buffer.Acquire());
+            CHECK(buffer.GetReadSlot() == i);
+            CHECK(&buffer.GetReadSlot() != &buffer.GetWriteSlot());
+        }
+    }
+
+    int count = 0;
+    buffer.ForEachSlot([&](int&) { count++; });
+    CHECK(count == 3);
+}
+
+TEST_CASE(TripleBuffer_StressProducerConsumer)
+{
+    TripleBuffer<Mesh> buffer;
+    constexpr uint64_t PublishCount = 200000;
+
+    std::thread producer([&] {
+        for (uint64_t sequence = 1; sequence <= PublishCount; sequence++)
+        {
+            WriteMesh(buffer.GetWriteSlot(), sequence);
+            buffer.Publish();
+        }
+    });
+
+    // The consumer plays the render thread: it picks up whatever is newest, and must never see a torn or an older value.
+    uint64_t lastSequence = 0;
+    uint64_t acquireCount = 0;
+    bool consistent = true;
+    bool monotonic = true;
+    while (lastSequence < PublishCount)
+    {
+        if (buffer.Acquire())
+        {
+            const Mesh& mesh = buffer.GetReadSlot();
+            consistent &= IsConsistent(mesh);
+            monotonic &= mesh.sequence > lastSequence;
+            lastSequence = mesh.sequence;
+            acquireCount++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    CHECK(consistent);
+    CHECK(monotonic);
+    CHECK(lastSequence == PublishCount);
+    CHECK(acquireCount > 0);
+}
+
+BENCHMARK(TripleBuffer_HandoffLatency)
+{
+    // The producer publishes a timestamp at a fixed rate, the consumer polls and measures how old the value is when it sees it.
+    std::printf("%12s %12s %12s %12s %12s\n", "publishes", "acquired", "avg us", "max us", "publish ns");
+
+    struct Stamp
+    {
+        std::chrono::steady_clock::time_point time;
+        uint64_t sequence = 0;
+    };
+
+    for (size_t publishCount : Tests::BenchmarkSizes({1000, 100000}))
+    {
+        TripleBuffer<Stamp> buffer;
+        std::atomic<bool> done = false;
+        double publishNanoseconds = 0.0;
+
+        std::thread producer([&] {
+            Tests::Stopwatch stopwatch;
+            for (uint64_t sequence = 1; sequence <= publishCount; sequence++)
+            {
+                buffer.GetWriteSlot() = {std::chrono::steady_clock::now(), sequence};
+                buffer.Publish();
+
+                // Roughly one mesh every few microseconds, much faster than any real surface update rate.
+                const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(5);
+                while (std::chrono::steady_clock::now() < until)
+                {
+                }
+            }
+            publishNanoseconds = stopwatch.ElapsedMilliseconds() * 1.0e6 / publishCount;
+            done = true;
+        });
+
+        uint64_t acquired = 0;
+        double totalLatency = 0.0;
+        double maxLatency = 0.0;
+        while (!done || buffer.HasPublished())
+        {
+            if (buffer.Acquire())
+            {
+                const double latency =
+                    std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - buffer.GetReadSlot().time).count();
+                totalLatency += latency;
+                maxLatency = std::max(maxLatency, latency);
+                acquired++;
+            }
+        }
+        producer.join();
+
+        std::printf(
+            "%12zu %12llu %12.2f %12.2f %12.1f\n",
+            publishCount,
+            static_cast<unsigned long long>(acquired),
+            acquired > 0 ? totalLatency / acquired : 0.0,
+            maxLatency,
+            publishNanoseconds);
+    }
+}
@@ -0,0 +1,339 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestFramework.h"
+#include "TestHands.h"
+
+#include <VertexPacking.h>
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    using VertexPacking::PackedJoint;
+    using VertexPacking::PackedVertex;
+    using VertexPacking::Quantization;
+
+    // Vertices of a room sized scene: a position within the bounds, a checkerboard uv, and a color in [0, 1] per kind of object.
+    std::vector<float> MakeVertices(size_t count, uint64_t seed)
+    {
+        Tests::Random random(seed);
+        std::vector<float> vertices(count * 8);
+        for (size_t i = 0; i < count; i++)
+        {
+            float* vertex = &vertices[i * 8];
+            vertex[0] = random.NextFloat(-6.0f, 6.0f);
+            vertex[1] = random.NextFloat(-1.5f, 1.5f);
+            vertex[2] = random.NextFloat(-8.0f, 4.0f);
+            vertex[3] = random.NextFloat(0.0f, 12.0f);
+            vertex[4] = random.NextFloat(0.0f, 12.0f);
+            vertex[5] = random.NextFloat(0.0f, 1.0f);
+            vertex[6] = random.NextFloat(0.0f, 1.0f);
+            vertex[7] = random.NextFloat(0.0f, 1.0f);
+        }
+        return vertices;
+    }
+
+    Quantization GetQuantization(const std::vector<float>& vertices)
+    {
+        float minimum[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+        float maximum[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        VertexPacking::ExtendBounds(vertices.data(), vertices.size() / 8, minimum, maximum);
+        return VertexPacking::GetQuantization(minimum, maximum);
+    }
+
+    // Joints of random poses, with normalized orientations, and the sizes of hand joints.
+    std::vector<TestHands::Joint> MakeJoints(size_t count, uint64_t seed)
+    {
+        Tests::Random random(seed);
+        std::vector<TestHands::Joint> joints(count);
+        for (TestHands::Joint& joint : joints)
+        {
+            float squaredLength = 0.0f;
+            for (int i = 0; i < 4; i++)
+            {
+                joint.orientation[i] = random.NextFloat(-1.0f, 1.0f);
+                squaredLength += joint.orientation[i] * joint.orientation[i];
+            }
+            for (int i = 0; i < 4; i++)
+            {
+                joint.orientation[i] /= std::sqrt(squaredLength);
+            }
+            for (int i = 0; i < 3; i++)
+            {
+                joint.position[i] = random.NextFloat(-2.0f, 2.0f);
+            }
+            joint.radius = random.NextFloat(0.004f, 0.02f);
+            joint.length = 2 * joint.radius;
+        }
+        return joints;
+    }
+} // namespace
+
+TEST_CASE(VertexPacking_HalfConversion)
+{
+    using VertexPacking::FloatToHalf;
+    using VertexPacking::HalfToFloat;
+
+    CHECK(FloatToHalf(0.0f) == 0x0000 && FloatToHalf(-0.0f) == 0x8000);
+    CHECK(FloatToHalf(1.0f) == 0x3c00 && FloatToHalf(-2.0f) == 0xc000);
+    CHECK(FloatToHalf(65504.0f) == 0x7bff);
+    CHECK(FloatToHalf(1.0e5f) == 0x7c00 && FloatToHalf(-1.0e5f) == 0xfc00);
+    CHECK(FloatToHalf(std::numeric_limits<float>::infinity()) == 0x7c00);
+    CHECK(std::isnan(HalfToFloat(FloatToHalf(std::numeric_limits<float>::quiet_NaN()))));
+
+    // The smallest subnormal, and ties round to even.
+    CHECK(FloatToHalf(5.9604645e-8f) == 0x0001);
+    CHECK(FloatToHalf(1.0f + 1.0f / 2048.0f) == 0x3c00);
+    CHECK(FloatToHalf(1.0f + 3.0f / 2048.0f) == 0x3c02);
+
+    // Every half survives the round trip through float.
+    bool roundTrip = true;
+    for (uint32_t bits = 0; bits < 0x10000; bits++)
+    {
+        const uint16_t half = static_cast<uint16_t>(bits);
+        if ((half & 0x7c00) != 0x7c00 || (half & 0x03ff) == 0)
+        {
+            roundTrip &= FloatToHalf(HalfToFloat(half)) == half;
+        }
+    }
+    CHECK(roundTrip);
+}
+
+TEST_CASE(VertexPacking_ErrorBounds)
+{
+    const std::vector<float> vertices = MakeVertices(10001, 3);
+    const size_t count = vertices.size() / 8;
+    const Quantization quantization = GetQuantization(vertices);
+    std::vector<PackedVertex> packed(count);
+    VertexPacking::PackVertices(vertices.data(), count, quantization, packed.data());
+
+    // Positions within half a step, uvs within the precision of a half float, colors within half of an 8 bit step.
+    float positionError = 0.0f;
+    float uvError = 0.0f;
+    float colorError = 0.0f;
+    bool padding = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        const float* vertex = &vertices[i * 8];
+        const PackedVertex& p = packed[i];
+        for (int k = 0; k < 3; k++)
+        {
+            const float position = p.position[k] / 32767.0f * quantization.extent[k] + quantization.origin[k];
+            positionError = std::max(positionError, std::abs(position - vertex[k]) / (quantization.extent[k] / 32767.0f));
+            colorError = std::max(colorError, std::abs(p.color[k] - vertex[5 + k] * 255.0f));
+        }
+        for (int k = 0; k < 2; k++)
+        {
+            const float uv = VertexPacking::HalfToFloat(p.uv[k]);
+            uvError = std::max(uvError, std::abs(uv - vertex[3 + k]) / std::max(std::abs(vertex[3 + k]), 1.0f / 16384.0f));
+        }
+        padding &= p.position[3] == 0 && p.color[3] == 255;
+    }
+    std::printf("    position %.3f steps, uv %.2e relative, color %.3f steps\n", positionError, uvError, colorError);
+    CHECK(positionError <= 0.5f + 1.0e-2f);
+    CHECK(uvError <= 1.0f / 2048.0f);
+    CHECK(colorError <= 0.5f + 1.0e-3f);
+    CHECK(padding);
+}
+
+TEST_CASE(VertexPacking_VectorAndScalarAgree)
+{
+    // The vector code packs pairs of vertices, the scalar code the last one of an odd count, so packing one vertex at a time goes
+    // through the scalar code only. Include the corners of the bounds, colors out of range and uvs beyond the half range.
+    std::vector<float> vertices = MakeVertices(999, 5);
+    const float extremes[][8] = {
+        {-6.0f, -1.5f, -8.0f, 0.0f, 0.0f, -0.5f, 1.5f, 0.5f},
+        {6.0f, 1.5f, 4.0f, 70000.0f, -1.0e-7f, 0.0f, 1.0f, 0.998f},
+        {0.0f, 0.0f, -2.0f, 0.5f, 0.25f, 0.001960784f, 0.5f, 1.0f}};
+    for (const float* extreme : extremes)
+    {
+        vertices.insert(vertices.begin() + 8 * (vertices.size() / 16), extreme, extreme + 8);
+    }
+    const size_t count = vertices.size() / 8;
+    const Quantization quantization = GetQuantization(vertices);
+
+    std::vector<PackedVertex> batch(count);
+    VertexPacking::PackVertices(vertices.data(), count, quantization, batch.data());
+    std::vector<PackedVertex> single(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        VertexPacking::PackVertices(&vertices[i * 8], 1, quantization, &single[i]);
+    }
+    CHECK(std::memcmp(batch.data(), single.data(), count * sizeof(PackedVertex)) == 0);
+
+    // The bounds also agree with the scalar code, which the last vertex of the batch goes through.
+    float minimum[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float maximum[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (size_t i = 0; i < count; i++)
+    {
+        VertexPacking::ExtendBounds(&vertices[i * 8], 1, minimum, maximum);
+    }
+    const Quantization scalarQuantization = VertexPacking::GetQuantization(minimum, maximum);
+    CHECK(std::memcmp(&scalarQuantization, &quantization, sizeof(Quantization)) == 0);
+    CHECK(minimum[0] == -6.0f && maximum[2] == 4.0f);
+}
+
+TEST_CASE(VertexPacking_DegenerateBounds)
+{
+    // A flat floor and an empty batch still get an extent which the positions can be divided by.
+    const float floor[2][8] = {{-1.0f, 0.0f, 2.0f, 0, 0, 0, 0, 0}, {1.0f, 0.0f, 3.0f, 0, 0, 0, 0, 0}};
+    float minimum[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float maximum[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    const Quantization empty = VertexPacking::GetQuantization(minimum, maximum);
+    CHECK(empty.extent[0] > 0.0f && empty.extent[1] > 0.0f && empty.extent[2] > 0.0f);
+
+    VertexPacking::ExtendBounds(&floor[0][0], 2, minimum, maximum);
+    const Quantization quantization = VertexPacking::GetQuantization(minimum, maximum);
+    CHECK(quantization.origin[0] == 0.0f && quantization.origin[2] == 2.5f && quantization.extent[0] == 1.0f);
+    CHECK(quantization.extent[1] > 0.0f);
+
+    PackedVertex packed[2];
+    VertexPacking::PackVertices(&floor[0][0], 2, quantization, packed);
+    CHECK(packed[0].position[0] == -32767 && packed[1].position[0] == 32767 && packed[0].position[1] == 0);
+}
+
+BENCHMARK(VertexPacking_Throughput)
+{
+    // Scene geometry of up to 10M vertices: the bounds and the packing, in batches and one vertex at a time, which only uses the scalar
+    // code, and the memory of the vertices before and after.
+    std::printf(
+        "%10s %12s %12s %14s %14s %12s %12s\n", "vertices", "bounds ms", "pack ms", "scalar ms", "Mvertices/s", "float MB", "packed MB");
+
+    for (size_t count : Tests::BenchmarkSizes({10000, 1000000, 10000000}))
+    {
+        const std::vector<float> vertices = MakeVertices(count, 7);
+        std::vector<PackedVertex> packed(count);
+        const int repetitions = Tests::IsSmokeRun() ? 1 : static_cast<int>(std::max<size_t>(1, 20000000 / count));
+
+        Quantization quantization = {};
+        Tests::Stopwatch bounds;
+        for (int r = 0; r < repetitions; r++)
+        {
+            quantization = GetQuantization(vertices);
+        }
+        const double boundsMilliseconds = bounds.ElapsedMilliseconds() / repetitions;
+
+        Tests::Stopwatch pack;
+        for (int r = 0; r < repetitions; r++)
+        {
+            VertexPacking::PackVertices(vertices.data(), count, quantization, packed.data());
+        }
+        const double packMilliseconds = pack.ElapsedMilliseconds() / repetitions;
+
+        Tests::Stopwatch scalar;
+        for (int r = 0; r < repetitions; r++)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                VertexPacking::PackVertices(&vertices[i * 8], 1, quantization, &packed[i]);
+            }
+        }
+        const double scalarMilliseconds = scalar.ElapsedMilliseconds() / repetitions;
+
+        std::printf(
+            "%10zu %12.3f %12.3f %14.3f %14.1f %12.1f %12.1f\n",
+            count,
+            boundsMilliseconds,
+            packMilliseconds,
+            scalarMilliseconds,
+            count / (packMilliseconds * 1000.0),
+            count * 8 * sizeof(float) / 1048576.0,
+            count * sizeof(PackedVertex) / 1048576.0);
+    }
+}
+
+TEST_CASE(VertexPacking_PackJoints)
+{
+    // Include orientations at the ends of the range, the pointer pose of length 1, and sizes which are subnormal half floats.
+    std::vector<TestHands::Joint> joints = MakeJoints(999, 9);
+    joints[10] = {{0.0f, 1.0f, -1.0f}, {-1.0f, 0.0f, 0.0f, 0.0f}, 1.0f, 0.01f};
+    joints[11] = {{1.0e6f, -1.0e-6f, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f}, 0.0f, 1.0e-5f};
+    static_assert(sizeof(TestHands::Joint) == 9 * sizeof(float));
+    const size_t count = joints.size();
+
+    std::vector<PackedJoint> batch(count);
+    VertexPacking::PackJoints(&joints[0].position[0], count, batch.data());
+
+    // Positions are kept, orientations are SNORM rounded to the nearest value, and the sizes are half floats.
+    bool positionsKept = true;
+    bool orientationsRounded = true;
+    bool sizesConverted = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        positionsKept &= std::memcmp(batch[i].position, joints[i].position, sizeof(batch[i].position)) == 0;
+        for (int k = 0; k < 4; k++)
+        {
+            const float error = std::abs(batch[i].orientation[k] / 32767.0f - joints[i].orientation[k]);
+            orientationsRounded &= error <= 0.5f / 32767.0f + 1.0e-7f && batch[i].orientation[k] >= -32767;
+        }
+        sizesConverted &= batch[i].size[0] == VertexPacking::FloatToHalf(joints[i].length) &&
+                          batch[i].size[1] == VertexPacking::FloatToHalf(joints[i].radius);
+    }
+    CHECK(positionsKept && orientationsRounded && sizesConverted);
+    CHECK(batch[10].orientation[0] == -32767 && batch[10].orientation[1] == 0 && batch[11].orientation[3] == 32767);
+    CHECK(batch[10].size[0] == 0x3c00 && batch[11].size[0] == 0 && batch[11].size[1] != 0);
+
+    // The vector code packs pairs of joints, the scalar code the last one of an odd count.
+    std::vector<PackedJoint> single(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        VertexPacking::PackJoints(&joints[i].position[0], 1, &single[i]);
+    }
+    CHECK(std::memcmp(batch.data(), single.data(), count * sizeof(PackedJoint)) == 0);
+}
+
+BENCHMARK(VertexPacking_JointInstances)
+{
+    // The joints of 2 hands and of 100 for a stress test, each with its pointer pose: the bytes uploaded and the CPU time per frame, for
+    // the 24 vertices of each joint built on the CPU and for one packed instance per joint of the static prototype mesh.
+    std::printf("%8s %8s %12s %14s %14s %12s %12s\n", "hands", "joints", "vertex KB", "instance KB", "expand us", "pack us", "speedup");
+
+    for (size_t handCount : {size_t(2), size_t(100)})
+    {
+        const size_t jointCount = handCount * TestHands::HandJointCount;
+        std::vector<TestHands::Joint> joints(jointCount);
+        std::vector<TestHands::Vertex> vertices(jointCount * TestHands::JointVertexCount);
+        std::vector<PackedJoint> packed(jointCount);
+        const int frameCount = Tests::IsSmokeRun() ? 10 : static_cast<int>(std::max<size_t>(100, 500000 / jointCount));
+
+        double expandMilliseconds = 0.0;
+        double packMilliseconds = 0.0;
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            TestHands::GetHandJoints(handCount, frame, joints.data());
+
+            Tests::Stopwatch expand;
+            for (size_t i = 0; i < jointCount; i++)
+            {
+                TestHands::SetJointVertices(joints[i], &vertices[i * TestHands::JointVertexCount]);
+            }
+            expandMilliseconds += expand.ElapsedMilliseconds();
+
+            Tests::Stopwatch pack;
+            VertexPacking::PackJoints(&joints[0].position[0], jointCount, packed.data());
+            packMilliseconds += pack.ElapsedMilliseconds();
+        }
+
+        std::printf(
+            "%8zu %8zu %12.1f %14.2f %14.2f %12.2f %11.1fx\n",
+            handCount,
+            jointCount,
+            vertices.size() * sizeof(TestHands::Vertex) / 1024.0,
+            packed.size() * sizeof(PackedJoint) / 1024.0,
+            expandMilliseconds * 1000.0 / frameCount,
+            packMilliseconds * 1000.0 / frameCount,
+            expandMilliseconds / packMilliseconds);
+    }
+}
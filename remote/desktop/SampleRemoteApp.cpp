@@ -583,6 +583,9 @@ void SampleRemoteApp::Render(HolographicFrame holographicFrame)
                             ID3D11RenderTargetView* const targets[1] = {pCameraResources->GetBackBufferRenderTargetView()};
                             context->OMSetRenderTargets(1, targets, pCameraResources->GetDepthStencilView());
 
+                            // Rasterize the spatial surfaces, the holograms behind them are not drawn.
+                            RenderOccluders(cameraPose, coordinateSystem, pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
+
                             // Render the scene objects.
                             m_spinningCubeRenderer->Render(pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
 
@@ -590,12 +593,12 @@ void SampleRemoteApp::Render(HolographicFrame holographicFrame)
                             m_simpleCubeRenderer->Render(pCameraResources->IsRenderingStereoscopic());
 #endif
 
-                            m_sceneUnderstandingRenderer->Render(pCameraResources->IsRenderingStereoscopic());
+                            m_sceneUnderstandingRenderer->Render(pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
                             m_qrCodeRenderer->Render(pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
 
                             if (m_spatialSurfaceMeshRenderer)
                             {
-                                m_spatialSurfaceMeshRenderer->Render(pCameraResources->IsRenderingStereoscopic());
+                                m_spatialSurfaceMeshRenderer->Render(pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
                             }
                             m_spatialInputRenderer->Render(pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
 
@@ -819,6 +822,10 @@ void SampleRemoteApp::CreateHolographicSpaceAndDeviceResources()
 
     m_qrCodeRenderer = std::make_unique<QRCodeRenderer>(m_deviceResources);
 
+    m_occlusionCuller = std::make_shared<OcclusionCuller>();
+    m_spinningCubeRenderer->SetOcclusionCuller(m_occlusionCuller);
+    m_qrCodeRenderer->SetOcclusionCuller(m_occlusionCuller);
+
     m_locator = SpatialLocator::GetDefault();
 
     // Be able to respond to changes in the positional tracking state.
@@ -1039,7 +1046,9 @@ void SampleRemoteApp::InitializeAccessToFeatures()
 
     // If not in standalone mode the spatial surface renderer needs to get recreated on every connect, because its SpatialSurfaceObserver
     // stops working on disconnect. Uncomment the line below to render spatial surfaces. This creates the SpatialSurfaceMeshRenderer and
-    // requests access from the SpatialSurfaceObserver.
+    // requests access from the SpatialSurfaceObserver. Pass a file path as second argument to keep computed meshes in a cache file, so
+    // that surfaces which did not change are shown right away after reconnecting, e.g. std::filesystem::temp_directory_path() /
+    // L"SRMeshCache.bin".
     // m_spatialSurfaceMeshRenderer = std::make_unique<SpatialSurfaceMeshRenderer>(m_deviceResources);
 }
 
@@ -1141,6 +1150,34 @@ void SampleRemoteApp::ToggleSceneUnderstanding()
     });
 }
 
+void SampleRemoteApp::RenderOccluders(
+    const HolographicCameraPose& cameraPose,
+    const SpatialCoordinateSystem& coordinateSystem,
+    bool isStereo,
+    const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum)
+{
+    float4x4 viewProjections[OcclusionCuller::MaxViewCount];
+    uint32_t viewCount = 0;
+    if (m_spatialSurfaceMeshRenderer)
+    {
+        if (auto viewTransform = cameraPose.TryGetViewTransform(coordinateSystem))
+        {
+            const HolographicStereoTransform view = viewTransform.Value();
+            const HolographicStereoTransform projection = cameraPose.ProjectionTransform();
+            viewProjections[0] = view.Left * projection.Left;
+            viewProjections[1] = view.Right * projection.Right;
+            viewCount = isStereo ? 2 : 1;
+        }
+    }
+
+    // The depth buffers are cleared in any case, so that no occluders of a previous frame are left.
+    m_occlusionCuller->BeginFrame(viewCount, &viewProjections[0].m11);
+    if (viewCount > 0)
+    {
+        m_spatialSurfaceMeshRenderer->RenderOccluders(*m_occlusionCuller, cullingFrustum);
+    }
+}
+
 winrt::fire_and_forget SampleRemoteApp::RequestQRCodeWatcherUpdates()
 {
     auto weakThis = weak_from_this();
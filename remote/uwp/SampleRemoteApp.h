@@ -138,6 +138,14 @@ private:
     // Compute scene update and toggle rendering mode.
     void ToggleSceneUnderstanding();
 
+    // Rasterizes the spatial surfaces of one camera into the occlusion culler, which the holograms are tested against. Without the
+    // SpatialSurfaceMeshRenderer there are no occluders and nothing is culled.
+    void RenderOccluders(
+        const winrt::Windows::Graphics::Holographic::HolographicCameraPose& cameraPose,
+        const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& coordinateSystem,
+        bool isStereo,
+        const winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum>& cullingFrustum);
+
     // Clears event registration state. Used when changing to a new HolographicSpace
     // and when tearing down SampleRemoteApp.
     void UnregisterHolographicEventHandlers();
@@ -220,6 +228,9 @@ private:
     // Renders qr codes.
     std::unique_ptr<QRCodeRenderer> m_qrCodeRenderer;
 
+    // Culls the holograms hidden behind the spatial surfaces.
+    std::shared_ptr<OcclusionCuller> m_occlusionCuller;
+
     // Event registration tokens.
     winrt::event_token m_cameraAddedToken;
     winrt::event_token m_cameraRemovedToken;